@@ -0,0 +1,105 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "JobPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Tools {
+
+JobPool::JobPool(size_t threadCount) :
+  m_generation(0), m_activeWorkers(0), m_stop(false), m_job(nullptr), m_jobCount(0), m_nextJob(0), m_firstFailedJob(0) {
+  if (threadCount == 0) {
+    threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  for (size_t i = 1; i < threadCount; ++i) {
+    m_workers.emplace_back(&JobPool::workerLoop, this);
+  }
+}
+
+JobPool::~JobPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_haveWork.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+size_t JobPool::threadCount() const {
+  return m_workers.size() + 1;
+}
+
+size_t JobPool::run(size_t jobCount, const Job& job) {
+  std::lock_guard<std::mutex> runLock(m_runMutex);
+
+  m_job = &job;
+  m_jobCount = jobCount;
+  m_nextJob = 0;
+  m_firstFailedJob = jobCount;
+
+  if (m_workers.empty() || jobCount < 2) {
+    processJobs();
+  } else {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_activeWorkers = m_workers.size();
+      ++m_generation;
+    }
+
+    m_haveWork.notify_all();
+    processJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this] { return m_activeWorkers == 0; });
+  }
+
+  m_job = nullptr;
+  return m_firstFailedJob;
+}
+
+void JobPool::workerLoop() {
+  uint64_t generation = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_haveWork.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+    if (m_stop) {
+      return;
+    }
+
+    generation = m_generation;
+    lock.unlock();
+    processJobs();
+    lock.lock();
+
+    assert(m_activeWorkers != 0);
+    if (--m_activeWorkers == 0) {
+      m_workDone.notify_one();
+    }
+  }
+}
+
+void JobPool::processJobs() {
+  const Job& job = *m_job;
+  for (;;) {
+    size_t index = m_nextJob++;
+    // jobs after an already known failure can't change the result
+    if (index >= m_jobCount || index > m_firstFailedJob) {
+      return;
+    }
+
+    if (!job(index)) {
+      size_t firstFailed = m_firstFailedJob;
+      while (index < firstFailed && !m_firstFailedJob.compare_exchange_weak(firstFailed, index)) {
+      }
+    }
+  }
+}
+
+}
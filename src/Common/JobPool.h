@@ -0,0 +1,55 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tools {
+
+// Runs indexed jobs on a fixed set of worker threads that live as long as the pool, so callers don't start threads
+// for every batch. Threads take the next unclaimed index until none are left, the calling thread works too.
+// threadCount == 0 means one thread per CPU core.
+class JobPool {
+public:
+  typedef std::function<bool(size_t)> Job;
+
+  explicit JobPool(size_t threadCount = 0);
+  ~JobPool();
+
+  JobPool(const JobPool&) = delete;
+  JobPool& operator=(const JobPool&) = delete;
+
+  size_t threadCount() const;
+
+  // Calls job(i) for every i in [0, jobCount) and returns the smallest index for which job returned false, or
+  // jobCount if all jobs succeeded. Jobs after a known failure may be skipped. Concurrent calls are serialized.
+  size_t run(size_t jobCount, const Job& job);
+
+private:
+  std::vector<std::thread> m_workers;
+  std::mutex m_runMutex;
+  std::mutex m_mutex;
+  std::condition_variable m_haveWork;
+  std::condition_variable m_workDone;
+  uint64_t m_generation;
+  size_t m_activeWorkers;
+  bool m_stop;
+
+  const Job* m_job;
+  size_t m_jobCount;
+  std::atomic<size_t> m_nextJob;
+  std::atomic<size_t> m_firstFailedJob;
+
+  void workerLoop();
+  void processJobs();
+};
+
+}
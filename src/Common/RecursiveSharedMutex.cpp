@@ -0,0 +1,93 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "RecursiveSharedMutex.h"
+
+#include <cassert>
+#include <unordered_map>
+
+namespace Tools {
+
+namespace {
+
+thread_local std::unordered_map<const RecursiveSharedMutex*, size_t> readDepths;
+
+}
+
+RecursiveSharedMutex::RecursiveSharedMutex() : m_writerDepth(0), m_readers(0), m_waitingWriters(0) {
+}
+
+void RecursiveSharedMutex::lock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_writerDepth != 0 && m_writer == std::this_thread::get_id()) {
+    ++m_writerDepth;
+    return;
+  }
+
+  assert(readDepths.find(this) == readDepths.end() && "upgrade of shared ownership is not supported");
+
+  ++m_waitingWriters;
+  m_writerCanEnter.wait(lock, [this] { return m_writerDepth == 0 && m_readers == 0; });
+  --m_waitingWriters;
+
+  m_writer = std::this_thread::get_id();
+  m_writerDepth = 1;
+}
+
+void RecursiveSharedMutex::unlock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  assert(m_writerDepth != 0 && m_writer == std::this_thread::get_id());
+  if (--m_writerDepth != 0) {
+    return;
+  }
+
+  m_writer = std::thread::id();
+  if (m_waitingWriters != 0) {
+    m_writerCanEnter.notify_one();
+  } else {
+    m_readersCanEnter.notify_all();
+  }
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_writerDepth != 0 && m_writer == std::this_thread::get_id()) {
+    // shared ownership requested by the writer is a nested exclusive ownership
+    ++m_writerDepth;
+    return;
+  }
+
+  size_t& depth = localReadDepth();
+  if (depth == 0) {
+    m_readersCanEnter.wait(lock, [this] { return m_writerDepth == 0 && m_waitingWriters == 0; });
+  }
+
+  ++depth;
+  ++m_readers;
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_writerDepth != 0 && m_writer == std::this_thread::get_id()) {
+    assert(m_writerDepth > 1);
+    --m_writerDepth;
+    return;
+  }
+
+  auto it = readDepths.find(this);
+  assert(it != readDepths.end() && m_readers != 0);
+  if (--it->second == 0) {
+    readDepths.erase(it);
+  }
+
+  if (--m_readers == 0 && m_waitingWriters != 0) {
+    m_writerCanEnter.notify_one();
+  }
+}
+
+size_t& RecursiveSharedMutex::localReadDepth() {
+  return readDepths[this];
+}
+
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace Tools {
+
+// Reader/writer lock that may be re-entered by the thread that already holds it.
+// A thread holding exclusive ownership may take it again in either mode, a thread holding shared
+// ownership may take it again in shared mode. Upgrading shared ownership to exclusive is not supported.
+// Waiting writers block new readers, but never readers that already hold the lock.
+class RecursiveSharedMutex {
+public:
+  RecursiveSharedMutex();
+  RecursiveSharedMutex(const RecursiveSharedMutex&) = delete;
+  RecursiveSharedMutex& operator=(const RecursiveSharedMutex&) = delete;
+
+  void lock();
+  void unlock();
+
+  void lock_shared();
+  void unlock_shared();
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_readersCanEnter;
+  std::condition_variable m_writerCanEnter;
+  std::thread::id m_writer;
+  size_t m_writerDepth;
+  size_t m_readers;
+  size_t m_waitingWriters;
+
+  size_t& localReadDepth();
+};
+
+class SharedLockGuard {
+public:
+  explicit SharedLockGuard(RecursiveSharedMutex& mutex) : m_mutex(mutex) {
+    m_mutex.lock_shared();
+  }
+
+  ~SharedLockGuard() {
+    m_mutex.unlock_shared();
+  }
+
+  SharedLockGuard(const SharedLockGuard&) = delete;
+  SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+private:
+  RecursiveSharedMutex& m_mutex;
+};
+
+}
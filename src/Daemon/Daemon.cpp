@@ -47,6 +47,9 @@ namespace
   const command_line::arg_descriptor<bool>        arg_testnet_on  = {"testnet", "Used to deploy test nets. Checkpoints and hardcoded seeds are ignored, "
     "network id is changed. Use it with --data-dir flag. The wallet must be launched with --testnet flag.", false};
   const command_line::arg_descriptor<bool>        arg_print_genesis_tx = { "print-genesis-tx", "Prints genesis' block tx hex to insert it to config and exits" };
+#ifdef __linux__
+  const command_line::arg_descriptor<std::string> arg_io_backend  = {"io-backend", "Network I/O backend: epoll or io_uring", "epoll"};
+#endif
 }
 
 bool command_line_preprocessor(const boost::program_options::variables_map& vm, LoggerRef& logger);
@@ -110,6 +113,9 @@ int main(int argc, char* argv[])
     command_line::add_arg(desc_cmd_sett, arg_console);
     command_line::add_arg(desc_cmd_sett, arg_testnet_on);
     command_line::add_arg(desc_cmd_sett, arg_print_genesis_tx);
+#ifdef __linux__
+    command_line::add_arg(desc_cmd_sett, arg_io_backend);
+#endif
 
     RpcServerConfig::initOptions(desc_cmd_sett);
     CoreConfig::initOptions(desc_cmd_sett);
@@ -228,11 +234,29 @@ int main(int argc, char* argv[])
       }
     }
 
+#ifdef __linux__
+    System::Dispatcher::Backend ioBackend = System::Dispatcher::Backend::EPOLL;
+    std::string ioBackendName = command_line::get_arg(vm, arg_io_backend);
+    if (ioBackendName == "io_uring") {
+      ioBackend = System::Dispatcher::Backend::IO_URING;
+    } else if (ioBackendName != "epoll") {
+      logger(ERROR, BRIGHT_RED) << "Unknown I/O backend: " << ioBackendName;
+      return 1;
+    }
+
+    System::Dispatcher dispatcher(ioBackend);
+    if (dispatcher.getBackend() != ioBackend) {
+      logger(WARNING, BRIGHT_YELLOW) << "io_uring is not available, falling back to epoll";
+    }
+#else
     System::Dispatcher dispatcher;
+#endif
 
     Fortress::FortressProtocolHandler cprotocol(currency, dispatcher, ccore, nullptr, logManager);
     Fortress::NodeServer p2psrv(dispatcher, cprotocol, logManager);
-    Fortress::RpcServer rpcServer(dispatcher, logManager, ccore, p2psrv, cprotocol);
+    // rpc is served by its own threads, so slow requests do not delay peer messages
+    System::DispatcherGroup rpcDispatchers(rpcConfig.threads);
+    Fortress::RpcServer rpcServer(rpcDispatchers.getDispatcher(0), rpcDispatchers, logManager, ccore, p2psrv, cprotocol);
 
     cprotocol.set_p2p_endpoint(&p2psrv);
     ccore.set_Fortress_protocol(&cprotocol);
@@ -266,8 +290,8 @@ int main(int argc, char* argv[])
       dch.start_handling();
     }
 
-    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
-    rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort);
+    logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress() << " with " << rpcConfig.threads << " thread(s)";
+    System::remoteInvoke(dispatcher, rpcDispatchers.getDispatcher(0), [&] { rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort); });
     logger(INFO) << "Core rpc server started ok";
 
     Tools::SignalHandler::install([&dch, &p2psrv] {
@@ -283,7 +307,8 @@ int main(int argc, char* argv[])
 
     //stop components
     logger(INFO) << "Stopping core rpc server...";
-    rpcServer.stop();
+    // p2p dispatcher keeps running meanwhile, requests in progress may still read p2p state
+    System::remoteInvoke(dispatcher, rpcDispatchers.getDispatcher(0), [&] { rpcServer.stop(); });
 
     //deinitialize components
     logger(INFO) << "Deinitializing core...";
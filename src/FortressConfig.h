@@ -65,10 +65,14 @@ const size_t   FUSION_TX_MIN_IN_OUT_COUNT_RATIO              = 4;
 
 const char     Fortress_BLOCKS_FILENAME[]                  = "blocks.dat";
 const char     Fortress_BLOCKINDEXES_FILENAME[]            = "blockindexes.dat";
+const char     Fortress_BLOCKSTORE_FILENAME[]              = "blockstore";
+const char     Fortress_BLOCKSTORE_INDEX_FILENAME[]        = "blockstoreindex.dat";
+const char     Fortress_OUTPUTSTORE_FILENAME[]             = "outputstore";
 const char     Fortress_BLOCKSCACHE_FILENAME[]             = "blockscache.dat";
 const char     Fortress_POOLDATA_FILENAME[]                = "poolstate.bin";
 const char     P2P_NET_DATA_FILENAME[]                       = "p2pstate.bin";
 const char     Fortress_BLOCKCHAIN_INDICES_FILENAME[]      = "blockchainindices.dat";
+const char     Fortress_BLOCKCHAIN_JOURNAL_FILENAME[]      = "blockchainjournal.dat";
 const char     MINER_CONFIG_FILE_NAME[]                      = "miner_conf.json";
 } // parameters
 
@@ -82,7 +86,12 @@ const uint8_t  BLOCK_MINOR_VERSION_0                         =  0;
 
 const size_t   BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT        =  10000;  //by default, blocks ids count in synchronizing
 const size_t   BLOCKS_SYNCHRONIZING_DEFAULT_COUNT            =  200;    //by default, blocks count in blocks downloading
+const size_t   BLOCKS_SYNCHRONIZING_PEER_REQUESTS            =  2;      //block requests sent to one peer at once
+const size_t   BLOCKS_SYNCHRONIZING_MAX_RANGES               =  16;     //requests of blocks downloaded ahead of the blockchain
+const uint32_t BLOCKS_SYNCHRONIZING_TIMEOUT                  =  30;     //seconds, blocks of slower peers are requested from others
 const size_t   COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT         =  1000;
+const size_t   COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES_MAX_COUNT = 10000;
+const uint32_t COMMAND_RPC_WAIT_NODE_STATUS_MAX_TIMEOUT      =  60000;  //milliseconds
 
 //TODO This port will be used by the daemon to establish connections with p2p network
 const int      P2P_DEFAULT_PORT                              = 1478;
@@ -102,6 +111,11 @@ const uint32_t P2P_DEFAULT_CONNECTION_TIMEOUT                = 5000;          //
 const uint32_t P2P_DEFAULT_PING_CONNECTION_TIMEOUT           = 2000;          // 2 seconds
 const uint64_t P2P_DEFAULT_INVOKE_TIMEOUT                    = 60 * 2 * 1000; // 2 minutes
 const size_t   P2P_DEFAULT_HANDSHAKE_INVOKE_TIMEOUT          = 5000;          // 5 seconds
+const size_t   P2P_TX_INVENTORY_MAX_COUNT                    = 1000;          // hashes in one announcement or request
+const size_t   P2P_TX_RELAY_MAX_RATE                         = 1000;          // transactions a peer may make us fetch, send unasked or request from us per second
+const size_t   P2P_KNOWN_TXS_MAX_COUNT                       = 50000;         // transactions remembered as known by a peer
+const uint32_t P2P_TX_REQUEST_TIMEOUT                        = 10;            // seconds before a requested transaction is asked from another peer
+const size_t   P2P_ANNOUNCED_TXS_MAX_COUNT                   = 50000;         // transactions announced to us and waiting to be fetched
 const char     P2P_STAT_TRUSTED_PUB_KEY[]                    = "8f80f9a5a434a9f1510d13336228debfee9c918ce505efe225d8c94d045fa115";
 
 //TODO Add here your network seed nodes
@@ -5,14 +5,22 @@
 #include "Blockchain.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdio>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <boost/filesystem/operations.hpp>
 #include <boost/foreach.hpp>
+#include <boost/scope_exit.hpp>
 #include "Common/Math.h"
-#include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Serialization/BinarySerializationTools.h"
+#include "FortressCore/SwappedVector.h"
 #include "FortressTools.h"
 
 using namespace Logging;
@@ -30,6 +38,19 @@ std::string appendPath(const std::string& path, const std::string& fileName) {
   return result;
 }
 
+bool saveBinaryFile(const std::string& fileName, const Fortress::BinaryArray& data) {
+  std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+  file.flush();
+  return static_cast<bool>(file);
+}
+
+const uint32_t REBUILD_BATCH_SIZE = 256;
+const char REBUILD_CHECKPOINT_SUFFIX[] = ".rebuild";
+const std::chrono::minutes REBUILD_CHECKPOINT_INTERVAL(5);
+const std::chrono::seconds REBUILD_PROGRESS_INTERVAL(10);
+const std::chrono::minutes JOURNAL_COMPACTION_INTERVAL(10);
+
 }
 
 namespace std {
@@ -42,7 +63,7 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 3
 #define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
 
 namespace Fortress {
@@ -113,8 +134,9 @@ void serialize(Blockchain::TransactionIndex& value, ISerializer& s) {
 class BlockCacheSerializer {
 
 public:
-  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
+  // A cache loaded with acceptChainPrefix may end at any block of the stored chain, not only at lastBlockHash
+  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger, bool acceptChainPrefix = false) :
+    m_bs(bs), m_lastBlockHash(lastBlockHash), m_acceptChainPrefix(acceptChainPrefix), m_loaded(false), logger(logger, "BlockCacheSerializer") {
   }
 
   void load(const std::string& filename) {
@@ -165,10 +187,11 @@ public:
       Crypto::Hash blockHash;
       s(blockHash, "last_block");
 
-      if (blockHash != m_lastBlockHash) {
+      if (blockHash != m_lastBlockHash && !m_acceptChainPrefix) {
         return;
       }
 
+      m_lastBlockHash = blockHash;
     } else {
       operation = "- saving ";
       s(m_lastBlockHash, "last_block");
@@ -176,6 +199,10 @@ public:
 
     logger(INFO) << operation << "block index...";
     s(m_bs.m_blockIndex, "block_index");
+    if (s.type() == ISerializer::INPUT && m_acceptChainPrefix && !isStoredChainPrefix()) {
+      m_bs.m_blockIndex.clear();
+      return;
+    }
 
     logger(INFO) << operation << "transaction map...";
     s(m_bs.m_transactionMap, "transactions");
@@ -185,6 +212,17 @@ public:
 
     logger(INFO) << operation << "outputs...";
     s(m_bs.m_outputs, "outputs");
+    // entries appended after the cache was stored belong to blocks that are merged again
+    uint64_t outputEntryCount = m_bs.m_outputEntries.size();
+    s(outputEntryCount, "output_entries");
+    if (s.type() == ISerializer::INPUT) {
+      if (outputEntryCount > m_bs.m_outputEntries.size()) {
+        logger(WARNING) << "output store is shorter than the cache expects";
+        return;
+      }
+
+      m_bs.m_outputEntries.resize(outputEntryCount);
+    }
 
     logger(INFO) << operation << "multi-signature outputs...";
     s(m_bs.m_multisignatureOutputs, "multisig_outputs");
@@ -206,6 +244,18 @@ private:
   bool m_loaded;
   Blockchain& m_bs;
   Crypto::Hash m_lastBlockHash;
+  bool m_acceptChainPrefix;
+
+  bool isStoredChainPrefix() const {
+    uint64_t height = m_bs.m_blockIndex.size();
+    if (height == 0 || height > m_bs.m_blocks.size() || m_bs.m_blockIndex.getTailId() != m_lastBlockHash) {
+      return false;
+    }
+
+    Blockchain::BlockHeaderEntry header;
+    m_bs.m_blocks.load(height - 1, header);
+    return get_block_hash(header.bl) == m_lastBlockHash;
+  }
 };
 
 class BlockchainIndicesSerializer {
@@ -306,13 +356,21 @@ m_currency(currency),
 m_tx_pool(tx_pool),
 m_current_block_cumul_sz_limit(0),
 m_is_in_checkpoint_zone(false),
-m_checkpoints(logger) {
+m_checkpoints(logger),
+m_difficultyWindow(currency.difficultyBlocksCount()),
+m_randomOutputs(static_cast<uint32_t>(currency.minedMoneyUnlockWindow())),
+m_nextDifficultyValid(false),
+m_stopJournalCompaction(false) {
 
   m_outputs.set_deleted_key(0);
   Crypto::KeyImage nullImage = boost::value_initialized<decltype(nullImage)>();
   m_spent_keys.set_deleted_key(nullImage);
 }
 
+Blockchain::~Blockchain() {
+  stopJournalCompaction();
+}
+
 bool Blockchain::addObserver(IBlockchainStorageObserver* observer) {
   return m_observerManager.add(observer);
 }
@@ -321,11 +379,11 @@ bool Blockchain::removeObserver(IBlockchainStorageObserver* observer) {
   return m_observerManager.remove(observer);
 }
 
-bool Blockchain::checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock) {
+bool Blockchain::checkTransactionInputs(const Fortress::CachedTransaction& tx, BlockInfo& maxUsedBlock) {
   return checkTransactionInputs(tx, maxUsedBlock.height, maxUsedBlock.id);
 }
 
-bool Blockchain::checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) {
+bool Blockchain::checkTransactionInputs(const Fortress::CachedTransaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) {
 
   BlockInfo tail;
 
@@ -381,17 +439,17 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return  m_spent_keys.find(key_im) != m_spent_keys.end();
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_blocks.size());
 }
 
@@ -404,30 +462,54 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   m_config_folder = config_folder;
 
-  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), 1024)) {
+  if (!m_blocks.open(appendPath(config_folder, m_currency.blockStoreFileName()), appendPath(config_folder, m_currency.blockStoreIndexFileName()), 1024)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open block store in " << config_folder;
+    return false;
+  }
+
+  if (!m_outputEntries.open(appendPath(config_folder, m_currency.outputStoreFileName()))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open output store in " << config_folder;
+    return false;
+  }
+
+  if (load_existing && !migrateLegacyBlocks()) {
+    return false;
+  }
+
+  std::vector<BinaryArray> journalRecords;
+  if (!m_journal.open(appendPath(config_folder, m_currency.blockchainJournalFileName()), journalRecords)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open blockchain journal in " << config_folder;
     return false;
   }
 
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
-    BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
-    loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
+    if (!recoverFromJournal(journalRecords)) {
+      BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
+      loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
 
-    if (!loader.loaded()) {
-      logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
-      rebuildCache();
-    }
+      if (!loader.loaded()) {
+        logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
+        rebuildCache();
+      }
 
-    loadBlockchainIndices();
+      loadBlockchainIndices();
+      compactJournal();
+    }
   } else {
     m_blocks.clear();
+    m_outputEntries.clear();
+    m_journal.reset(NULL_HASH);
   }
 
+  rebuildDifficultyWindow();
+  rebuildRandomOutputsIndex();
+
   if (m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    pushBlock(m_currency.genesisBlock(), bvc);
+    pushBlock(CachedBlock(m_currency.genesisBlock()), bvc);
     if (bvc.m_verifivation_failed) {
       logger(ERROR, BRIGHT_RED) << "Failed to add genesis block to blockchain";
       return false;
@@ -454,74 +536,466 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     << "Blockchain initialized. last block: " << m_blocks.size() - 1 << ", "
     << Common::timeIntervalToString(timestamp_diff)
     << " time ago, current difficulty: " << getDifficultyForNextBlock();
+
+  stopJournalCompaction();
+  m_stopJournalCompaction = false;
+  m_journalCompactionThread = std::thread([this] { journalCompactionLoop(); });
+  return true;
+}
+
+bool Blockchain::migrateLegacyBlocks() {
+  std::string blocksFileName = appendPath(m_config_folder, m_currency.blocksFileName());
+  std::string indexesFileName = appendPath(m_config_folder, m_currency.blockIndexesFileName());
+  boost::system::error_code ec;
+  if (!boost::filesystem::exists(blocksFileName, ec) || !boost::filesystem::exists(indexesFileName, ec)) {
+    return true;
+  }
+
+  // Legacy files are removed only after all of their blocks are in the block store,
+  // so an interrupted migration resumes from the last copied block.
+  {
+    SwappedVector<BlockEntry> legacyBlocks;
+    if (!legacyBlocks.open(blocksFileName, indexesFileName, 1)) {
+      logger(ERROR, BRIGHT_RED) << "Failed to open " << blocksFileName << " for migration";
+      return false;
+    }
+
+    if (m_blocks.size() > legacyBlocks.size()) {
+      logger(ERROR, BRIGHT_RED) << "Block store is ahead of " << blocksFileName << ", remove one of them to continue";
+      return false;
+    }
+
+    // the legacy files may have been replaced since the migration was interrupted, copied blocks are kept only if they match
+    if (!m_blocks.empty()) {
+      uint64_t tail = m_blocks.size() - 1;
+      BlockHeaderEntry header;
+      m_blocks.load(tail, header);
+      if (get_block_hash(header.bl) != get_block_hash(legacyBlocks[tail].bl)) {
+        logger(WARNING, BRIGHT_YELLOW) << "Block store does not match " << blocksFileName << " at height " << tail << ", restarting migration";
+        m_blocks.clear();
+      }
+    }
+
+    logger(INFO, BRIGHT_WHITE) << "Migrating " << legacyBlocks.size() << " blocks from " << blocksFileName << " to the block store...";
+    for (uint64_t b = m_blocks.size(); b < legacyBlocks.size(); ++b) {
+      if (b % 10000 == 0) {
+        logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << legacyBlocks.size();
+      }
+
+      m_blocks.push_back(legacyBlocks[b]);
+    }
+  }
+
+  m_blocks.flush();
+  boost::filesystem::remove(blocksFileName, ec);
+  boost::filesystem::remove(indexesFileName, ec);
+  logger(INFO, BRIGHT_WHITE) << "Block migration finished";
   return true;
 }
 
+void Blockchain::rebuildDifficultyWindow() {
+  // the genesis block never takes part in difficulty calculation
+  uint32_t begin = static_cast<uint32_t>(m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_difficultyWindow.capacity())));
+  m_difficultyWindow.clear(std::max<uint32_t>(begin, 1));
+  for (uint32_t height = m_difficultyWindow.beginHeight(); height < m_blocks.size(); ++height) {
+    BlockHeaderEntry header;
+    m_blocks.load(height, header);
+    m_difficultyWindow.push(header.bl.timestamp, header.cumulative_difficulty);
+  }
+}
+
+void Blockchain::rebuildRandomOutputsIndex() {
+  m_randomOutputs.clear();
+  for (const auto& amountOutputs : m_outputs) {
+    for (uint64_t entryIndex : amountOutputs.second) {
+      const OutputIndexEntry& output = m_outputEntries[entryIndex];
+      m_randomOutputs.push(amountOutputs.first, output.transactionIndex.block, mayStayLockedWhenMature(output.unlockTime, output.transactionIndex.block));
+    }
+  }
+
+  m_randomOutputs.setChainSize(static_cast<uint32_t>(m_blocks.size()));
+}
+
+struct Blockchain::RebuildBatch {
+  uint32_t firstHeight;
+  std::vector<BlockEntry> blocks;
+  std::vector<Crypto::Hash> blockHashes;
+  std::vector<std::vector<Crypto::Hash>> transactionHashes;
+};
+
 void Blockchain::rebuildCache() {
   std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  std::string checkpointFileName = appendPath(m_config_folder, m_currency.blocksCacheFileName() + REBUILD_CHECKPOINT_SUFFIX);
+  clearCache();
+
+  BlockCacheSerializer checkpointLoader(*this, NULL_HASH, logger.getLogger(), true);
+  checkpointLoader.load(checkpointFileName);
+  if (checkpointLoader.loaded()) {
+    logger(INFO, BRIGHT_WHITE) << "Resuming rebuild of internal structures from height " << m_blockIndex.size();
+  } else {
+    clearCache();
+    m_outputEntries.clear();
+  }
+
+  uint32_t startHeight = m_blockIndex.size();
+  uint32_t height = static_cast<uint32_t>(m_blocks.size());
+  size_t batchCount = (height - startHeight + REBUILD_BATCH_SIZE - 1) / REBUILD_BATCH_SIZE;
+  size_t threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  // Workers decode and hash batches in any order, this thread merges them in chain order.
+  std::mutex mutex;
+  std::condition_variable batchDecoded;
+  std::condition_variable batchMerged;
+  std::map<size_t, RebuildBatch> decodedBatches;
+  size_t nextBatch = 0;
+  size_t mergedBatches = 0;
+  std::exception_ptr error;
+
+  auto decode = [&] {
+    for (;;) {
+      size_t batchIndex;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        batchMerged.wait(lock, [&] { return error || nextBatch < mergedBatches + 2 * threadCount; });
+        if (error || nextBatch == batchCount) {
+          return;
+        }
+
+        batchIndex = nextBatch++;
+      }
+
+      try {
+        RebuildBatch batch;
+        batch.firstHeight = startHeight + static_cast<uint32_t>(batchIndex * REBUILD_BATCH_SIZE);
+        uint32_t batchEnd = std::min(height, batch.firstHeight + REBUILD_BATCH_SIZE);
+        batch.blocks.resize(batchEnd - batch.firstHeight);
+        batch.blockHashes.resize(batch.blocks.size());
+        batch.transactionHashes.resize(batch.blocks.size());
+        for (size_t i = 0; i < batch.blocks.size(); ++i) {
+          m_blocks.load(batch.firstHeight + i, batch.blocks[i]);
+          const Block& block = batch.blocks[i].bl;
+          CachedBlock cachedBlock(block);
+          batch.blockHashes[i] = cachedBlock.getBlockHash();
+          // the block commits to the hashes of its other transactions, only the base one is hashed
+          batch.transactionHashes[i].reserve(block.transactionHashes.size() + 1);
+          batch.transactionHashes[i].push_back(cachedBlock.getBaseTransactionHash());
+          batch.transactionHashes[i].insert(batch.transactionHashes[i].end(), block.transactionHashes.begin(), block.transactionHashes.end());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        decodedBatches.emplace(batchIndex, std::move(batch));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+      }
+
+      batchDecoded.notify_one();
+      batchMerged.notify_all();
+    }
+  };
+
+  {
+    std::vector<std::thread> workers;
+    // workers are stopped and joined before leaving, also when merging throws
+    BOOST_SCOPE_EXIT_ALL(&) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error && mergedBatches != batchCount) {
+          error = std::make_exception_ptr(std::runtime_error("Rebuild of internal structures was interrupted"));
+        }
+      }
+
+      batchMerged.notify_all();
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    };
+
+    for (size_t i = 0; i < threadCount; ++i) {
+      workers.emplace_back(decode);
+    }
+
+    std::chrono::steady_clock::time_point checkpointTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point progressTime = checkpointTime;
+    uint64_t progressBlocks = 0;
+    uint64_t progressTransactions = 0;
+    for (size_t batchIndex = 0; batchIndex < batchCount; ++batchIndex) {
+      RebuildBatch batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        batchDecoded.wait(lock, [&] { return error || decodedBatches.count(batchIndex) != 0; });
+        if (error) {
+          break;
+        }
+
+        auto batchIter = decodedBatches.find(batchIndex);
+        batch = std::move(batchIter->second);
+        decodedBatches.erase(batchIter);
+        ++mergedBatches;
+      }
+
+      batchMerged.notify_all();
+      mergeRebuildBatch(batch);
+
+      progressBlocks += batch.blocks.size();
+      for (const auto& transactionHashes : batch.transactionHashes) {
+        progressTransactions += transactionHashes.size();
+      }
+
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      if (now - progressTime >= REBUILD_PROGRESS_INTERVAL) {
+        double seconds = std::chrono::duration<double>(now - progressTime).count();
+        logger(INFO, BRIGHT_WHITE) << "Height " << m_blockIndex.size() << " of " << height << ", " <<
+          static_cast<uint64_t>(progressBlocks / seconds) << " blocks/s, " << static_cast<uint64_t>(progressTransactions / seconds) << " transactions/s";
+        progressTime = now;
+        progressBlocks = 0;
+        progressTransactions = 0;
+      }
+
+      if (now - checkpointTime >= REBUILD_CHECKPOINT_INTERVAL && batchIndex + 1 < batchCount) {
+        storeRebuildCheckpoint(checkpointFileName);
+        checkpointTime = std::chrono::steady_clock::now();
+      }
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+}
+
+void Blockchain::clearCache() {
   m_blockIndex.clear();
   m_transactionMap.clear();
   m_spent_keys.clear();
   m_outputs.clear();
   m_multisignatureOutputs.clear();
-  for (uint32_t b = 0; b < m_blocks.size(); ++b) {
-    if (b % 1000 == 0) {
-      logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
-    }
-    const BlockEntry& block = m_blocks[b];
-    Crypto::Hash blockHash = get_block_hash(block.bl);
-    m_blockIndex.push(blockHash);
-    for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-      const TransactionEntry& transaction = block.transactions[t];
-      Crypto::Hash transactionHash = getObjectHash(transaction.tx);
-      TransactionIndex transactionIndex = { b, t };
-      m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
-
-      // process inputs
-      for (auto& i : transaction.tx.inputs) {
-        if (i.type() == typeid(KeyInput)) {
-          m_spent_keys.insert(::boost::get<KeyInput>(i).keyImage);
-        } else if (i.type() == typeid(MultisignatureInput)) {
-          auto out = ::boost::get<MultisignatureInput>(i);
-          m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
-        }
+}
+
+void Blockchain::mergeRebuildBatch(const RebuildBatch& batch) {
+  for (size_t index = 0; index < batch.blocks.size(); ++index) {
+    mergeBlock(batch.firstHeight + static_cast<uint32_t>(index), batch.blocks[index], batch.blockHashes[index], batch.transactionHashes[index]);
+  }
+}
+
+void Blockchain::mergeBlock(uint32_t height, const BlockEntry& block, const Crypto::Hash& blockHash, const std::vector<Crypto::Hash>& transactionHashes) {
+  m_blockIndex.push(blockHash);
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const TransactionEntry& transaction = block.transactions[t];
+    TransactionIndex transactionIndex = { height, t };
+    m_transactionMap.insert(std::make_pair(transactionHashes[t], transactionIndex));
+
+    // process inputs
+    for (auto& i : transaction.tx.inputs) {
+      if (i.type() == typeid(KeyInput)) {
+        m_spent_keys.insert(::boost::get<KeyInput>(i).keyImage);
+      } else if (i.type() == typeid(MultisignatureInput)) {
+        auto out = ::boost::get<MultisignatureInput>(i);
+        m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
       }
+    }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
+    // process outputs
+    for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
+      const auto& out = transaction.tx.outputs[o];
+      if (out.target.type() == typeid(KeyOutput)) {
+        OutputIndexEntry entry = { boost::get<KeyOutput>(out.target).key, transaction.tx.unlockTime, transactionIndex, o };
+        m_outputEntries.push_back(entry);
+        m_outputs[out.amount].push_back(m_outputEntries.size() - 1);
+      } else if (out.target.type() == typeid(MultisignatureOutput)) {
+        MultisignatureOutputUsage usage = { transactionIndex, o, false };
+        m_multisignatureOutputs[out.amount].push_back(usage);
+      }
+    }
+  }
+}
+
+void Blockchain::storeRebuildCheckpoint(const std::string& fileName) {
+  logger(INFO, BRIGHT_WHITE) << "Saving rebuild checkpoint at height " << m_blockIndex.size() << "...";
+  BlockCacheSerializer ser(*this, m_blockIndex.getTailId(), logger.getLogger());
+  std::string temporaryFileName = fileName + ".tmp";
+  if (!ser.save(temporaryFileName)) {
+    logger(WARNING, BRIGHT_YELLOW) << "Failed to save rebuild checkpoint";
+    return;
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::rename(temporaryFileName, fileName, ec);
+  if (ec) {
+    logger(WARNING, BRIGHT_YELLOW) << "Failed to save rebuild checkpoint: " << ec.message();
+  }
+}
+
+bool Blockchain::deinit() {
+  stopJournalCompaction();
+  compactJournal();
+  assert(m_messageQueueList.empty());
+  return true;
+}
+
+bool Blockchain::recoverFromJournal(const std::vector<BinaryArray>& records) {
+  Crypto::Hash snapshotHash = m_journal.snapshotHash();
+  if (snapshotHash == NULL_HASH) {
+    return false;
+  }
+
+  BlockCacheSerializer cacheLoader(*this, snapshotHash, logger.getLogger());
+  cacheLoader.load(appendPath(m_config_folder, m_currency.blocksCacheFileName()));
+  BlockchainIndicesSerializer indicesLoader(*this, snapshotHash, logger.getLogger());
+  if (cacheLoader.loaded()) {
+    loadFromBinaryFile(indicesLoader, appendPath(m_config_folder, m_currency.blockchinIndicesFileName()));
+  }
+
+  bool recovered = cacheLoader.loaded() && indicesLoader.loaded();
+  try {
+    // undo blocks of the snapshot that were popped after it, later pushed blocks are not applied yet
+    for (size_t i = 0; recovered && i < records.size(); ++i) {
+      BlockEntry block;
+      loadFromBinary(block, records[i]);
+      if (block.height >= m_blockIndex.size()) {
+        continue;
+      }
+
+      CachedBlock cachedBlock(block.bl);
+      const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
+      if (block.height + 1 != m_blockIndex.size() || blockHash != m_blockIndex.getTailId()) {
+        recovered = false;
+        break;
+      }
+
+      popTransactions(block, cachedBlock.getBaseTransactionHash());
+      m_timestampIndex.remove(block.bl.timestamp, blockHash);
+      m_generatedTransactionsIndex.remove(block.bl);
+      m_blockIndex.pop();
+    }
+
+    uint32_t height = m_blockIndex.size();
+    if (recovered && height != 0 && height <= m_blocks.size()) {
+      BlockHeaderEntry header;
+      m_blocks.load(height - 1, header);
+      recovered = get_block_hash(header.bl) == m_blockIndex.getTailId();
+    } else {
+      recovered = false;
+    }
+
+    if (recovered) {
+      logger(INFO, BRIGHT_WHITE) << "Replaying " << m_blocks.size() - height << " blocks stored after blockchain snapshot...";
+      for (; height < m_blocks.size(); ++height) {
+        BlockEntry block;
+        m_blocks.load(height, block);
+        CachedBlock cachedBlock(block.bl);
+        std::vector<Crypto::Hash> transactionHashes;
+        transactionHashes.push_back(cachedBlock.getBaseTransactionHash());
+        transactionHashes.insert(transactionHashes.end(), block.bl.transactionHashes.begin(), block.bl.transactionHashes.end());
+        for (const TransactionEntry& transaction : block.transactions) {
+          m_paymentIdIndex.add(transaction.tx);
         }
+
+        const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
+        mergeBlock(height, block, blockHash, transactionHashes);
+        m_timestampIndex.add(block.bl.timestamp, blockHash);
+        m_generatedTransactionsIndex.add(block.bl);
       }
     }
+  } catch (std::exception& e) {
+    logger(WARNING, BRIGHT_YELLOW) << "Blockchain journal replay failed: " << e.what();
+    recovered = false;
   }
 
-  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+  if (!recovered) {
+    logger(WARNING, BRIGHT_YELLOW) << "Blockchain snapshot does not match the stored blocks";
+    clearCache();
+    m_paymentIdIndex.clear();
+    m_timestampIndex.clear();
+    m_generatedTransactionsIndex.clear();
+  }
+
+  return recovered;
 }
 
-bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::compactJournal() {
+  Crypto::Hash tailId;
+  size_t journalRecordCount;
+  BinaryArray cache;
+  BinaryArray indices;
+  {
+    // the state is copied to memory under the lock, writing it to disk doesn't block the blockchain
+    Tools::SharedLockGuard lk(m_blockchain_lock);
+    tailId = getTailId();
+    if (tailId == m_journal.snapshotHash()) {
+      return true;
+    }
+
+    logger(INFO, BRIGHT_WHITE) << "Saving blockchain snapshot...";
+    journalRecordCount = m_journal.recordCount();
+    try {
+      cache = storeToBinary(BlockCacheSerializer(*this, tailId, logger.getLogger()));
+      indices = storeToBinary(BlockchainIndicesSerializer(*this, tailId, logger.getLogger()));
+    } catch (std::exception& e) {
+      logger(ERROR, BRIGHT_RED) << "Failed to save blockchain snapshot: " << e.what();
+      return false;
+    }
+  }
 
-  logger(INFO, BRIGHT_WHITE) << "Saving blockchain...";
-  BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
-  if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
-    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
+  std::string cacheFileName = appendPath(m_config_folder, m_currency.blocksCacheFileName());
+  std::string indicesFileName = appendPath(m_config_folder, m_currency.blockchinIndicesFileName());
+  if (!saveBinaryFile(cacheFileName + ".tmp", cache) || !saveBinaryFile(indicesFileName + ".tmp", indices)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain snapshot";
     return false;
   }
 
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  boost::system::error_code ec;
+  // the blocks popped meanwhile are undone by the journal only, the next snapshot is taken later
+  if (m_journal.recordCount() != journalRecordCount) {
+    logger(INFO, BRIGHT_WHITE) << "Blockchain snapshot is outdated by popped blocks, it is discarded";
+    boost::filesystem::remove(cacheFileName + ".tmp", ec);
+    boost::filesystem::remove(indicesFileName + ".tmp", ec);
+    return false;
+  }
+
+  boost::filesystem::rename(cacheFileName + ".tmp", cacheFileName, ec);
+  if (!ec) {
+    boost::filesystem::rename(indicesFileName + ".tmp", indicesFileName, ec);
+  }
+
+  if (ec || !m_journal.reset(tailId)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain snapshot";
+    return false;
+  }
+
+  // a snapshot supersedes any rebuild checkpoint
+  boost::filesystem::remove(cacheFileName + REBUILD_CHECKPOINT_SUFFIX, ec);
   return true;
 }
 
-bool Blockchain::deinit() {
-  storeCache();
-  storeBlockchainIndices();
-  assert(m_messageQueueList.empty());
-  return true;
+void Blockchain::journalCompactionLoop() {
+  std::unique_lock<std::mutex> lock(m_journalCompactionLock);
+  for (;;) {
+    m_journalCompactionCondition.wait_for(lock, JOURNAL_COMPACTION_INTERVAL, [this] { return m_stopJournalCompaction; });
+    if (m_stopJournalCompaction) {
+      break;
+    }
+
+    lock.unlock();
+    compactJournal();
+    lock.lock();
+  }
+}
+
+void Blockchain::stopJournalCompaction() {
+  {
+    std::lock_guard<std::mutex> lock(m_journalCompactionLock);
+    m_stopJournalCompaction = true;
+  }
+
+  m_journalCompactionCondition.notify_one();
+  if (m_journalCompactionThread.joinable()) {
+    m_journalCompactionThread.join();
+  }
 }
 
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
@@ -529,10 +1003,15 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   m_blocks.clear();
   m_blockIndex.clear();
   m_transactionMap.clear();
+  rebuildDifficultyWindow();
+  m_journal.reset(NULL_HASH);
 
   m_spent_keys.clear();
   m_alternative_chains.clear();
   m_outputs.clear();
+  m_outputEntries.clear();
+  m_randomOutputs.clear();
+  m_tx_pool.on_blockchain_dec(0, NULL_HASH);
 
   m_paymentIdIndex.clear();
   m_timestampIndex.clear();
@@ -546,24 +1025,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -600,13 +1079,14 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
 
   uint32_t height = 0;
 
@@ -627,29 +1107,29 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  Tools::SharedLockGuard lock(m_blockchain_lock);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  std::vector<uint64_t> timestamps;
-  std::vector<difficulty_type> commulative_difficulties;
-  size_t offset = m_blocks.size() - std::min(m_blocks.size(), static_cast<uint64_t>(m_currency.difficultyBlocksCount()));
-  if (offset == 0) {
-    ++offset;
-  }
-
-  for (; offset < m_blocks.size(); offset++) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    commulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_nextDifficultyLock)> lock(m_nextDifficultyLock);
+  Crypto::Hash tip = getTailId();
+  if (!m_nextDifficultyValid || m_nextDifficultyTip != tip) {
+    std::vector<uint64_t> timestamps;
+    std::vector<difficulty_type> commulative_difficulties;
+    m_difficultyWindow.copy(m_difficultyWindow.beginHeight(), m_difficultyWindow.endHeight(), timestamps, commulative_difficulties);
+    m_nextDifficulty = m_currency.nextDifficulty(std::move(timestamps), std::move(commulative_difficulties));
+    m_nextDifficultyTip = tip;
+    m_nextDifficultyValid = true;
   }
 
-  return m_currency.nextDifficulty(timestamps, commulative_difficulties);
+  return m_nextDifficulty;
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   if (m_blocks.empty()) {
     return 0;
   } else {
@@ -661,14 +1141,14 @@ bool Blockchain::rollback_blockchain_switching(std::list<Block> &original_chain,
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   // remove failed subchain
   for (size_t i = m_blocks.size() - 1; i >= rollback_height; i--) {
-    popBlock(get_block_hash(m_blocks.back().bl));
+    popBlock(m_blockIndex.getTailId());
   }
 
   // return back original chain
   for (auto &bl : original_chain) {
     block_verification_context bvc =
       boost::value_initialized<block_verification_context>();
-    bool r = pushBlock(bl, bvc);
+    bool r = pushBlock(CachedBlock(bl), bvc);
     if (!(r && bvc.m_added_to_main_chain)) {
       logger(ERROR, BRIGHT_RED) << "PANIC!!! failed to add (again) block while "
         "chain switching during the rollback!";
@@ -699,7 +1179,7 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
   std::list<Block> disconnected_chain;
   for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
     Block b = m_blocks[i].bl;
-    popBlock(get_block_hash(b));
+    popBlock(m_blockIndex.getTailId());
     //if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to remove block on chain switching"; return false; }
     disconnected_chain.push_front(b);
   }
@@ -708,7 +1188,7 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
   for (auto alt_ch_iter = alt_chain.begin(); alt_ch_iter != alt_chain.end(); alt_ch_iter++) {
     auto ch_ent = *alt_ch_iter;
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    bool r = pushBlock(ch_ent->second.bl, bvc);
+    bool r = pushBlock(CachedBlock(ch_ent->second.bl), bvc);
     if (!r || !bvc.m_added_to_main_chain) {
       logger(INFO, BRIGHT_WHITE) << "Failed to switch to alternative blockchain";
       rollback_blockchain_switching(disconnected_chain, split_height);
@@ -762,7 +1242,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   std::vector<uint64_t> timestamps;
   std::vector<difficulty_type> commulative_difficulties;
   if (alt_chain.size() < m_currency.difficultyBlocksCount()) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    Tools::SharedLockGuard lk(m_blockchain_lock);
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
     size_t main_chain_count = m_currency.difficultyBlocksCount() - std::min(m_currency.difficultyBlocksCount(), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -770,9 +1250,15 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 
     if (!main_chain_start_offset)
       ++main_chain_start_offset; //skip genesis block
-    for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      commulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+    if (main_chain_start_offset >= m_difficultyWindow.beginHeight() && main_chain_stop_offset <= m_difficultyWindow.endHeight()) {
+      m_difficultyWindow.copy(static_cast<uint32_t>(main_chain_start_offset), static_cast<uint32_t>(main_chain_stop_offset), timestamps, commulative_difficulties);
+    } else {
+      for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
+        BlockHeaderEntry header;
+        m_blocks.load(main_chain_start_offset, header);
+        timestamps.push_back(header.bl.timestamp);
+        commulative_difficulties.push_back(header.cumulative_difficulty);
+      }
     }
 
     if (!((alt_chain.size() + timestamps.size()) <= m_currency.difficultyBlocksCount())) {
@@ -868,7 +1354,8 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -884,7 +1371,7 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (!m_blocks.size()) {
     return true;
   }
@@ -900,7 +1387,8 @@ bool Blockchain::complete_timestamps_vector(uint64_t start_top_height, std::vect
   if (timestamps.size() >= m_currency.timestampCheckWindow())
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   size_t need_elements = m_currency.timestampCheckWindow() - timestamps.size();
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
@@ -964,8 +1452,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     if (alt_chain.size()) {
       //make sure that it has right connection to main chain
       if (!(m_blocks.size() > alt_chain.front()->second.height)) { logger(ERROR, BRIGHT_RED) << "main blockchain wrong height"; return false; }
-      Crypto::Hash h = NULL_HASH;
-      get_block_hash(m_blocks[alt_chain.front()->second.height - 1].bl, h);
+      Crypto::Hash h = m_blockIndex.getBlockId(alt_chain.front()->second.height - 1);
       if (!(h == alt_chain.front()->second.bl.previousBlockHash)) { logger(ERROR, BRIGHT_RED) << "alternative chain have wrong connection to main chain"; return false; }
       complete_timestamps_vector(alt_chain.front()->second.height - 1, timestamps);
     } else {
@@ -1080,7 +1567,8 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   if (start_offset >= m_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
@@ -1094,20 +1582,23 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
 
   for (uint32_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
+    BlockHeaderEntry header;
+    m_blocks.load(i, header);
+    blocks.push_back(std::move(header.bl));
   }
 
   return true;
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with FortressProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
   std::list<Block> blocks;
   getBlocks(arg.blocks, blocks, rsp.missed_ids);
@@ -1139,7 +1630,7 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1148,48 +1639,15 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
-    logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
-  }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
-
-  //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlockTime))
-    return false;
-
-  COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
-  oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
-  return true;
-}
-
-size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (amount_outs.empty()) {
-    return 0;
-  }
-
-  size_t i = amount_outs.size();
-  do {
-    --i;
-    if (amount_outs[i].first.block + m_currency.minedMoneyUnlockWindow() <= getCurrentBlockchainHeight()) {
-      return i + 1;
-    }
-  } while (i != 0);
-
-  return 0;
-}
-
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  uint32_t chainSize = static_cast<uint32_t>(m_blocks.size());
+  std::vector<uint32_t> indexes;
+  res.outs.reserve(req.amounts.size());
 
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
@@ -1201,17 +1659,20 @@ bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_
       continue;//actually this is strange situation, wallet should use some real outs when it lookup for some mix, so, at least one out for this amount should exist
     }
 
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs = it->second;
-    //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split
-    //lets find upper bound of not fresh outs
-    size_t up_index_limit = find_end_of_allowed_index(amount_outs);
-    if (!(up_index_limit <= amount_outs.size())) { logger(ERROR, BRIGHT_RED) << "internal error: find_end_of_allowed_index returned wrong index=" << up_index_limit << ", with amount_outs.size = " << amount_outs.size(); return false; }
-
-    if (up_index_limit > 0) {
-      ShuffleGenerator<size_t, Crypto::random_engine<size_t>> generator(up_index_limit);
-      for (uint64_t j = 0; j < up_index_limit && result_outs.outs.size() < req.outs_count; ++j) {
-        add_out_to_get_random_outs(amount_outs, result_outs, amount, generator());
-      }
+    //it is not good idea to use top fresh outs, because it increases possibility of transaction canceling on split,
+    //so only outputs below the mature bound are offered
+    const std::vector<uint64_t>& amount_outs = it->second;
+    indexes.clear();
+    m_randomOutputs.sample(amount, req.outs_count, indexes, [&](uint32_t index) {
+      return is_tx_spendtime_unlocked(m_outputEntries[amount_outs[index]].unlockTime, chainSize);
+    });
+
+    result_outs.outs.reserve(indexes.size());
+    for (uint32_t index : indexes) {
+      COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry oen;
+      oen.global_amount_index = index;
+      oen.out_key = m_outputEntries[amount_outs[index]].key;
+      result_outs.outs.push_back(oen);
     }
   }
   return true;
@@ -1221,7 +1682,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1229,7 +1690,8 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
     return m_blocks[i].cumulative_difficulty;
@@ -1239,7 +1701,8 @@ uint64_t Blockchain::blockDifficulty(size_t i) {
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_WHITE) <<
       "Wrong starter index set: " << start_index << ", expected max index " << m_blocks.size() - 1;
@@ -1259,7 +1722,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1273,13 +1736,15 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   for (const outputs_container::value_type& v : m_outputs) {
-    const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
+    const std::vector<uint64_t>& vals = v.second;
     if (!vals.empty()) {
       ss << "amount: " << v.first << ENDL;
       for (size_t i = 0; i != vals.size(); i++) {
-        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first).tx) << ": " << vals[i].second << ENDL;
+        const OutputIndexEntry& entry = m_outputEntries[vals[i]];
+        ss << "\t" << getTransactionHash(entry.transactionIndex) << ": " << entry.outputIndex << ENDL;
       }
     }
   }
@@ -1299,7 +1764,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1307,7 +1772,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1318,12 +1783,13 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_transactionMap.size();
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
@@ -1341,7 +1807,8 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1363,8 +1830,9 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::checkTransactionInputs(const CachedTransaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
 
   if (tail)
     tail->id = getTailId(tail->height);
@@ -1372,7 +1840,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
   bool res = checkTransactionInputs(tx, &max_used_block_height);
   if (!res) return false;
   if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  max_used_block_id = m_blockIndex.getBlockId(max_used_block_height);
   return true;
 }
 
@@ -1388,23 +1856,24 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
   return false;
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
-  Crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
-}
-
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+/**
+* If deferredSignatures is not NULL, ring signatures are not checked here but appended to it, the caller must verify them
+*/
+bool Blockchain::checkTransactionInputs(const CachedTransaction& transaction, uint32_t* pmax_used_block_height,
+  std::vector<RingSignatureVerifier::Job>* deferredSignatures) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
-  Crypto::Hash transactionHash = getObjectHash(tx);
+  const Transaction& tx = transaction.getTransaction();
+  const Crypto::Hash& tx_prefix_hash = transaction.getTransactionPrefixHash();
+  const Crypto::Hash& transactionHash = transaction.getTransactionHash();
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
     if (txin.type() == typeid(KeyInput)) {
       const KeyInput& in_to_key = boost::get<KeyInput>(txin);
-      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << getObjectHash(tx); return false; }
+      if (!(!in_to_key.outputIndexes.empty())) { logger(ERROR, BRIGHT_RED) << "empty in_to_key.outputIndexes in transaction with id " << transactionHash; return false; }
 
       if (have_tx_keyimg_as_spent(in_to_key.keyImage)) {
         logger(DEBUGGING) <<
@@ -1412,7 +1881,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height, deferredSignatures)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
@@ -1436,9 +1905,13 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
 }
 
 bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
+  return is_tx_spendtime_unlocked(unlock_time, getCurrentBlockchainHeight());
+}
+
+bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t chainSize) {
   if (unlock_time < m_currency.maxBlockHeight()) {
     //interpret as block index
-    if (getCurrentBlockchainHeight() - 1 + m_currency.lockedTxAllowedDeltaBlocks() >= unlock_time)
+    if (chainSize - 1 + m_currency.lockedTxAllowedDeltaBlocks() >= unlock_time)
       return true;
     else
       return false;
@@ -1454,8 +1927,19 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time) {
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::mayStayLockedWhenMature(uint64_t unlockTime, uint32_t blockIndex) const {
+  // an output is mature once the chain size reaches blockIndex + minedMoneyUnlockWindow,
+  // outputs unlocked by that height never have to be checked by the random outputs sampler
+  if (unlockTime >= m_currency.maxBlockHeight()) {
+    return true;
+  }
+
+  return unlockTime + 1 > uint64_t(blockIndex) + m_currency.minedMoneyUnlockWindow() + m_currency.lockedTxAllowedDeltaBlocks();
+}
+
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height,
+  std::vector<RingSignatureVerifier::Job>* deferredSignatures) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
 
   struct outputs_visitor {
     std::vector<const Crypto::PublicKey *>& m_results_collector;
@@ -1464,21 +1948,15 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
     }
 
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
+    bool handle_output(const OutputIndexEntry& output) {
       //check tx unlock time
-      if (!m_bch.is_tx_spendtime_unlocked(tx.unlockTime)) {
-        logger(INFO, BRIGHT_WHITE) <<
-          "One of outputs for one of inputs have wrong tx.unlockTime = " << tx.unlockTime;
-        return false;
-      }
-
-      if (out.target.type() != typeid(KeyOutput)) {
+      if (!m_bch.is_tx_spendtime_unlocked(output.unlockTime)) {
         logger(INFO, BRIGHT_WHITE) <<
-          "Output have wrong type id, which=" << out.target.which();
+          "One of outputs for one of inputs have wrong tx.unlockTime = " << output.unlockTime;
         return false;
       }
 
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
+      m_results_collector.push_back(&output.key);
       return true;
     }
   };
@@ -1504,6 +1982,21 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
+  if (deferredSignatures != NULL) {
+    // output keys point into the output index, which may change once the lock is released
+    RingSignatureVerifier::Job job;
+    job.prefixHash = tx_prefix_hash;
+    job.keyImage = txin.keyImage;
+    job.keys.reserve(output_keys.size());
+    for (const Crypto::PublicKey* key : output_keys) {
+      job.keys.push_back(*key);
+    }
+
+    job.signatures = sig;
+    deferredSignatures->push_back(std::move(job));
+    return true;
+  }
+
   return Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
 }
 
@@ -1586,16 +2079,12 @@ bool Blockchain::update_next_comulative_size_limit() {
 }
 
 bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc) {
-  //copy block here to let modify block.target
-  Block bl = bl_;
-  Crypto::Hash id;
-  if (!get_block_hash(bl, id)) {
-    logger(ERROR, BRIGHT_RED) <<
-      "Failed to get block hash, possible block has invalid format";
-    bvc.m_verifivation_failed = true;
-    return false;
-  }
+  return addNewBlock(CachedBlock(bl_), bvc);
+}
 
+bool Blockchain::addNewBlock(const CachedBlock& block, block_verification_context& bvc) {
+  const Block& bl = block.getBlock();
+  const Crypto::Hash& id = block.getBlockHash();
   bool add_result;
 
   { //to avoid deadlock lets lock tx_pool for whole add/reorganize process
@@ -1614,7 +2103,7 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
       bvc.m_added_to_main_chain = false;
       add_result = handle_alternative_block(bl, id, bvc);
     } else {
-      add_result = pushBlock(bl, bvc);
+      add_result = pushBlock(block, bvc);
       if (add_result) {
         sendMessage(BlockchainMessage(NewBlockMessage(id)));
       }
@@ -1632,14 +2121,26 @@ const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIn
   return m_blocks[index.block].transactions[index.transaction];
 }
 
-bool Blockchain::pushBlock(const Block& blockData, block_verification_context& bvc) {
+Crypto::Hash Blockchain::getTransactionHash(TransactionIndex index) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  BlockHeaderEntry header;
+  m_blocks.load(index.block, header);
+  if (index.transaction == 0) {
+    return getObjectHash(header.bl.baseTransaction);
+  }
+
+  return header.bl.transactionHashes[index.transaction - 1];
+}
+
+bool Blockchain::pushBlock(const CachedBlock& cachedBlock, block_verification_context& bvc) {
   std::vector<Transaction> transactions;
-  if (!loadTransactions(blockData, transactions)) {
+  std::vector<size_t> transactionSizes;
+  if (!loadTransactions(cachedBlock.getBlock(), transactions, transactionSizes)) {
     bvc.m_verifivation_failed = true;
     return false;
   }
 
-  if (!pushBlock(blockData, transactions, bvc)) {
+  if (!pushBlock(cachedBlock, transactions, transactionSizes, bvc)) {
     saveTransactions(transactions);
     return false;
   }
@@ -1647,12 +2148,13 @@ bool Blockchain::pushBlock(const Block& blockData, block_verification_context& b
   return true;
 }
 
-bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc) {
+bool Blockchain::pushBlock(const CachedBlock& cachedBlock, const std::vector<Transaction>& transactions, const std::vector<size_t>& transactionSizes, block_verification_context& bvc) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
 
-  Crypto::Hash blockHash = get_block_hash(blockData);
+  const Block& blockData = cachedBlock.getBlock();
+  const Crypto::Hash& blockHash = cachedBlock.getBlockHash();
 
   if (m_blockIndex.hasBlock(blockHash)) {
     logger(ERROR, BRIGHT_RED) <<
@@ -1712,7 +2214,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     return false;
   }
 
-  Crypto::Hash minerTransactionHash = getObjectHash(blockData.baseTransaction);
+  const Crypto::Hash& minerTransactionHash = cachedBlock.getBaseTransactionHash();
 
   BlockEntry block;
   block.bl = blockData;
@@ -1724,6 +2226,9 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
+  // ring signatures of the whole block are checked at once after all other input checks
+  std::vector<RingSignatureVerifier::Job> ringSignatures;
+  std::vector<Crypto::Hash> ringSignatureTransactions;
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
@@ -1731,9 +2236,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     uint64_t fee = 0;
     block.transactions.back().tx = transactions[i];
 
-    blob_size = toBinaryArray(block.transactions.back().tx).size();
+    blob_size = transactionSizes[i];
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    CachedTransaction transaction(block.transactions.back().tx, tx_id, blob_size);
+    if (!checkTransactionInputs(transaction, NULL, &ringSignatures)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verifivation_failed = true;
@@ -1743,6 +2249,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
 
+    ringSignatureTransactions.resize(ringSignatures.size(), tx_id);
+
     ++transactionIndex.transaction;
     pushTransaction(block, tx_id, transactionIndex);
 
@@ -1750,6 +2258,17 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     fee_summary += fee;
   }
 
+  size_t failedSignature = m_ringSignatureVerifier.verify(ringSignatures);
+  if (failedSignature != ringSignatures.size()) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Failed to check ring signature for tx " << ringSignatureTransactions[failedSignature];
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " has at least one transaction with wrong inputs: " << ringSignatureTransactions[failedSignature];
+    bvc.m_verifivation_failed = true;
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verifivation_failed = true;
     return false;
@@ -1773,7 +2292,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
   }
 
-  pushBlock(block);
+  pushBlock(block, blockHash);
+  m_tx_pool.on_blockchain_inc(m_blocks.size(), blockHash);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
@@ -1792,11 +2312,15 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   return true;
 }
 
-bool Blockchain::pushBlock(BlockEntry& block) {
-  Crypto::Hash blockHash = get_block_hash(block.bl);
-
+bool Blockchain::pushBlock(BlockEntry& block, const Crypto::Hash& blockHash) {
   m_blocks.push_back(block);
   m_blockIndex.push(blockHash);
+  if (block.height != 0) {
+    assert(m_difficultyWindow.endHeight() == block.height);
+    m_difficultyWindow.push(block.bl.timestamp, block.cumulative_difficulty);
+  }
+
+  m_randomOutputs.setChainSize(static_cast<uint32_t>(m_blocks.size()));
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
@@ -1813,6 +2337,9 @@ void Blockchain::popBlock(const Crypto::Hash& blockHash) {
     return;
   }
 
+  // the journal has to know the block before any index forgets it
+  m_journal.append(storeToBinary(m_blocks.back()));
+
   std::vector<Transaction> transactions(m_blocks.back().transactions.size() - 1);
   for (size_t i = 0; i < m_blocks.back().transactions.size() - 1; ++i) {
     transactions[i] = m_blocks.back().transactions[1 + i].tx;
@@ -1827,8 +2354,19 @@ void Blockchain::popBlock(const Crypto::Hash& blockHash) {
 
   m_blocks.pop_back();
   m_blockIndex.pop();
+  if (!m_blocks.empty()) {
+    m_difficultyWindow.pop();
+    if (!m_difficultyWindow.full() && m_difficultyWindow.beginHeight() > 1) {
+      BlockHeaderEntry header;
+      m_blocks.load(m_difficultyWindow.beginHeight() - 1, header);
+      m_difficultyWindow.pushFront(header.bl.timestamp, header.cumulative_difficulty);
+    }
+  }
 
+  m_randomOutputs.setChainSize(static_cast<uint32_t>(m_blocks.size()));
   assert(m_blockIndex.size() == m_blocks.size());
+
+  m_tx_pool.on_blockchain_dec(m_blocks.size(), m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId());
 }
 
 bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex) {
@@ -1877,7 +2415,10 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
     if (transaction.tx.outputs[output].target.type() == typeid(KeyOutput)) {
       auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
-      amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      OutputIndexEntry entry = { boost::get<KeyOutput>(transaction.tx.outputs[output].target).key, transaction.tx.unlockTime, transactionIndex, output };
+      m_outputEntries.push_back(entry);
+      amountOutputs.push_back(m_outputEntries.size() - 1);
+      m_randomOutputs.push(transaction.tx.outputs[output].amount, transactionIndex.block, mayStayLockedWhenMature(entry.unlockTime, transactionIndex.block));
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
       auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
@@ -1909,19 +2450,21 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
         continue;
       }
 
-      if (amountOutputs->second.back().first.block != transactionIndex.block || amountOutputs->second.back().first.transaction != transactionIndex.transaction) {
+      const OutputIndexEntry& entry = m_outputEntries[amountOutputs->second.back()];
+      if (entry.transactionIndex.block != transactionIndex.block || entry.transactionIndex.transaction != transactionIndex.transaction) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid transaction index.";
         continue;
       }
 
-      if (amountOutputs->second.back().second != transaction.outputs.size() - 1 - outputIndex) {
+      if (entry.outputIndex != transaction.outputs.size() - 1 - outputIndex) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - invalid output index.";
         continue;
       }
 
       amountOutputs->second.pop_back();
+      m_randomOutputs.pop(output.amount);
       if (amountOutputs->second.empty()) {
         m_outputs.erase(amountOutputs);
       }
@@ -2058,7 +2601,8 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
 
   assert(startOffset < m_blocks.size());
 
@@ -2074,12 +2618,13 @@ bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
@@ -2091,7 +2636,8 @@ bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto:
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2112,7 +2658,8 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2133,7 +2680,8 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
+  std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2150,20 +2698,6 @@ bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMulti
   return true;
 }
 
-bool Blockchain::storeBlockchainIndices() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-
-  logger(INFO, BRIGHT_WHITE) << "Saving blockchain indices...";
-  BlockchainIndicesSerializer ser(*this, getTailId(), logger.getLogger());
-
-  if (!storeToBinaryFile(ser, appendPath(m_config_folder, m_currency.blockchinIndicesFileName()))) {
-    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain indices";
-    return false;
-  }
-
-  return true;
-}
-
 bool Blockchain::loadBlockchainIndices() {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
@@ -2200,31 +2734,31 @@ bool Blockchain::loadBlockchainIndices() {
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_generatedTransactionsIndex.find(height, generatedTransactions);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_orthanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
-bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions) {
+bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions, std::vector<size_t>& transactionSizes) {
   transactions.resize(block.transactionHashes.size());
-  size_t transactionSize;
+  transactionSizes.resize(block.transactionHashes.size());
   uint64_t fee;
   for (size_t i = 0; i < block.transactionHashes.size(); ++i) {
-    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], transactionSize, fee)) {
+    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], transactionSizes[i], fee)) {
       tx_verification_context context;
       for (size_t j = 0; j < i; ++j) {
         if (!m_tx_pool.add_tx(transactions[i - 1 - j], context, true)) {
@@ -2263,6 +2797,7 @@ void Blockchain::sendMessage(const BlockchainMessage& message) {
 }
 
 bool Blockchain::isBlockInMainChain(const Crypto::Hash& blockId) {
+  Tools::SharedLockGuard lk(m_blockchain_lock);
   return m_blockIndex.hasBlock(blockId);
 }
 
@@ -5,18 +5,27 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <thread>
 
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 
 #include "Common/ObserverManager.h"
+#include "Common/RecursiveSharedMutex.h"
 #include "Common/Util.h"
 #include "FortressCore/BlockIndex.h"
+#include "FortressCore/CachedBlock.h"
+#include "FortressCore/BlockchainJournal.h"
 #include "FortressCore/Checkpoints.h"
 #include "FortressCore/Currency.h"
 #include "FortressCore/IBlockchainStorageObserver.h"
 #include "FortressCore/ITransactionValidator.h"
-#include "FortressCore/SwappedVector.h"
+#include "FortressCore/RingSignatureVerifier.h"
+#include "FortressCore/DifficultyWindow.h"
+#include "FortressCore/RandomOutputsIndex.h"
+#include "FortressCore/MappedArray.h"
+#include "FortressCore/MappedVector.h"
 #include "FortressCore/FortressFormatUtils.h"
 #include "FortressCore/TransactionPool.h"
 #include "FortressCore/BlockchainIndices.h"
@@ -40,13 +49,14 @@ namespace Fortress {
   class Blockchain : public Fortress::ITransactionValidator {
   public:
     Blockchain(const Currency& currency, tx_memory_pool& tx_pool, Logging::ILogger& logger);
+    ~Blockchain();
 
     bool addObserver(IBlockchainStorageObserver* observer);
     bool removeObserver(IBlockchainStorageObserver* observer);
 
     // ITransactionValidator
-    virtual bool checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock) override;
-    virtual bool checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override;
+    virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock) override;
+    virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override;
     virtual bool haveSpentKeyImages(const Fortress::Transaction& tx) override;
     virtual bool checkTransactionSize(size_t blobSize) override;
 
@@ -77,6 +87,7 @@ namespace Fortress {
     difficulty_type getDifficultyForNextBlock();
     uint64_t getCoinsInCirculation();
     bool addNewBlock(const Block& bl_, block_verification_context& bvc);
+    bool addNewBlock(const CachedBlock& block, block_verification_context& bvc);
     bool resetAndSetGenesisBlock(const Block& b);
     bool haveBlock(const Crypto::Hash& id);
     size_t getTotalTransactions();
@@ -90,7 +101,7 @@ namespace Fortress {
     bool getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count);
     bool getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs);
     bool get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t& pmax_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail = 0);
+    bool checkTransactionInputs(const CachedTransaction& transaction, uint32_t& pmax_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail = 0);
     uint64_t getCurrentCumulativeBlocksizeLimit();
     uint64_t blockDifficulty(size_t i);
     bool getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight);
@@ -110,7 +121,7 @@ namespace Fortress {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      Tools::SharedLockGuard lk(m_blockchain_lock);
 
       for (const auto& bl_id : block_ids) {
         uint32_t height = 0;
@@ -119,7 +130,9 @@ namespace Fortress {
         } else {
           if (!(height < m_blocks.size())) { logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: bl_id=" << Common::podToHex(bl_id)
             << " have index record with offset=" << height << ", bigger then m_blocks.size()=" << m_blocks.size(); return false; }
-            blocks.push_back(m_blocks[height].bl);
+            BlockHeaderEntry header;
+            m_blocks.load(height, header);
+            blocks.push_back(std::move(header.bl));
         }
       }
 
@@ -128,7 +141,8 @@ namespace Fortress {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      Tools::SharedLockGuard bcLock(m_blockchain_lock);
+      std::lock_guard<decltype(m_blocksLock)> blocksLock(m_blocksLock);
 
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
@@ -171,6 +185,25 @@ namespace Fortress {
       }
     };
 
+    // Entry of the global output index. It keeps everything needed to use the output as a ring member,
+    // so ring lookups and random output selection never load the transaction itself. Entries are stored
+    // in the memory mapped output store, the in-memory index keeps only their positions there.
+    struct OutputIndexEntry {
+      Crypto::PublicKey key;
+      uint64_t unlockTime;
+      TransactionIndex transactionIndex;
+      uint16_t outputIndex;
+
+      void serialize(ISerializer& s) {
+        s(key, "key");
+        s(unlockTime, "unlock_time");
+        s(transactionIndex, "txindex");
+        s(outputIndex, "outindex");
+      }
+    };
+
+    Crypto::Hash getTransactionHash(TransactionIndex index);
+
   private:
 
     struct MultisignatureOutputUsage {
@@ -213,27 +246,54 @@ namespace Fortress {
       }
     };
 
+    // Leading fields of a stored BlockEntry, loaded without the block transactions.
+    struct BlockHeaderEntry {
+      Block bl;
+      uint32_t height;
+      uint64_t block_cumulative_size;
+      difficulty_type cumulative_difficulty;
+      uint64_t already_generated_coins;
+
+      void serialize(ISerializer& s) {
+        s(bl, "block");
+        s(height, "height");
+        s(block_cumulative_size, "block_cumulative_size");
+        s(cumulative_difficulty, "cumulative_difficulty");
+        s(already_generated_coins, "already_generated_coins");
+      }
+    };
+
     typedef google::sparse_hash_set<Crypto::KeyImage> key_images_container;
     typedef std::unordered_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
-    typedef google::sparse_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
+    // amount -> positions of the outputs' entries in m_outputEntries
+    typedef google::sparse_hash_map<uint64_t, std::vector<uint64_t>> outputs_container;
     typedef google::sparse_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    // Exclusive ownership is required to modify the chain, shared ownership is enough to query it.
+    Tools::RecursiveSharedMutex m_blockchain_lock;
+    // MappedVector updates its cache on every indexed read, so shared owners take this lock while they access
+    // m_blocks through operator[]. MappedVector::load does not touch the cache and needs only the shared lock.
+    std::recursive_mutex m_blocksLock;
     Crypto::cn_context m_cn_context;
+    RingSignatureVerifier m_ringSignatureVerifier;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
     key_images_container m_spent_keys;
     size_t m_current_block_cumul_sz_limit;
     blocks_ext_by_hash m_alternative_chains; // Crypto::Hash -> block_extended_info
     outputs_container m_outputs;
+    // Append-only while running, entries of popped outputs stay in place so that a stored snapshot keeps
+    // referring to its own entries. The snapshot load truncates it to the entries the snapshot knows.
+    MappedArray<OutputIndexEntry> m_outputEntries;
+    RandomOutputsIndex m_randomOutputs;
 
     std::string m_config_folder;
     Checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
-    typedef SwappedVector<BlockEntry> Blocks;
+    typedef MappedVector<BlockEntry> Blocks;
     typedef std::unordered_map<Crypto::Hash, uint32_t> BlockMap;
     typedef std::unordered_map<Crypto::Hash, TransactionIndex> TransactionMap;
 
@@ -241,6 +301,12 @@ namespace Fortress {
     friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
+    // Follows the main chain top, modified only by owners of exclusive m_blockchain_lock ownership
+    DifficultyWindow m_difficultyWindow;
+    std::mutex m_nextDifficultyLock;
+    bool m_nextDifficultyValid;
+    Crypto::Hash m_nextDifficultyTip;
+    difficulty_type m_nextDifficulty;
     Fortress::BlockIndex m_blockIndex;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
@@ -252,10 +318,28 @@ namespace Fortress {
 
     IntrusiveLinkedList<MessageQueue<BlockchainMessage>> m_messageQueueList;
 
+    // Blocks popped since the last snapshot of the cache and indices, pushed blocks are replayed from m_blocks
+    BlockchainJournal m_journal;
+    std::thread m_journalCompactionThread;
+    std::mutex m_journalCompactionLock;
+    std::condition_variable m_journalCompactionCondition;
+    bool m_stopJournalCompaction;
+
     Logging::LoggerRef logger;
 
+    struct RebuildBatch;
+
     void rebuildCache();
-    bool storeCache();
+    void clearCache();
+    void mergeRebuildBatch(const RebuildBatch& batch);
+    void mergeBlock(uint32_t height, const BlockEntry& block, const Crypto::Hash& blockHash, const std::vector<Crypto::Hash>& transactionHashes);
+    bool recoverFromJournal(const std::vector<BinaryArray>& records);
+    bool compactJournal();
+    void journalCompactionLoop();
+    void stopJournalCompaction();
+    void storeRebuildCheckpoint(const std::string& fileName);
+    bool migrateLegacyBlocks();
+    void rebuildDifficultyWindow();
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei);
@@ -263,9 +347,10 @@ namespace Fortress {
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
     bool rollback_blockchain_switching(std::list<Block>& original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
-    size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs);
+    bool is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t chainSize);
+    bool mayStayLockedWhenMature(uint64_t unlockTime, uint32_t blockIndex) const;
+    void rebuildRandomOutputsIndex();
     bool check_block_timestamp_main(const Block& b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block& b);
     uint64_t get_adjusted_time();
@@ -274,24 +359,24 @@ namespace Fortress {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_comulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL,
+      std::vector<RingSignatureVerifier::Job>* deferredSignatures = NULL);
+    bool checkTransactionInputs(const CachedTransaction& transaction, uint32_t* pmax_used_block_height = NULL,
+      std::vector<RingSignatureVerifier::Job>* deferredSignatures = NULL);
     bool have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
-    bool pushBlock(const Block& blockData, block_verification_context& bvc);
-    bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc);
-    bool pushBlock(BlockEntry& block);
+    bool pushBlock(const CachedBlock& cachedBlock, block_verification_context& bvc);
+    bool pushBlock(const CachedBlock& cachedBlock, const std::vector<Transaction>& transactions, const std::vector<size_t>& transactionSizes, block_verification_context& bvc);
+    bool pushBlock(BlockEntry& block, const Crypto::Hash& blockHash);
     void popBlock(const Crypto::Hash& blockHash);
     bool pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex);
     void popTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash);
     void popTransactions(const BlockEntry& block, const Crypto::Hash& minerTransactionHash);
     bool validateInput(const MultisignatureInput& input, const Crypto::Hash& transactionHash, const Crypto::Hash& transactionPrefixHash, const std::vector<Crypto::Signature>& transactionSignatures);
 
-    bool storeBlockchainIndices();
     bool loadBlockchainIndices();
 
-    bool loadTransactions(const Block& block, std::vector<Transaction>& transactions);
+    bool loadTransactions(const Block& block, std::vector<Transaction>& transactions, std::vector<size_t>& transactionSizes);
     void saveTransactions(const std::vector<Transaction>& transactions);
 
     void sendMessage(const BlockchainMessage& message);
@@ -312,17 +397,17 @@ namespace Fortress {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    Tools::SharedLockGuard m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+    Tools::SharedLockGuard lk(m_blockchain_lock);
     auto it = m_outputs.find(tx_in_to_key.amount);
     if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
       return false;
 
     std::vector<uint32_t> absolute_offsets = relative_output_offsets_to_absolute(tx_in_to_key.outputIndexes);
-    std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs_vec = it->second;
+    const std::vector<uint64_t>& amount_outs_vec = it->second;
     size_t count = 0;
     for (uint64_t i : absolute_offsets) {
       if(i >= amount_outs_vec.size() ) {
@@ -330,27 +415,15 @@ namespace Fortress {
         return false;
       }
 
-      //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
-      //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
-
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
-
-      if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
-        logger(Logging::ERROR, Logging::BRIGHT_RED)
-            << "Wrong index in transaction outputs: "
-            << amount_outs_vec[i].second << ", expected less then "
-            << tx.tx.outputs.size();
-        return false;
-      }
-
-      if (!vis.handle_output(tx.tx, tx.tx.outputs[amount_outs_vec[i].second], amount_outs_vec[i].second)) {
+      const OutputIndexEntry& output = m_outputEntries[amount_outs_vec[i]];
+      if (!vis.handle_output(output)) {
         logger(Logging::INFO) << "Failed to handle_output for output no = " << count << ", with absolute offset " << i;
         return false;
       }
 
       if(count++ == absolute_offsets.size()-1 && pmax_related_block_height) {
-        if (*pmax_related_block_height < amount_outs_vec[i].first.block) {
-          *pmax_related_block_height = amount_outs_vec[i].first.block;
+        if (*pmax_related_block_height < output.transactionIndex.block) {
+          *pmax_related_block_height = output.transactionIndex.block;
         }
       }
     }
@@ -0,0 +1,143 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BlockchainJournal.h"
+
+#include <cstring>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "FortressCore/FortressBasic.h"
+
+namespace Fortress {
+
+namespace {
+
+const uint32_t JOURNAL_SIGNATURE = 0x314c4e4a; // "JNL1"
+const uint32_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+uint32_t recordChecksum(const BinaryArray& record) {
+  Crypto::Hash hash = Crypto::cn_fast_hash(record.data(), record.size());
+  uint32_t checksum;
+  memcpy(&checksum, &hash, sizeof checksum);
+  return checksum;
+}
+
+template<class T> bool readValue(std::istream& stream, T& value) {
+  stream.read(reinterpret_cast<char*>(&value), sizeof value);
+  return static_cast<bool>(stream);
+}
+
+template<class T> void writeValue(std::ostream& stream, const T& value) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+}
+
+BlockchainJournal::BlockchainJournal() : m_snapshotHash(NULL_HASH), m_recordCount(0) {
+}
+
+bool BlockchainJournal::open(const std::string& fileName, std::vector<BinaryArray>& records) {
+  close();
+  m_fileName = fileName;
+  records.clear();
+
+  uint64_t validSize = 0;
+  {
+    std::ifstream file(fileName, std::ios::binary);
+    uint32_t signature;
+    if (!file || !readValue(file, signature) || signature != JOURNAL_SIGNATURE || !readValue(file, m_snapshotHash)) {
+      return reset(NULL_HASH);
+    }
+
+    validSize = sizeof signature + sizeof m_snapshotHash;
+    for (;;) {
+      uint32_t size;
+      uint32_t checksum;
+      if (!readValue(file, size) || size > MAX_RECORD_SIZE) {
+        break;
+      }
+
+      BinaryArray record(size);
+      if (size != 0 && !file.read(reinterpret_cast<char*>(record.data()), size)) {
+        break;
+      }
+
+      if (!readValue(file, checksum) || checksum != recordChecksum(record)) {
+        break;
+      }
+
+      records.emplace_back(std::move(record));
+      validSize += sizeof size + size + sizeof checksum;
+    }
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::resize_file(fileName, validSize, ec);
+  if (ec) {
+    return false;
+  }
+
+  m_recordCount = records.size();
+  m_file.open(fileName, std::ios::binary | std::ios::out | std::ios::app);
+  return static_cast<bool>(m_file);
+}
+
+void BlockchainJournal::close() {
+  if (m_file.is_open()) {
+    m_file.close();
+  }
+}
+
+const Crypto::Hash& BlockchainJournal::snapshotHash() const {
+  return m_snapshotHash;
+}
+
+size_t BlockchainJournal::recordCount() const {
+  return m_recordCount;
+}
+
+void BlockchainJournal::append(const BinaryArray& record) {
+  if (!m_file.is_open()) {
+    throw std::runtime_error("BlockchainJournal::append");
+  }
+
+  writeValue(m_file, static_cast<uint32_t>(record.size()));
+  m_file.write(reinterpret_cast<const char*>(record.data()), record.size());
+  writeValue(m_file, recordChecksum(record));
+  m_file.flush();
+  if (!m_file) {
+    throw std::runtime_error("BlockchainJournal::append");
+  }
+
+  ++m_recordCount;
+}
+
+bool BlockchainJournal::reset(const Crypto::Hash& snapshotHash) {
+  close();
+
+  std::string temporaryFileName = m_fileName + ".tmp";
+  {
+    std::ofstream file(temporaryFileName, std::ios::binary | std::ios::trunc);
+    writeValue(file, JOURNAL_SIGNATURE);
+    writeValue(file, snapshotHash);
+    file.flush();
+    if (!file) {
+      return false;
+    }
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::rename(temporaryFileName, m_fileName, ec);
+  if (ec) {
+    return false;
+  }
+
+  m_snapshotHash = snapshotHash;
+  m_recordCount = 0;
+  m_file.open(m_fileName, std::ios::binary | std::ios::out | std::ios::app);
+  return static_cast<bool>(m_file);
+}
+
+}
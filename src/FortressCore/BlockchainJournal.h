@@ -0,0 +1,41 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Fortress.h"
+#include "crypto/hash.h"
+
+namespace Fortress {
+
+// Append-only log of records written after the blockchain state snapshot identified by the snapshot hash.
+// Every append is flushed, a record torn by a crash is dropped when the journal is opened.
+class BlockchainJournal {
+public:
+  BlockchainJournal();
+
+  // Opens the journal and reads its records, a missing or damaged journal is replaced by an empty one
+  // that follows no snapshot.
+  bool open(const std::string& fileName, std::vector<BinaryArray>& records);
+  void close();
+
+  const Crypto::Hash& snapshotHash() const;
+  // records written after the snapshot
+  size_t recordCount() const;
+  void append(const BinaryArray& record);
+  // Replaces the journal by an empty one that follows the given snapshot
+  bool reset(const Crypto::Hash& snapshotHash);
+
+private:
+  std::string m_fileName;
+  std::ofstream m_file;
+  Crypto::Hash m_snapshotHash;
+  size_t m_recordCount;
+};
+
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "CachedBlock.h"
+#include <Common/Varint.h>
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/FortressTools.h"
+
+namespace Fortress {
+
+CachedBlock::CachedBlock(const Block& block) : block(block) {
+}
+
+CachedBlock::CachedBlock(const Block& block, const BinaryArray& blockBinaryArray) : block(block), blockBinaryArray(blockBinaryArray) {
+}
+
+const Block& CachedBlock::getBlock() const {
+  return block;
+}
+
+const Crypto::Hash& CachedBlock::getBlockHash() const {
+  if (!blockHash.is_initialized()) {
+    blockHash = getObjectHash(getBlockHashingBinaryArray());
+  }
+
+  return blockHash.get();
+}
+
+const Crypto::Hash& CachedBlock::getBaseTransactionHash() const {
+  if (!baseTransactionHash.is_initialized()) {
+    baseTransactionHash = getObjectHash(block.baseTransaction);
+  }
+
+  return baseTransactionHash.get();
+}
+
+const Crypto::Hash& CachedBlock::getTransactionTreeHash() const {
+  if (!transactionTreeHash.is_initialized()) {
+    std::vector<Crypto::Hash> transactionHashes;
+    transactionHashes.reserve(block.transactionHashes.size() + 1);
+    transactionHashes.push_back(getBaseTransactionHash());
+    transactionHashes.insert(transactionHashes.end(), block.transactionHashes.begin(), block.transactionHashes.end());
+    transactionTreeHash = get_tx_tree_hash(transactionHashes);
+  }
+
+  return transactionTreeHash.get();
+}
+
+// same layout as get_block_hashing_blob
+const BinaryArray& CachedBlock::getBlockHashingBinaryArray() const {
+  if (!blockHashingBinaryArray.is_initialized()) {
+    BinaryArray binaryArray = toBinaryArray(static_cast<const BlockHeader&>(block));
+    const Crypto::Hash& treeHash = getTransactionTreeHash();
+    binaryArray.insert(binaryArray.end(), treeHash.data, treeHash.data + sizeof(treeHash.data));
+    auto transactionCount = Common::asBinaryArray(Tools::get_varint_data(block.transactionHashes.size() + 1));
+    binaryArray.insert(binaryArray.end(), transactionCount.begin(), transactionCount.end());
+    blockHashingBinaryArray = std::move(binaryArray);
+  }
+
+  return blockHashingBinaryArray.get();
+}
+
+const BinaryArray& CachedBlock::getBlockBinaryArray() const {
+  if (!blockBinaryArray.is_initialized()) {
+    blockBinaryArray = toBinaryArray(block);
+  }
+
+  return blockBinaryArray.get();
+}
+
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include "FortressCore/FortressBasic.h"
+
+namespace Fortress {
+
+// Refers to a block and computes its id, the hash of its base transaction and its blobs once, on
+// first use. The block must outlive the object and must not be changed.
+class CachedBlock {
+public:
+  explicit CachedBlock(const Block& block);
+  // blockBinaryArray is the blob the block was parsed from, it is not serialized again
+  CachedBlock(const Block& block, const BinaryArray& blockBinaryArray);
+
+  const Block& getBlock() const;
+  const Crypto::Hash& getBlockHash() const;
+  const Crypto::Hash& getBaseTransactionHash() const;
+  const Crypto::Hash& getTransactionTreeHash() const;
+  const BinaryArray& getBlockHashingBinaryArray() const;
+  const BinaryArray& getBlockBinaryArray() const;
+
+private:
+  const Block& block;
+  mutable boost::optional<BinaryArray> blockBinaryArray;
+  mutable boost::optional<BinaryArray> blockHashingBinaryArray;
+  mutable boost::optional<Crypto::Hash> blockHash;
+  mutable boost::optional<Crypto::Hash> baseTransactionHash;
+  mutable boost::optional<Crypto::Hash> transactionTreeHash;
+};
+
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "CachedTransaction.h"
+#include "FortressCore/FortressTools.h"
+
+namespace Fortress {
+
+CachedTransaction::CachedTransaction(const Transaction& transaction) : transaction(transaction) {
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash, size_t transactionBinarySize) :
+  transaction(transaction), transactionHash(transactionHash), transactionBinarySize(transactionBinarySize) {
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash, const Crypto::Hash& transactionPrefixHash, size_t transactionBinarySize) :
+  transaction(transaction), transactionHash(transactionHash), transactionPrefixHash(transactionPrefixHash), transactionBinarySize(transactionBinarySize) {
+}
+
+const Transaction& CachedTransaction::getTransaction() const {
+  return transaction;
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionHash() const {
+  if (!transactionHash.is_initialized()) {
+    // hash and size come from the same serialization
+    Crypto::Hash hash;
+    size_t size;
+    getObjectHash(transaction, hash, size);
+    transactionHash = hash;
+    transactionBinarySize = size;
+  }
+
+  return transactionHash.get();
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionPrefixHash() const {
+  if (!transactionPrefixHash.is_initialized()) {
+    transactionPrefixHash = getObjectHash(static_cast<const TransactionPrefix&>(transaction));
+  }
+
+  return transactionPrefixHash.get();
+}
+
+size_t CachedTransaction::getTransactionBinarySize() const {
+  if (!transactionBinarySize.is_initialized()) {
+    getTransactionHash();
+  }
+
+  return transactionBinarySize.get();
+}
+
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include "FortressCore/FortressBasic.h"
+
+namespace Fortress {
+
+// Refers to a transaction and computes its hashes and binary size once, on first use. Values that
+// are already known, e.g. from parsing the blob, are taken as is. The transaction must outlive the
+// object and must not be changed.
+class CachedTransaction {
+public:
+  explicit CachedTransaction(const Transaction& transaction);
+  CachedTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash, size_t transactionBinarySize);
+  CachedTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash, const Crypto::Hash& transactionPrefixHash, size_t transactionBinarySize);
+
+  const Transaction& getTransaction() const;
+  const Crypto::Hash& getTransactionHash() const;
+  const Crypto::Hash& getTransactionPrefixHash() const;
+  size_t getTransactionBinarySize() const;
+
+private:
+  const Transaction& transaction;
+  mutable boost::optional<Crypto::Hash> transactionHash;
+  mutable boost::optional<Crypto::Hash> transactionPrefixHash;
+  mutable boost::optional<size_t> transactionBinarySize;
+};
+
+}
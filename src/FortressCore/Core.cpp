@@ -14,6 +14,8 @@
 #include "../FortressProtocol/FortressProtocolDefinitions.h"
 #include "../Logging/LoggerRef.h"
 #include "../Rpc/CoreRpcServerCommandsDefinitions.h"
+#include "CachedBlock.h"
+#include "CachedTransaction.h"
 #include "FortressFormatUtils.h"
 #include "FortressTools.h"
 #include "FortressStatInfo.h"
@@ -150,15 +152,11 @@ size_t core::addChain(const std::vector<const IBlock*>& chain) {
   for (const IBlock* block : chain) {
     bool allTransactionsAdded = true;
     for (size_t txNumber = 0; txNumber < block->getTransactionCount(); ++txNumber) {
-      const Transaction& tx = block->getTransaction(txNumber);
-
-      Crypto::Hash txHash = NULL_HASH;
-      size_t blobSize = 0;
-      getObjectHash(tx, txHash, blobSize);
+      CachedTransaction transaction(block->getTransaction(txNumber));
       tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
 
-      if (!handleIncomingTransaction(tx, txHash, blobSize, tvc, true)) {
-        logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle transaction " << txHash << " from block " << blocksCounter << "/" << chain.size();
+      if (!handleIncomingTransaction(transaction, tvc, true)) {
+        logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle transaction " << transaction.getTransactionHash() << " from block " << blocksCounter << "/" << chain.size();
         allTransactionsAdded = false;
         break;
       }
@@ -169,9 +167,10 @@ size_t core::addChain(const std::vector<const IBlock*>& chain) {
     }
 
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_blockchain.addNewBlock(block->getBlock(), bvc);
+    CachedBlock cachedBlock(block->getBlock());
+    m_blockchain.addNewBlock(cachedBlock, bvc);
     if (bvc.m_marked_as_orphaned || bvc.m_verifivation_failed) {
-      logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle incoming block " << get_block_hash(block->getBlock()) <<
+      logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle incoming block " << cachedBlock.getBlockHash() <<
         ", " << blocksCounter << "/" << chain.size();
       break;
     }
@@ -204,7 +203,7 @@ bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_contex
   }
   //std::cout << "!"<< tx.inputs.size() << std::endl;
 
-  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block);
+  return handleIncomingTransaction(CachedTransaction(tx, tx_hash, tx_prefixt_hash, tx_blob.size()), tvc, keeped_by_block);
 }
 
 bool core::get_stat_info(core_stat_info& st_inf) {
@@ -282,7 +281,8 @@ size_t core::get_blockchain_total_transactions() {
 //  return m_blockchain.get_outs(amount, pkeys);
 //}
 
-bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block) {
+bool core::add_new_tx(const CachedTransaction& transaction, tx_verification_context& tvc, bool keeped_by_block) {
+  const Crypto::Hash& tx_hash = transaction.getTransactionHash();
   //Locking on m_mempool and m_blockchain closes possibility to add tx to memory pool which is already in blockchain 
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
   LockedBlockchainStorage lbs(m_blockchain);
@@ -297,7 +297,7 @@ bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t
     return true;
   }
 
-  return m_mempool.add_tx(tx, tx_hash, blob_size, tvc, keeped_by_block);
+  return m_mempool.add_tx(transaction, tvc, keeped_by_block);
 }
 
 bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) {
@@ -424,7 +424,7 @@ void core::update_block_template_and_resume_mining() {
 
 bool core::handle_block_found(Block& b) {
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
-  handle_incoming_block(b, bvc, true, true);
+  handle_incoming_block(CachedBlock(b), bvc, true, true);
 
   if (bvc.m_verifivation_failed) {
     logger(ERROR) << "mined block failed verification";
@@ -469,6 +469,13 @@ void core::getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vec
   assert(misses.empty());
 }
 
+std::vector<Crypto::Hash> core::getPoolChangesTransactionIds() {
+  std::vector<Crypto::Hash> addedTxsIds;
+  std::vector<Crypto::Hash> deletedTxsIds;
+  m_mempool.get_difference(std::vector<Crypto::Hash>(), addedTxsIds, deletedTxsIds);
+  return addedTxsIds;
+}
+
 bool core::handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) {
   if (block_blob.size() > m_currency.maxBlockBlobSize()) {
     logger(INFO) << "WRONG BLOCK BLOB, too big size " << block_blob.size() << ", rejected";
@@ -483,15 +490,16 @@ bool core::handle_incoming_block_blob(const BinaryArray& block_blob, block_verif
     return false;
   }
 
-  return handle_incoming_block(b, bvc, control_miner, relay_block);
+  return handle_incoming_block(CachedBlock(b, block_blob), bvc, control_miner, relay_block);
 }
 
-bool core::handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block) {
+bool core::handle_incoming_block(const CachedBlock& block, block_verification_context& bvc, bool control_miner, bool relay_block) {
   if (control_miner) {
     pause_mining();
   }
 
-  m_blockchain.addNewBlock(b, bvc);
+  const Block& b = block.getBlock();
+  m_blockchain.addNewBlock(block, bvc);
 
   if (control_miner) {
     update_block_template_and_resume_mining();
@@ -501,21 +509,18 @@ bool core::handle_incoming_block(const Block& b, block_verification_context& bvc
     std::list<Crypto::Hash> missed_txs;
     std::list<Transaction> txs;
     m_blockchain.getTransactions(b.transactionHashes, txs, missed_txs);
-    if (!missed_txs.empty() && getBlockIdByHeight(get_block_height(b)) != get_block_hash(b)) {
+    if (!missed_txs.empty() && getBlockIdByHeight(get_block_height(b)) != block.getBlockHash()) {
       logger(INFO) << "Block added, but it seems that reorganize just happened after that, do not relay this block";
     } else {
       if (!(txs.size() == b.transactionHashes.size() && missed_txs.empty())) {
         logger(ERROR, BRIGHT_RED) << "can't find some transactions in found block:" <<
-          get_block_hash(b) << " txs.size()=" << txs.size() << ", b.transactionHashes.size()=" << b.transactionHashes.size() << ", missed_txs.size()" << missed_txs.size(); return false;
+          block.getBlockHash() << " txs.size()=" << txs.size() << ", b.transactionHashes.size()=" << b.transactionHashes.size() << ", missed_txs.size()" << missed_txs.size(); return false;
       }
 
       NOTIFY_NEW_BLOCK::request arg;
       arg.hop = 0;
       arg.current_blockchain_height = m_blockchain.getCurrentBlockchainHeight();
-      BinaryArray blockBa;
-      bool r = toBinaryArray(b, blockBa);
-      if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to serialize block"; return false; }
-      arg.b.block = asString(blockBa);
+      arg.b.block = asString(block.getBlockBinaryArray());
       for (auto& tx : txs) {
         arg.b.txs.push_back(asString(toBinaryArray(tx)));
       }
@@ -558,6 +563,10 @@ std::vector<Transaction> core::getPoolTransactions() {
   return result;
 }
 
+bool core::havePoolTransaction(const Crypto::Hash& transactionHash) {
+  return m_mempool.have_tx(transactionHash);
+}
+
 std::vector<Crypto::Hash> core::buildSparseChain() {
   assert(m_blockchain.getCurrentBlockchainHeight() != 0);
   return m_blockchain.buildSparseChain();
@@ -675,11 +684,14 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
 
   std::list<Block> blocks;
   lbs->getBlocks(startFullOffset, blocksLeft, blocks);
+  // ids of stored blocks are kept in the index, no need to hash the blocks again
+  std::vector<Crypto::Hash> fullBlockIds = lbs->getBlockIds(startFullOffset, static_cast<uint32_t>(blocks.size()));
+  auto fullBlockId = fullBlockIds.begin();
 
   for (auto& b : blocks) {
     BlockFullInfo item;
 
-    item.block_id = get_block_hash(b);
+    item.block_id = *fullBlockId++;
 
     if (b.timestamp >= timestamp) {
       // query transactions
@@ -763,11 +775,13 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
 
   std::list<Block> blocks;
   lbs->getBlocks(resFullOffset, blocksLeft, blocks);
+  std::vector<Crypto::Hash> fullBlockIds = lbs->getBlockIds(resFullOffset, static_cast<uint32_t>(blocks.size()));
+  auto fullBlockId = fullBlockIds.begin();
 
   for (auto& b : blocks) {
     BlockShortInfo item;
 
-    item.blockId = get_block_hash(b);
+    item.blockId = *fullBlockId++;
 
     if (b.timestamp >= timestamp) {
       std::list<Transaction> txs;
@@ -776,10 +790,12 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
 
       item.block = asString(toBinaryArray(b));
 
+      // transactions come back in the order of the block, so the hashes stored in it can be used
+      auto txHash = b.transactionHashes.begin();
       for (const auto& tx: txs) {
         TransactionPrefixInfo info;
         info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
+        info.txHash = missedTxs.empty() ? *txHash++ : getObjectHash(tx);
 
         item.txPrefixes.push_back(std::move(info));
       }
@@ -812,15 +828,16 @@ bool core::scanOutputkeysForIndices(const KeyInput& txInToKey, std::list<std::pa
   struct outputs_visitor
   {
     std::list<std::pair<Crypto::Hash, size_t>>& m_resultsCollector;
-    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector):m_resultsCollector(resultsCollector){}
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex)
+    Blockchain& m_blockchain;
+    outputs_visitor(std::list<std::pair<Crypto::Hash, size_t>>& resultsCollector, Blockchain& blockchain):m_resultsCollector(resultsCollector), m_blockchain(blockchain){}
+    bool handle_output(const Blockchain::OutputIndexEntry& output)
     {
-      m_resultsCollector.push_back(std::make_pair(getObjectHash(tx), transactionOutputIndex));
+      m_resultsCollector.push_back(std::make_pair(m_blockchain.getTransactionHash(output.transactionIndex), output.outputIndex));
       return true;
     }
   };
     
-  outputs_visitor vi(outputReferences);
+  outputs_visitor vi(outputReferences, m_blockchain);
     
   return m_blockchain.scanOutputKeysForIndexes(txInToKey, vi);
 }
@@ -927,6 +944,12 @@ uint64_t core::getTotalGeneratedAmount() {
 }
 
 bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock) {
+  return handleIncomingTransaction(CachedTransaction(tx, txHash, blobSize), tvc, keptByBlock);
+}
+
+bool core::handleIncomingTransaction(const CachedTransaction& transaction, tx_verification_context& tvc, bool keptByBlock) {
+  const Transaction& tx = transaction.getTransaction();
+  const Crypto::Hash& txHash = transaction.getTransactionHash();
   if (!check_tx_syntax(tx)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
     tvc.m_verifivation_failed = true;
@@ -939,7 +962,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
     return false;
   }
 
-  bool r = add_new_tx(tx, txHash, blobSize, tvc, keptByBlock);
+  bool r = add_new_tx(transaction, tvc, keptByBlock);
   if (tvc.m_verifivation_failed) {
     if (!tvc.m_tx_fee_too_small) {
       logger(ERROR) << "Transaction verification failed: " << txHash;
@@ -38,6 +38,7 @@ namespace Fortress {
      bool on_idle() override;
      virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) override; //Deprecated. Should be removed with FortressProtocolHandler.
      bool handle_incoming_block_blob(const BinaryArray& block_blob, block_verification_context& bvc, bool control_miner, bool relay_block) override;
+     bool handle_incoming_block(const CachedBlock& block, block_verification_context& bvc, bool control_miner, bool relay_block) override;
      virtual i_Fortress_protocol* get_protocol() override {return m_pprotocol;}
      const Currency& currency() const { return m_currency; }
 
@@ -110,6 +111,7 @@ namespace Fortress {
      void set_checkpoints(Checkpoints&& chk_pts);
 
      std::vector<Transaction> getPoolTransactions() override;
+     bool havePoolTransaction(const Crypto::Hash& transactionHash) override;
      size_t get_pool_transactions_count();
      size_t get_blockchain_total_transactions();
      //bool get_outs(uint64_t amount, std::list<Crypto::PublicKey>& pkeys);
@@ -134,15 +136,17 @@ namespace Fortress {
                                   std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
      virtual void getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Transaction>& addedTxs,
                                  std::vector<Crypto::Hash>& deletedTxsIds) override;
+     // ids of the pool transactions getPoolChanges reports as added to an empty known set
+     std::vector<Crypto::Hash> getPoolChangesTransactionIds();
 
      uint64_t getNextBlockDifficulty();
      uint64_t getTotalGeneratedAmount();
 
    private:
-     bool add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block);
+     bool add_new_tx(const CachedTransaction& transaction, tx_verification_context& tvc, bool keeped_by_block);
+     bool handleIncomingTransaction(const CachedTransaction& transaction, tx_verification_context& tvc, bool keptByBlock);
      bool load_state_data();
      bool parse_tx_from_blob(Transaction& tx, Crypto::Hash& tx_hash, Crypto::Hash& tx_prefix_hash, const BinaryArray& blob);
-     bool handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block);
 
      bool check_tx_syntax(const Transaction& tx);
      //check correct values, amounts and all lightweight checks not related with database
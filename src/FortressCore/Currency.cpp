@@ -61,8 +61,12 @@ bool Currency::init() {
     m_blocksFileName = "testnet_" + m_blocksFileName;
     m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
     m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
+    m_blockStoreFileName = "testnet_" + m_blockStoreFileName;
+    m_blockStoreIndexFileName = "testnet_" + m_blockStoreIndexFileName;
+    m_outputStoreFileName = "testnet_" + m_outputStoreFileName;
     m_txPoolFileName = "testnet_" + m_txPoolFileName;
     m_blockchinIndicesFileName = "testnet_" + m_blockchinIndicesFileName;
+    m_blockchainJournalFileName = "testnet_" + m_blockchainJournalFileName;
   }
 
   return true;
@@ -475,8 +479,12 @@ CurrencyBuilder::CurrencyBuilder(Logging::ILogger& log) : m_currency(log) {
   blocksFileName(parameters::Fortress_BLOCKS_FILENAME);
   blocksCacheFileName(parameters::Fortress_BLOCKSCACHE_FILENAME);
   blockIndexesFileName(parameters::Fortress_BLOCKINDEXES_FILENAME);
+  blockStoreFileName(parameters::Fortress_BLOCKSTORE_FILENAME);
+  blockStoreIndexFileName(parameters::Fortress_BLOCKSTORE_INDEX_FILENAME);
+  outputStoreFileName(parameters::Fortress_OUTPUTSTORE_FILENAME);
   txPoolFileName(parameters::Fortress_POOLDATA_FILENAME);
   blockchinIndicesFileName(parameters::Fortress_BLOCKCHAIN_INDICES_FILENAME);
+  blockchainJournalFileName(parameters::Fortress_BLOCKCHAIN_JOURNAL_FILENAME);
 
   testnet(false);
 }
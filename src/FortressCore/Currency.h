@@ -66,8 +66,12 @@ public:
   const std::string& blocksFileName() const { return m_blocksFileName; }
   const std::string& blocksCacheFileName() const { return m_blocksCacheFileName; }
   const std::string& blockIndexesFileName() const { return m_blockIndexesFileName; }
+  const std::string& blockStoreFileName() const { return m_blockStoreFileName; }
+  const std::string& blockStoreIndexFileName() const { return m_blockStoreIndexFileName; }
+  const std::string& outputStoreFileName() const { return m_outputStoreFileName; }
   const std::string& txPoolFileName() const { return m_txPoolFileName; }
   const std::string& blockchinIndicesFileName() const { return m_blockchinIndicesFileName; }
+  const std::string& blockchainJournalFileName() const { return m_blockchainJournalFileName; }
 
   bool isTestnet() const { return m_testnet; }
 
@@ -155,8 +159,12 @@ private:
   std::string m_blocksFileName;
   std::string m_blocksCacheFileName;
   std::string m_blockIndexesFileName;
+  std::string m_blockStoreFileName;
+  std::string m_blockStoreIndexFileName;
+  std::string m_outputStoreFileName;
   std::string m_txPoolFileName;
   std::string m_blockchinIndicesFileName;
+  std::string m_blockchainJournalFileName;
 
   static const std::vector<uint64_t> PRETTY_AMOUNTS;
 
@@ -227,8 +235,12 @@ public:
   CurrencyBuilder& blocksFileName(const std::string& val) { m_currency.m_blocksFileName = val; return *this; }
   CurrencyBuilder& blocksCacheFileName(const std::string& val) { m_currency.m_blocksCacheFileName = val; return *this; }
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
+  CurrencyBuilder& blockStoreFileName(const std::string& val) { m_currency.m_blockStoreFileName = val; return *this; }
+  CurrencyBuilder& blockStoreIndexFileName(const std::string& val) { m_currency.m_blockStoreIndexFileName = val; return *this; }
+  CurrencyBuilder& outputStoreFileName(const std::string& val) { m_currency.m_outputStoreFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchinIndicesFileName(const std::string& val) { m_currency.m_blockchinIndicesFileName = val; return *this; }
+  CurrencyBuilder& blockchainJournalFileName(const std::string& val) { m_currency.m_blockchainJournalFileName = val; return *this; }
   
   CurrencyBuilder& testnet(bool val) { m_currency.m_testnet = val; return *this; }
 
@@ -0,0 +1,71 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "DifficultyWindow.h"
+
+#include <cassert>
+
+namespace Fortress {
+
+DifficultyWindow::DifficultyWindow(size_t capacity) : m_entries(capacity), m_beginHeight(0) {
+}
+
+size_t DifficultyWindow::capacity() const {
+  return m_entries.capacity();
+}
+
+size_t DifficultyWindow::size() const {
+  return m_entries.size();
+}
+
+bool DifficultyWindow::full() const {
+  return m_entries.full();
+}
+
+uint32_t DifficultyWindow::beginHeight() const {
+  return m_beginHeight;
+}
+
+uint32_t DifficultyWindow::endHeight() const {
+  return m_beginHeight + static_cast<uint32_t>(m_entries.size());
+}
+
+void DifficultyWindow::clear(uint32_t height) {
+  m_entries.clear();
+  m_beginHeight = height;
+}
+
+void DifficultyWindow::push(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  if (m_entries.full()) {
+    ++m_beginHeight;
+  }
+
+  Entry entry = { timestamp, cumulativeDifficulty };
+  m_entries.push_back(entry);
+}
+
+void DifficultyWindow::pop() {
+  assert(!m_entries.empty());
+  m_entries.pop_back();
+}
+
+void DifficultyWindow::pushFront(uint64_t timestamp, difficulty_type cumulativeDifficulty) {
+  assert(!m_entries.full() && m_beginHeight != 0);
+  Entry entry = { timestamp, cumulativeDifficulty };
+  m_entries.push_front(entry);
+  --m_beginHeight;
+}
+
+void DifficultyWindow::copy(uint32_t begin, uint32_t end, std::vector<uint64_t>& timestamps, std::vector<difficulty_type>& cumulativeDifficulties) const {
+  assert(m_beginHeight <= begin && begin <= end && end <= endHeight());
+  timestamps.reserve(timestamps.size() + (end - begin));
+  cumulativeDifficulties.reserve(cumulativeDifficulties.size() + (end - begin));
+  for (uint32_t height = begin; height < end; ++height) {
+    const Entry& entry = m_entries[height - m_beginHeight];
+    timestamps.push_back(entry.timestamp);
+    cumulativeDifficulties.push_back(entry.cumulativeDifficulty);
+  }
+}
+
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/circular_buffer.hpp>
+
+#include "Difficulty.h"
+
+namespace Fortress {
+
+// Timestamps and cumulative difficulties of the newest blocks of a chain, the input of Currency::nextDifficulty.
+// The window covers a contiguous range of heights and follows the chain top as blocks are pushed and popped.
+class DifficultyWindow {
+public:
+  explicit DifficultyWindow(size_t capacity);
+
+  size_t capacity() const;
+  size_t size() const;
+  bool full() const;
+  // Height of the oldest block in the window
+  uint32_t beginHeight() const;
+  // Height following the newest block in the window
+  uint32_t endHeight() const;
+
+  // Empties the window, the next pushed block gets the given height
+  void clear(uint32_t height);
+  // Appends the block at endHeight, the oldest block is dropped when the window is full
+  void push(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+  // Removes the newest block
+  void pop();
+  // Prepends the block at beginHeight - 1, the window must not be full
+  void pushFront(uint64_t timestamp, difficulty_type cumulativeDifficulty);
+
+  // Appends the blocks with heights in [begin, end), the range must lie within the window
+  void copy(uint32_t begin, uint32_t end, std::vector<uint64_t>& timestamps, std::vector<difficulty_type>& cumulativeDifficulties) const;
+
+private:
+  struct Entry {
+    uint64_t timestamp;
+    difficulty_type cumulativeDifficulty;
+  };
+
+  boost::circular_buffer<Entry> m_entries;
+  uint32_t m_beginHeight;
+};
+
+}
@@ -28,6 +28,7 @@ class IBlock;
 class ICoreObserver;
 struct Block;
 struct block_verification_context;
+class CachedBlock;
 struct BlockFullInfo;
 struct BlockShortInfo;
 struct core_stat_info;
@@ -53,6 +54,7 @@ public:
   virtual void pause_mining() = 0;
   virtual void update_block_template_and_resume_mining() = 0;
   virtual bool handle_incoming_block_blob(const Fortress::BinaryArray& block_blob, Fortress::block_verification_context& bvc, bool control_miner, bool relay_block) = 0;
+  virtual bool handle_incoming_block(const CachedBlock& block, Fortress::block_verification_context& bvc, bool control_miner, bool relay_block) = 0;
   virtual bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS_request& arg, NOTIFY_RESPONSE_GET_OBJECTS_request& rsp) = 0; //Deprecated. Should be removed with FortressProtocolHandler.
   virtual void on_synchronized() = 0;
   virtual size_t addChain(const std::vector<const IBlock*>& chain) = 0;
@@ -66,6 +68,7 @@ public:
   virtual i_Fortress_protocol* get_protocol() = 0;
   virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) = 0; //Deprecated. Should be removed with FortressProtocolHandler.
   virtual std::vector<Transaction> getPoolTransactions() = 0;
+  virtual bool havePoolTransaction(const Crypto::Hash& transactionHash) = 0;
   virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                               std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) = 0;
   virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "FortressCore/FortressBasic.h"
+#include "FortressCore/CachedTransaction.h"
 
 namespace Fortress {
 
@@ -30,8 +31,8 @@ namespace Fortress {
   public:
     virtual ~ITransactionValidator() {}
     
-    virtual bool checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock) = 0;
-    virtual bool checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) = 0;
+    virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock) = 0;
+    virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) = 0;
     virtual bool haveSpentKeyImages(const Fortress::Transaction& tx) = 0;
     virtual bool checkTransactionSize(size_t blobSize) = 0;
   };
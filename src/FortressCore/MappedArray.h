@@ -0,0 +1,246 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// Append-only array of fixed-size trivially copyable items stored in memory mapped segment files.
+// Items are addressed by their position and returned by reference into the mapping, segments are never remapped,
+// so references stay valid until the array is closed. Only the header with the item count is kept in the header
+// file, the items themselves are paged in by the OS when they are read.
+//
+// An item is written before the count is increased, so an interrupted process leaves a consistent prefix.
+template<class T> class MappedArray {
+  static_assert(std::is_pod<T>::value, "MappedArray items are copied as raw memory");
+
+public:
+  typedef T value_type;
+
+  static const uint64_t DEFAULT_SEGMENT_SIZE = 256 * 1024 * 1024;
+
+  explicit MappedArray(uint64_t segmentSize = DEFAULT_SEGMENT_SIZE);
+  MappedArray(const MappedArray&) = delete;
+  ~MappedArray();
+  MappedArray& operator=(const MappedArray&) = delete;
+
+  bool open(const std::string& fileName);
+  void close();
+  // Writes modified pages of the mapped files to disk.
+  void flush();
+
+  bool empty() const;
+  uint64_t size() const;
+  const T& operator[](uint64_t index) const;
+  void clear();
+  // Drops the items from count on, the array never grows by resize.
+  void resize(uint64_t count);
+  void push_back(const T& item);
+
+private:
+  struct Header {
+    uint64_t signature;
+    uint64_t itemSize;
+    uint64_t segmentSize;
+    uint64_t count;
+  };
+
+  static const uint64_t SIGNATURE = 0x3130524141504d46ULL; // "FMPAAR01"
+
+  uint64_t m_defaultSegmentSize;
+  uint64_t m_segmentSize;
+  uint64_t m_segmentCapacity;
+  std::string m_fileName;
+  std::unique_ptr<boost::interprocess::mapped_region> m_headerRegion;
+  std::vector<std::unique_ptr<boost::interprocess::mapped_region>> m_segments;
+  uint64_t m_count;
+
+  static void createFile(const std::string& fileName, uint64_t size);
+
+  std::string segmentFileName(uint64_t segment) const;
+  Header& header();
+  void mapHeader();
+  bool mapSegment(uint64_t segment, bool create);
+  void writeCount(uint64_t count);
+};
+
+template<class T> MappedArray<T>::MappedArray(uint64_t segmentSize) : m_defaultSegmentSize(segmentSize), m_segmentSize(segmentSize),
+  m_segmentCapacity(0), m_count(0) {
+}
+
+template<class T> MappedArray<T>::~MappedArray() {
+  close();
+}
+
+template<class T> bool MappedArray<T>::open(const std::string& fileName) {
+  if (m_defaultSegmentSize < sizeof(T)) {
+    return false;
+  }
+
+  close();
+  m_fileName = fileName;
+
+  try {
+    boost::system::error_code ec;
+    uint64_t fileSize = boost::filesystem::file_size(fileName, ec);
+    if (ec || fileSize < sizeof(Header)) {
+      createFile(fileName, sizeof(Header));
+      mapHeader();
+      header().signature = SIGNATURE;
+      header().itemSize = sizeof(T);
+      header().segmentSize = m_defaultSegmentSize;
+      header().count = 0;
+      m_segmentSize = m_defaultSegmentSize;
+      m_segmentCapacity = m_segmentSize / sizeof(T);
+      return true;
+    }
+
+    mapHeader();
+    if (header().signature != SIGNATURE || header().itemSize != sizeof(T) || header().segmentSize < sizeof(T)) {
+      close();
+      return false;
+    }
+
+    m_segmentSize = header().segmentSize;
+    m_segmentCapacity = m_segmentSize / sizeof(T);
+    uint64_t count = header().count;
+    uint64_t segmentCount = (count + m_segmentCapacity - 1) / m_segmentCapacity;
+    for (uint64_t segment = 0; segment < segmentCount; ++segment) {
+      if (!mapSegment(segment, false)) {
+        count = segment * m_segmentCapacity;
+        break;
+      }
+    }
+
+    m_count = count;
+    if (m_count != header().count) {
+      writeCount(m_count);
+    }
+  } catch (std::exception&) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+template<class T> void MappedArray<T>::close() {
+  flush();
+  m_segments.clear();
+  m_headerRegion.reset();
+  m_count = 0;
+}
+
+template<class T> void MappedArray<T>::flush() {
+  if (m_headerRegion) {
+    for (auto& segment : m_segments) {
+      segment->flush();
+    }
+
+    m_headerRegion->flush();
+  }
+}
+
+template<class T> bool MappedArray<T>::empty() const {
+  return m_count == 0;
+}
+
+template<class T> uint64_t MappedArray<T>::size() const {
+  return m_count;
+}
+
+template<class T> const T& MappedArray<T>::operator[](uint64_t index) const {
+  return static_cast<const T*>(m_segments[index / m_segmentCapacity]->get_address())[index % m_segmentCapacity];
+}
+
+template<class T> void MappedArray<T>::clear() {
+  resize(0);
+}
+
+template<class T> void MappedArray<T>::resize(uint64_t count) {
+  if (!m_headerRegion || count > m_count) {
+    throw std::runtime_error("MappedArray::resize");
+  }
+
+  writeCount(count);
+}
+
+template<class T> void MappedArray<T>::push_back(const T& item) {
+  if (!m_headerRegion) {
+    throw std::runtime_error("MappedArray::push_back");
+  }
+
+  uint64_t segment = m_count / m_segmentCapacity;
+  if (!mapSegment(segment, true)) {
+    throw std::runtime_error("MappedArray::push_back, failed to map segment");
+  }
+
+  memcpy(static_cast<T*>(m_segments[segment]->get_address()) + m_count % m_segmentCapacity, &item, sizeof(T));
+  writeCount(m_count + 1);
+}
+
+template<class T> void MappedArray<T>::createFile(const std::string& fileName, uint64_t size) {
+  {
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw std::runtime_error("MappedArray: failed to create " + fileName);
+    }
+  }
+
+  boost::filesystem::resize_file(fileName, size);
+}
+
+template<class T> std::string MappedArray<T>::segmentFileName(uint64_t segment) const {
+  std::string number = std::to_string(segment);
+  return m_fileName + "." + std::string(number.size() < 4 ? 4 - number.size() : 0, '0') + number;
+}
+
+template<class T> typename MappedArray<T>::Header& MappedArray<T>::header() {
+  return *static_cast<Header*>(m_headerRegion->get_address());
+}
+
+template<class T> void MappedArray<T>::mapHeader() {
+  boost::interprocess::file_mapping mapping(m_fileName.c_str(), boost::interprocess::read_write);
+  m_headerRegion.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_write, 0, sizeof(Header)));
+}
+
+template<class T> bool MappedArray<T>::mapSegment(uint64_t segment, bool create) {
+  if (segment < m_segments.size()) {
+    return true;
+  }
+
+  while (m_segments.size() <= segment) {
+    std::string fileName = segmentFileName(m_segments.size());
+    boost::system::error_code ec;
+    uint64_t fileSize = boost::filesystem::file_size(fileName, ec);
+    if (ec || fileSize != m_segmentSize) {
+      if (!create) {
+        return false;
+      }
+
+      createFile(fileName, m_segmentSize);
+    }
+
+    boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_write);
+    m_segments.emplace_back(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_write, 0, m_segmentSize));
+  }
+
+  return true;
+}
+
+template<class T> void MappedArray<T>::writeCount(uint64_t count) {
+  header().count = count;
+  m_count = count;
+}
@@ -0,0 +1,545 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "Common/ArrayView.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+#include "crypto/hash.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+
+// Append-only vector of serialized items stored in memory mapped segment files.
+// The index file holds a fixed-size record (offset, size, checksum) per item, so any item is located without
+// reading the items before it. Items never cross a segment boundary and segments are never remapped, so raw item
+// data may be accessed without copying. Deserialized items are kept in an LRU cache of poolSize entries.
+//
+// Items are written before the index record and the record before the item count, so an interrupted process leaves
+// a consistent prefix. On open the tail records are verified against the segment data and the vector is truncated
+// to the last item that survived.
+template<class T> class MappedVector {
+public:
+  typedef T value_type;
+
+  static const uint64_t DEFAULT_SEGMENT_SIZE = 256 * 1024 * 1024;
+  static const uint64_t RECOVERY_CHECK_DEPTH = 16;
+
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef const T* pointer;
+    typedef const T& reference;
+    typedef T value_type;
+
+    const_iterator() {
+    }
+
+    const_iterator(MappedVector* mappedVector, size_t index) : m_mappedVector(mappedVector), m_index(index) {
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const const_iterator& other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator<=(const const_iterator& other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator>(const const_iterator& other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator>=(const const_iterator& other) const {
+      return m_index >= other.m_index;
+    }
+
+    const_iterator& operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator i = *this;
+      ++m_index;
+      return i;
+    }
+
+    const_iterator& operator--() {
+      --m_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator i = *this;
+      --m_index;
+      return i;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index + n);
+    }
+
+    friend const_iterator operator+(difference_type n, const const_iterator& i) {
+      return const_iterator(i.m_mappedVector, n + i.m_index);
+    }
+
+    difference_type operator-(const const_iterator& other) const {
+      return m_index - other.m_index;
+    }
+
+    const_iterator operator-(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index - n);
+    }
+
+    const T& operator*() const {
+      return (*m_mappedVector)[m_index];
+    }
+
+    const T* operator->() const {
+      return &(*m_mappedVector)[m_index];
+    }
+
+    const T& operator[](difference_type offset) const {
+      return (*m_mappedVector)[m_index + offset];
+    }
+
+    size_t index() const {
+      return m_index;
+    }
+
+  private:
+    MappedVector* m_mappedVector;
+    size_t m_index;
+  };
+
+  explicit MappedVector(uint64_t segmentSize = DEFAULT_SEGMENT_SIZE);
+  MappedVector(const MappedVector&) = delete;
+  ~MappedVector();
+  MappedVector& operator=(const MappedVector&) = delete;
+
+  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  void close();
+  // Writes modified pages of the mapped files to disk.
+  void flush();
+
+  bool empty() const;
+  uint64_t size() const;
+  const_iterator begin();
+  const_iterator end();
+  const T& operator[](uint64_t index);
+  const T& front();
+  const T& back();
+  void clear();
+  void pop_back();
+  void push_back(const T& item);
+
+  // Serialized item, stays valid until the item is removed or the vector is closed.
+  Common::ArrayView<uint8_t> raw(uint64_t index) const;
+  // Deserializes the leading fields of an item without touching the cache. Part must serialize a prefix of T.
+  template<class Part> void load(uint64_t index, Part& part) const;
+
+private:
+  struct IndexHeader {
+    uint64_t signature;
+    uint64_t segmentSize;
+    uint64_t count;
+    uint64_t reserved;
+  };
+
+  struct IndexRecord {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t checksum;
+  };
+
+  struct ItemEntry;
+  struct CacheEntry;
+
+  struct ItemEntry {
+  public:
+    T item;
+    typename std::list<CacheEntry>::iterator cacheIter;
+  };
+
+  struct CacheEntry {
+  public:
+    typename std::map<uint64_t, ItemEntry>::iterator itemIter;
+  };
+
+  static const uint64_t SIGNATURE = 0x31305453444b4c42ULL; // "BLKDST01"
+  static const uint64_t INITIAL_INDEX_CAPACITY = 1024;
+
+  uint64_t m_defaultSegmentSize;
+  uint64_t m_segmentSize;
+  std::string m_itemFileName;
+  std::string m_indexFileName;
+  std::unique_ptr<boost::interprocess::mapped_region> m_indexRegion;
+  uint64_t m_indexCapacity;
+  std::vector<std::unique_ptr<boost::interprocess::mapped_region>> m_segments;
+  std::vector<IndexRecord> m_records;
+  size_t m_poolSize;
+  std::map<uint64_t, ItemEntry> m_items;
+  std::list<CacheEntry> m_cache;
+
+  static uint32_t checksum(const uint8_t* data, size_t size);
+  static void createFile(const std::string& fileName, uint64_t size);
+
+  std::string segmentFileName(uint64_t segment) const;
+  IndexHeader& header();
+  IndexRecord* indexRecords();
+  void mapIndex();
+  void reserveIndex(uint64_t capacity);
+  bool mapSegment(uint64_t segment, bool create);
+  void writeCount(uint64_t count);
+  const uint8_t* itemData(uint64_t index) const;
+  T* prepare(uint64_t index);
+};
+
+template<class T> MappedVector<T>::MappedVector(uint64_t segmentSize) : m_defaultSegmentSize(segmentSize), m_segmentSize(segmentSize), m_indexCapacity(0), m_poolSize(0) {
+}
+
+template<class T> MappedVector<T>::~MappedVector() {
+  close();
+}
+
+template<class T> bool MappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
+  if (poolSize == 0 || m_defaultSegmentSize == 0) {
+    return false;
+  }
+
+  close();
+  m_itemFileName = itemFileName;
+  m_indexFileName = indexFileName;
+  m_poolSize = poolSize;
+
+  try {
+    boost::system::error_code ec;
+    uint64_t indexFileSize = boost::filesystem::file_size(indexFileName, ec);
+    if (ec || indexFileSize < sizeof(IndexHeader)) {
+      createFile(indexFileName, sizeof(IndexHeader) + INITIAL_INDEX_CAPACITY * sizeof(IndexRecord));
+      mapIndex();
+      header().signature = SIGNATURE;
+      header().segmentSize = m_defaultSegmentSize;
+      header().count = 0;
+      header().reserved = 0;
+      m_segmentSize = m_defaultSegmentSize;
+      return true;
+    }
+
+    mapIndex();
+    if (header().signature != SIGNATURE || header().segmentSize == 0) {
+      close();
+      return false;
+    }
+
+    m_segmentSize = header().segmentSize;
+    uint64_t count = std::min(header().count, m_indexCapacity);
+    m_records.reserve(count);
+    uint64_t itemsEnd = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+      const IndexRecord& record = indexRecords()[i];
+      uint64_t segment = record.offset / m_segmentSize;
+      if (record.offset < itemsEnd || record.offset % m_segmentSize + record.size > m_segmentSize || !mapSegment(segment, false)) {
+        break;
+      }
+
+      m_records.push_back(record);
+      itemsEnd = record.offset + record.size;
+    }
+
+    // Only the most recent items may be left incomplete by an interrupted write.
+    uint64_t firstChecked = m_records.size() > RECOVERY_CHECK_DEPTH ? m_records.size() - RECOVERY_CHECK_DEPTH : 0;
+    for (uint64_t i = firstChecked; i < m_records.size(); ++i) {
+      if (checksum(itemData(i), m_records[i].size) != m_records[i].checksum) {
+        m_records.resize(i);
+        break;
+      }
+    }
+
+    if (m_records.size() != header().count) {
+      writeCount(m_records.size());
+    }
+  } catch (std::exception&) {
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+template<class T> void MappedVector<T>::close() {
+  flush();
+  m_items.clear();
+  m_cache.clear();
+  m_records.clear();
+  m_segments.clear();
+  m_indexRegion.reset();
+  m_indexCapacity = 0;
+}
+
+template<class T> void MappedVector<T>::flush() {
+  if (m_indexRegion) {
+    for (auto& segment : m_segments) {
+      segment->flush();
+    }
+
+    m_indexRegion->flush();
+  }
+}
+
+template<class T> bool MappedVector<T>::empty() const {
+  return m_records.empty();
+}
+
+template<class T> uint64_t MappedVector<T>::size() const {
+  return m_records.size();
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::begin() {
+  return const_iterator(this, 0);
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::end() {
+  return const_iterator(this, m_records.size());
+}
+
+template<class T> const T& MappedVector<T>::operator[](uint64_t index) {
+  auto itemIter = m_items.find(index);
+  if (itemIter != m_items.end()) {
+    if (itemIter->second.cacheIter != --m_cache.end()) {
+      m_cache.splice(m_cache.end(), m_cache, itemIter->second.cacheIter);
+    }
+
+    return itemIter->second.item;
+  }
+
+  T tempItem;
+  load(index, tempItem);
+
+  T* item = prepare(index);
+  std::swap(tempItem, *item);
+  return *item;
+}
+
+template<class T> const T& MappedVector<T>::front() {
+  return operator[](0);
+}
+
+template<class T> const T& MappedVector<T>::back() {
+  return operator[](m_records.size() - 1);
+}
+
+template<class T> void MappedVector<T>::clear() {
+  if (!m_indexRegion) {
+    throw std::runtime_error("MappedVector::clear");
+  }
+
+  writeCount(0);
+  m_records.clear();
+  m_items.clear();
+  m_cache.clear();
+}
+
+template<class T> void MappedVector<T>::pop_back() {
+  if (!m_indexRegion || m_records.empty()) {
+    throw std::runtime_error("MappedVector::pop_back");
+  }
+
+  writeCount(m_records.size() - 1);
+  m_records.pop_back();
+  auto itemIter = m_items.find(m_records.size());
+  if (itemIter != m_items.end()) {
+    m_cache.erase(itemIter->second.cacheIter);
+    m_items.erase(itemIter);
+  }
+}
+
+template<class T> void MappedVector<T>::push_back(const T& item) {
+  if (!m_indexRegion) {
+    throw std::runtime_error("MappedVector::push_back");
+  }
+
+  std::vector<uint8_t> data;
+  {
+    Common::VectorOutputStream stream(data);
+    Fortress::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+  }
+
+  if (data.size() > m_segmentSize || data.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("MappedVector::push_back, item is larger than a segment");
+  }
+
+  uint64_t offset = m_records.empty() ? 0 : m_records.back().offset + m_records.back().size;
+  if (offset % m_segmentSize + data.size() > m_segmentSize) {
+    offset += m_segmentSize - offset % m_segmentSize;
+  }
+
+  uint64_t segment = offset / m_segmentSize;
+  if (!mapSegment(segment, true)) {
+    throw std::runtime_error("MappedVector::push_back, failed to map segment");
+  }
+
+  if (!data.empty()) {
+    memcpy(static_cast<uint8_t*>(m_segments[segment]->get_address()) + offset % m_segmentSize, data.data(), data.size());
+  }
+
+  IndexRecord record = { offset, static_cast<uint32_t>(data.size()), checksum(data.data(), data.size()) };
+  if (m_records.size() == m_indexCapacity) {
+    reserveIndex(m_indexCapacity * 2);
+  }
+
+  indexRecords()[m_records.size()] = record;
+  writeCount(m_records.size() + 1);
+  m_records.push_back(record);
+
+  T* newItem = prepare(m_records.size() - 1);
+  *newItem = item;
+}
+
+template<class T> Common::ArrayView<uint8_t> MappedVector<T>::raw(uint64_t index) const {
+  if (index >= m_records.size()) {
+    throw std::runtime_error("MappedVector::raw");
+  }
+
+  return Common::ArrayView<uint8_t>(itemData(index), m_records[index].size);
+}
+
+template<class T> template<class Part> void MappedVector<T>::load(uint64_t index, Part& part) const {
+  if (index >= m_records.size()) {
+    throw std::runtime_error("MappedVector::load");
+  }
+
+  Common::MemoryInputStream stream(itemData(index), m_records[index].size);
+  Fortress::BinaryInputStreamSerializer archive(stream);
+  serialize(part, archive);
+}
+
+template<class T> uint32_t MappedVector<T>::checksum(const uint8_t* data, size_t size) {
+  Crypto::Hash hash = Crypto::cn_fast_hash(data, size);
+  uint32_t result;
+  memcpy(&result, &hash, sizeof result);
+  return result;
+}
+
+template<class T> void MappedVector<T>::createFile(const std::string& fileName, uint64_t size) {
+  {
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw std::runtime_error("MappedVector: failed to create " + fileName);
+    }
+  }
+
+  boost::filesystem::resize_file(fileName, size);
+}
+
+template<class T> std::string MappedVector<T>::segmentFileName(uint64_t segment) const {
+  std::string number = std::to_string(segment);
+  return m_itemFileName + "." + std::string(number.size() < 4 ? 4 - number.size() : 0, '0') + number;
+}
+
+template<class T> typename MappedVector<T>::IndexHeader& MappedVector<T>::header() {
+  return *static_cast<IndexHeader*>(m_indexRegion->get_address());
+}
+
+template<class T> typename MappedVector<T>::IndexRecord* MappedVector<T>::indexRecords() {
+  return reinterpret_cast<IndexRecord*>(static_cast<uint8_t*>(m_indexRegion->get_address()) + sizeof(IndexHeader));
+}
+
+template<class T> void MappedVector<T>::mapIndex() {
+  boost::interprocess::file_mapping mapping(m_indexFileName.c_str(), boost::interprocess::read_write);
+  m_indexRegion.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_write));
+  m_indexCapacity = (m_indexRegion->get_size() - sizeof(IndexHeader)) / sizeof(IndexRecord);
+}
+
+template<class T> void MappedVector<T>::reserveIndex(uint64_t capacity) {
+  m_indexRegion->flush();
+  m_indexRegion.reset();
+  boost::filesystem::resize_file(m_indexFileName, sizeof(IndexHeader) + capacity * sizeof(IndexRecord));
+  mapIndex();
+}
+
+template<class T> bool MappedVector<T>::mapSegment(uint64_t segment, bool create) {
+  if (segment < m_segments.size()) {
+    return true;
+  }
+
+  while (m_segments.size() <= segment) {
+    std::string fileName = segmentFileName(m_segments.size());
+    boost::system::error_code ec;
+    uint64_t fileSize = boost::filesystem::file_size(fileName, ec);
+    if (ec || fileSize != m_segmentSize) {
+      if (!create) {
+        return false;
+      }
+
+      createFile(fileName, m_segmentSize);
+    }
+
+    boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_write);
+    m_segments.emplace_back(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_write, 0, m_segmentSize));
+  }
+
+  return true;
+}
+
+template<class T> void MappedVector<T>::writeCount(uint64_t count) {
+  header().count = count;
+}
+
+template<class T> const uint8_t* MappedVector<T>::itemData(uint64_t index) const {
+  const IndexRecord& record = m_records[index];
+  return static_cast<const uint8_t*>(m_segments[record.offset / m_segmentSize]->get_address()) + record.offset % m_segmentSize;
+}
+
+template<class T> T* MappedVector<T>::prepare(uint64_t index) {
+  if (m_items.size() == m_poolSize) {
+    auto cacheIter = m_cache.begin();
+    m_items.erase(cacheIter->itemIter);
+    m_cache.erase(cacheIter);
+  }
+
+  auto itemIter = m_items.insert(std::make_pair(index, ItemEntry()));
+  CacheEntry cacheEntry = { itemIter.first };
+  auto cacheIter = m_cache.insert(m_cache.end(), cacheEntry);
+  itemIter.first->second.cacheIter = cacheIter;
+  return &itemIter.first->second.item;
+}
@@ -22,6 +22,7 @@
 #include "Serialization/SerializationTools.h"
 
 #include "FortressFormatUtils.h"
+#include "MiningJob.h"
 #include "TransactionExtra.h"
 
 using namespace Logging;
@@ -58,6 +59,7 @@ namespace Fortress
     std::lock_guard<decltype(m_template_lock)> lk(m_template_lock);
 
     m_template = bl;
+    m_template_job = MiningJob(bl);
     m_diffic = di;
     ++m_template_no;
     m_starter_nonce = Crypto::rand<uint32_t>();
@@ -253,6 +255,8 @@ namespace Fortress
 
     unsigned nthreads = std::thread::hardware_concurrency();
 
+    MiningJob job(bl);
+
     if (nthreads > 0 && diffic > 5) {
       std::vector<std::future<void>> threads(nthreads);
       std::atomic<uint32_t> foundNonce;
@@ -264,14 +268,11 @@ namespace Fortress
           Crypto::cn_context localctx;
           Crypto::Hash h;
 
-          Block lb(bl); // copy to local block
+          MiningJob localJob(job); // copy to local job
 
           for (uint32_t nonce = startNonce + i; !found; nonce += nthreads) {
-            lb.nonce = nonce;
-
-            if (!get_block_longhash(localctx, lb, h)) {
-              return;
-            }
+            localJob.setNonce(nonce);
+            localJob.getLongHash(localctx, h);
 
             if (check_hash(h, diffic)) {
               foundNonce = nonce;
@@ -294,9 +295,8 @@ namespace Fortress
     } else {
       for (; bl.nonce != std::numeric_limits<uint32_t>::max(); bl.nonce++) {
         Crypto::Hash h;
-        if (!get_block_longhash(context, bl, h)) {
-          return false;
-        }
+        job.setNonce(bl.nonce);
+        job.getLongHash(context, h);
 
         if (check_hash(h, diffic)) {
           return true;
@@ -341,8 +341,10 @@ namespace Fortress
     uint32_t nonce = m_starter_nonce + th_local_index;
     difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
+    // allocated once per thread, the scratchpad stays locked in memory for all templates
     Crypto::cn_context context;
     Block b;
+    MiningJob job;
 
     while(!m_stop)
     {
@@ -355,6 +357,7 @@ namespace Fortress
       if(local_template_ver != m_template_no) {
         std::unique_lock<std::mutex> lk(m_template_lock);
         b = m_template;
+        job = m_template_job;
         local_diff = m_diffic;
         lk.unlock();
 
@@ -369,16 +372,14 @@ namespace Fortress
         continue;
       }
 
-      b.nonce = nonce;
+      job.setNonce(nonce);
       Crypto::Hash h;
-      if (!m_stop && !get_block_longhash(context, b, h)) {
-        logger(ERROR) << "Failed to get block long hash";
-        m_stop = true;
-      }
+      job.getLongHash(context, h);
 
       if (!m_stop && check_hash(h, local_diff))
       {
         //we lucky!
+        b.nonce = nonce;
         ++m_config.current_extra_message_index;
 
         logger(INFO, GREEN) << "Found block for difficulty: " << local_diff;
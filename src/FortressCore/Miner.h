@@ -14,6 +14,7 @@
 #include "FortressCore/Difficulty.h"
 #include "FortressCore/IMinerHandler.h"
 #include "FortressCore/MinerConfig.h"
+#include "FortressCore/MiningJob.h"
 #include "FortressCore/OnceInInterval.h"
 
 #include <Logging/LoggerRef.h>
@@ -61,6 +62,7 @@ namespace Fortress {
     std::atomic<bool> m_stop;
     std::mutex m_template_lock;
     Block m_template;
+    MiningJob m_template_job;
     std::atomic<uint32_t> m_template_no;
     std::atomic<uint32_t> m_starter_nonce;
     difficulty_type m_diffic;
@@ -0,0 +1,57 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "MiningJob.h"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#include "CachedBlock.h"
+#include "FortressTools.h"
+
+namespace Fortress {
+
+MiningJob::MiningJob() : nonceOffset(0) {
+}
+
+MiningJob::MiningJob(const Block& blockTemplate) : hashingBinaryArray(CachedBlock(blockTemplate).getBlockHashingBinaryArray()) {
+  // the nonce is the last field of the serialized header, stored as is
+  nonceOffset = toBinaryArray(static_cast<const BlockHeader&>(blockTemplate)).size() - sizeof(blockTemplate.nonce);
+  assert(getNonce() == blockTemplate.nonce);
+}
+
+uint32_t MiningJob::getNonce() const {
+  assert(nonceOffset + sizeof(uint32_t) <= hashingBinaryArray.size());
+  uint32_t nonce;
+  memcpy(&nonce, hashingBinaryArray.data() + nonceOffset, sizeof(nonce));
+  return nonce;
+}
+
+void MiningJob::setNonce(uint32_t nonce) {
+  assert(nonceOffset + sizeof(nonce) <= hashingBinaryArray.size());
+  memcpy(hashingBinaryArray.data() + nonceOffset, &nonce, sizeof(nonce));
+}
+
+const BinaryArray& MiningJob::getHashingBinaryArray() const {
+  return hashingBinaryArray;
+}
+
+void MiningJob::getLongHash(Crypto::cn_context& context, Crypto::Hash& hash) const {
+  Crypto::cn_slow_hash(context, hashingBinaryArray.data(), hashingBinaryArray.size(), hash);
+}
+
+void MiningJob::getLongHashes(Crypto::cn_context* contexts, size_t contextCount, uint32_t nonceStep, Crypto::Hash* hashes, size_t count) const {
+  std::vector<MiningJob> jobs(count, *this);
+  std::vector<const void*> data(count);
+  std::vector<size_t> sizes(count, hashingBinaryArray.size());
+  for (size_t i = 0; i < count; ++i) {
+    jobs[i].setNonce(getNonce() + static_cast<uint32_t>(i) * nonceStep);
+    data[i] = jobs[i].hashingBinaryArray.data();
+  }
+
+  Crypto::cn_slow_hash(contexts, contextCount, data.data(), sizes.data(), hashes, count);
+}
+
+}
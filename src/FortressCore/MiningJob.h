@@ -0,0 +1,34 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "FortressCore/FortressBasic.h"
+#include "crypto/hash.h"
+
+namespace Fortress {
+
+// Hashing blob of a block template, serialized once. Only the nonce changes from one hash to the
+// next, so workers patch it in place instead of rebuilding the blob for every nonce. Each worker
+// should hash its own copy of the job.
+class MiningJob {
+public:
+  // empty job, must be assigned before use
+  MiningJob();
+  explicit MiningJob(const Block& blockTemplate);
+
+  uint32_t getNonce() const;
+  void setNonce(uint32_t nonce);
+  const BinaryArray& getHashingBinaryArray() const;
+  // same as get_block_longhash of the template with the current nonce
+  void getLongHash(Crypto::cn_context& context, Crypto::Hash& hash) const;
+  // hashes of count nonces, nonceStep apart starting with the current one, up to contextCount of them side by side
+  void getLongHashes(Crypto::cn_context* contexts, size_t contextCount, uint32_t nonceStep, Crypto::Hash* hashes, size_t count) const;
+
+private:
+  BinaryArray hashingBinaryArray;
+  size_t nonceOffset;
+};
+
+}
@@ -0,0 +1,165 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "RandomOutputsIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Fortress {
+
+RandomOutputsIndex::RandomOutputsIndex(uint32_t matureDepth) : m_matureDepth(matureDepth), m_chainSize(0), m_firstListedBlock(0) {
+}
+
+void RandomOutputsIndex::clear() {
+  m_amounts.clear();
+  m_chainSize = 0;
+  m_blockAmounts.clear();
+  m_firstListedBlock = 0;
+}
+
+void RandomOutputsIndex::push(uint64_t amount, uint32_t blockIndex, bool mayBeLocked) {
+  AmountOutputs& outputs = m_amounts[amount];
+  assert(outputs.blockIndexes.empty() || outputs.blockIndexes.back() <= blockIndex);
+
+  uint32_t index = static_cast<uint32_t>(outputs.blockIndexes.size());
+  outputs.blockIndexes.push_back(blockIndex);
+  if (index % 64 == 0) {
+    outputs.lockedBits.push_back(0);
+  }
+
+  if (mayBeLocked) {
+    outputs.lockedBits.back() |= uint64_t(1) << (index % 64);
+  }
+
+  if (m_blockAmounts.empty()) {
+    m_firstListedBlock = blockIndex;
+  }
+
+  if (blockIndex >= m_firstListedBlock) {
+    if (blockIndex - m_firstListedBlock >= m_blockAmounts.size()) {
+      m_blockAmounts.resize(blockIndex - m_firstListedBlock + 1);
+    }
+
+    std::vector<uint64_t>& blockAmounts = m_blockAmounts[blockIndex - m_firstListedBlock];
+    if (std::find(blockAmounts.begin(), blockAmounts.end(), amount) == blockAmounts.end()) {
+      blockAmounts.push_back(amount);
+    }
+
+    trimBlockAmounts();
+  }
+
+  updateMatureEnd(outputs);
+}
+
+void RandomOutputsIndex::pop(uint64_t amount) {
+  auto it = m_amounts.find(amount);
+  if (it == m_amounts.end()) {
+    return;
+  }
+
+  AmountOutputs& outputs = it->second;
+  uint32_t blockIndex = outputs.blockIndexes.back();
+  outputs.blockIndexes.pop_back();
+  if ((outputs.blockIndexes.empty() || outputs.blockIndexes.back() != blockIndex) && blockIndex >= m_firstListedBlock &&
+    blockIndex - m_firstListedBlock < m_blockAmounts.size()) {
+    std::vector<uint64_t>& blockAmounts = m_blockAmounts[blockIndex - m_firstListedBlock];
+    blockAmounts.erase(std::remove(blockAmounts.begin(), blockAmounts.end(), amount), blockAmounts.end());
+  }
+
+  if (outputs.blockIndexes.empty()) {
+    m_amounts.erase(it);
+    return;
+  }
+
+  uint32_t index = static_cast<uint32_t>(outputs.blockIndexes.size());
+  if (index % 64 == 0) {
+    outputs.lockedBits.pop_back();
+  } else {
+    outputs.lockedBits.back() &= ~(uint64_t(1) << (index % 64));
+  }
+
+  if (outputs.matureEnd > index) {
+    outputs.matureEnd = index;
+  }
+}
+
+void RandomOutputsIndex::setChainSize(uint32_t chainSize) {
+  // outputs of the blocks between the old and the new mature bound change maturity
+  uint32_t oldBound = m_chainSize >= m_matureDepth ? m_chainSize - m_matureDepth + 1 : 0;
+  uint32_t newBound = chainSize >= m_matureDepth ? chainSize - m_matureDepth + 1 : 0;
+  uint32_t begin = std::min(oldBound, newBound);
+  uint32_t end = std::max(oldBound, newBound);
+  m_chainSize = chainSize;
+  if (begin == end) {
+    return;
+  }
+
+  if (begin < m_firstListedBlock && !m_blockAmounts.empty()) {
+    for (auto& amount : m_amounts) {
+      updateMatureEnd(amount.second);
+    }
+  } else {
+    // blocks after the listed ones have no outputs
+    for (uint32_t block = begin; block < end && block - m_firstListedBlock < m_blockAmounts.size(); ++block) {
+      for (uint64_t amount : m_blockAmounts[block - m_firstListedBlock]) {
+        updateMatureEnd(m_amounts.at(amount));
+      }
+    }
+  }
+
+  trimBlockAmounts();
+}
+
+uint32_t RandomOutputsIndex::chainSize() const {
+  return m_chainSize;
+}
+
+uint32_t RandomOutputsIndex::size(uint64_t amount) const {
+  auto it = m_amounts.find(amount);
+  return it == m_amounts.end() ? 0 : static_cast<uint32_t>(it->second.blockIndexes.size());
+}
+
+uint32_t RandomOutputsIndex::matureEnd(uint64_t amount) const {
+  auto it = m_amounts.find(amount);
+  return it == m_amounts.end() ? 0 : it->second.matureEnd;
+}
+
+bool RandomOutputsIndex::mayBeLocked(uint64_t amount, uint32_t index) const {
+  auto it = m_amounts.find(amount);
+  assert(it != m_amounts.end() && index < it->second.blockIndexes.size());
+  return it->second.isFlagged(index);
+}
+
+void RandomOutputsIndex::updateMatureEnd(AmountOutputs& outputs) const {
+  // both directions move by the number of outputs in blocks that changed maturity, a few per call
+  const std::vector<uint32_t>& blockIndexes = outputs.blockIndexes;
+  while (outputs.matureEnd < blockIndexes.size() && uint64_t(blockIndexes[outputs.matureEnd]) + m_matureDepth <= m_chainSize) {
+    ++outputs.matureEnd;
+  }
+
+  while (outputs.matureEnd > 0 && uint64_t(blockIndexes[outputs.matureEnd - 1]) + m_matureDepth > m_chainSize) {
+    --outputs.matureEnd;
+  }
+}
+
+void RandomOutputsIndex::trimBlockAmounts() {
+  if (m_blockAmounts.empty()) {
+    return;
+  }
+
+  uint32_t lastBlock = m_firstListedBlock + static_cast<uint32_t>(m_blockAmounts.size()) - 1;
+  uint32_t top = std::max(m_chainSize, lastBlock + 1);
+  if (top <= m_matureDepth + LISTED_MATURE_BLOCKS) {
+    return;
+  }
+
+  uint32_t firstKept = top - m_matureDepth - LISTED_MATURE_BLOCKS;
+  while (m_firstListedBlock < firstKept && m_blockAmounts.size() > 1) {
+    m_blockAmounts.pop_front();
+    ++m_firstListedBlock;
+  }
+}
+
+}
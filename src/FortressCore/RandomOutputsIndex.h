@@ -0,0 +1,94 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/ShuffleGenerator.h"
+#include "crypto/crypto.h"
+
+namespace Fortress {
+
+// Sampling view of the key output index, used to pick random ring members.
+// Outputs of an amount are appended in chain order, so the outputs buried deep enough to be offered form a prefix,
+// whose end is kept up to date as the chain grows and shrinks. Outputs which unlock time may keep them locked after
+// they get buried are flagged, every other output of the prefix can be offered without looking at it.
+// The amounts with outputs in each recent block are listed, so a chain size change visits only the amounts of the
+// blocks that changed maturity. A change beyond the listed blocks, like the first one after a rebuild, visits all.
+class RandomOutputsIndex {
+public:
+  // blocks this far below the mature bound stay listed, chains shrinking by less are handled without a full scan
+  static const uint32_t LISTED_MATURE_BLOCKS = 100;
+
+  explicit RandomOutputsIndex(uint32_t matureDepth);
+
+  void clear();
+  // Appends an output of the amount from the block with the given index
+  void push(uint64_t amount, uint32_t blockIndex, bool mayBeLocked);
+  // Removes the newest output of the amount
+  void pop(uint64_t amount);
+  // Moves the mature bounds of all amounts to the given chain size
+  void setChainSize(uint32_t chainSize);
+
+  uint32_t chainSize() const;
+  uint32_t size(uint64_t amount) const;
+  // Outputs with indexes below the returned value are mature
+  uint32_t matureEnd(uint64_t amount) const;
+  bool mayBeLocked(uint64_t amount, uint32_t index) const;
+
+  // Appends up to count distinct indexes of mature outputs of the amount in random order.
+  // Flagged outputs are offered only when isUnlocked(index) returns true. Returns the number of appended indexes.
+  template<class UnlockedPredicate>
+  size_t sample(uint64_t amount, size_t count, std::vector<uint32_t>& indexes, UnlockedPredicate isUnlocked) const {
+    auto it = m_amounts.find(amount);
+    if (it == m_amounts.end() || it->second.matureEnd == 0) {
+      return 0;
+    }
+
+    const AmountOutputs& outputs = it->second;
+    ShuffleGenerator<uint32_t, Crypto::random_engine<uint32_t>> generator(outputs.matureEnd);
+    size_t added = 0;
+    for (uint32_t i = 0; i < outputs.matureEnd && added < count; ++i) {
+      uint32_t index = generator();
+      if (outputs.isFlagged(index) && !isUnlocked(index)) {
+        continue;
+      }
+
+      indexes.push_back(index);
+      ++added;
+    }
+
+    return added;
+  }
+
+private:
+  struct AmountOutputs {
+    std::vector<uint32_t> blockIndexes;
+    std::vector<uint64_t> lockedBits;
+    uint32_t matureEnd;
+
+    AmountOutputs() : matureEnd(0) {
+    }
+
+    bool isFlagged(uint32_t index) const {
+      return (lockedBits[index / 64] >> (index % 64) & 1) != 0;
+    }
+  };
+
+  std::unordered_map<uint64_t, AmountOutputs> m_amounts;
+  uint32_t m_matureDepth;
+  uint32_t m_chainSize;
+  // distinct amounts with outputs in the blocks [m_firstListedBlock, m_firstListedBlock + m_blockAmounts.size())
+  std::deque<std::vector<uint64_t>> m_blockAmounts;
+  uint32_t m_firstListedBlock;
+
+  void updateMatureEnd(AmountOutputs& outputs) const;
+  void trimBlockAmounts();
+};
+
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "RingSignatureVerifier.h"
+
+#include <algorithm>
+
+namespace Fortress {
+
+namespace {
+
+bool checkJob(const RingSignatureVerifier::Job& job) {
+  if (job.keys.size() != job.signatures.size()) {
+    return false;
+  }
+
+  std::vector<const Crypto::PublicKey*> keys;
+  keys.reserve(job.keys.size());
+  for (const auto& key : job.keys) {
+    keys.push_back(&key);
+  }
+
+  return Crypto::check_ring_signature(job.prefixHash, job.keyImage, keys, job.signatures.data());
+}
+
+}
+
+RingSignatureVerifier::RingSignatureVerifier(size_t threadCount) : m_pool(std::max<size_t>(threadCount, 1)) {
+}
+
+size_t RingSignatureVerifier::threadCount() const {
+  return m_pool.threadCount();
+}
+
+size_t RingSignatureVerifier::verify(const std::vector<Job>& jobs) {
+  return m_pool.run(jobs.size(), [&jobs](size_t index) {
+    return checkJob(jobs[index]);
+  });
+}
+
+}
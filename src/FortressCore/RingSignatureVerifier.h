@@ -0,0 +1,37 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <thread>
+#include <vector>
+
+#include "Common/JobPool.h"
+#include "crypto/crypto.h"
+
+namespace Fortress {
+
+// Checks batches of ring signatures on a Tools::JobPool.
+class RingSignatureVerifier {
+public:
+  struct Job {
+    Crypto::Hash prefixHash;
+    Crypto::KeyImage keyImage;
+    std::vector<Crypto::PublicKey> keys;
+    std::vector<Crypto::Signature> signatures;
+  };
+
+  explicit RingSignatureVerifier(size_t threadCount = std::thread::hardware_concurrency());
+
+  size_t threadCount() const;
+
+  // Returns the index of the first job with an invalid signature, or jobs.size() if all signatures are valid.
+  // The result does not depend on the number of threads or on scheduling.
+  size_t verify(const std::vector<Job>& jobs);
+
+private:
+  Tools::JobPool m_pool;
+};
+
+}
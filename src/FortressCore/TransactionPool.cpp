@@ -95,10 +95,16 @@ namespace Fortress {
     m_timeProvider(timeProvider), 
     m_txCheckInterval(60, timeProvider),
     m_fee_index(boost::get<1>(m_transactions)),
+    m_topBlockId(NULL_HASH),
+    m_poolVersion(0),
     logger(log, "txpool") {
+    m_templateCache.valid = false;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::add_tx(const Transaction &tx, /*const Crypto::Hash& tx_prefix_hash,*/ const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keptByBlock) {
+  bool tx_memory_pool::add_tx(const CachedTransaction& transaction, tx_verification_context& tvc, bool keptByBlock) {
+    const Transaction& tx = transaction.getTransaction();
+    const Crypto::Hash& id = transaction.getTransactionHash();
+    size_t blobSize = transaction.getTransactionBinarySize();
     if (!check_inputs_types_supported(tx)) {
       tvc.m_verifivation_failed = true;
       return false;
@@ -142,7 +148,7 @@ namespace Fortress {
     BlockInfo maxUsedBlock;
 
     // check inputs
-    bool inputsValid = m_validator.checkTransactionInputs(tx, maxUsedBlock);
+    bool inputsValid = m_validator.checkTransactionInputs(transaction, maxUsedBlock);
 
     if (!inputsValid) {
       if (!keptByBlock) {
@@ -179,6 +185,7 @@ namespace Fortress {
       TransactionDetails txd;
 
       txd.id = id;
+      txd.prefixHash = transaction.getTransactionPrefixHash();
       txd.blobSize = blobSize;
       txd.tx = tx;
       txd.fee = fee;
@@ -195,7 +202,7 @@ namespace Fortress {
       }
       m_paymentIdIndex.add(txd.tx);
       m_timestampIndex.add(txd.receiveTime, txd.id);
-
+      poolChanged();
     }
 
     tvc.m_added_to_pool = true;
@@ -212,10 +219,7 @@ namespace Fortress {
 
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(const Transaction &tx, tx_verification_context& tvc, bool keeped_by_block) {
-    Crypto::Hash h = NULL_HASH;
-    size_t blobSize = 0;
-    getObjectHash(tx, h, blobSize);
-    return add_tx(tx, h, blobSize, tvc, keeped_by_block);
+    return add_tx(CachedTransaction(tx), tvc, keeped_by_block);
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee) {
@@ -252,7 +256,7 @@ namespace Fortress {
     std::unordered_set<Crypto::Hash> ready_tx_ids;
     for (const auto& tx : m_transactions) {
       TransactionCheckInfo checkInfo(tx);
-      if (is_transaction_ready_to_go(tx.tx, checkInfo)) {
+      if (isTransactionReady(tx, checkInfo)) {
         ready_tx_ids.insert(tx.id);
       }
     }
@@ -274,10 +278,33 @@ namespace Fortress {
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+
+    // A new block can only invalidate a ready transaction by spending its inputs, so ready results are carried
+    // over to the new top after a key image lookup, the rest is checked again when it is needed
+    for (auto it = m_readyChecks.begin(); it != m_readyChecks.end();) {
+      auto txIt = m_transactions.find(it->first);
+      bool carryOver = it->second.ready && it->second.topBlockId == m_topBlockId && txIt != m_transactions.end() &&
+        std::all_of(txIt->tx.inputs.begin(), txIt->tx.inputs.end(), [](const TransactionInput& in) { return in.type() == typeid(KeyInput); }) &&
+        !m_validator.haveSpentKeyImages(txIt->tx);
+
+      if (carryOver) {
+        it->second.topBlockId = top_block_id;
+        ++it;
+      } else {
+        it = m_readyChecks.erase(it);
+      }
+    }
+
+    m_topBlockId = top_block_id;
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    // outputs used by pool transactions may be gone with the popped block
+    m_readyChecks.clear();
+    m_topBlockId = top_block_id;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -302,19 +329,35 @@ namespace Fortress {
   }
 
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const {
+  bool tx_memory_pool::is_transaction_ready_to_go(const CachedTransaction& transaction, TransactionCheckInfo& txd) const {
 
-    if (!m_validator.checkTransactionInputs(tx, txd.maxUsedBlock, txd.lastFailedBlock))
+    if (!m_validator.checkTransactionInputs(transaction, txd.maxUsedBlock, txd.lastFailedBlock))
       return false;
 
     //if we here, transaction seems valid, but, anyway, check for key_images collisions with blockchain, just to be sure
-    if (m_validator.haveSpentKeyImages(tx))
+    if (m_validator.haveSpentKeyImages(transaction.getTransaction()))
       return false;
 
     //transaction is ok.
     return true;
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::isTransactionReady(const TransactionDetails& txd, TransactionCheckInfo& checkInfo) const {
+    auto it = m_readyChecks.find(txd.id);
+    if (it != m_readyChecks.end() && it->second.topBlockId == m_topBlockId) {
+      return it->second.ready;
+    }
+
+    bool ready = is_transaction_ready_to_go(CachedTransaction(txd.tx, txd.id, txd.prefixHash, txd.blobSize), checkInfo);
+    ReadyCheckResult result = { m_topBlockId, ready };
+    m_readyChecks[txd.id] = result;
+    return ready;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::poolChanged() {
+    ++m_poolVersion;
+  }
+  //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const {
     std::stringstream ss;
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
@@ -342,6 +385,14 @@ namespace Fortress {
                                            uint64_t already_generated_coins, size_t& total_size, uint64_t& fee) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
 
+    if (m_templateCache.valid && m_templateCache.topBlockId == m_topBlockId && m_templateCache.poolVersion == m_poolVersion &&
+      m_templateCache.medianSize == median_size && m_templateCache.maxCumulativeSize == maxCumulativeSize) {
+      bl.transactionHashes = m_templateCache.transactionHashes;
+      total_size = m_templateCache.totalSize;
+      fee = m_templateCache.fee;
+      return true;
+    }
+
     total_size = 0;
     fee = 0;
 
@@ -358,7 +409,7 @@ namespace Fortress {
       }
 
       TransactionCheckInfo checkInfo(txd);
-      if (is_transaction_ready_to_go(txd.tx, checkInfo) && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (isTransactionReady(txd, checkInfo) && blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
       }
     }
@@ -372,12 +423,14 @@ namespace Fortress {
       }
 
       TransactionCheckInfo checkInfo(txd);
-      bool ready = is_transaction_ready_to_go(txd.tx, checkInfo);
+      bool ready = isTransactionReady(txd, checkInfo);
 
-      // update item state
-      m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
-        item = checkInfo;
-      });
+      // update item state, if the check actually ran
+      if (checkInfo.maxUsedBlock.id != txd.maxUsedBlock.id || checkInfo.lastFailedBlock.id != txd.lastFailedBlock.id) {
+        m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
+          item = checkInfo;
+        });
+      }
 
       if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
         total_size += txd.blobSize;
@@ -386,6 +439,15 @@ namespace Fortress {
     }
 
     bl.transactionHashes = blockTemplate.getTransactions();
+
+    m_templateCache.valid = true;
+    m_templateCache.topBlockId = m_topBlockId;
+    m_templateCache.poolVersion = m_poolVersion;
+    m_templateCache.medianSize = median_size;
+    m_templateCache.maxCumulativeSize = maxCumulativeSize;
+    m_templateCache.transactionHashes = bl.transactionHashes;
+    m_templateCache.totalSize = total_size;
+    m_templateCache.fee = fee;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -408,6 +470,9 @@ namespace Fortress {
 
       m_paymentIdIndex.clear();
       m_timestampIndex.clear();
+
+      m_readyChecks.clear();
+      poolChanged();
     } else {
       buildIndices();
     }
@@ -449,6 +514,9 @@ namespace Fortress {
     s(td.lastFailedBlock.id, "lastFailedBlock.id");
     s(td.keptByBlock, "keptByBlock");
     s(reinterpret_cast<uint64_t&>(td.receiveTime), "receiveTime");
+    if (s.type() == ISerializer::INPUT) {
+      td.prefixHash = getObjectHash(static_cast<const TransactionPrefix&>(td.tx));
+    }
   }
 
   //---------------------------------------------------------------------------------
@@ -474,6 +542,11 @@ namespace Fortress {
     KV_MEMBER(m_spent_key_images);
     KV_MEMBER(m_spentOutputs);
     KV_MEMBER(m_recentlyDeletedTransactions);
+
+    if (s.type() == ISerializer::INPUT) {
+      m_readyChecks.clear();
+      poolChanged();
+    }
   }
 
   //---------------------------------------------------------------------------------
@@ -524,6 +597,8 @@ namespace Fortress {
     removeTransactionInputs(i->id, i->tx, i->keptByBlock);
     m_paymentIdIndex.remove(i->tx);
     m_timestampIndex.remove(i->receiveTime, i->id);
+    m_readyChecks.erase(i->id);
+    poolChanged();
     return m_transactions.erase(i);
   }
 
@@ -84,11 +84,12 @@ namespace Fortress {
     bool deinit();
 
     bool have_tx(const Crypto::Hash &id) const;
-    bool add_tx(const Transaction &tx, const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block);
+    bool add_tx(const CachedTransaction& transaction, tx_verification_context& tvc, bool keeped_by_block);
     bool add_tx(const Transaction &tx, tx_verification_context& tvc, bool keeped_by_block);
     //gets tx and remove it from pool
     bool take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee);
 
+    // Called by the blockchain for every block pushed to or popped from the main chain
     bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id);
     bool on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id);
 
@@ -130,6 +131,7 @@ namespace Fortress {
 
     struct TransactionDetails : public TransactionCheckInfo {
       Crypto::Hash id;
+      Crypto::Hash prefixHash;
       Transaction tx;
       size_t blobSize;
       uint64_t fee;
@@ -167,6 +169,24 @@ namespace Fortress {
       indexed_by<main_index_t, fee_index_t>
     > tx_container_t;
 
+    // Result of is_transaction_ready_to_go for a transaction, valid while the chain top is topBlockId
+    struct ReadyCheckResult {
+      Crypto::Hash topBlockId;
+      bool ready;
+    };
+
+    // Last filled block template, reused while neither the pool nor the chain top nor the size limits change
+    struct BlockTemplateCache {
+      bool valid;
+      Crypto::Hash topBlockId;
+      uint64_t poolVersion;
+      size_t medianSize;
+      size_t maxCumulativeSize;
+      std::vector<Crypto::Hash> transactionHashes;
+      size_t totalSize;
+      uint64_t fee;
+    };
+
     typedef std::pair<uint64_t, uint64_t> GlobalOutput;
     typedef std::set<GlobalOutput> GlobalOutputsContainer;
     typedef std::unordered_map<Crypto::KeyImage, std::unordered_set<Crypto::Hash> > key_images_container;
@@ -179,7 +199,9 @@ namespace Fortress {
 
     tx_container_t::iterator removeTransaction(tx_container_t::iterator i);
     bool removeExpiredTransactions();
-    bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
+    bool is_transaction_ready_to_go(const CachedTransaction& transaction, TransactionCheckInfo& txd) const;
+    bool isTransactionReady(const TransactionDetails& txd, TransactionCheckInfo& checkInfo) const;
+    void poolChanged();
 
     void buildIndices();
 
@@ -198,6 +220,11 @@ namespace Fortress {
     tx_container_t::nth_index<1>::type& m_fee_index;
     std::unordered_map<Crypto::Hash, uint64_t> m_recentlyDeletedTransactions;
 
+    Crypto::Hash m_topBlockId;
+    uint64_t m_poolVersion;
+    mutable std::unordered_map<Crypto::Hash, ReadyCheckResult> m_readyChecks;
+    BlockTemplateCache m_templateCache;
+
     Logging::LoggerRef logger;
 
     PaymentIdIndex m_paymentIdIndex;
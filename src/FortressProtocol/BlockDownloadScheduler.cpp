@@ -0,0 +1,169 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "BlockDownloadScheduler.h"
+
+#include <algorithm>
+
+namespace Fortress {
+
+BlockDownloadScheduler::BlockDownloadScheduler(size_t rangeSize, size_t connectionRequests, size_t maxRanges, Clock::duration timeout) :
+  m_rangeSize(rangeSize),
+  m_connectionRequests(connectionRequests),
+  m_maxRanges(maxRanges),
+  m_timeout(timeout),
+  m_tailHeight(0),
+  m_tailId(Crypto::Hash()) {
+}
+
+bool BlockDownloadScheduler::empty() const {
+  return m_ranges.empty();
+}
+
+bool BlockDownloadScheduler::hasUnrequestedRanges() const {
+  return std::any_of(m_ranges.begin(), m_ranges.end(), [](const Range& range) {
+    return !range.requested && !range.downloaded;
+  });
+}
+
+bool BlockDownloadScheduler::hasRequests(const boost::uuids::uuid& connectionId) const {
+  return std::any_of(m_ranges.begin(), m_ranges.end(), [&](const Range& range) {
+    return range.requested && range.connectionId == connectionId;
+  });
+}
+
+void BlockDownloadScheduler::reset(uint32_t height, const Crypto::Hash& blockId) {
+  m_ranges.clear();
+  m_tailHeight = height;
+  m_tailId = blockId;
+}
+
+bool BlockDownloadScheduler::addBlockIds(uint32_t startHeight, const std::vector<Crypto::Hash>& blockIds) {
+  if (blockIds.empty() || m_tailHeight < startHeight) {
+    return false;
+  }
+
+  // the peer is behind the queued blocks, it can still send those it has
+  size_t index = m_tailHeight - startHeight;
+  if (index >= blockIds.size()) {
+    return true;
+  }
+
+  if (blockIds[index] != m_tailId) {
+    return false;
+  }
+
+  for (++index; index < blockIds.size(); ++index) {
+    if (m_ranges.empty() || m_ranges.back().requested || m_ranges.back().downloaded || m_ranges.back().blockIds.size() == m_rangeSize) {
+      Range range;
+      range.startHeight = m_tailHeight + 1;
+      range.requested = false;
+      range.downloaded = false;
+      m_ranges.push_back(std::move(range));
+    }
+
+    m_ranges.back().blockIds.push_back(blockIds[index]);
+    ++m_tailHeight;
+    m_tailId = blockIds[index];
+  }
+
+  return true;
+}
+
+bool BlockDownloadScheduler::requestRange(const boost::uuids::uuid& connectionId, uint32_t remoteHeight, Clock::time_point now,
+  std::vector<Crypto::Hash>& blockIds) {
+  size_t requests = 0;
+  for (const Range& range : m_ranges) {
+    if (range.requested && range.connectionId == connectionId) {
+      ++requests;
+    }
+  }
+
+  if (requests >= m_connectionRequests) {
+    return false;
+  }
+
+  // ranges after the window wait until the blockchain takes the first ones
+  size_t count = std::min(m_ranges.size(), m_maxRanges);
+  for (size_t i = 0; i < count; ++i) {
+    Range& range = m_ranges[i];
+    if (range.requested || range.downloaded) {
+      continue;
+    }
+
+    if (range.startHeight + range.blockIds.size() > remoteHeight) {
+      return false;
+    }
+
+    range.requested = true;
+    range.connectionId = connectionId;
+    range.requestTime = now;
+    blockIds = range.blockIds;
+    return true;
+  }
+
+  return false;
+}
+
+bool BlockDownloadScheduler::addRange(DownloadedRange&& downloadedRange) {
+  for (Range& range : m_ranges) {
+    if (!range.requested || range.connectionId != downloadedRange.connectionId || range.blockIds.size() != downloadedRange.cachedBlocks.size()) {
+      continue;
+    }
+
+    bool matches = true;
+    for (size_t i = 0; i < range.blockIds.size() && matches; ++i) {
+      matches = range.blockIds[i] == downloadedRange.cachedBlocks[i].getBlockHash();
+    }
+
+    if (matches) {
+      range.requested = false;
+      range.downloaded = true;
+      range.blocks = std::move(downloadedRange);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool BlockDownloadScheduler::takeRange(DownloadedRange& range) {
+  if (m_ranges.empty() || !m_ranges.front().downloaded) {
+    return false;
+  }
+
+  range = std::move(m_ranges.front().blocks);
+  m_ranges.pop_front();
+  return true;
+}
+
+void BlockDownloadScheduler::releaseConnection(const boost::uuids::uuid& connectionId) {
+  for (Range& range : m_ranges) {
+    if (range.requested && range.connectionId == connectionId) {
+      range.requested = false;
+    }
+  }
+}
+
+std::vector<boost::uuids::uuid> BlockDownloadScheduler::releaseStalledConnections(Clock::time_point now) {
+  std::vector<boost::uuids::uuid> connections;
+  for (const Range& range : m_ranges) {
+    if (range.requested && now - range.requestTime >= m_timeout &&
+      std::find(connections.begin(), connections.end(), range.connectionId) == connections.end()) {
+      connections.push_back(range.connectionId);
+    }
+  }
+
+  for (const auto& connectionId : connections) {
+    releaseConnection(connectionId);
+  }
+
+  return connections;
+}
+
+void BlockDownloadScheduler::clear() {
+  m_ranges.clear();
+}
+
+}
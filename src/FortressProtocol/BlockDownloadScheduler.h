@@ -0,0 +1,78 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include <boost/uuid/uuid.hpp>
+
+#include "FortressCore/CachedBlock.h"
+#include "FortressProtocol/FortressProtocolDefinitions.h"
+
+namespace Fortress {
+
+// Splits the blocks found during synchronization into ranges, spreads the ranges over the connections and returns
+// the downloaded ranges in blockchain order. It is used on the dispatcher thread only.
+class BlockDownloadScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  // cachedBlocks refer to blocks, the vectors are only moved to keep the references valid
+  struct DownloadedRange {
+    boost::uuids::uuid connectionId;
+    std::vector<block_complete_entry> entries;
+    std::vector<Block> blocks;
+    std::vector<CachedBlock> cachedBlocks;
+  };
+
+  BlockDownloadScheduler(size_t rangeSize, size_t connectionRequests, size_t maxRanges, Clock::duration timeout);
+
+  // no range is queued, requested or downloaded
+  bool empty() const;
+  bool hasUnrequestedRanges() const;
+  bool hasRequests(const boost::uuids::uuid& connectionId) const;
+
+  // the blocks queued next follow the given one
+  void reset(uint32_t height, const Crypto::Hash& blockId);
+  // blockIds[0] is at startHeight, returns false if the ids fork from the queued ones
+  bool addBlockIds(uint32_t startHeight, const std::vector<Crypto::Hash>& blockIds);
+
+  // picks the first range the connection has and can request, remoteHeight is the blockchain height of the peer
+  bool requestRange(const boost::uuids::uuid& connectionId, uint32_t remoteHeight, Clock::time_point now, std::vector<Crypto::Hash>& blockIds);
+  // returns false if the blocks aren't a range requested from the connection
+  bool addRange(DownloadedRange&& range);
+  // takes the first range if it is downloaded
+  bool takeRange(DownloadedRange& range);
+
+  // the ranges requested from the connection can be requested from other connections
+  void releaseConnection(const boost::uuids::uuid& connectionId);
+  // releases and returns the connections that haven't returned a range in time
+  std::vector<boost::uuids::uuid> releaseStalledConnections(Clock::time_point now);
+  void clear();
+
+private:
+  struct Range {
+    uint32_t startHeight;
+    std::vector<Crypto::Hash> blockIds;
+    bool requested;
+    bool downloaded;
+    boost::uuids::uuid connectionId;
+    Clock::time_point requestTime;
+    DownloadedRange blocks;
+  };
+
+  const size_t m_rangeSize;
+  const size_t m_connectionRequests;
+  const size_t m_maxRanges;
+  const Clock::duration m_timeout;
+
+  std::deque<Range> m_ranges;
+  uint32_t m_tailHeight;
+  Crypto::Hash m_tailId;
+};
+
+}
@@ -196,4 +196,75 @@ namespace Fortress
     const static int ID = BC_COMMANDS_POOL_BASE + 8;
     typedef NOTIFY_REQUEST_TX_POOL_request request;
   };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // The block blob lists the hashes of its transactions, the receiver takes them from its pool.
+  // txs carries only the transactions requested with NOTIFY_REQUEST_BLOCK_TXS.
+  struct NOTIFY_NEW_COMPACT_BLOCK_request {
+    std::string block;
+    std::vector<std::string> txs;
+    uint32_t current_blockchain_height;
+    uint32_t hop;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block)
+      KV_MEMBER(txs)
+      KV_MEMBER(current_blockchain_height)
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_NEW_COMPACT_BLOCK {
+    const static int ID = BC_COMMANDS_POOL_BASE + 9;
+    typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TXS_request {
+    Crypto::Hash blockId;
+    // strictly increasing indices in block.transactionHashes
+    std::vector<uint32_t> txIndices;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(blockId)
+      serializeAsBinary(txIndices, "txIndices", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TXS {
+    const static int ID = BC_COMMANDS_POOL_BASE + 10;
+    typedef NOTIFY_REQUEST_BLOCK_TXS_request request;
+  };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // Announces transactions by hash, the receiver fetches the unknown ones with NOTIFY_REQUEST_TXS.
+  struct NOTIFY_TX_INVENTORY_request {
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_TX_INVENTORY {
+    const static int ID = BC_COMMANDS_POOL_BASE + 11;
+    typedef NOTIFY_TX_INVENTORY_request request;
+  };
+
+  // Answered with NOTIFY_NEW_TRANSACTIONS, transactions the sender no longer has are left out.
+  struct NOTIFY_REQUEST_TXS_request {
+    std::vector<Crypto::Hash> txs;
+
+    void serialize(ISerializer& s) {
+      serializeAsBinary(txs, "txs", s);
+    }
+  };
+
+  struct NOTIFY_REQUEST_TXS {
+    const static int ID = BC_COMMANDS_POOL_BASE + 12;
+    typedef NOTIFY_REQUEST_TXS_request request;
+  };
 }
@@ -4,11 +4,15 @@
 
 #include "FortressProtocolHandler.h"
 
+#include <algorithm>
 #include <future>
+#include <boost/functional/hash.hpp>
 #include <boost/scope_exit.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <System/Dispatcher.h>
+#include <System/RemoteContext.h>
 
+#include "FortressCore/CachedBlock.h"
 #include "FortressCore/FortressBasicImpl.h"
 #include "FortressCore/FortressFormatUtils.h"
 #include "FortressCore/FortressTools.h"
@@ -28,9 +32,40 @@ bool post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const For
   return p2p.invoke_notify_to_peer(t_parametr::ID, LevinProtocol::encode(arg), context);
 }
 
-template<class t_parametr>
-void relay_post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const net_connection_id* excludeConnection = nullptr) {
-  p2p.relay_notify_to_all(t_parametr::ID, LevinProtocol::encode(arg), excludeConnection);
+bool supportsCompactBlocks(const FortressConnectionContext& context) {
+  return context.version >= P2PProtocolVersion::V2;
+}
+
+bool lacksCompactBlocks(const FortressConnectionContext& context) {
+  return !supportsCompactBlocks(context);
+}
+
+bool supportsTxInventory(const FortressConnectionContext& context) {
+  return context.version >= P2PProtocolVersion::V3;
+}
+
+bool lacksTxInventory(const FortressConnectionContext& context) {
+  return !supportsTxInventory(context);
+}
+
+void rememberKnownTx(FortressConnectionContext& context, const Crypto::Hash& txHash) {
+  if (!context.m_knownTxs.insert(txHash).second) {
+    return;
+  }
+
+  context.m_knownTxsOrder.push_back(txHash);
+  if (context.m_knownTxsOrder.size() > P2P_KNOWN_TXS_MAX_COUNT) {
+    context.m_knownTxs.erase(context.m_knownTxsOrder.front());
+    context.m_knownTxsOrder.pop_front();
+  }
+}
+
+NOTIFY_NEW_COMPACT_BLOCK::request makeCompactBlock(const NOTIFY_NEW_BLOCK::request& arg) {
+  NOTIFY_NEW_COMPACT_BLOCK::request compactArg;
+  compactArg.block = arg.b.block;
+  compactArg.current_blockchain_height = arg.current_blockchain_height;
+  compactArg.hop = arg.hop;
+  return compactArg;
 }
 
 }
@@ -44,6 +79,10 @@ FortressProtocolHandler::FortressProtocolHandler(const Currency& currency, Syste
   m_stop(false),
   m_observedHeight(0),
   m_peersCount(0),
+  m_downloadScheduler(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, BLOCKS_SYNCHRONIZING_PEER_REQUESTS, BLOCKS_SYNCHRONIZING_MAX_RANGES,
+    std::chrono::seconds(BLOCKS_SYNCHRONIZING_TIMEOUT)),
+  m_committingBlocks(false),
+  m_txRequestScheduler(P2P_ANNOUNCED_TXS_MAX_COUNT, std::chrono::seconds(P2P_TX_REQUEST_TIMEOUT)),
   logger(log, "protocol") {
   
   if (!m_p2p) {
@@ -66,6 +105,9 @@ void FortressProtocolHandler::onConnectionOpened(FortressConnectionContext& cont
 }
 
 void FortressProtocolHandler::onConnectionClosed(FortressConnectionContext& context) {
+  m_downloadScheduler.releaseConnection(context.m_connection_id);
+  m_txRequestScheduler.releaseConnection(context.m_connection_id);
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -95,13 +137,8 @@ bool FortressProtocolHandler::start_sync(FortressConnectionContext& context) {
   logger(Logging::TRACE) << context << "Starting synchronization";
 
   if (context.m_state == FortressConnectionContext::state_synchronizing) {
-    assert(context.m_needed_objects.empty());
-    assert(context.m_requested_objects.empty());
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    assert(!m_downloadScheduler.hasRequests(context.m_connection_id));
+    requestChain(context);
   }
 
   return true;
@@ -212,6 +249,10 @@ int FortressProtocolHandler::handleCommand(bool is_notify, int command, const Bi
     HANDLE_NOTIFY(NOTIFY_REQUEST_CHAIN, &FortressProtocolHandler::handle_request_chain)
     HANDLE_NOTIFY(NOTIFY_RESPONSE_CHAIN_ENTRY, &FortressProtocolHandler::handle_response_chain_entry)
     HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, &FortressProtocolHandler::handleRequestTxPool)
+    HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, &FortressProtocolHandler::handle_notify_new_compact_block)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_BLOCK_TXS, &FortressProtocolHandler::handleRequestBlockTxs)
+    HANDLE_NOTIFY(NOTIFY_TX_INVENTORY, &FortressProtocolHandler::handleTxInventory)
+    HANDLE_NOTIFY(NOTIFY_REQUEST_TXS, &FortressProtocolHandler::handleRequestTxs)
 
   default:
     handled = false;
@@ -252,21 +293,145 @@ int FortressProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_BLO
   }
   if (bvc.m_added_to_main_chain) {
     ++arg.hop;
-    //TODO: Add here announce protocol usage
-    relay_post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-    // relay_block(arg, context);
+    relayBlock(arg, &context.m_connection_id);
+
+    if (bvc.m_switched_to_alt_chain) {
+      requestMissingPoolTransactions(context);
+    }
+  } else if (bvc.m_marked_as_orphaned) {
+    context.m_state = FortressConnectionContext::state_synchronizing;
+    requestChain(context);
+  }
+
+  return 1;
+}
+
+int FortressProtocolHandler::handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, FortressConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ", txs " << arg.txs.size() << ")";
+
+  updateObservedHeight(arg.current_blockchain_height, context);
+
+  context.m_remote_blockchain_height = arg.current_blockchain_height;
+
+  if (context.m_state != FortressConnectionContext::state_normal) {
+    return 1;
+  }
+
+  BinaryArray blockBlob = asBinaryArray(arg.block);
+  Block block;
+  if (blockBlob.size() > m_currency.maxBlockBlobSize() || !fromBinaryArray(block, blockBlob)) {
+    logger(Logging::INFO) << context << "Failed to parse compact block, dropping connection";
+    context.m_state = FortressConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  CachedBlock cachedBlock(block, blockBlob);
+  if (m_core.have_block(cachedBlock.getBlockHash())) {
+    return 1;
+  }
+
+  for (auto& txBlob : arg.txs) {
+    Fortress::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+    m_core.handle_incoming_tx(asBinaryArray(txBlob), tvc, true);
+    if (tvc.m_verifivation_failed) {
+      logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
+      context.m_state = FortressConnectionContext::state_shutdown;
+      return 1;
+    }
+  }
+
+  NOTIFY_REQUEST_BLOCK_TXS::request request;
+  for (uint32_t i = 0; i < block.transactionHashes.size(); ++i) {
+    if (!m_core.havePoolTransaction(block.transactionHashes[i])) {
+      request.txIndices.push_back(i);
+    }
+  }
+
+  if (!request.txIndices.empty()) {
+    if (arg.txs.empty()) {
+      request.blockId = cachedBlock.getBlockHash();
+      logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_BLOCK_TXS: txIndices.size()=" << request.txIndices.size();
+      post_notify<NOTIFY_REQUEST_BLOCK_TXS>(*m_p2p, request, context);
+      return 1;
+    }
+
+    // the peer has sent the requested transactions, but the pool still misses some, fall back to synchronization
+    logger(Logging::DEBUGGING) << context << "Compact block " << cachedBlock.getBlockHash() << " misses " << request.txIndices.size() << " transactions";
+    context.m_state = FortressConnectionContext::state_synchronizing;
+    requestChain(context);
+    return 1;
+  }
+
+  block_verification_context bvc = boost::value_initialized<block_verification_context>();
+  m_core.handle_incoming_block(cachedBlock, bvc, true, false);
+  if (bvc.m_verifivation_failed) {
+    logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
+    context.m_state = FortressConnectionContext::state_shutdown;
+    return 1;
+  }
+  if (bvc.m_added_to_main_chain) {
+    ++arg.hop;
+    arg.txs.clear();
+    relayCompactBlock(arg, block, &context.m_connection_id);
 
     if (bvc.m_switched_to_alt_chain) {
       requestMissingPoolTransactions(context);
     }
   } else if (bvc.m_marked_as_orphaned) {
     context.m_state = FortressConnectionContext::state_synchronizing;
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
+  }
+
+  return 1;
+}
+
+int FortressProtocolHandler::handleRequestBlockTxs(int command, NOTIFY_REQUEST_BLOCK_TXS::request& arg, FortressConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_BLOCK_TXS: txIndices.size()=" << arg.txIndices.size();
+
+  Block block;
+  if (!m_core.getBlockByHash(arg.blockId, block)) {
+    logger(Logging::DEBUGGING) << context << "Transactions of unknown block " << arg.blockId << " are requested";
+    return 1;
+  }
+
+  // strictly increasing indices ask for every transaction of the block once at most
+  std::vector<Crypto::Hash> txIds;
+  txIds.reserve(arg.txIndices.size());
+  for (size_t i = 0; i < arg.txIndices.size(); ++i) {
+    uint32_t index = arg.txIndices[i];
+    if (index >= block.transactionHashes.size()) {
+      logger(Logging::INFO) << context << "Requested transaction index is out of block, dropping connection";
+      context.m_state = FortressConnectionContext::state_shutdown;
+      return 1;
+    }
+
+    if (i > 0 && index <= arg.txIndices[i - 1]) {
+      logger(Logging::INFO) << context << "Requested transaction indices aren't strictly increasing, dropping connection";
+      context.m_state = FortressConnectionContext::state_shutdown;
+      return 1;
+    }
+
+    txIds.push_back(block.transactionHashes[index]);
+  }
+
+  std::list<Transaction> txs;
+  std::list<Crypto::Hash> missedTxs;
+  m_core.getTransactions(txIds, txs, missedTxs, true);
+  if (!missedTxs.empty()) {
+    logger(Logging::DEBUGGING) << context << "Can't find " << missedTxs.size() << " transactions of block " << arg.blockId;
+    return 1;
   }
 
+  NOTIFY_NEW_COMPACT_BLOCK::request rsp;
+  rsp.block = asString(toBinaryArray(block));
+  for (auto& tx : txs) {
+    rsp.txs.push_back(asString(toBinaryArray(tx)));
+  }
+
+  rsp.current_blockchain_height = get_current_blockchain_height() + 1;
+  rsp.hop = 0;
+  logger(Logging::TRACE) << context << "-->>NOTIFY_NEW_COMPACT_BLOCK: txs.size()=" << rsp.txs.size();
+  post_notify<NOTIFY_NEW_COMPACT_BLOCK>(*m_p2p, rsp, context);
   return 1;
 }
 
@@ -275,13 +440,30 @@ int FortressProtocolHandler::handle_notify_new_transactions(int command, NOTIFY_
   if (context.m_state != FortressConnectionContext::state_normal)
     return 1;
 
+  std::vector<Crypto::Hash> txHashes;
   for (auto tx_blob_it = arg.txs.begin(); tx_blob_it != arg.txs.end();) {
+    BinaryArray txBlob = asBinaryArray(*tx_blob_it);
+    Crypto::Hash txHash = getBinaryArrayHash(txBlob);
+    rememberKnownTx(context, txHash);
+
+    // requested transactions are counted when they are asked, the others when they arrive
+    if (!m_txRequestScheduler.remove(txHash)) {
+      if (context.m_txsFetchedCount == P2P_TX_RELAY_MAX_RATE) {
+        logger(Logging::DEBUGGING) << context << "Transactions are rate limited, " << txHash << " ignored";
+        tx_blob_it = arg.txs.erase(tx_blob_it);
+        continue;
+      }
+
+      ++context.m_txsFetchedCount;
+    }
+
     Fortress::tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-    m_core.handle_incoming_tx(asBinaryArray(*tx_blob_it), tvc, false);
+    m_core.handle_incoming_tx(txBlob, tvc, false);
     if (tvc.m_verifivation_failed) {
       logger(Logging::INFO) << context << "Tx verification failed";
     }
     if (!tvc.m_verifivation_failed && tvc.m_should_be_relayed) {
+      txHashes.push_back(txHash);
       ++tx_blob_it;
     } else {
       tx_blob_it = arg.txs.erase(tx_blob_it);
@@ -289,13 +471,88 @@ int FortressProtocolHandler::handle_notify_new_transactions(int command, NOTIFY_
   }
 
   if (arg.txs.size()) {
-    //TODO: add announce usage here
-    relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, arg, &context.m_connection_id);
+    m_p2p->relay_notify_to_filtered(NOTIFY_NEW_TRANSACTIONS::ID, LevinProtocol::encode(arg), &context.m_connection_id, lacksTxInventory);
+    announceTransactions(txHashes, &context.m_connection_id);
   }
 
   return true;
 }
 
+int FortressProtocolHandler::handleTxInventory(int command, NOTIFY_TX_INVENTORY::request& arg, FortressConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_TX_INVENTORY: txs.size()=" << arg.txs.size();
+  if (arg.txs.size() > P2P_TX_INVENTORY_MAX_COUNT) {
+    logger(Logging::INFO) << context << "Too many transactions announced, dropping connection";
+    context.m_state = FortressConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  if (context.m_state != FortressConnectionContext::state_normal) {
+    return 1;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  NOTIFY_REQUEST_TXS::request request;
+  for (const auto& txHash : arg.txs) {
+    rememberKnownTx(context, txHash);
+    if (m_core.havePoolTransaction(txHash)) {
+      continue;
+    }
+
+    // the peer is asked later if the transaction isn't received from the others
+    if (m_txRequestScheduler.addAnnouncement(txHash, context.m_connection_id, context.m_txsFetchedCount < P2P_TX_RELAY_MAX_RATE, now)) {
+      request.txs.push_back(txHash);
+      ++context.m_txsFetchedCount;
+    }
+  }
+
+  if (!request.txs.empty()) {
+    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_TXS: txs.size()=" << request.txs.size();
+    post_notify<NOTIFY_REQUEST_TXS>(*m_p2p, request, context);
+  }
+
+  return 1;
+}
+
+int FortressProtocolHandler::handleRequestTxs(int command, NOTIFY_REQUEST_TXS::request& arg, FortressConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TXS: txs.size()=" << arg.txs.size();
+  if (arg.txs.size() > P2P_TX_INVENTORY_MAX_COUNT) {
+    logger(Logging::INFO) << context << "Too many transactions requested, dropping connection";
+    context.m_state = FortressConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  size_t count = std::min(arg.txs.size(), P2P_TX_RELAY_MAX_RATE - context.m_txsServedCount);
+  if (count < arg.txs.size()) {
+    logger(Logging::DEBUGGING) << context << "Transaction requests are rate limited, " << arg.txs.size() - count << " ignored";
+    arg.txs.resize(count);
+  }
+
+  context.m_txsServedCount += count;
+  if (arg.txs.empty()) {
+    return 1;
+  }
+
+  std::list<Transaction> txs;
+  std::list<Crypto::Hash> missedTxs;
+  m_core.getTransactions(arg.txs, txs, missedTxs, true);
+
+  NOTIFY_NEW_TRANSACTIONS::request rsp;
+  for (auto& tx : txs) {
+    rsp.txs.push_back(asString(toBinaryArray(tx)));
+  }
+
+  for (const auto& txHash : arg.txs) {
+    rememberKnownTx(context, txHash);
+  }
+
+  if (!rsp.txs.empty()) {
+    logger(Logging::TRACE) << context << "-->>NOTIFY_NEW_TRANSACTIONS: txs.size()=" << rsp.txs.size();
+    post_notify<NOTIFY_NEW_TRANSACTIONS>(*m_p2p, rsp, context);
+  }
+
+  return 1;
+}
+
 int FortressProtocolHandler::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, FortressConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_GET_OBJECTS";
   NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
@@ -312,6 +569,12 @@ int FortressProtocolHandler::handle_request_get_objects(int command, NOTIFY_REQU
 int FortressProtocolHandler::handle_response_get_objects(int command, NOTIFY_RESPONSE_GET_OBJECTS::request& arg, FortressConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_GET_OBJECTS";
 
+  // the requests of a connection that stopped synchronizing are downloaded from other connections
+  if (context.m_state != FortressConnectionContext::state_synchronizing) {
+    logger(Logging::DEBUGGING) << context << "Blocks received out of synchronization are ignored";
+    return 1;
+  }
+
   if (context.m_last_response_height > arg.current_blockchain_height) {
     logger(Logging::ERROR) << context << "sent wrong NOTIFY_HAVE_OBJECTS: arg.m_current_blockchain_height=" << arg.current_blockchain_height
       << " < m_last_response_height=" << context.m_last_response_height << ", dropping connection";
@@ -323,80 +586,128 @@ int FortressProtocolHandler::handle_response_get_objects(int command, NOTIFY_RES
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-  size_t count = 0;
-  for (const block_complete_entry& block_entry : arg.blocks) {
-    ++count;
-    Block b;
-    if (!fromBinaryArray(b, asBinaryArray(block_entry.block))) {
-      logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << toHex(asBinaryArray(block_entry.block)) << "\r\n dropping connection";
-      context.m_state = FortressConnectionContext::state_shutdown;
-      return 1;
-    }
-
-    //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    if (count == 2) {
-      if (m_core.have_block(get_block_hash(b))) {
-        context.m_state = FortressConnectionContext::state_idle;
-        context.m_needed_objects.clear();
-        context.m_requested_objects.clear();
-        logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-        return 1;
-      }
-    }
+  if (!arg.missed_ids.empty()) {
+    logger(Logging::DEBUGGING) << context << "Peer doesn't have " << arg.missed_ids.size() << " requested blocks, switching to idle state";
+    m_downloadScheduler.releaseConnection(context.m_connection_id);
+    context.m_state = FortressConnectionContext::state_idle;
+    return 1;
+  }
 
-    auto blockHash = get_block_hash(b);
-    auto req_it = context.m_requested_objects.find(blockHash);
-    if (req_it == context.m_requested_objects.end()) {
-      logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << " wasn't requested, dropping connection";
-      context.m_state = FortressConnectionContext::state_shutdown;
-      return 1;
-    }
-    if (b.transactionHashes.size() != block_entry.txs.size()) {
-      logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << ", transactionHashes.size()=" << b.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size() << ", dropping connection";
-      context.m_state = FortressConnectionContext::state_shutdown;
-      return 1;
-    }
+  // blocks are parsed and hashed once, on a worker thread, and handed to the core as is
+  BlockDownloadScheduler::DownloadedRange range;
+  range.connectionId = context.m_connection_id;
+  range.entries = std::move(arg.blocks);
+  System::RemoteContext<bool> parsing(m_dispatcher, [this, &range] { return parseBlocks(range); });
+  if (!parsing.get()) {
+    context.m_state = FortressConnectionContext::state_shutdown;
+    return 1;
+  }
 
-    context.m_requested_objects.erase(req_it);
+  // the connection could be set idle and its requests released while the blocks were parsed
+  if (m_stop || context.m_state != FortressConnectionContext::state_synchronizing) {
+    return 1;
   }
 
-  if (context.m_requested_objects.size()) {
-    logger(Logging::ERROR, Logging::BRIGHT_RED) << context <<
-      "returned not all requested objects (context.m_requested_objects.size()="
-      << context.m_requested_objects.size() << "), dropping connection";
+  if (!m_downloadScheduler.addRange(std::move(range))) {
+    logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: blocks weren't requested, dropping connection";
     context.m_state = FortressConnectionContext::state_shutdown;
     return 1;
   }
 
-  {
-    m_core.pause_mining();
+  commitDownloadedBlocks();
+
+  // the committed blocks make room for ranges other connections wait for
+  if (!m_stop) {
+    continueSynchronization();
+  }
+
+  return 1;
+}
 
-    BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+void FortressProtocolHandler::commitDownloadedBlocks() {
+  // the coroutine that is committing takes the ranges downloaded meanwhile too
+  if (m_committingBlocks) {
+    return;
+  }
+
+  m_committingBlocks = true;
+  BOOST_SCOPE_EXIT_ALL(this) { m_committingBlocks = false; };
+
+  BlockDownloadScheduler::DownloadedRange range;
+  while (!m_stop && m_downloadScheduler.takeRange(range)) {
+    bool processed;
+    {
+      m_core.pause_mining();
+
+      BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
 
-    int result = processObjects(context, arg.blocks);
-    if (result != 0) {
-      return result;
+      // the core verifies the blocks on a worker thread, the dispatcher keeps serving the connections meanwhile
+      System::RemoteContext<bool> processing(m_dispatcher, [this, &range] {
+        return processObjects(range.connectionId, range.entries, range.cachedBlocks);
+      });
+
+      processed = processing.get();
+    }
+
+    if (!processed) {
+      // the blocks queued after the wrong ones can't be added either, synchronization starts over
+      m_downloadScheduler.clear();
+      m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+        if (context.m_connection_id == range.connectionId) {
+          context.m_state = FortressConnectionContext::state_shutdown;
+        } else if (context.m_state == FortressConnectionContext::state_synchronizing) {
+          context.m_state = FortressConnectionContext::state_idle;
+        }
+      });
+
+      return;
     }
+
+    uint32_t height;
+    Crypto::Hash top;
+    m_core.get_blockchain_top(height, top);
+    logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
   }
+}
 
-  uint32_t height;
-  Crypto::Hash top;
-  m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+bool FortressProtocolHandler::parseBlocks(BlockDownloadScheduler::DownloadedRange& range) {
+  range.blocks.resize(range.entries.size());
+  range.cachedBlocks.reserve(range.entries.size());
+
+  for (size_t i = 0; i < range.entries.size(); ++i) {
+    const block_complete_entry& block_entry = range.entries[i];
+    Block& b = range.blocks[i];
+    BinaryArray blockBinaryArray = asBinaryArray(block_entry.block);
+    if (blockBinaryArray.size() > m_currency.maxBlockBlobSize()) {
+      logger(Logging::ERROR) << range.connectionId << " sent too big block: " << blockBinaryArray.size() << " bytes, dropping connection";
+      return false;
+    }
+
+    if (!fromBinaryArray(b, blockBinaryArray)) {
+      logger(Logging::ERROR) << range.connectionId << " sent wrong block: failed to parse and validate block: \r\n"
+        << toHex(blockBinaryArray) << "\r\n dropping connection";
+      return false;
+    }
 
-  if (!m_stop && context.m_state == FortressConnectionContext::state_synchronizing) {
-    request_missing_objects(context, true);
+    range.cachedBlocks.emplace_back(b, blockBinaryArray);
+    if (b.transactionHashes.size() != block_entry.txs.size()) {
+      logger(Logging::ERROR) << range.connectionId << " sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(range.cachedBlocks.back().getBlockHash())
+        << ", transactionHashes.size()=" << b.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size() << ", dropping connection";
+      return false;
+    }
+
+    range.cachedBlocks.back().getBlockHash();
   }
 
-  return 1;
+  return true;
 }
 
-int FortressProtocolHandler::processObjects(FortressConnectionContext& context, const std::vector<block_complete_entry>& blocks) {
+bool FortressProtocolHandler::processObjects(const net_connection_id& connectionId, const std::vector<block_complete_entry>& blocks,
+  const std::vector<CachedBlock>& cachedBlocks) {
 
-  for (const block_complete_entry& block_entry : blocks) {
+  assert(blocks.size() == cachedBlocks.size());
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const block_complete_entry& block_entry = blocks[i];
     if (m_stop) {
       break;
     }
@@ -406,42 +717,33 @@ int FortressProtocolHandler::processObjects(FortressConnectionContext& context,
       tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
       m_core.handle_incoming_tx(asBinaryArray(tx_blob), tvc, true);
       if (tvc.m_verifivation_failed) {
-        logger(Logging::ERROR) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+        logger(Logging::ERROR) << "Transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS from " << connectionId << ", \r\ntx_id = "
           << Common::podToHex(getBinaryArrayHash(asBinaryArray(tx_blob))) << ", dropping connection";
-        context.m_state = FortressConnectionContext::state_shutdown;
-        return 1;
+        return false;
       }
     }
 
     // process block
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block_blob(asBinaryArray(block_entry.block), bvc, false, false);
+    m_core.handle_incoming_block(cachedBlocks[i], bvc, false, false);
 
     if (bvc.m_verifivation_failed) {
-      logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
-      context.m_state = FortressConnectionContext::state_shutdown;
-      return 1;
+      logger(Logging::DEBUGGING) << "Block verification failed on NOTIFY_RESPONSE_GET_OBJECTS from " << connectionId << ", dropping connection";
+      return false;
     } else if (bvc.m_marked_as_orphaned) {
-      logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection";
-      context.m_state = FortressConnectionContext::state_shutdown;
-      return 1;
+      logger(Logging::INFO) << "Block received from " << connectionId << " at sync phase was marked as orphaned, dropping connection";
+      return false;
     } else if (bvc.m_already_exists) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = FortressConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+      logger(Logging::DEBUGGING) << "Block " << cachedBlocks[i].getBlockHash() << " already exists";
     }
-
-    m_dispatcher.yield();
   }
 
-  return 0;
-
+  return true;
 }
 
-
 bool FortressProtocolHandler::on_idle() {
+  continueSynchronization();
+  sendTransactionAnnouncements();
   return m_core.on_idle();
 }
 
@@ -468,40 +770,29 @@ int FortressProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_CH
   return 1;
 }
 
-bool FortressProtocolHandler::request_missing_objects(FortressConnectionContext& context, bool check_having_blocks) {
-  if (context.m_needed_objects.size()) {
-    //we know objects that we need, request this objects
-    NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
-
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(check_having_blocks && m_core.have_block(*it))) {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
-      }
-      it = context.m_needed_objects.erase(it);
-    }
+bool FortressProtocolHandler::request_missing_objects(FortressConnectionContext& context) {
+  auto now = std::chrono::steady_clock::now();
+  NOTIFY_REQUEST_GET_OBJECTS::request req;
+  while (m_downloadScheduler.requestRange(context.m_connection_id, context.m_remote_blockchain_height, now, req.blocks)) {
     logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
     post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
-  } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
+  }
 
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
-  } else {
-    if (!(context.m_last_response_height ==
-      context.m_remote_blockchain_height - 1 &&
-      !context.m_needed_objects.size() &&
-      !context.m_requested_objects.size())) {
+  if (context.m_chainRequested || m_downloadScheduler.hasRequests(context.m_connection_id)) {
+    return true;
+  }
+
+  if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
+    // until the known blocks are requested the connection waits for them
+    if (!m_downloadScheduler.hasUnrequestedRanges()) {
+      requestChain(context);
+    }
+  } else if (m_downloadScheduler.empty() && !m_committingBlocks) {
+    if (context.m_last_response_height != context.m_remote_blockchain_height - 1) {
       logger(Logging::ERROR, Logging::BRIGHT_RED)
         << "request_missing_blocks final condition failed!"
         << "\r\nm_last_response_height=" << context.m_last_response_height
         << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-        << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
-        << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size() 
         << "\r\non connection [" << context << "]";
       return false;
     }
@@ -515,6 +806,32 @@ bool FortressProtocolHandler::request_missing_objects(FortressConnectionContext&
   return true;
 }
 
+void FortressProtocolHandler::requestChain(FortressConnectionContext& context) {
+  NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+  r.block_ids = m_core.buildSparseChain();
+  context.m_chainRequested = true;
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+  post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+}
+
+// connections wait when the ranges they can download are requested from others or are ahead of the window
+void FortressProtocolHandler::continueSynchronization() {
+  auto stalledConnections = m_downloadScheduler.releaseStalledConnections(std::chrono::steady_clock::now());
+  m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+    if (context.m_state != FortressConnectionContext::state_synchronizing) {
+      return;
+    }
+
+    if (std::find(stalledConnections.begin(), stalledConnections.end(), context.m_connection_id) != stalledConnections.end()) {
+      logger(Logging::INFO) << context << "Peer is too slow to send blocks, switching to idle state";
+      context.m_state = FortressConnectionContext::state_idle;
+      return;
+    }
+
+    request_missing_objects(context);
+  });
+}
+
 bool FortressProtocolHandler::on_connection_synchronized() {
   bool val_expected = false;
   if (m_synchronized.compare_exchange_strong(val_expected, true)) {
@@ -565,14 +882,31 @@ int FortressProtocolHandler::handle_response_chain_entry(int command, NOTIFY_RES
       << arg.total_height << "\r\nm_start_height=" << arg.start_height
       << "\r\nm_block_ids.size()=" << arg.m_block_ids.size();
     context.m_state = FortressConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  context.m_chainRequested = false;
+  if (context.m_state != FortressConnectionContext::state_synchronizing) {
+    return 1;
+  }
+
+  if (m_downloadScheduler.empty() && !m_committingBlocks) {
+    // the blocks after the last one we have may fork from our blockchain
+    size_t known = 1;
+    while (known < arg.m_block_ids.size() && m_core.have_block(arg.m_block_ids[known])) {
+      ++known;
+    }
+
+    m_downloadScheduler.reset(arg.start_height + static_cast<uint32_t>(known) - 1, arg.m_block_ids[known - 1]);
   }
 
-  for (auto& bl_id : arg.m_block_ids) {
-    if (!m_core.have_block(bl_id))
-      context.m_needed_objects.push_back(bl_id);
+  if (!m_downloadScheduler.addBlockIds(arg.start_height, arg.m_block_ids)) {
+    logger(Logging::DEBUGGING) << context << "Blocks of the peer fork from the blocks being downloaded, switching to idle state";
+    context.m_state = FortressConnectionContext::state_idle;
+    return 1;
   }
 
-  request_missing_objects(context, false);
+  request_missing_objects(context);
   return 1;
 }
 
@@ -580,11 +914,24 @@ int FortressProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_TX_
                                                      FortressConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_TX_POOL: txs.size() = " << arg.txs.size();
 
+  for (const auto& txHash : arg.txs) {
+    rememberKnownTx(context, txHash);
+  }
+
   std::vector<Transaction> addedTransactions;
   std::vector<Crypto::Hash> deletedTransactions;
   m_core.getPoolChanges(arg.txs, addedTransactions, deletedTransactions);
 
-  if (!addedTransactions.empty()) {
+  // the peer fetches the announced transactions it hasn't got from other peers meanwhile
+  if (supportsTxInventory(context)) {
+    for (auto& tx : addedTransactions) {
+      Crypto::Hash txHash = getObjectHash(tx);
+      if (context.m_knownTxs.count(txHash) == 0) {
+        rememberKnownTx(context, txHash);
+        context.m_txsToAnnounce.push_back(txHash);
+      }
+    }
+  } else if (!addedTransactions.empty()) {
     NOTIFY_NEW_TRANSACTIONS::request notification;
     for (auto& tx : addedTransactions) {
       notification.txs.push_back(asString(toBinaryArray(tx)));
@@ -601,13 +948,142 @@ int FortressProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_TX_
 
 
 void FortressProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_BLOCK::ID, buf);
+  auto compactArg = makeCompactBlock(arg);
+  m_p2p->externalRelayNotifyToFiltered(NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(compactArg), supportsCompactBlocks);
+  m_p2p->externalRelayNotifyToFiltered(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(arg), lacksCompactBlocks);
+}
+
+void FortressProtocolHandler::relayBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection) {
+  auto compactArg = makeCompactBlock(arg);
+  m_p2p->relay_notify_to_filtered(NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(compactArg), excludeConnection, supportsCompactBlocks);
+  m_p2p->relay_notify_to_filtered(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(arg), excludeConnection, lacksCompactBlocks);
+}
+
+void FortressProtocolHandler::relayCompactBlock(NOTIFY_NEW_COMPACT_BLOCK::request& arg, const Block& block, const net_connection_id* excludeConnection) {
+  m_p2p->relay_notify_to_filtered(NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(arg), excludeConnection, supportsCompactBlocks);
+
+  bool hasLegacyPeers = false;
+  m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+    if (context.m_state == FortressConnectionContext::state_normal || context.m_state == FortressConnectionContext::state_synchronizing) {
+      hasLegacyPeers = hasLegacyPeers || lacksCompactBlocks(context);
+    }
+  });
+
+  if (!hasLegacyPeers) {
+    return;
+  }
+
+  // the transactions have just left the pool for the blockchain
+  std::list<Transaction> txs;
+  std::list<Crypto::Hash> missedTxs;
+  m_core.getTransactions(block.transactionHashes, txs, missedTxs, true);
+  if (!missedTxs.empty()) {
+    logger(Logging::DEBUGGING) << "Can't find " << missedTxs.size() << " transactions of relayed block, it is not relayed to older peers";
+    return;
+  }
+
+  NOTIFY_NEW_BLOCK::request fullArg;
+  fullArg.b.block = arg.block;
+  for (auto& tx : txs) {
+    fullArg.b.txs.push_back(asString(toBinaryArray(tx)));
+  }
+
+  fullArg.current_blockchain_height = arg.current_blockchain_height;
+  fullArg.hop = arg.hop;
+  m_p2p->relay_notify_to_filtered(NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(fullArg), excludeConnection, lacksCompactBlocks);
 }
 
 void FortressProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg) {
   auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_TRANSACTIONS::ID, buf);
+  m_p2p->externalRelayNotifyToFiltered(NOTIFY_NEW_TRANSACTIONS::ID, buf, lacksTxInventory);
+
+  std::vector<Crypto::Hash> txHashes;
+  for (const auto& txBlob : arg.txs) {
+    txHashes.push_back(getBinaryArrayHash(asBinaryArray(txBlob)));
+  }
+
+  m_dispatcher.remoteSpawn([this, txHashes] {
+    announceTransactions(txHashes, nullptr);
+  });
+}
+
+void FortressProtocolHandler::announceTransactions(const std::vector<Crypto::Hash>& txHashes, const net_connection_id* excludeConnection) {
+  m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+    if (!supportsTxInventory(context) || (excludeConnection != nullptr && context.m_connection_id == *excludeConnection)) {
+      return;
+    }
+
+    if (context.m_state != FortressConnectionContext::state_normal && context.m_state != FortressConnectionContext::state_synchronizing) {
+      return;
+    }
+
+    for (const auto& txHash : txHashes) {
+      if (context.m_knownTxs.count(txHash) == 0) {
+        rememberKnownTx(context, txHash);
+        context.m_txsToAnnounce.push_back(txHash);
+      }
+    }
+  });
+}
+
+void FortressProtocolHandler::sendTransactionAnnouncements() {
+  m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+    context.m_txsFetchedCount = 0;
+    context.m_txsServedCount = 0;
+  });
+
+  requestAnnouncedTransactions();
+
+  m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+    if (context.m_txsToAnnounce.empty()) {
+      return;
+    }
+
+    auto end = context.m_txsToAnnounce.begin() + std::min(context.m_txsToAnnounce.size(), P2P_TX_INVENTORY_MAX_COUNT);
+    NOTIFY_TX_INVENTORY::request notification;
+    notification.txs.assign(context.m_txsToAnnounce.begin(), end);
+    context.m_txsToAnnounce.erase(context.m_txsToAnnounce.begin(), end);
+
+    logger(Logging::TRACE) << context << "-->>NOTIFY_TX_INVENTORY: txs.size()=" << notification.txs.size();
+    post_notify<NOTIFY_TX_INVENTORY>(*m_p2p, notification, context);
+  });
+}
+
+void FortressProtocolHandler::requestAnnouncedTransactions() {
+  if (m_txRequestScheduler.size() == 0) {
+    return;
+  }
+
+  std::unordered_map<net_connection_id, FortressConnectionContext*, boost::hash<net_connection_id>> connections;
+  m_p2p->for_each_connection([&](FortressConnectionContext& context, PeerIdType peerId) {
+    if (context.m_state == FortressConnectionContext::state_normal) {
+      connections.emplace(context.m_connection_id, &context);
+    }
+  });
+
+  std::unordered_map<FortressConnectionContext*, NOTIFY_REQUEST_TXS::request> requests;
+  m_txRequestScheduler.requestTransactions(std::chrono::steady_clock::now(), [this](const Crypto::Hash& txHash) {
+    return m_core.havePoolTransaction(txHash);
+  }, [&](const net_connection_id& connectionId, const Crypto::Hash& txHash) {
+    auto it = connections.find(connectionId);
+    if (it == connections.end() || it->second->m_txsFetchedCount == P2P_TX_RELAY_MAX_RATE) {
+      return false;
+    }
+
+    ++it->second->m_txsFetchedCount;
+    requests[it->second].txs.push_back(txHash);
+    return true;
+  });
+
+  for (auto& request : requests) {
+    const auto& txs = request.second.txs;
+    for (size_t start = 0; start < txs.size(); start += P2P_TX_INVENTORY_MAX_COUNT) {
+      NOTIFY_REQUEST_TXS::request part;
+      part.txs.assign(txs.begin() + start, txs.begin() + std::min(txs.size(), start + P2P_TX_INVENTORY_MAX_COUNT));
+      logger(Logging::TRACE) << *request.first << "-->>NOTIFY_REQUEST_TXS: txs.size()=" << part.txs.size();
+      post_notify<NOTIFY_REQUEST_TXS>(*m_p2p, part, *request.first);
+    }
+  }
 }
 
 void FortressProtocolHandler::requestMissingPoolTransactions(const FortressConnectionContext& context) {
@@ -5,15 +5,19 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <unordered_map>
 
 #include <Common/ObserverManager.h>
 
 #include "FortressCore/ICore.h"
 
+#include "FortressProtocol/BlockDownloadScheduler.h"
 #include "FortressProtocol/FortressProtocolDefinitions.h"
 #include "FortressProtocol/FortressProtocolHandlerCommon.h"
 #include "FortressProtocol/IFortressProtocolObserver.h"
 #include "FortressProtocol/IFortressProtocolQuery.h"
+#include "FortressProtocol/TransactionRequestScheduler.h"
 
 #include "P2p/P2pProtocolDefinitions.h"
 #include "P2p/NetNodeCommon.h"
@@ -68,6 +72,10 @@ namespace Fortress
     int handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, FortressConnectionContext& context);
     int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, FortressConnectionContext& context);
     int handleRequestTxPool(int command, NOTIFY_REQUEST_TX_POOL::request& arg, FortressConnectionContext& context);
+    int handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, FortressConnectionContext& context);
+    int handleRequestBlockTxs(int command, NOTIFY_REQUEST_BLOCK_TXS::request& arg, FortressConnectionContext& context);
+    int handleTxInventory(int command, NOTIFY_TX_INVENTORY::request& arg, FortressConnectionContext& context);
+    int handleRequestTxs(int command, NOTIFY_REQUEST_TXS::request& arg, FortressConnectionContext& context);
 
     //----------------- i_Fortress_protocol ----------------------------------
     virtual void relay_block(NOTIFY_NEW_BLOCK::request& arg) override;
@@ -75,11 +83,27 @@ namespace Fortress
 
     //----------------------------------------------------------------------------------
     uint32_t get_current_blockchain_height();
-    bool request_missing_objects(FortressConnectionContext& context, bool check_having_blocks);
+    bool request_missing_objects(FortressConnectionContext& context);
+    void requestChain(FortressConnectionContext& context);
+    // requests blocks from the synchronizing connections that wait for them, slow connections are set idle
+    void continueSynchronization();
+    // hands the downloaded ranges to the core in blockchain order, one range at a time
+    void commitDownloadedBlocks();
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const FortressConnectionContext& context);
     void recalculateMaxObservedHeight(const FortressConnectionContext& context);
-    int processObjects(FortressConnectionContext& context, const std::vector<block_complete_entry>& blocks);
+    // parses the blocks and computes their ids, runs on a worker thread
+    bool parseBlocks(BlockDownloadScheduler::DownloadedRange& range);
+    // hands the blocks and their transactions to the core, runs on a worker thread
+    bool processObjects(const net_connection_id& connectionId, const std::vector<block_complete_entry>& blocks, const std::vector<CachedBlock>& cachedBlocks);
+    // peers that support compact blocks get the block without its transactions, the others get the full block
+    void relayBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection);
+    void relayCompactBlock(NOTIFY_NEW_COMPACT_BLOCK::request& arg, const Block& block, const net_connection_id* excludeConnection);
+    // queues the hashes for peers that support transaction inventory, on_idle sends them
+    void announceTransactions(const std::vector<Crypto::Hash>& txHashes, const net_connection_id* excludeConnection);
+    void sendTransactionAnnouncements();
+    // asks the announced transactions that aren't requested, or whose requests timed out, from the connections within their rate
+    void requestAnnouncedTransactions();
     Logging::LoggerRef logger;
 
   private:
@@ -97,6 +121,10 @@ namespace Fortress
     uint32_t m_observedHeight;
 
     std::atomic<size_t> m_peersCount;
+    BlockDownloadScheduler m_downloadScheduler;
+    bool m_committingBlocks;
+    // transactions announced by peers and missing in the pool
+    TransactionRequestScheduler m_txRequestScheduler;
     Tools::ObserverManager<IFortressProtocolObserver> m_observerManager;
   };
 }
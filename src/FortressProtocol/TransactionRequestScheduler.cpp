@@ -0,0 +1,99 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "TransactionRequestScheduler.h"
+
+#include <algorithm>
+
+namespace Fortress {
+
+TransactionRequestScheduler::TransactionRequestScheduler(size_t maxCount, Clock::duration timeout) :
+  m_maxCount(maxCount),
+  m_timeout(timeout) {
+}
+
+size_t TransactionRequestScheduler::size() const {
+  return m_txs.size();
+}
+
+bool TransactionRequestScheduler::addAnnouncement(const Crypto::Hash& txHash, const net_connection_id& connectionId, bool canRequest,
+  Clock::time_point now) {
+  auto it = m_txs.find(txHash);
+  if (it != m_txs.end()) {
+    auto& announcers = it->second.announcers;
+    if (std::find(announcers.begin(), announcers.end(), connectionId) == announcers.end()) {
+      announcers.push_back(connectionId);
+    }
+
+    return false;
+  }
+
+  if (m_txs.size() >= m_maxCount) {
+    return false;
+  }
+
+  AnnouncedTx& tx = m_txs[txHash];
+  tx.announcers.push_back(connectionId);
+  tx.requested = canRequest;
+  tx.requestTime = now;
+  return canRequest;
+}
+
+bool TransactionRequestScheduler::remove(const Crypto::Hash& txHash) {
+  return m_txs.erase(txHash) != 0;
+}
+
+void TransactionRequestScheduler::releaseConnection(const net_connection_id& connectionId) {
+  for (auto& entry : m_txs) {
+    AnnouncedTx& tx = entry.second;
+    auto announcer = std::find(tx.announcers.begin(), tx.announcers.end(), connectionId);
+    if (announcer == tx.announcers.end()) {
+      continue;
+    }
+
+    if (announcer == tx.announcers.begin()) {
+      tx.requested = false;
+    }
+
+    tx.announcers.erase(announcer);
+  }
+}
+
+void TransactionRequestScheduler::requestTransactions(Clock::time_point now, const std::function<bool(const Crypto::Hash&)>& isReceived,
+  const std::function<bool(const net_connection_id&, const Crypto::Hash&)>& request) {
+  for (auto it = m_txs.begin(); it != m_txs.end();) {
+    AnnouncedTx& tx = it->second;
+    if (tx.requested) {
+      if (now - tx.requestTime < m_timeout) {
+        ++it;
+        continue;
+      }
+
+      tx.announcers.pop_front();
+      tx.requested = false;
+    }
+
+    if (isReceived(it->first)) {
+      it = m_txs.erase(it);
+      continue;
+    }
+
+    for (auto announcer = tx.announcers.begin(); announcer != tx.announcers.end(); ++announcer) {
+      if (request(*announcer, it->first)) {
+        std::iter_swap(announcer, tx.announcers.begin());
+        tx.requested = true;
+        tx.requestTime = now;
+        break;
+      }
+    }
+
+    if (tx.announcers.empty()) {
+      it = m_txs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+#include "crypto/hash.h"
+#include "P2p/P2pProtocolTypes.h"
+
+namespace Fortress {
+
+// Keeps the transactions peers announced until they are received. Each transaction is asked from one announcer at a
+// time, the next announcer is asked if it isn't received in time. It is used on the dispatcher thread only.
+class TransactionRequestScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  TransactionRequestScheduler(size_t maxCount, Clock::duration timeout);
+
+  size_t size() const;
+
+  // remembers the connection as an announcer of the transaction, returns true if the transaction is asked from it now;
+  // canRequest tells whether the connection can be asked now, otherwise the transaction waits for requestTransactions
+  bool addAnnouncement(const Crypto::Hash& txHash, const net_connection_id& connectionId, bool canRequest, Clock::time_point now);
+  // the transaction is received, returns false if it wasn't announced
+  bool remove(const Crypto::Hash& txHash);
+  void releaseConnection(const net_connection_id& connectionId);
+
+  // asks the transactions that aren't requested or whose requests timed out from their next announcers;
+  // request returns false if the connection can't be asked now, the transactions without announcers are forgotten
+  void requestTransactions(Clock::time_point now, const std::function<bool(const Crypto::Hash&)>& isReceived,
+    const std::function<bool(const net_connection_id&, const Crypto::Hash&)>& request);
+
+private:
+  struct AnnouncedTx {
+    // the front one is asked when the transaction is requested
+    std::deque<net_connection_id> announcers;
+    bool requested;
+    Clock::time_point requestTime;
+  };
+
+  const size_t m_maxCount;
+  const Clock::duration m_timeout;
+
+  std::unordered_map<Crypto::Hash, AnnouncedTx> m_txs;
+};
+
+}
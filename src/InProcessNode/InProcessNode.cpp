@@ -218,6 +218,47 @@ std::error_code InProcessNode::doGetTransactionOutsGlobalIndices(const Crypto::H
   return std::error_code();
 }
 
+void InProcessNode::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (state != INITIALIZED) {
+    lock.unlock();
+    callback(make_error_code(Fortress::error::NOT_INITIALIZED));
+    return;
+  }
+
+  ioService.post(
+    std::bind(&InProcessNode::getTransactionsOutsGlobalIndicesAsync,
+      this,
+      std::cref(transactionHashes),
+      std::ref(outsGlobalIndices),
+      callback
+    )
+  );
+}
+
+void InProcessNode::getTransactionsOutsGlobalIndicesAsync(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback)
+{
+  std::error_code ec = doGetTransactionsOutsGlobalIndices(transactionHashes, outsGlobalIndices);
+  callback(ec);
+}
+
+std::error_code InProcessNode::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.resize(transactionHashes.size());
+  for (size_t i = 0; i < transactionHashes.size(); ++i) {
+    std::error_code ec = doGetTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices[i]);
+    if (ec) {
+      return ec;
+    }
+  }
+
+  return std::error_code();
+}
+
 void InProcessNode::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
     std::vector<Fortress::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback)
 {
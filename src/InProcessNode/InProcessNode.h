@@ -47,6 +47,7 @@ public:
 
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<Fortress::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
       std::vector<Fortress::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override;
   virtual void relayTransaction(const Fortress::Transaction& transaction, const Callback& callback) override;
@@ -78,6 +79,9 @@ private:
   void getTransactionOutsGlobalIndicesAsync(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback);
   std::error_code doGetTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices);
 
+  void getTransactionsOutsGlobalIndicesAsync(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback);
+  std::error_code doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices);
+
   void getRandomOutsByAmountsAsync(std::vector<uint64_t>& amounts, uint64_t outsCount,
       std::vector<Fortress::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback);
   std::error_code doGetRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
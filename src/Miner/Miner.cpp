@@ -4,8 +4,11 @@
 
 #include "Miner.h"
 
+#include <chrono>
 #include <functional>
 
+#include <boost/scope_exit.hpp>
+
 #include "crypto/crypto.h"
 #include "FortressCore/FortressFormatUtils.h"
 
@@ -17,6 +20,8 @@ Miner::Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger) :
   m_dispatcher(dispatcher),
   m_miningStopped(dispatcher),
   m_state(MiningState::MINING_STOPPED),
+  m_hashWays(0),
+  m_hashes(0),
   m_logger(logger, "Miner") {
 }
 
@@ -24,11 +29,15 @@ Miner::~Miner() {
   assert(m_state != MiningState::MINING_IN_PROGRESS);
 }
 
-Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount) {
+Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount, size_t hashWays) {
   if (threadCount == 0) {
     throw std::runtime_error("Miner requires at least one thread");
   }
 
+  if (hashWays == 0 || hashWays > Crypto::SLOW_HASH_MAX_WAYS) {
+    throw std::runtime_error("Miner supports 1.." + std::to_string(Crypto::SLOW_HASH_MAX_WAYS) + " hash ways");
+  }
+
   if (m_state == MiningState::MINING_IN_PROGRESS) {
     throw std::runtime_error("Mining is already in progress");
   }
@@ -36,7 +45,7 @@ Block Miner::mine(const BlockMiningParameters& blockMiningParameters, size_t thr
   m_state = MiningState::MINING_IN_PROGRESS;
   m_miningStopped.clear();
 
-  runWorkers(blockMiningParameters, threadCount);
+  runWorkers(blockMiningParameters, threadCount, hashWays);
 
   assert(m_state != MiningState::MINING_IN_PROGRESS);
   if (m_state == MiningState::MINING_STOPPED) {
@@ -57,24 +66,43 @@ void Miner::stop() {
   }
 }
 
-void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount) {
+void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount, size_t hashWays) {
   assert(threadCount > 0);
 
   m_logger(Logging::INFO) << "Starting mining for difficulty " << blockMiningParameters.difficulty;
 
   try {
     blockMiningParameters.blockTemplate.nonce = Crypto::rand<uint32_t>();
+    MiningJob job(blockMiningParameters.blockTemplate);
+
+    // scratchpads are kept between templates, so each worker allocates and locks one only once
+    if (m_hashWays != hashWays) {
+      m_cryptoContexts.clear();
+      m_hashWays = hashWays;
+    }
+
+    while (m_cryptoContexts.size() < threadCount) {
+      m_cryptoContexts.emplace_back(new Crypto::cn_context[hashWays]);
+    }
+
+    m_hashes = 0;
+    auto startTime = std::chrono::steady_clock::now();
 
     for (size_t i = 0; i < threadCount; ++i) {
       m_workers.emplace_back(std::unique_ptr<System::RemoteContext<void>> (
-        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, blockMiningParameters.difficulty, threadCount)))
+        new System::RemoteContext<void>(m_dispatcher, std::bind(&Miner::workerFunc, this, blockMiningParameters.blockTemplate, job,
+          blockMiningParameters.difficulty, static_cast<uint32_t>(threadCount), hashWays, m_cryptoContexts[i].get())))
       );
 
-      blockMiningParameters.blockTemplate.nonce++;
+      job.setNonce(job.getNonce() + 1);
     }
 
     m_workers.clear();
 
+    uint64_t hashes = m_hashes;
+    uint64_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    m_logger(Logging::INFO) << "Hashrate: " << hashes * 1000 / (milliseconds + 1) << " H/s, " << hashes << " hashes in " << milliseconds << " ms";
+
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Error occured during mining: " << e.what();
     m_state = MiningState::MINING_STOPPED;
@@ -83,33 +111,38 @@ void Miner::runWorkers(BlockMiningParameters blockMiningParameters, size_t threa
   m_miningStopped.set();
 }
 
-void Miner::workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep) {
+void Miner::workerFunc(const Block& blockTemplate, MiningJob job, difficulty_type difficulty, uint32_t nonceStep, size_t hashWays,
+  Crypto::cn_context* cryptoContexts) {
   try {
-    Block block = blockTemplate;
-    Crypto::cn_context cryptoContext;
+    uint64_t hashes = 0;
+    BOOST_SCOPE_EXIT_ALL(this, &hashes) { m_hashes += hashes; };
 
+    Crypto::Hash hash[Crypto::SLOW_HASH_MAX_WAYS];
     while (m_state == MiningState::MINING_IN_PROGRESS) {
-      Crypto::Hash hash;
-      if (!get_block_longhash(cryptoContext, block, hash)) {
-        //error occured
-        m_logger(Logging::DEBUGGING) << "calculating long hash error occured";
-        m_state = MiningState::MINING_STOPPED;
-        return;
+      if (hashWays == 1) {
+        job.getLongHash(cryptoContexts[0], hash[0]);
+      } else {
+        job.getLongHashes(cryptoContexts, hashWays, nonceStep, hash, hashWays);
       }
 
-      if (check_hash(hash, difficulty)) {
-        m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+      hashes += hashWays;
 
-        if (!setStateBlockFound()) {
-          m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+      for (size_t i = 0; i < hashWays; ++i) {
+        if (check_hash(hash[i], difficulty)) {
+          m_logger(Logging::INFO) << "Found block for difficulty " << difficulty;
+
+          if (!setStateBlockFound()) {
+            m_logger(Logging::DEBUGGING) << "block is already found or mining stopped";
+            return;
+          }
+
+          m_block = blockTemplate;
+          m_block.nonce = job.getNonce() + static_cast<uint32_t>(i) * nonceStep;
           return;
         }
-
-        m_block = block;
-        return;
       }
 
-      block.nonce += nonceStep;
+      job.setNonce(job.getNonce() + static_cast<uint32_t>(hashWays) * nonceStep);
     }
   } catch (std::exception& e) {
     m_logger(Logging::ERROR) << "Miner got error: " << e.what();
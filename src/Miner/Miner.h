@@ -13,6 +13,7 @@
 
 #include "Fortress.h"
 #include "FortressCore/Difficulty.h"
+#include "FortressCore/MiningJob.h"
 
 #include "Logging/LoggerRef.h"
 
@@ -28,7 +29,8 @@ public:
   Miner(System::Dispatcher& dispatcher, Logging::ILogger& logger);
   ~Miner();
 
-  Block mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount);
+  // each thread hashes hashWays nonces side by side
+  Block mine(const BlockMiningParameters& blockMiningParameters, size_t threadCount, size_t hashWays = 1);
 
   //NOTE! this is blocking method
   void stop();
@@ -41,13 +43,16 @@ private:
   std::atomic<MiningState> m_state;
 
   std::vector<std::unique_ptr<System::RemoteContext<void>>>  m_workers;
+  std::vector<std::unique_ptr<Crypto::cn_context[]>> m_cryptoContexts;
+  size_t m_hashWays;
+  std::atomic<uint64_t> m_hashes;
 
   Block m_block;
 
   Logging::LoggerRef m_logger;
 
-  void runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount);
-  void workerFunc(const Block& blockTemplate, difficulty_type difficulty, uint32_t nonceStep);
+  void runWorkers(BlockMiningParameters blockMiningParameters, size_t threadCount, size_t hashWays);
+  void workerFunc(const Block& blockTemplate, MiningJob job, difficulty_type difficulty, uint32_t nonceStep, size_t hashWays, Crypto::cn_context* cryptoContexts);
   bool setStateBlockFound();
 };
 
@@ -148,7 +148,7 @@ void MinerManager::pushEvent(MinerEvent&& event) {
 void MinerManager::startMining(const Fortress::BlockMiningParameters& params) {
   m_contextGroup.spawn([this, params] () {
     try {
-      m_minedBlock = m_miner.mine(params, m_config.threadCount);
+      m_minedBlock = m_miner.mine(params, m_config.threadCount, m_config.hashWays);
       pushEvent(BlockMinedEvent());
     } catch (System::InterruptedException&) {
     } catch (std::exception& e) {
@@ -19,6 +19,7 @@ struct MiningConfig {
   std::string daemonHost;
   uint16_t daemonPort;
   size_t threadCount;
+  size_t hashWays;
   size_t scanPeriod;
   uint8_t logLevel;
   size_t blocksLimit;
@@ -5,6 +5,7 @@
 #include "NodeRpcProxy.h"
 #include "NodeErrors.h"
 
+#include <algorithm>
 #include <atomic>
 #include <system_error>
 #include <thread>
@@ -13,16 +14,16 @@
 #include <HTTP/HttpResponse.h>
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
-#include <System/Event.h>
-#include <System/EventLock.h>
+#include <System/InterruptedException.h>
 #include <System/Timer.h>
 #include <FortressCore/TransactionApi.h>
 
 #include "Common/StringTools.h"
+#include "FortressConfig.h"
 #include "FortressCore/FortressBasicImpl.h"
 #include "FortressCore/FortressTools.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
-#include "Rpc/HttpClient.h"
+#include "Rpc/HttpClientPool.h"
 #include "Rpc/JsonRpc.h"
 
 #ifndef AUTO_VAL_INIT
@@ -48,11 +49,13 @@ std::error_code interpretResponseStatus(const std::string& status) {
 
 }
 
-NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort) :
+NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort, size_t connectionCount) :
     m_rpcTimeout(10000),
     m_pullInterval(5000),
+    m_statusWaitTimeout(30000),
     m_nodeHost(nodeHost),
     m_nodePort(nodePort),
+    m_connectionCount(std::max(connectionCount, static_cast<size_t>(1))),
     m_lastLocalBlockTimestamp(0),
     m_connected(true) {
   resetInternalState();
@@ -72,6 +75,9 @@ void NodeRpcProxy::resetInternalState() {
   m_networkHeight.store(0, std::memory_order_relaxed);
   m_lastKnowHash = Fortress::NULL_HASH;
   m_knownTxs.clear();
+  m_nodeStatusSupported = true;
+  m_waitNodeStatusSupported = true;
+  m_txsOutsGlobalIndicesSupported = true;
 }
 
 void NodeRpcProxy::init(const INode::Callback& callback) {
@@ -106,6 +112,8 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    // a held status request could take until its timeout otherwise
+    m_statusContextGroup->interrupt();
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -124,11 +132,12 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     m_dispatcher = &dispatcher;
     ContextGroup contextGroup(dispatcher);
     m_context_group = &contextGroup;
-    HttpClient httpClient(dispatcher, m_nodeHost, m_nodePort);
-    m_httpClient = &httpClient;
-    Event httpEvent(dispatcher);
-    m_httpEvent = &httpEvent;
-    m_httpEvent->set();
+    ContextGroup statusContextGroup(dispatcher);
+    m_statusContextGroup = &statusContextGroup;
+    HttpClientPool httpClients(dispatcher, m_nodeHost, m_nodePort, m_connectionCount);
+    m_httpClients = &httpClients;
+    HttpClient statusClient(dispatcher, m_nodeHost, m_nodePort);
+    m_statusClient = &statusClient;
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -139,16 +148,23 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
-    contextGroup.spawn([this]() {
-      Timer pullTimer(*m_dispatcher);
-      while (!m_stop) {
-        updateNodeStatus();
-        if (!m_stop) {
-          pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+    statusContextGroup.spawn([this]() {
+      try {
+        Timer pullTimer(*m_dispatcher);
+        while (!m_stop) {
+          // the node answers as soon as its state changes, a node that can't hold the request is polled
+          if (!waitNodeStatus() && !m_stop) {
+            updateNodeStatus();
+            if (!m_stop) {
+              pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+            }
+          }
         }
+      } catch (System::InterruptedException&) {
       }
     });
 
+    statusContextGroup.wait();
     contextGroup.wait();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
@@ -157,8 +173,9 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
   m_dispatcher = nullptr;
   m_context_group = nullptr;
-  m_httpClient = nullptr;
-  m_httpEvent = nullptr;
+  m_statusContextGroup = nullptr;
+  m_httpClients = nullptr;
+  m_statusClient = nullptr;
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
@@ -166,9 +183,86 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 void NodeRpcProxy::updateNodeStatus() {
   bool updateBlockchain = true;
   while (updateBlockchain) {
-    updateBlockchainStatus();
-    updateBlockchain = !updatePoolStatus();
+    bool isTailBlockActual = true;
+    if (m_nodeStatusSupported && pollNodeStatus(isTailBlockActual) == make_error_code(error::NOT_SUPPORTED)) {
+      m_nodeStatusSupported = false;
+    }
+
+    if (m_nodeStatusSupported) {
+      updateBlockchain = !isTailBlockActual;
+    } else {
+      // the node doesn't know the combined request, ask the old way
+      updateBlockchainStatus();
+      updateBlockchain = !updatePoolStatus();
+    }
+  }
+
+  updateConnectionStatus(m_httpClients->isConnected());
+}
+
+std::error_code NodeRpcProxy::pollNodeStatus(bool& isTailBlockActual) {
+  Fortress::COMMAND_RPC_GET_NODE_STATUS::request req = AUTO_VAL_INIT(req);
+  Fortress::COMMAND_RPC_GET_NODE_STATUS::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.tailBlockId = m_lastKnowHash;
+  req.knownTxsIds = getKnownTxsVector();
+
+  std::error_code ec = binaryCommand("/get_node_status.bin", req, rsp);
+  if (ec) {
+    return ec;
+  }
+
+  isTailBlockActual = applyNodeStatus(rsp);
+  return ec;
+}
+
+bool NodeRpcProxy::waitNodeStatus() {
+  if (!m_waitNodeStatusSupported) {
+    return false;
+  }
+
+  Fortress::COMMAND_RPC_WAIT_NODE_STATUS::request req = AUTO_VAL_INIT(req);
+  Fortress::COMMAND_RPC_WAIT_NODE_STATUS::response rsp = AUTO_VAL_INIT(rsp);
+
+  req.tailBlockId = m_lastKnowHash;
+  req.knownTxsIds = getKnownTxsVector();
+  req.timeout = m_statusWaitTimeout;
+
+  std::error_code ec = binaryCommand(*m_statusClient, "/wait_node_status.bin", req, rsp);
+  if (ec) {
+    m_waitNodeStatusSupported = ec != make_error_code(error::NOT_SUPPORTED);
+    return false;
   }
+
+  updateConnectionStatus(m_statusClient->isConnected());
+
+  // if the tail block is not actual the next request returns at once with the pool changes
+  applyNodeStatus(rsp);
+  return true;
+}
+
+bool NodeRpcProxy::applyNodeStatus(const COMMAND_RPC_GET_NODE_STATUS::response& status) {
+  updateLocalBlockchain(status.topBlockId, status.topBlockIndex, status.topBlockTimestamp);
+  updateNetworkHeight(status.lastKnownBlockIndex);
+  updatePeerCount(status.peerCount);
+
+  // pool changes are relative to the tail block sent, they are useless if it is not the top anymore
+  if (!status.isTailBlockActual) {
+    return false;
+  }
+
+  if (!status.addedTxs.empty() || !status.deletedTxsIds.empty()) {
+    std::vector<std::unique_ptr<ITransactionReader>> addedTxs;
+    addedTxs.reserve(status.addedTxs.size());
+    for (const auto& tpi : status.addedTxs) {
+      addedTxs.push_back(createTransactionPrefix(tpi.txPrefix, tpi.txHash));
+    }
+
+    updatePoolState(addedTxs, status.deletedTxsIds);
+    m_observerManager.notify(&INodeObserver::poolChanged);
+  }
+
+  return true;
 }
 
 bool NodeRpcProxy::updatePoolStatus() {
@@ -208,12 +302,7 @@ void NodeRpcProxy::updateBlockchainStatus() {
       return;
     }
 
-    if (blockHash != m_lastKnowHash) {
-      m_lastKnowHash = blockHash;
-      m_nodeHeight.store(static_cast<uint32_t>(rsp.block_header.height), std::memory_order_relaxed);
-      m_lastLocalBlockTimestamp.store(rsp.block_header.timestamp, std::memory_order_relaxed);
-      m_observerManager.notify(&INodeObserver::localBlockchainUpdated, m_nodeHeight.load(std::memory_order_relaxed));
-    }
+    updateLocalBlockchain(blockHash, static_cast<uint32_t>(rsp.block_header.height), rsp.block_header.timestamp);
   }
 
   Fortress::COMMAND_RPC_GET_INFO::request getInfoReq = AUTO_VAL_INIT(getInfoReq);
@@ -221,20 +310,27 @@ void NodeRpcProxy::updateBlockchainStatus() {
 
   ec = jsonCommand("/getinfo", getInfoReq, getInfoResp);
   if (!ec) {
-    //a quirk to let wallets work with previous versions daemons.
-    //Previous daemons didn't have the 'last_known_block_index' parameter in RPC so it may have zero value.
-    auto lastKnownBlockIndex = std::max(getInfoResp.last_known_block_index, m_nodeHeight.load(std::memory_order_relaxed));
-    if (m_networkHeight.load(std::memory_order_relaxed) != lastKnownBlockIndex) {
-      m_networkHeight.store(lastKnownBlockIndex, std::memory_order_relaxed);
-      m_observerManager.notify(&INodeObserver::lastKnownBlockHeightUpdated, m_networkHeight.load(std::memory_order_relaxed));
-    }
-
+    updateNetworkHeight(getInfoResp.last_known_block_index);
     updatePeerCount(getInfoResp.incoming_connections_count + getInfoResp.outgoing_connections_count);
   }
+}
 
-  if (m_connected != m_httpClient->isConnected()) {
-    m_connected = m_httpClient->isConnected();
-    m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
+void NodeRpcProxy::updateLocalBlockchain(const Crypto::Hash& topBlockHash, uint32_t topBlockIndex, uint64_t topBlockTimestamp) {
+  if (topBlockHash != m_lastKnowHash) {
+    m_lastKnowHash = topBlockHash;
+    m_nodeHeight.store(topBlockIndex, std::memory_order_relaxed);
+    m_lastLocalBlockTimestamp.store(topBlockTimestamp, std::memory_order_relaxed);
+    m_observerManager.notify(&INodeObserver::localBlockchainUpdated, m_nodeHeight.load(std::memory_order_relaxed));
+  }
+}
+
+void NodeRpcProxy::updateNetworkHeight(uint32_t lastKnownBlockIndex) {
+  //a quirk to let wallets work with previous versions daemons.
+  //Previous daemons didn't have the 'last_known_block_index' parameter in RPC so it may have zero value.
+  lastKnownBlockIndex = std::max(lastKnownBlockIndex, m_nodeHeight.load(std::memory_order_relaxed));
+  if (m_networkHeight.load(std::memory_order_relaxed) != lastKnownBlockIndex) {
+    m_networkHeight.store(lastKnownBlockIndex, std::memory_order_relaxed);
+    m_observerManager.notify(&INodeObserver::lastKnownBlockHeightUpdated, m_networkHeight.load(std::memory_order_relaxed));
   }
 }
 
@@ -245,6 +341,20 @@ void NodeRpcProxy::updatePeerCount(size_t peerCount) {
   }
 }
 
+void NodeRpcProxy::updateConnectionStatus(bool connected) {
+  if (m_connected != connected) {
+    m_connected = connected;
+    if (!connected) {
+      // the node may come back upgraded
+      m_nodeStatusSupported = true;
+      m_waitNodeStatusSupported = true;
+      m_txsOutsGlobalIndicesSupported = true;
+    }
+
+    m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
+  }
+}
+
 void NodeRpcProxy::updatePoolState(const std::vector<std::unique_ptr<ITransactionReader>>& addedTxs, const std::vector<Crypto::Hash>& deletedTxsIds) {
   for (const auto& hash : deletedTxsIds) {
     m_knownTxs.erase(hash);
@@ -349,6 +459,18 @@ void NodeRpcProxy::getTransactionOutsGlobalIndices(const Crypto::Hash& transacti
     std::ref(outsGlobalIndices)), callback);
 }
 
+void NodeRpcProxy::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+  std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doGetTransactionsOutsGlobalIndices, this, std::cref(transactionHashes),
+    std::ref(outsGlobalIndices)), callback);
+}
+
 void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
   uint32_t& startHeight, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
@@ -516,6 +638,50 @@ std::error_code NodeRpcProxy::doGetTransactionOutsGlobalIndices(const Crypto::Ha
   return ec;
 }
 
+std::error_code NodeRpcProxy::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+  std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.reserve(transactionHashes.size());
+
+  for (size_t offset = 0; offset < transactionHashes.size(); offset += COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES_MAX_COUNT) {
+    size_t count = std::min(transactionHashes.size() - offset, COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES_MAX_COUNT);
+
+    if (m_txsOutsGlobalIndicesSupported) {
+      Fortress::COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request req = AUTO_VAL_INIT(req);
+      Fortress::COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response rsp = AUTO_VAL_INIT(rsp);
+      req.txids.assign(transactionHashes.begin() + offset, transactionHashes.begin() + offset + count);
+
+      std::error_code ec = binaryCommand("/get_txs_o_indexes.bin", req, rsp);
+      if (ec == make_error_code(error::NOT_SUPPORTED)) {
+        m_txsOutsGlobalIndicesSupported = false;
+      } else if (ec) {
+        return ec;
+      } else {
+        if (rsp.transactions.size() != count) {
+          return make_error_code(error::INTERNAL_NODE_ERROR);
+        }
+
+        for (auto& transaction : rsp.transactions) {
+          outsGlobalIndices.push_back(std::move(transaction.o_indexes));
+        }
+
+        continue;
+      }
+    }
+
+    // the node doesn't know the batch request, ask for every transaction separately
+    for (size_t i = offset; i < offset + count; ++i) {
+      outsGlobalIndices.emplace_back();
+      std::error_code ec = doGetTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices.back());
+      if (ec) {
+        return ec;
+      }
+    }
+  }
+
+  return std::error_code();
+}
+
 std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
         std::vector<Fortress::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   Fortress::COMMAND_RPC_QUERY_BLOCKS_LITE::request req = AUTO_VAL_INIT(req);
@@ -611,10 +777,7 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
           callback(std::make_error_code(std::errc::operation_canceled));
         } else {
           std::error_code ec = procedure();
-          if (m_connected != m_httpClient->isConnected()) {
-            m_connected = m_httpClient->isConnected();
-            m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
-          }
+          updateConnectionStatus(m_httpClients->isConnected());
           callback(m_stop ? std::make_error_code(std::errc::operation_canceled) : ec);
         }
       }, std::move(procedure), std::move(callback)));
@@ -626,11 +789,26 @@ std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Reques
   std::error_code ec;
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeBinaryCommand(*m_httpClient, url, req, res);
+    HttpClientPool::Lease lease(*m_httpClients);
+    ec = binaryCommand(lease.client(), url, req, res);
+  } catch (const std::exception&) {
+    ec = make_error_code(error::NETWORK_ERROR);
+  }
+
+  return ec;
+}
+
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::binaryCommand(HttpClient& httpClient, const std::string& url, const Request& req, Response& res) {
+  std::error_code ec;
+
+  try {
+    invokeBinaryCommand(httpClient, url, req, res);
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
+  } catch (const NotFoundException&) {
+    ec = make_error_code(error::NOT_SUPPORTED);
   } catch (const std::exception&) {
     ec = make_error_code(error::NETWORK_ERROR);
   }
@@ -643,8 +821,8 @@ std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request&
   std::error_code ec;
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeJsonCommand(*m_httpClient, url, req, res);
+    HttpClientPool::Lease lease(*m_httpClients);
+    invokeJsonCommand(lease.client(), url, req, res);
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
@@ -660,7 +838,7 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
   std::error_code ec = make_error_code(error::INTERNAL_NODE_ERROR);
 
   try {
-    EventLock eventLock(*m_httpEvent);
+    HttpClientPool::Lease lease(*m_httpClients);
 
     JsonRpc::JsonRpcRequest jsReq;
 
@@ -673,7 +851,7 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
     httpReq.setUrl("/json_rpc");
     httpReq.setBody(jsReq.getBody());
 
-    m_httpClient->request(httpReq, httpRes);
+    lease.client().request(httpReq, httpRes);
 
     JsonRpc::JsonRpcResponse jsRes;
 
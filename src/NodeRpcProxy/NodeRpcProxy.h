@@ -23,6 +23,7 @@ namespace System {
 namespace Fortress {
 
 class HttpClient;
+class HttpClientPool;
 
 class INodeRpcProxyObserver {
 public:
@@ -32,7 +33,10 @@ public:
 
 class NodeRpcProxy : public Fortress::INode {
 public:
-  NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort);
+  static const size_t DEFAULT_CONNECTION_COUNT = 4;
+
+  // connectionCount is the number of keep-alive connections to the node, it bounds the number of requests in flight
+  NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort, size_t connectionCount = DEFAULT_CONNECTION_COUNT);
   virtual ~NodeRpcProxy();
 
   virtual bool addObserver(Fortress::INodeObserver* observer) override;
@@ -55,6 +59,8 @@ public:
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override;
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<Fortress::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override;
@@ -77,9 +83,15 @@ private:
   std::vector<Crypto::Hash> getKnownTxsVector() const;
   void pullNodeStatusAndScheduleTheNext();
   void updateNodeStatus();
+  std::error_code pollNodeStatus(bool& isTailBlockActual);
+  bool waitNodeStatus();
+  bool applyNodeStatus(const COMMAND_RPC_GET_NODE_STATUS::response& status);
   void updateBlockchainStatus();
   bool updatePoolStatus();
+  void updateLocalBlockchain(const Crypto::Hash& topBlockHash, uint32_t topBlockIndex, uint64_t topBlockTimestamp);
+  void updateNetworkHeight(uint32_t lastKnownBlockIndex);
   void updatePeerCount(size_t peerCount);
+  void updateConnectionStatus(bool connected);
   void updatePoolState(const std::vector<std::unique_ptr<ITransactionReader>>& addedTxs, const std::vector<Crypto::Hash>& deletedTxsIds);
 
   std::error_code doRelayTransaction(const Fortress::Transaction& transaction);
@@ -89,6 +101,8 @@ private:
     std::vector<Fortress::block_complete_entry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash,
                                                     std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+    std::vector<std::vector<uint32_t>>& outsGlobalIndices);
   std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
     std::vector<Fortress::BlockShortEntry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
@@ -98,6 +112,8 @@ private:
   template <typename Request, typename Response>
   std::error_code binaryCommand(const std::string& url, const Request& req, Response& res);
   template <typename Request, typename Response>
+  std::error_code binaryCommand(HttpClient& httpClient, const std::string& url, const Request& req, Response& res);
+  template <typename Request, typename Response>
   std::error_code jsonCommand(const std::string& url, const Request& req, Response& res);
   template <typename Request, typename Response>
   std::error_code jsonRpcCommand(const std::string& method, const Request& req, Response& res);
@@ -115,19 +131,27 @@ private:
   std::thread m_workerThread;
   System::Dispatcher* m_dispatcher = nullptr;
   System::ContextGroup* m_context_group = nullptr;
+  System::ContextGroup* m_statusContextGroup = nullptr;
   Tools::ObserverManager<Fortress::INodeObserver> m_observerManager;
   Tools::ObserverManager<Fortress::INodeRpcProxyObserver> m_rpcProxyObserverManager;
 
   const std::string m_nodeHost;
   const unsigned short m_nodePort;
+  const size_t m_connectionCount;
   unsigned int m_rpcTimeout;
-  HttpClient* m_httpClient = nullptr;
-  System::Event* m_httpEvent = nullptr;
+  HttpClientPool* m_httpClients = nullptr;
+  // status requests held by the node get a connection of their own
+  HttpClient* m_statusClient = nullptr;
 
   uint64_t m_pullInterval;
+  uint32_t m_statusWaitTimeout;
 
   // Internal state
   bool m_stop = false;
+  // cleared when the node answers that it doesn't serve the request, owned by dispatcher
+  bool m_nodeStatusSupported = true;
+  bool m_waitNodeStatusSupported = true;
+  bool m_txsOutsGlobalIndicesSupported = true;
   std::atomic<size_t> m_peerCount;
   std::atomic<uint32_t> m_nodeHeight;
   std::atomic<uint32_t> m_networkHeight;
@@ -4,9 +4,10 @@
 
 #pragma once
 
-#include <list>
+#include <deque>
 #include <ostream>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/uuid/uuid.hpp>
 #include "Common/StringTools.h"
@@ -33,10 +34,17 @@ struct FortressConnectionContext {
   };
 
   state m_state = state_befor_handshake;
-  std::list<Crypto::Hash> m_needed_objects;
-  std::unordered_set<Crypto::Hash> m_requested_objects;
   uint32_t m_remote_blockchain_height = 0;
   uint32_t m_last_response_height = 0;
+  bool m_chainRequested = false;
+
+  // transactions the peer has or has been told about, the oldest are forgotten first
+  std::unordered_set<Crypto::Hash> m_knownTxs;
+  std::deque<Crypto::Hash> m_knownTxsOrder;
+  std::vector<Crypto::Hash> m_txsToAnnounce;
+  // counted per second, see P2P_TX_RELAY_MAX_RATE
+  size_t m_txsFetchedCount = 0;
+  size_t m_txsServedCount = 0;
 };
 
 inline std::string get_protocol_state_string(FortressConnectionContext::state s) {
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "LevinProtocol.h"
+#include <cstring>
 #include <System/TcpConnection.h>
 
 using namespace Fortress;
@@ -29,6 +30,45 @@ struct bucket_head2
 };
 #pragma pack(pop)
 
+static_assert(sizeof(bucket_head2) == LevinProtocol::HEADER_SIZE, "Unexpected Levin header size");
+
+void makeHeader(uint8_t* header, uint64_t size, bool needResponse, uint32_t command, int32_t returnCode, uint32_t flags) {
+  bucket_head2 head = { 0 };
+  head.m_signature = LEVIN_SIGNATURE;
+  head.m_cb = size;
+  head.m_have_to_return_data = needResponse;
+  head.m_command = command;
+  head.m_return_code = returnCode;
+  head.m_flags = flags;
+  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
+  memcpy(header, &head, sizeof(head));
+}
+
+void addBuffer(std::vector<System::TcpConnection::Buffer>& buffers, const uint8_t* data, size_t size) {
+  if (size != 0) {
+    System::TcpConnection::Buffer buffer = { data, size };
+    buffers.push_back(buffer);
+  }
+}
+
+void writeStrict(System::TcpConnection& connection, std::vector<System::TcpConnection::Buffer>& buffers) {
+  size_t first = 0;
+  while (first < buffers.size()) {
+    size_t transferred = connection.writeBuffers(&buffers[first], buffers.size() - first);
+    while (transferred != 0) {
+      System::TcpConnection::Buffer& buffer = buffers[first];
+      if (transferred < buffer.size) {
+        buffer.data += transferred;
+        buffer.size -= transferred;
+        break;
+      }
+
+      transferred -= buffer.size;
+      ++first;
+    }
+  }
+}
+
 }
 
 bool LevinProtocol::Command::needReply() const {
@@ -39,23 +79,14 @@ LevinProtocol::LevinProtocol(System::TcpConnection& connection)
   : m_conn(connection) {}
 
 void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool needResponse) {
-  bucket_head2 head = { 0 };
-  head.m_signature = LEVIN_SIGNATURE;
-  head.m_cb = out.size();
-  head.m_have_to_return_data = needResponse;
-  head.m_command = command;
-  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-  head.m_flags = LEVIN_PACKET_REQUEST;
+  uint8_t header[HEADER_SIZE];
+  makeHeader(header, out.size(), needResponse, command, 0, LEVIN_PACKET_REQUEST);
 
   // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  std::vector<System::TcpConnection::Buffer> buffers;
+  addBuffer(buffers, header, sizeof(header));
+  addBuffer(buffers, out.data(), out.size());
+  writeStrict(m_conn, buffers);
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -91,30 +122,38 @@ bool LevinProtocol::readCommand(Command& cmd) {
 }
 
 void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode) {
-  bucket_head2 head = { 0 };
-  head.m_signature = LEVIN_SIGNATURE;
-  head.m_cb = out.size();
-  head.m_have_to_return_data = false;
-  head.m_command = command;
-  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-  head.m_flags = LEVIN_PACKET_RESPONSE;
-  head.m_return_code = returnCode;
+  uint8_t header[HEADER_SIZE];
+  makeHeader(header, out.size(), false, command, returnCode, LEVIN_PACKET_RESPONSE);
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
+  std::vector<System::TcpConnection::Buffer> buffers;
+  addBuffer(buffers, header, sizeof(header));
+  addBuffer(buffers, out.data(), out.size());
+  writeStrict(m_conn, buffers);
+}
 
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
+void LevinProtocol::sendPackets(const std::vector<const Packet*>& packets) {
+  std::vector<System::TcpConnection::Buffer> buffers;
+  buffers.reserve(packets.size() * 2);
+  for (const Packet* packet : packets) {
+    addBuffer(buffers, packet->header, sizeof(packet->header));
+    addBuffer(buffers, packet->body.data(), packet->body.size());
+  }
 
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(m_conn, buffers);
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
-  size_t offset = 0;
-  while (offset < size) {
-    offset += m_conn.write(ptr + offset, size - offset);
-  }
+LevinProtocol::Packet LevinProtocol::makeMessagePacket(uint32_t command, BinaryArray body, bool needResponse) {
+  Packet packet;
+  makeHeader(packet.header, body.size(), needResponse, command, 0, LEVIN_PACKET_REQUEST);
+  packet.body = std::move(body);
+  return packet;
+}
+
+LevinProtocol::Packet LevinProtocol::makeReplyPacket(uint32_t command, BinaryArray body, int32_t returnCode) {
+  Packet packet;
+  makeHeader(packet.header, body.size(), false, command, returnCode, LEVIN_PACKET_RESPONSE);
+  packet.body = std::move(body);
+  return packet;
 }
 
 bool LevinProtocol::readStrict(uint8_t* ptr, size_t size) {
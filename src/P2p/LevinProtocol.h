@@ -31,6 +31,13 @@ const int32_t LEVIN_PROTOCOL_RETCODE_SUCCESS = 1;
 
 class LevinProtocol {
 public:
+  static const size_t HEADER_SIZE = 33;
+
+  // A message with its header already built, it can be queued to many connections without copying
+  struct Packet {
+    uint8_t header[HEADER_SIZE];
+    BinaryArray body;
+  };
 
   LevinProtocol(System::TcpConnection& connection);
 
@@ -66,6 +73,11 @@ public:
 
   void sendMessage(uint32_t command, const BinaryArray& out, bool needResponse);
   void sendReply(uint32_t command, const BinaryArray& out, int32_t returnCode);
+  // Writes the packets in order, gathering as many of them as possible into each system call
+  void sendPackets(const std::vector<const Packet*>& packets);
+
+  static Packet makeMessagePacket(uint32_t command, BinaryArray body, bool needResponse);
+  static Packet makeReplyPacket(uint32_t command, BinaryArray body, int32_t returnCode);
 
   template <typename T>
   static bool decode(const BinaryArray& buf, T& value) {
@@ -93,7 +105,6 @@ public:
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
-  void writeStrict(const uint8_t* ptr, size_t size);
   System::TcpConnection& m_conn;
 };
 
@@ -122,6 +122,24 @@ namespace Fortress
   }
 
 
+  //-----------------------------------------------------------------------------------
+  // P2pMessage implementation
+  //-----------------------------------------------------------------------------------
+
+  P2pMessage::P2pMessage(Type type, uint32_t command, BinaryArray buffer, int32_t returnCode) : type(type), command(command) {
+    switch (type) {
+    case COMMAND:
+    case NOTIFY:
+      packet = std::make_shared<LevinProtocol::Packet>(LevinProtocol::makeMessagePacket(command, std::move(buffer), type == COMMAND));
+      break;
+    case REPLY:
+      packet = std::make_shared<LevinProtocol::Packet>(LevinProtocol::makeReplyPacket(command, std::move(buffer), returnCode));
+      break;
+    default:
+      assert(false);
+    }
+  }
+
   //-----------------------------------------------------------------------------------
   // P2pConnectionContext implementation
   //-----------------------------------------------------------------------------------
@@ -321,6 +339,12 @@ namespace Fortress
     });
   }
 
+  void NodeServer::externalRelayNotifyToFiltered(int command, const BinaryArray& data_buff, ConnectionFilter filter) {
+    m_dispatcher.remoteSpawn([this, command, data_buff, filter] {
+      relay_notify_to_filtered(command, data_buff, nullptr, filter);
+    });
+  }
+
   //-----------------------------------------------------------------------------------
   bool NodeServer::make_default_config()
   {
@@ -1037,13 +1061,25 @@ namespace Fortress
   //-----------------------------------------------------------------------------------
   
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
+    relay_notify_to_filtered(command, data_buff, excludeConnection, nullptr);
+  }
+
+  //-----------------------------------------------------------------------------------
+  void NodeServer::relay_notify_to_filtered(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection, ConnectionFilter filter) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    // the payload is copied and framed once, every connection queues the same packet
+    std::shared_ptr<const LevinProtocol::Packet> packet;
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && conn.m_connection_id != excludeId &&
           (conn.m_state == FortressConnectionContext::state_normal ||
-           conn.m_state == FortressConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+           conn.m_state == FortressConnectionContext::state_synchronizing) &&
+          (!filter || filter(conn))) {
+        if (!packet) {
+          packet = std::make_shared<LevinProtocol::Packet>(LevinProtocol::makeMessagePacket(command, data_buff, false));
+        }
+
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, packet));
       }
     });
   }
@@ -1427,22 +1463,14 @@ namespace Fortress
           break;
         }
 
+        std::vector<const LevinProtocol::Packet*> packets;
+        packets.reserve(msgs.size());
         for (const auto& msg : msgs) {
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
-          switch (msg.type) {
-          case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
-            break;
-          case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
-            break;
-          case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
-            break;
-          default:
-            assert(false);
-          }
+          packets.push_back(msg.packet.get());
         }
+
+        proto.sendPackets(packets);
       }
     } catch (System::InterruptedException&) {
       // connection stopped
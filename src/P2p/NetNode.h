@@ -5,6 +5,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
@@ -46,22 +47,19 @@ namespace Fortress
       NOTIFY
     };
 
-    P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
-      type(type), command(command), buffer(buffer), returnCode(returnCode) {
+    P2pMessage(Type type, uint32_t command, BinaryArray buffer, int32_t returnCode = 0);
+    // shares a packet that is queued to other connections as well
+    P2pMessage(Type type, uint32_t command, std::shared_ptr<const LevinProtocol::Packet> packet) :
+      type(type), command(command), packet(std::move(packet)) {
     }
 
-    P2pMessage(P2pMessage&& msg) :
-      type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
-    }
-
-    size_t size() {
-      return buffer.size();
+    size_t size() const {
+      return packet->body.size();
     }
 
     Type type;
     uint32_t command;
-    const BinaryArray buffer;
-    int32_t returnCode;
+    std::shared_ptr<const LevinProtocol::Packet> packet;
   };
 
   struct P2pConnectionContext : public FortressConnectionContext {
@@ -131,6 +129,7 @@ namespace Fortress
     size_t get_outgoing_connections_count();
 
     Fortress::PeerlistManager& getPeerlistManager() { return m_peerlist; }
+    System::Dispatcher& getDispatcher() { return m_dispatcher; }
 
   private:
 
@@ -162,9 +161,11 @@ namespace Fortress
 
     //----------------- i_p2p_endpoint -------------------------------------------------------------
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
+    virtual void relay_notify_to_filtered(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection, ConnectionFilter filter) override;
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const FortressConnectionContext& context) override;
     virtual void for_each_connection(std::function<void(Fortress::FortressConnectionContext&, PeerIdType)> f) override;
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff) override;
+    virtual void externalRelayNotifyToFiltered(int command, const BinaryArray& data_buff, ConnectionFilter filter) override;
 
     //-----------------------------------------------------------------------------------------------
     bool handle_command_line(const boost::program_options::variables_map& vm);
@@ -12,19 +12,26 @@ namespace Fortress {
   struct FortressConnectionContext;
 
   struct IP2pEndpoint {
+    typedef std::function<bool(const Fortress::FortressConnectionContext&)> ConnectionFilter;
+
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) = 0;
+    // relays only to the connections the filter accepts
+    virtual void relay_notify_to_filtered(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection, ConnectionFilter filter) = 0;
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const Fortress::FortressConnectionContext& context) = 0;
     virtual uint64_t get_connections_count()=0;
     virtual void for_each_connection(std::function<void(Fortress::FortressConnectionContext&, PeerIdType)> f) = 0;
     // can be called from external threads
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff) = 0;
+    virtual void externalRelayNotifyToFiltered(int command, const BinaryArray& data_buff, ConnectionFilter filter) = 0;
   };
 
   struct p2p_endpoint_stub: public IP2pEndpoint {
     virtual void relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override {}
+    virtual void relay_notify_to_filtered(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection, ConnectionFilter filter) override {}
     virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const Fortress::FortressConnectionContext& context) override { return true; }
     virtual void for_each_connection(std::function<void(Fortress::FortressConnectionContext&, PeerIdType)> f) override {}
     virtual uint64_t get_connections_count() override { return 0; }   
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff) override {}
+    virtual void externalRelayNotifyToFiltered(int command, const BinaryArray& data_buff, ConnectionFilter filter) override {}
   };
 }
@@ -42,7 +42,9 @@ namespace Fortress
   enum P2PProtocolVersion : uint8_t {
     V0 = 0,
     V1 = 1,
-    CURRENT = V1
+    V2 = 2, // relays blocks with NOTIFY_NEW_COMPACT_BLOCK
+    V3 = 3, // announces transactions with NOTIFY_TX_INVENTORY
+    CURRENT = V3
   };
 
   struct basic_node_data
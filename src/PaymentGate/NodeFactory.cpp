@@ -35,6 +35,8 @@ public:
     callback(std::error_code());
   }
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override { }
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices,
+    const Callback& callback) override { }
 
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<Fortress::BlockShortEntry>& newBlocks,
     uint32_t& startHeight, const Callback& callback) override {
@@ -103,8 +105,8 @@ NodeFactory::NodeFactory() {
 NodeFactory::~NodeFactory() {
 }
 
-Fortress::INode* NodeFactory::createNode(const std::string& daemonAddress, uint16_t daemonPort) {
-  std::unique_ptr<Fortress::INode> node(new Fortress::NodeRpcProxy(daemonAddress, daemonPort));
+Fortress::INode* NodeFactory::createNode(const std::string& daemonAddress, uint16_t daemonPort, size_t connectionCount) {
+  std::unique_ptr<Fortress::INode> node(new Fortress::NodeRpcProxy(daemonAddress, daemonPort, connectionCount));
 
   NodeInitObserver initObserver;
   node->init(std::bind(&NodeInitObserver::initCompleted, &initObserver, std::placeholders::_1));
@@ -12,7 +12,7 @@ namespace PaymentService {
 
 class NodeFactory {
 public:
-  static Fortress::INode* createNode(const std::string& daemonAddress, uint16_t daemonPort);
+  static Fortress::INode* createNode(const std::string& daemonAddress, uint16_t daemonPort, size_t connectionCount);
   static Fortress::INode* createNodeStub();
 private:
   NodeFactory();
@@ -21,8 +21,9 @@ WalletFactory::WalletFactory() {
 WalletFactory::~WalletFactory() {
 }
 
-Fortress::IWallet* WalletFactory::createWallet(const Fortress::Currency& currency, Fortress::INode& node, System::Dispatcher& dispatcher) {
-  Fortress::IWallet* wallet = new Fortress::WalletGreen(dispatcher, currency, node);
+Fortress::IWallet* WalletFactory::createWallet(const Fortress::Currency& currency, Fortress::INode& node, System::Dispatcher& dispatcher,
+  size_t syncThreadCount) {
+  Fortress::IWallet* wallet = new Fortress::WalletGreen(dispatcher, currency, node, 1, syncThreadCount);
   return wallet;
 }
 
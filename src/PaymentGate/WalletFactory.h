@@ -19,7 +19,9 @@ namespace PaymentService {
 
 class WalletFactory {
 public:
-  static Fortress::IWallet* createWallet(const Fortress::Currency& currency, Fortress::INode& node, System::Dispatcher& dispatcher);
+  // syncThreadCount is the number of threads scanning new blocks for wallet transactions, 0 means one per CPU core
+  static Fortress::IWallet* createWallet(const Fortress::Currency& currency, Fortress::INode& node, System::Dispatcher& dispatcher,
+    size_t syncThreadCount = 0);
 private:
   WalletFactory();
   ~WalletFactory();
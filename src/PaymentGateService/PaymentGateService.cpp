@@ -197,7 +197,8 @@ void PaymentGateService::runRpcProxy(Logging::LoggerRef& log) {
   std::unique_ptr<Fortress::INode> node(
     PaymentService::NodeFactory::createNode(
       config.remoteNodeConfig.daemonHost, 
-      config.remoteNodeConfig.daemonPort));
+      config.remoteNodeConfig.daemonPort,
+      config.remoteNodeConfig.daemonConnections));
 
   runWalletService(currency, *node);
 }
@@ -208,7 +209,8 @@ void PaymentGateService::runWalletService(const Fortress::Currency& currency, Fo
     config.gateConfiguration.containerPassword
   };
 
-  std::unique_ptr<Fortress::IWallet> wallet (WalletFactory::createWallet(currency, node, *dispatcher));
+  std::unique_ptr<Fortress::IWallet> wallet (WalletFactory::createWallet(currency, node, *dispatcher,
+    config.gateConfiguration.syncThreadCount));
 
   service = new PaymentService::WalletService(currency, *dispatcher, node, *wallet, walletConfiguration, logger);
   std::unique_ptr<PaymentService::WalletService> serviceGuard(service);
@@ -25,6 +25,7 @@ Configuration::Configuration() {
   logLevel = Logging::INFO;
   bindAddress = "";
   bindPort = 0;
+  syncThreadCount = 0;
 }
 
 void Configuration::initOptions(boost::program_options::options_description& desc) {
@@ -42,6 +43,7 @@ void Configuration::initOptions(boost::program_options::options_description& des
       ("log-file,l", po::value<std::string>(), "log file")
       ("server-root", po::value<std::string>(), "server root. The service will use it as working directory. Don't set it if don't want to change it")
       ("log-level", po::value<size_t>(), "log level")
+      ("sync-threads", po::value<size_t>(), "number of threads scanning new blocks for wallet transactions, 0 means one per CPU core")
       ("address", "print wallet addresses and exit");
 }
 
@@ -78,6 +80,10 @@ void Configuration::init(const boost::program_options::variables_map& options) {
     }
   }
 
+  if (options.count("sync-threads") != 0) {
+    syncThreadCount = options["sync-threads"].as<size_t>();
+  }
+
   if (options.count("server-root") != 0) {
     serverRoot = options["server-root"].as<std::string>();
   }
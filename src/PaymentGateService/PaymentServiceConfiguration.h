@@ -39,6 +39,7 @@ struct Configuration {
   bool printAddresses;
 
   size_t logLevel;
+  size_t syncThreadCount;
 };
 
 } //namespace PaymentService
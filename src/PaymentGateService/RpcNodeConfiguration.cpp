@@ -4,6 +4,8 @@
 
 #include "RpcNodeConfiguration.h"
 
+#include "NodeRpcProxy/NodeRpcProxy.h"
+
 namespace PaymentService {
 
 namespace po = boost::program_options;
@@ -11,12 +13,14 @@ namespace po = boost::program_options;
 RpcNodeConfiguration::RpcNodeConfiguration() {
   daemonHost = "";
   daemonPort = 0;
+  daemonConnections = Fortress::NodeRpcProxy::DEFAULT_CONNECTION_COUNT;
 }
 
 void RpcNodeConfiguration::initOptions(boost::program_options::options_description& desc) {
   desc.add_options()
     ("daemon-address", po::value<std::string>()->default_value("localhost"), "daemon address")
-    ("daemon-port", po::value<uint16_t>()->default_value(8081), "daemon port");
+    ("daemon-port", po::value<uint16_t>()->default_value(8081), "daemon port")
+    ("daemon-connections", po::value<size_t>(), "number of simultaneous connections to the daemon");
 }
 
 void RpcNodeConfiguration::init(const boost::program_options::variables_map& options) {
@@ -27,6 +31,10 @@ void RpcNodeConfiguration::init(const boost::program_options::variables_map& opt
   if (options.count("daemon-port") != 0 && (!options["daemon-port"].defaulted() || daemonPort == 0)) {
     daemonPort = options["daemon-port"].as<uint16_t>();
   }
+
+  if (options.count("daemon-connections") != 0) {
+    daemonConnections = options["daemon-connections"].as<size_t>();
+  }
 }
 
 } //namespace PaymentService
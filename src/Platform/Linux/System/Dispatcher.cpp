@@ -3,16 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "Dispatcher.h"
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <sys/timerfd.h>
 #include <fcntl.h>
 #include <string.h>
-#include <ucontext.h>
 #include <unistd.h>
 #include "ErrorMessage.h"
+#include "IoUring.h"
+#include "MachineContext.h"
 
 namespace System {
 
@@ -20,7 +23,8 @@ namespace {
 
 struct ContextMakingData {
   Dispatcher* dispatcher;
-  void* ucontext;
+  void* machineContext;
+  NativeContext* context;
 };
 
 class MutextGuard {
@@ -43,19 +47,30 @@ private:
 static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
 
 const size_t STACK_SIZE = 64 * 1024;
+const int EPOLL_BATCH_SIZE = 64;
+const unsigned IO_URING_ENTRIES = 256;
+const size_t IO_URING_BATCH_SIZE = 64;
+
+std::atomic<Dispatcher::Backend> defaultBackend(Dispatcher::Backend::EPOLL);
 
 };
 
-Dispatcher::Dispatcher() {
+Dispatcher::Dispatcher() : Dispatcher(defaultBackend.load()) {
+}
+
+Dispatcher::Dispatcher(Backend backend) : ioUring(nullptr), pendingOperations(0) {
   std::string message;
   epoll = ::epoll_create1(0);
   if (epoll == -1) {
     message = "epoll_create1 failed, " + lastErrorMessage();
   } else {
-    mainContext.ucontext = new ucontext_t;
-    if (getcontext(reinterpret_cast<ucontext_t*>(mainContext.ucontext)) == -1) {
-      message = "getcontext failed, " + lastErrorMessage();
-    } else {
+    try {
+      mainContext.machineContext = createMachineContext();
+    } catch (std::runtime_error& e) {
+      message = e.what();
+    }
+
+    if (message.empty()) {
       remoteSpawnEvent = eventfd(0, O_NONBLOCK);
       if(remoteSpawnEvent == -1) {
         message = "eventfd failed, " + lastErrorMessage();
@@ -84,6 +99,19 @@ Dispatcher::Dispatcher() {
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
           runningContextCount = 0;
+          if (backend == Backend::IO_URING) {
+            try {
+              ioUring = new IoUring(IO_URING_ENTRIES);
+            } catch (std::runtime_error&) {
+              // kernel without io_uring support, stay on epoll
+            }
+
+            if (ioUring != nullptr) {
+              // contexts waiting on epoll (remote spawns, connectors) are woken through a poll on the epoll descriptor
+              ioUring->preparePoll(&epollOperation, epoll);
+            }
+          }
+
           return;
         }
 
@@ -105,41 +133,35 @@ Dispatcher::~Dispatcher() {
   }
 
   yield();
+  while (pendingOperations != 0) {
+    // cancelled io_uring operations complete asynchronously
+    pollIoUring(true);
+    yield();
+  }
+
   assert(contextGroup.firstContext == nullptr);
   assert(contextGroup.firstWaiter == nullptr);
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
+  releaseReusableContexts();
   while (!timers.empty()) {
     int result = ::close(timers.top());
     assert(result == 0);
     timers.pop();
   }
 
+  delete ioUring;
   auto result = close(epoll);
   assert(result == 0);
   result = close(remoteSpawnEvent);
   assert(result == 0);
   result = pthread_mutex_destroy(reinterpret_cast<pthread_mutex_t*>(this->mutex));
   assert(result == 0);
+  destroyMachineContext(mainContext.machineContext);
 }
 
 void Dispatcher::clear() {
-  while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
-    firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
-  }
-
+  releaseReusableContexts();
   while (!timers.empty()) {
     int result = ::close(timers.top());
     if (result == -1) {
@@ -159,51 +181,17 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
-
-        continue;
-      }
-
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
-        continue;
-      }
-
-      assert(context != nullptr);
-      break;
-    }
-
-    if (errno != EINTR) {
-      throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, "  + lastErrorMessage());
+    if (ioUring != nullptr) {
+      pollIoUring(true);
+    } else {
+      pollEpoll(-1);
     }
   }
 
   if (context != currentContext) {
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
+    NativeContext* oldContext = currentContext;
     currentContext = context;
-    if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
-      throw std::runtime_error("Dispatcher::dispatch, swapcontext failed, " + lastErrorMessage());
-    }
+    switchMachineContext(oldContext->machineContext, context->machineContext);
   }
 }
 
@@ -282,47 +270,13 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
 }
 
 void Dispatcher::yield() {
-  for(;;){
-    epoll_event events[16];
-    int count = epoll_wait(epoll, events, 16, 0);
-    if (count == 0) {
-      break;
-    }
-
-    if(count > 0) {
-      for(int i = 0; i < count; ++i) {
-        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          contextPair->writeContext->context->interruptProcedure = nullptr;
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          contextPair->readContext->context->interruptProcedure = nullptr;
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else {
-          continue;
-        }
-      }
-    } else {
-      if (errno != EINTR) {
-        throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, " + lastErrorMessage());
+  if (ioUring != nullptr) {
+    pollIoUring(false);
+  } else {
+    for (;;) {
+      int count = pollEpoll(0);
+      if (count >= 0 && count < EPOLL_BATCH_SIZE) {
+        break;
       }
     }
   }
@@ -333,42 +287,81 @@ void Dispatcher::yield() {
   }
 }
 
+Dispatcher::Backend Dispatcher::getDefaultBackend() {
+  return defaultBackend.load();
+}
+
+void Dispatcher::setDefaultBackend(Backend backend) {
+  defaultBackend.store(backend);
+}
+
+Dispatcher::Backend Dispatcher::getBackend() const {
+  return ioUring != nullptr ? Backend::IO_URING : Backend::EPOLL;
+}
+
 int Dispatcher::getEpoll() const {
   return epoll;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
-  if(firstReusableContext == nullptr) {
-    ucontext_t* newlyCreatedContext = new ucontext_t;
-    if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
-      throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
-    }
+IoUring* Dispatcher::getIoUring() const {
+  return ioUring;
+}
 
-    auto stackPointer = new uint8_t[STACK_SIZE];
-    newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
+void Dispatcher::waitOperation(OperationContext& operation) {
+  assert(ioUring != nullptr);
+  operation.context = currentContext;
+  operation.interrupted = false;
+  ++pendingOperations;
+  currentContext->interruptProcedure = [this, &operation]() {
+    ioUring->prepareCancel(&operation);
+    operation.interrupted = true;
+  };
+
+  dispatch();
+  currentContext->interruptProcedure = nullptr;
+  assert(operation.context == currentContext);
+  if (operation.interrupted && operation.result != -ECANCELED) {
+    // the operation completed before the cancellation, the interruption applies to the next one
+    operation.interrupted = false;
+    currentContext->interrupted = true;
+  }
+}
 
-    ContextMakingData makingContextData {this, newlyCreatedContext};
-    makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
+NativeContext& Dispatcher::getReusableContext(size_t stackSize) {
+  if (stackSize == 0) {
+    stackSize = STACK_SIZE;
+  } else {
+    size_t pageSize = getStackPageSize();
+    stackSize = (stackSize + pageSize - 1) / pageSize * pageSize;
+  }
 
-    ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
-    if (swapcontext(oldContext, newlyCreatedContext) == -1) {
-      throw std::runtime_error("Dispatcher::getReusableContext, swapcontext failed, " + lastErrorMessage());
+  NativeContext*& firstContext = stackSize == STACK_SIZE ? firstReusableContext : sizedReusableContexts[stackSize];
+  if (firstContext == nullptr) {
+    uint8_t* stack = allocateStack(stackSize);
+    ContextMakingData makingContextData {this, nullptr, nullptr};
+    try {
+      makingContextData.machineContext = createMachineContext(stack, stackSize, contextProcedureStatic, &makingContextData);
+    } catch (std::runtime_error&) {
+      releaseStack(stack, stackSize);
+      throw;
     }
 
-    assert(firstReusableContext != nullptr);
-    assert(firstReusableContext->ucontext == newlyCreatedContext);
-    firstReusableContext->stackPtr = stackPointer;
-  };
+    switchMachineContext(currentContext->machineContext, makingContextData.machineContext);
+    assert(makingContextData.context != nullptr);
+    makingContextData.context->stackPtr = stack;
+    makingContextData.context->stackSize = stackSize;
+    return *makingContextData.context;
+  }
 
-  NativeContext* context = firstReusableContext;
-  firstReusableContext = firstReusableContext-> next;
+  NativeContext* context = firstContext;
+  firstContext = context->next;
   return *context;
 }
 
 void Dispatcher::pushReusableContext(NativeContext& context) {
-  context.next = firstReusableContext;
-  firstReusableContext = &context;
+  NativeContext*& firstContext = context.stackSize == STACK_SIZE ? firstReusableContext : sizedReusableContexts[context.stackSize];
+  context.next = firstContext;
+  firstContext = &context;
   --runningContextCount;
 }
 
@@ -395,17 +388,115 @@ void Dispatcher::pushTimer(int timer) {
   timers.push(timer);
 }
 
-void Dispatcher::contextProcedure(void* ucontext) {
-  assert(firstReusableContext == nullptr);
+int Dispatcher::pollEpoll(int timeout) {
+  epoll_event events[EPOLL_BATCH_SIZE];
+  int count = epoll_wait(epoll, events, EPOLL_BATCH_SIZE, timeout);
+  if (count == -1) {
+    if (errno != EINTR) {
+      throw std::runtime_error("Dispatcher::pollEpoll, epoll_wait failed, " + lastErrorMessage());
+    }
+
+    return -1;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
+    if (contextPair == nullptr) {
+      continue;
+    }
+
+    if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
+      uint64_t buf;
+      auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+      if(transferred == -1) {
+        throw std::runtime_error("Dispatcher::pollEpoll, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+      }
+
+      MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+      while (!remoteSpawningProcedures.empty()) {
+        spawn(std::move(remoteSpawningProcedures.front()));
+        remoteSpawningProcedures.pop();
+      }
+
+      continue;
+    }
+
+    // the context is queued already, an interrupt must not queue it twice
+    if ((events[i].events & EPOLLOUT) != 0) {
+      contextPair->writeContext->context->interruptProcedure = nullptr;
+      pushContext(contextPair->writeContext->context);
+      contextPair->writeContext->events = events[i].events;
+    } else if ((events[i].events & EPOLLIN) != 0) {
+      contextPair->readContext->context->interruptProcedure = nullptr;
+      pushContext(contextPair->readContext->context);
+      contextPair->readContext->events = events[i].events;
+    }
+  }
+
+  return count;
+}
+
+void Dispatcher::pollIoUring(bool wait) {
+  if (!ioUring->enter(wait ? 1 : 0)) {
+    return;
+  }
+
+  IoUringCompletion completions[IO_URING_BATCH_SIZE];
+  for (;;) {
+    size_t count = ioUring->reap(completions, IO_URING_BATCH_SIZE);
+    for (size_t i = 0; i < count; ++i) {
+      if (completions[i].userData == nullptr) {
+        continue;
+      }
+
+      if (completions[i].userData == &epollOperation) {
+        while (pollEpoll(0) == EPOLL_BATCH_SIZE) {
+        }
+
+        ioUring->preparePoll(&epollOperation, epoll);
+        continue;
+      }
+
+      OperationContext* operation = static_cast<OperationContext*>(completions[i].userData);
+      operation->result = completions[i].result;
+      operation->context->interruptProcedure = nullptr;
+      pushContext(operation->context);
+      --pendingOperations;
+    }
+
+    if (count < IO_URING_BATCH_SIZE) {
+      break;
+    }
+  }
+}
+
+void Dispatcher::releaseReusableContexts() {
+  sizedReusableContexts[STACK_SIZE] = firstReusableContext;
+  firstReusableContext = nullptr;
+  for (auto& reusableContexts : sizedReusableContexts) {
+    while (reusableContexts.second != nullptr) {
+      // the context lives on the stack being released
+      NativeContext* context = reusableContexts.second;
+      void* machineContext = context->machineContext;
+      uint8_t* stack = static_cast<uint8_t*>(context->stackPtr);
+      size_t stackSize = context->stackSize;
+      reusableContexts.second = context->next;
+      destroyMachineContext(machineContext);
+      releaseStack(stack, stackSize);
+    }
+  }
+
+  sizedReusableContexts.clear();
+}
+
+void Dispatcher::contextProcedure(void* contextMakingData) {
+  ContextMakingData* makingContextData = static_cast<ContextMakingData*>(contextMakingData);
   NativeContext context;
-  context.ucontext = ucontext;
+  context.machineContext = makingContextData->machineContext;
   context.interrupted = false;
   context.next = nullptr;
-  firstReusableContext = &context;
-  ucontext_t* oldContext = static_cast<ucontext_t*>(context.ucontext);
-  if (swapcontext(oldContext, static_cast<ucontext_t*>(currentContext->ucontext)) == -1) {
-    throw std::runtime_error("Dispatcher::contextProcedure, swapcontext failed, " + lastErrorMessage());
-  }
+  makingContextData->context = &context;
+  switchMachineContext(context.machineContext, currentContext->machineContext);
 
   for (;;) {
     ++runningContextCount;
@@ -455,8 +546,8 @@ void Dispatcher::contextProcedure(void* ucontext) {
 };
 
 void Dispatcher::contextProcedureStatic(void *context) {
-  ContextMakingData* makingContextData = reinterpret_cast<ContextMakingData*>(context);
-  makingContextData->dispatcher->contextProcedure(makingContextData->ucontext);
+  ContextMakingData* makingContextData = static_cast<ContextMakingData*>(context);
+  makingContextData->dispatcher->contextProcedure(makingContextData);
 }
 
 }
@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <functional>
+#include <map>
 #include <queue>
 #include <stack>
 
@@ -14,8 +15,9 @@ namespace System {
 struct NativeContextGroup;
 
 struct NativeContext {
-  void* ucontext;
+  void* machineContext;
   void* stackPtr;
+  size_t stackSize;
   bool interrupted;
   NativeContext* next;
   NativeContextGroup* group;
@@ -36,6 +38,7 @@ struct OperationContext {
   NativeContext *context;
   bool interrupted;
   uint32_t events;
+  int32_t result;
 };
 
 struct ContextPair {
@@ -43,9 +46,17 @@ struct ContextPair {
   OperationContext *writeContext;
 };
 
+class IoUring;
+
 class Dispatcher {
 public:
+  enum class Backend {
+    EPOLL,
+    IO_URING
+  };
+
   Dispatcher();
+  explicit Dispatcher(Backend backend);
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
   Dispatcher& operator=(const Dispatcher&) = delete;
@@ -60,8 +71,15 @@ public:
   void yield();
 
   // system-dependent
+  // Backend of dispatchers constructed without one, epoll unless set otherwise.
+  static Backend getDefaultBackend();
+  static void setDefaultBackend(Backend backend);
+  Backend getBackend() const;
   int getEpoll() const;
-  NativeContext& getReusableContext();
+  IoUring* getIoUring() const;
+  void waitOperation(OperationContext& operation);
+  // stackSize of 0 selects the default stack size
+  NativeContext& getReusableContext(size_t stackSize = 0);
   void pushReusableContext(NativeContext&);
   int getTimer();
   void pushTimer(int timer);
@@ -79,6 +97,9 @@ public:
 private:
   void spawn(std::function<void()>&& procedure);
   int epoll;
+  IoUring* ioUring;
+  OperationContext epollOperation;
+  size_t pendingOperations;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
   ContextPair remoteSpawnEventContext;
@@ -91,9 +112,13 @@ private:
   NativeContext* firstResumingContext;
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
+  std::map<size_t, NativeContext*> sizedReusableContexts;
   size_t runningContextCount;
 
-  void contextProcedure(void* ucontext);
+  int pollEpoll(int timeout);
+  void pollIoUring(bool wait);
+  void releaseReusableContexts();
+  void contextProcedure(void* contextMakingData);
   static void contextProcedureStatic(void* context);
 };
 
@@ -0,0 +1,251 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "IoUring.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING
+#endif
+#endif
+
+#include "ErrorMessage.h"
+
+namespace System {
+
+#if defined(HAVE_IO_URING) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+namespace {
+
+template<class T> T* at(void* base, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+}
+
+}
+
+IoUring::IoUring(unsigned entries) : submissionRing(MAP_FAILED), completionRing(MAP_FAILED), submissionEntriesMemory(MAP_FAILED) {
+  io_uring_params params;
+  memset(&params, 0, sizeof params);
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+
+  std::string message;
+  ring = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (ring == -1) {
+    message = "io_uring_setup failed, " + lastErrorMessage();
+  } else if ((params.features & (IORING_FEAT_NODROP | IORING_FEAT_FAST_POLL)) != (IORING_FEAT_NODROP | IORING_FEAT_FAST_POLL)) {
+    // without fast poll socket operations would occupy kernel worker threads
+    message = "io_uring lacks required features";
+  } else {
+    submissionEntries = params.sq_entries;
+    pendingSubmissions = 0;
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping) {
+      submissionRingSize = completionRingSize = std::max(submissionRingSize, completionRingSize);
+    }
+
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    if (submissionRing != MAP_FAILED) {
+      completionRing = singleMapping ? submissionRing :
+        mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+      if (completionRing != MAP_FAILED) {
+        submissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+        submissionEntriesMemory = mmap(nullptr, submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+      }
+    }
+
+    if (submissionEntriesMemory == MAP_FAILED) {
+      message = "mmap failed, " + lastErrorMessage();
+    } else {
+      submissionHead = at<unsigned>(submissionRing, params.sq_off.head);
+      submissionTail = at<unsigned>(submissionRing, params.sq_off.tail);
+      submissionMask = *at<unsigned>(submissionRing, params.sq_off.ring_mask);
+      submissionArray = at<unsigned>(submissionRing, params.sq_off.array);
+      completionHead = at<unsigned>(completionRing, params.cq_off.head);
+      completionTail = at<unsigned>(completionRing, params.cq_off.tail);
+      completionMask = *at<unsigned>(completionRing, params.cq_off.ring_mask);
+      completionEntries = at<io_uring_cqe>(completionRing, params.cq_off.cqes);
+      return;
+    }
+  }
+
+  release();
+  throw std::runtime_error("IoUring::IoUring, " + message);
+}
+
+IoUring::~IoUring() {
+  release();
+}
+
+void IoUring::prepareAccept(void* userData, int socket) {
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(getSubmissionEntry(IORING_OP_ACCEPT, userData));
+  entry->fd = socket;
+  entry->accept_flags = SOCK_NONBLOCK;
+}
+
+void IoUring::prepareCancel(void* target) {
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(getSubmissionEntry(IORING_OP_ASYNC_CANCEL, nullptr));
+  entry->fd = -1;
+  entry->addr = reinterpret_cast<uint64_t>(target);
+}
+
+void IoUring::preparePoll(void* userData, int fd) {
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(getSubmissionEntry(IORING_OP_POLL_ADD, userData));
+  entry->fd = fd;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  entry->poll32_events = __builtin_bswap32(POLLIN);
+#else
+  entry->poll32_events = POLLIN;
+#endif
+}
+
+void IoUring::prepareRecv(void* userData, int socket, void* data, size_t size) {
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(getSubmissionEntry(IORING_OP_RECV, userData));
+  entry->fd = socket;
+  entry->addr = reinterpret_cast<uint64_t>(data);
+  entry->len = static_cast<uint32_t>(size);
+}
+
+void IoUring::prepareSend(void* userData, int socket, const void* data, size_t size) {
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(getSubmissionEntry(IORING_OP_SEND, userData));
+  entry->fd = socket;
+  entry->addr = reinterpret_cast<uint64_t>(data);
+  entry->len = static_cast<uint32_t>(size);
+  entry->msg_flags = MSG_NOSIGNAL;
+}
+
+void IoUring::prepareTimeout(void* userData, const IoUringTimeout* deadline) {
+  static_assert(sizeof(IoUringTimeout) == sizeof(__kernel_timespec), "invalid timeout layout");
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(getSubmissionEntry(IORING_OP_TIMEOUT, userData));
+  entry->fd = -1;
+  entry->addr = reinterpret_cast<uint64_t>(deadline);
+  entry->len = 1;
+  entry->timeout_flags = IORING_TIMEOUT_ABS;
+}
+
+bool IoUring::enter(unsigned minComplete) {
+  long submitted = syscall(__NR_io_uring_enter, ring, pendingSubmissions, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+  if (submitted == -1) {
+    if (errno == EINTR) {
+      return false;
+    }
+
+    // completion ring is overflown, the caller has to reap before submitting more
+    if (errno == EBUSY || errno == EAGAIN) {
+      return true;
+    }
+
+    throw std::runtime_error("IoUring::enter, io_uring_enter failed, " + lastErrorMessage());
+  }
+
+  assert(static_cast<unsigned>(submitted) <= pendingSubmissions);
+  pendingSubmissions -= static_cast<unsigned>(submitted);
+  return true;
+}
+
+size_t IoUring::reap(IoUringCompletion* completions, size_t count) {
+  unsigned head = *completionHead;
+  unsigned tail = __atomic_load_n(completionTail, __ATOMIC_ACQUIRE);
+  size_t reaped = 0;
+  for (; head != tail && reaped < count; ++head, ++reaped) {
+    const io_uring_cqe& entry = static_cast<io_uring_cqe*>(completionEntries)[head & completionMask];
+    completions[reaped].userData = reinterpret_cast<void*>(entry.user_data);
+    completions[reaped].result = entry.res;
+  }
+
+  __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+  return reaped;
+}
+
+void* IoUring::getSubmissionEntry(uint8_t opcode, void* userData) {
+  unsigned tail = *submissionTail;
+  if (tail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE) == submissionEntries) {
+    enter(0);
+    if (tail - __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE) == submissionEntries) {
+      throw std::runtime_error("IoUring::getSubmissionEntry, submission ring is full");
+    }
+  }
+
+  unsigned index = tail & submissionMask;
+  io_uring_sqe* entry = static_cast<io_uring_sqe*>(submissionEntriesMemory) + index;
+  memset(entry, 0, sizeof *entry);
+  entry->opcode = opcode;
+  entry->user_data = reinterpret_cast<uint64_t>(userData);
+  submissionArray[index] = index;
+  __atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+  ++pendingSubmissions;
+  return entry;
+}
+
+void IoUring::release() {
+  if (submissionEntriesMemory != MAP_FAILED) {
+    munmap(submissionEntriesMemory, submissionEntriesSize);
+  }
+
+  if (completionRing != MAP_FAILED && completionRing != submissionRing) {
+    munmap(completionRing, completionRingSize);
+  }
+
+  if (submissionRing != MAP_FAILED) {
+    munmap(submissionRing, submissionRingSize);
+  }
+
+  if (ring != -1) {
+    int result = close(ring);
+    assert(result != -1);
+  }
+}
+
+#else
+
+IoUring::IoUring(unsigned entries) {
+  throw std::runtime_error("IoUring::IoUring, io_uring is not supported by this build");
+}
+
+IoUring::~IoUring() {
+}
+
+void IoUring::prepareAccept(void* userData, int socket) {
+}
+
+void IoUring::prepareCancel(void* target) {
+}
+
+void IoUring::preparePoll(void* userData, int fd) {
+}
+
+void IoUring::prepareRecv(void* userData, int socket, void* data, size_t size) {
+}
+
+void IoUring::prepareSend(void* userData, int socket, const void* data, size_t size) {
+}
+
+void IoUring::prepareTimeout(void* userData, const IoUringTimeout* deadline) {
+}
+
+bool IoUring::enter(unsigned minComplete) {
+  return true;
+}
+
+size_t IoUring::reap(IoUringCompletion* completions, size_t count) {
+  return 0;
+}
+
+#endif
+
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace System {
+
+struct IoUringCompletion {
+  void* userData;
+  int32_t result;
+};
+
+// layout of __kernel_timespec
+struct IoUringTimeout {
+  int64_t seconds;
+  long long nanoseconds;
+};
+
+// Minimal io_uring ring driven through raw system calls. Operations are queued in the
+// submission ring and handed to the kernel in one io_uring_enter call, which also waits
+// for completions. A null userData is reserved for operations whose completion is ignored.
+class IoUring {
+public:
+  explicit IoUring(unsigned entries);
+  IoUring(const IoUring&) = delete;
+  ~IoUring();
+  IoUring& operator=(const IoUring&) = delete;
+
+  void prepareAccept(void* userData, int socket);
+  void prepareCancel(void* target);
+  void preparePoll(void* userData, int fd);
+  void prepareRecv(void* userData, int socket, void* data, size_t size);
+  void prepareSend(void* userData, int socket, const void* data, size_t size);
+  // deadline on CLOCK_MONOTONIC, queued timeouts do not drift until submission
+  void prepareTimeout(void* userData, const IoUringTimeout* deadline);
+
+  // Submits queued operations and blocks until at least minComplete operations are completed,
+  // returns false if the wait was interrupted by a signal.
+  bool enter(unsigned minComplete);
+  size_t reap(IoUringCompletion* completions, size_t count);
+
+private:
+  int ring;
+  unsigned submissionEntries;
+  unsigned pendingSubmissions;
+  void* submissionRing;
+  size_t submissionRingSize;
+  void* completionRing;
+  size_t completionRingSize;
+  void* submissionEntriesMemory;
+  size_t submissionEntriesSize;
+
+  unsigned* submissionHead;
+  unsigned* submissionTail;
+  unsigned submissionMask;
+  unsigned* submissionArray;
+  unsigned* completionHead;
+  unsigned* completionTail;
+  unsigned completionMask;
+  void* completionEntries;
+
+  void* getSubmissionEntry(uint8_t opcode, void* userData);
+  void release();
+};
+
+}
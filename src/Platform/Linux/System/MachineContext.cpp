@@ -0,0 +1,153 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "MachineContext.h"
+#include <cassert>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "ErrorMessage.h"
+
+#if defined(__x86_64__)
+
+// Saves callee-saved registers, the x87 control word and MXCSR on the current stack, stores
+// the stack pointer to *from and restores the same layout from to.
+asm(
+  ".pushsection .text\n"
+  ".globl FortressSwitchContext\n"
+  ".hidden FortressSwitchContext\n"
+  ".type FortressSwitchContext, @function\n"
+  ".p2align 4\n"
+  "FortressSwitchContext:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  subq $16, %rsp\n"
+  "  stmxcsr 8(%rsp)\n"
+  "  fnstcw (%rsp)\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  fldcw (%rsp)\n"
+  "  ldmxcsr 8(%rsp)\n"
+  "  addq $16, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size FortressSwitchContext, .-FortressSwitchContext\n"
+  ".globl FortressContextEntry\n"
+  ".hidden FortressContextEntry\n"
+  ".type FortressContextEntry, @function\n"
+  "FortressContextEntry:\n"
+  "  movq %r12, %rdi\n"
+  "  callq *%r13\n"
+  "  ud2\n"
+  ".size FortressContextEntry, .-FortressContextEntry\n"
+  ".popsection\n");
+
+extern "C" void FortressSwitchContext(void** from, void* to);
+extern "C" void FortressContextEntry();
+
+#endif
+
+namespace System {
+
+#if defined(__x86_64__)
+
+void* createMachineContext() {
+  // filled in by the first switch away from the running thread
+  return nullptr;
+}
+
+void* createMachineContext(uint8_t* stack, size_t stackSize, void (*procedure)(void*), void* argument) {
+  uint64_t* top = reinterpret_cast<uint64_t*>(reinterpret_cast<uintptr_t>(stack + stackSize) & ~static_cast<uintptr_t>(15));
+  top[-1] = reinterpret_cast<uint64_t>(&FortressContextEntry);
+  top[-2] = 0; // rbp
+  top[-3] = 0; // rbx
+  top[-4] = reinterpret_cast<uint64_t>(argument); // r12
+  top[-5] = reinterpret_cast<uint64_t>(procedure); // r13
+  top[-6] = 0; // r14
+  top[-7] = 0; // r15
+  top[-8] = 0x1F80; // MXCSR default
+  top[-9] = 0x037F; // x87 control word default
+  return top - 9;
+}
+
+void destroyMachineContext(void* context) {
+}
+
+void switchMachineContext(void*& from, void* to) {
+  FortressSwitchContext(&from, to);
+}
+
+#else
+
+void* createMachineContext() {
+  ucontext_t* context = new ucontext_t;
+  if (getcontext(context) == -1) {
+    delete context;
+    throw std::runtime_error("createMachineContext, getcontext failed, " + lastErrorMessage());
+  }
+
+  return context;
+}
+
+void* createMachineContext(uint8_t* stack, size_t stackSize, void (*procedure)(void*), void* argument) {
+  ucontext_t* context = static_cast<ucontext_t*>(createMachineContext());
+  context->uc_stack.ss_sp = stack;
+  context->uc_stack.ss_size = stackSize;
+  context->uc_link = nullptr;
+  makecontext(context, (void(*)())procedure, 1, argument);
+  return context;
+}
+
+void destroyMachineContext(void* context) {
+  delete static_cast<ucontext_t*>(context);
+}
+
+void switchMachineContext(void*& from, void* to) {
+  if (swapcontext(static_cast<ucontext_t*>(from), static_cast<ucontext_t*>(to)) == -1) {
+    throw std::runtime_error("switchMachineContext, swapcontext failed, " + lastErrorMessage());
+  }
+}
+
+#endif
+
+size_t getStackPageSize() {
+  static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return pageSize;
+}
+
+uint8_t* allocateStack(size_t stackSize) {
+  size_t guardSize = getStackPageSize();
+  void* memory = mmap(nullptr, guardSize + stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (memory == MAP_FAILED) {
+    throw std::runtime_error("allocateStack, mmap failed, " + lastErrorMessage());
+  }
+
+  if (mprotect(memory, guardSize, PROT_NONE) == -1) {
+    std::string message = "allocateStack, mprotect failed, " + lastErrorMessage();
+    int result = munmap(memory, guardSize + stackSize);
+    assert(result == 0);
+    throw std::runtime_error(message);
+  }
+
+  return static_cast<uint8_t*>(memory) + guardSize;
+}
+
+void releaseStack(uint8_t* stack, size_t stackSize) {
+  size_t guardSize = getStackPageSize();
+  int result = munmap(stack - guardSize, guardSize + stackSize);
+  assert(result == 0);
+}
+
+}
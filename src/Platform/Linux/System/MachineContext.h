@@ -0,0 +1,26 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace System {
+
+// A machine context is an opaque handle of a suspended coroutine. On x86-64 it is the saved
+// stack pointer and switching stays in user space; elsewhere it is a ucontext_t, whose
+// swapcontext also saves and restores the signal mask.
+void* createMachineContext();
+void* createMachineContext(uint8_t* stack, size_t stackSize, void (*procedure)(void*), void* argument);
+void destroyMachineContext(void* context);
+void switchMachineContext(void*& from, void* to);
+
+// Stacks are mapped lazily with an inaccessible guard page below them, so a stack overflow
+// faults instead of corrupting the neighbouring memory.
+size_t getStackPageSize();
+uint8_t* allocateStack(size_t stackSize);
+void releaseStack(uint8_t* stack, size_t stackSize);
+
+}
@@ -7,14 +7,23 @@
 #include <arpa/inet.h>
 #include <cassert>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
 #include <System/Ipv4Address.h>
+#include "IoUring.h"
 
 namespace System {
 
+namespace {
+
+const std::size_t MAX_WRITE_BUFFERS = 64;
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -70,6 +79,25 @@ size_t TcpConnection::read(uint8_t* data, size_t size) {
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "recv failed, " + lastErrorMessage();
+    } else if (dispatcher->getIoUring() != nullptr) {
+      OperationContext operationContext;
+      contextPair.readContext = &operationContext;
+      do {
+        dispatcher->getIoUring()->prepareRecv(&operationContext, connection, data, size);
+        dispatcher->waitOperation(operationContext);
+      } while (!operationContext.interrupted && operationContext.result == -EAGAIN);
+
+      contextPair.readContext = nullptr;
+      if (operationContext.interrupted) {
+        throw InterruptedException();
+      }
+
+      if (operationContext.result < 0) {
+        message = "recv failed, " + errorMessage(-operationContext.result);
+      } else {
+        assert(operationContext.result <= static_cast<ssize_t>(size));
+        return operationContext.result;
+      }
     } else {
       epoll_event connectionEvent;
       OperationContext operationContext;
@@ -166,6 +194,25 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
       message = "send failed, " + lastErrorMessage();
+    } else if (dispatcher->getIoUring() != nullptr) {
+      OperationContext operationContext;
+      contextPair.writeContext = &operationContext;
+      do {
+        dispatcher->getIoUring()->prepareSend(&operationContext, connection, data, size);
+        dispatcher->waitOperation(operationContext);
+      } while (!operationContext.interrupted && operationContext.result == -EAGAIN);
+
+      contextPair.writeContext = nullptr;
+      if (operationContext.interrupted) {
+        throw InterruptedException();
+      }
+
+      if (operationContext.result < 0) {
+        message = "send failed, " + errorMessage(-operationContext.result);
+      } else {
+        assert(operationContext.result <= static_cast<ssize_t>(size));
+        return operationContext.result;
+      }
     } else {
       epoll_event connectionEvent;
       OperationContext operationContext;
@@ -242,6 +289,41 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
   return transferred;
 }
 
+std::size_t TcpConnection::writeBuffers(const Buffer* buffers, std::size_t count) {
+  assert(dispatcher != nullptr);
+  assert(contextPair.writeContext == nullptr);
+  assert(count != 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec vectors[MAX_WRITE_BUFFERS];
+  if (count > MAX_WRITE_BUFFERS) {
+    count = MAX_WRITE_BUFFERS;
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    assert(buffers[i].size != 0);
+    vectors[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+    vectors[i].iov_len = buffers[i].size;
+  }
+
+  msghdr header = {};
+  header.msg_iov = vectors;
+  header.msg_iovlen = count;
+  ssize_t transferred = ::sendmsg(connection, &header, MSG_NOSIGNAL);
+  if (transferred == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      throw std::runtime_error("TcpConnection::writeBuffers, sendmsg failed, " + lastErrorMessage());
+    }
+
+    // The socket buffer is full, wait for it to drain and send the first buffer alone
+    return write(buffers[0].data, buffers[0].size);
+  }
+
+  return transferred;
+}
+
 std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
   sockaddr_in addr;
   socklen_t size = sizeof(addr);
@@ -256,6 +338,10 @@ std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
 TcpConnection::TcpConnection(Dispatcher& dispatcher, int socket) : dispatcher(&dispatcher), connection(socket) {
   contextPair.readContext = nullptr;
   contextPair.writeContext = nullptr;
+  if (dispatcher.getIoUring() != nullptr) {
+    return;
+  }
+
   epoll_event connectionEvent;
   connectionEvent.events = EPOLLONESHOT;
   connectionEvent.data.ptr = nullptr;
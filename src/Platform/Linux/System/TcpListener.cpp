@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "Dispatcher.h"
+#include "IoUring.h"
 #include "TcpConnection.h"
 #include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
@@ -45,6 +46,9 @@ TcpListener::TcpListener(Dispatcher& dispatcher, const Ipv4Address& addr, uint16
           message = "bind failed, " + lastErrorMessage();
         } else if (listen(listener, SOMAXCONN) != 0) {
           message = "listen failed, " + lastErrorMessage();
+        } else if (dispatcher.getIoUring() != nullptr) {
+          context = nullptr;
+          return;
         } else {
           epoll_event listenEvent;
           listenEvent.events = 0;
@@ -110,6 +114,26 @@ TcpConnection TcpListener::accept() {
     throw InterruptedException();
   }
 
+  if (dispatcher->getIoUring() != nullptr) {
+    OperationContext listenerContext;
+    context = &listenerContext;
+    do {
+      dispatcher->getIoUring()->prepareAccept(&listenerContext, listener);
+      dispatcher->waitOperation(listenerContext);
+    } while (!listenerContext.interrupted && listenerContext.result == -EAGAIN);
+
+    context = nullptr;
+    if (listenerContext.interrupted) {
+      throw InterruptedException();
+    }
+
+    if (listenerContext.result < 0) {
+      throw std::runtime_error("TcpListener::accept, accept failed, " + errorMessage(-listenerContext.result));
+    }
+
+    return TcpConnection(*dispatcher, listenerContext.result);
+  }
+
   ContextPair contextPair;
   OperationContext listenerContext;
   listenerContext.interrupted = false;
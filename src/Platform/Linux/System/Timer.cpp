@@ -7,10 +7,12 @@
 #include <stdexcept>
 
 #include <sys/timerfd.h>
+#include <time.h>
 #include <sys/epoll.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
+#include "IoUring.h"
 #include <System/ErrorMessage.h>
 #include <System/InterruptedException.h>
 
@@ -58,6 +60,26 @@ void Timer::sleep(std::chrono::nanoseconds duration) {
 
   if(duration.count() == 0 ) {
     dispatcher->yield();
+  } else if (dispatcher->getIoUring() != nullptr) {
+    timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == -1) {
+      throw std::runtime_error("Timer::sleep, clock_gettime failed, " + lastErrorMessage());
+    }
+
+    auto deadline = std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec) + duration;
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(deadline);
+    IoUringTimeout timeout;
+    timeout.seconds = seconds.count();
+    timeout.nanoseconds = (deadline - seconds).count();
+
+    OperationContext timerContext;
+    context = &timerContext;
+    dispatcher->getIoUring()->prepareTimeout(&timerContext, &timeout);
+    dispatcher->waitOperation(timerContext);
+    context = nullptr;
+    if (timerContext.interrupted) {
+      throw InterruptedException();
+    }
   } else {
     timer = dispatcher->getTimer();
 
@@ -322,7 +322,7 @@ int Dispatcher::getKqueue() const {
   return kqueue;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
+NativeContext& Dispatcher::getReusableContext(size_t stackSize) {
   if(firstReusableContext == nullptr) {
    uctx* newlyCreatedContext = new uctx;
    uint8_t* stackPointer = new uint8_t[STACK_SIZE];
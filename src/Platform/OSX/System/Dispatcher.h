@@ -55,7 +55,8 @@ public:
   void yield();
 
   int getKqueue() const;
-  NativeContext& getReusableContext();
+  // stackSize is accepted for portability, contexts use the platform default stack size
+  NativeContext& getReusableContext(size_t stackSize = 0);
   void pushReusableContext(NativeContext&);
   int getTimer();
   void pushTimer(int timer);
@@ -9,6 +9,7 @@
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -18,6 +19,12 @@
 
 namespace System {
 
+namespace {
+
+const std::size_t MAX_WRITE_BUFFERS = 64;
+
+}
+
 TcpConnection::TcpConnection() : dispatcher(nullptr) {
 }
 
@@ -205,6 +212,41 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
   return transferred;
 }
 
+std::size_t TcpConnection::writeBuffers(const Buffer* buffers, std::size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  assert(count != 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  iovec vectors[MAX_WRITE_BUFFERS];
+  if (count > MAX_WRITE_BUFFERS) {
+    count = MAX_WRITE_BUFFERS;
+  }
+
+  for (std::size_t i = 0; i < count; ++i) {
+    assert(buffers[i].size != 0);
+    vectors[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+    vectors[i].iov_len = buffers[i].size;
+  }
+
+  msghdr header = {};
+  header.msg_iov = vectors;
+  header.msg_iovlen = count;
+  ssize_t transferred = ::sendmsg(connection, &header, 0);
+  if (transferred == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      throw std::runtime_error("TcpConnection::writeBuffers, sendmsg failed, " + lastErrorMessage());
+    }
+
+    // The socket buffer is full, wait for it to drain and send the first buffer alone
+    return write(buffers[0].data, buffers[0].size);
+  }
+
+  return transferred;
+}
+
 std::pair<Ipv4Address, uint16_t> TcpConnection::getPeerAddressAndPort() const {
   sockaddr_in addr;
   socklen_t size = sizeof(addr);
@@ -15,6 +15,11 @@ class Ipv4Address;
 
 class TcpConnection {
 public:
+  struct Buffer {
+    const uint8_t* data;
+    std::size_t size;
+  };
+
   TcpConnection();
   TcpConnection(const TcpConnection&) = delete;
   TcpConnection(TcpConnection&& other);
@@ -23,6 +28,9 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // Writes the buffers in order with a single system call, returns the number of bytes written.
+  // Buffers must not be empty.
+  std::size_t writeBuffers(const Buffer* buffers, std::size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -321,7 +321,7 @@ void* Dispatcher::getCompletionPort() const {
   return completionPort;
 }
 
-NativeContext& Dispatcher::getReusableContext() {
+NativeContext& Dispatcher::getReusableContext(size_t stackSize) {
   if (firstReusableContext == nullptr) {
     void* fiber = CreateFiberEx(STACK_SIZE, RESERVE_STACK_SIZE, 0, contextProcedureStatic, this);
     if (fiber == NULL) {
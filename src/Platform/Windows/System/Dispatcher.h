@@ -50,7 +50,8 @@ public:
   // Platform-specific
   void addTimer(uint64_t time, NativeContext* context);
   void* getCompletionPort() const;
-  NativeContext& getReusableContext();
+  // stackSize is accepted for portability, contexts use the platform default stack size
+  NativeContext& getReusableContext(size_t stackSize = 0);
   void pushReusableContext(NativeContext&);
   void interruptTimer(uint64_t time, NativeContext* context);
 
@@ -18,6 +18,8 @@ namespace System {
 
 namespace {
 
+const size_t MAX_WRITE_BUFFERS = 64;
+
 struct TcpConnectionContext : public OVERLAPPED {
   NativeContext* context;
   bool interrupted;
@@ -147,13 +149,37 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  Buffer buffer = { data, size };
+  return writeBuffers(&buffer, 1);
+}
+
+size_t TcpConnection::writeBuffers(const Buffer* buffers, size_t count) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  assert(count != 0);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  WSABUF bufs[MAX_WRITE_BUFFERS];
+  if (count > MAX_WRITE_BUFFERS) {
+    count = MAX_WRITE_BUFFERS;
+  }
+
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    assert(buffers[i].size != 0);
+    bufs[i].len = static_cast<ULONG>(buffers[i].size);
+    bufs[i].buf = reinterpret_cast<char*>(const_cast<uint8_t*>(buffers[i].data));
+    size += buffers[i].size;
+  }
+
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, bufs, static_cast<DWORD>(count), NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
-      throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
+      throw std::runtime_error("TcpConnection::writeBuffers, WSASend failed, " + errorMessage(lastError));
     }
   }
 
@@ -189,7 +215,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
   if (WSAGetOverlappedResult(connection, &context, &transferred, FALSE, &flags) != TRUE) {
     int lastError = WSAGetLastError();
     if (lastError != ERROR_OPERATION_ABORTED) {
-      throw std::runtime_error("TcpConnection::write, WSAGetOverlappedResult failed, " + errorMessage(lastError));
+      throw std::runtime_error("TcpConnection::writeBuffers, WSAGetOverlappedResult failed, " + errorMessage(lastError));
     }
 
     assert(context.interrupted);
@@ -14,6 +14,11 @@ class Ipv4Address;
 
 class TcpConnection {
 public:
+  struct Buffer {
+    const uint8_t* data;
+    size_t size;
+  };
+
   TcpConnection();
   TcpConnection(const TcpConnection&) = delete;
   TcpConnection(TcpConnection&& other);
@@ -22,6 +27,9 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // Writes the buffers in order with a single system call, returns the number of bytes written.
+  // Buffers must not be empty.
+  size_t writeBuffers(const Buffer* buffers, size_t count);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -141,6 +141,62 @@ struct COMMAND_RPC_GET_POOL_CHANGES_LITE {
   };
 };
 
+// everything a wallet polls for in one round trip: the top block, the network height, the peer count
+// and the pool changes against the wallet's tail block, which a syncing node leaves out
+struct COMMAND_RPC_GET_NODE_STATUS {
+  struct request {
+    Crypto::Hash tailBlockId;
+    std::vector<Crypto::Hash> knownTxsIds;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tailBlockId)
+      serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+    }
+  };
+
+  struct response {
+    Crypto::Hash topBlockId;
+    uint32_t topBlockIndex;
+    uint64_t topBlockTimestamp;
+    uint32_t lastKnownBlockIndex;
+    uint64_t peerCount;
+    bool isTailBlockActual;
+    std::vector<TransactionPrefixInfo> addedTxs;
+    std::vector<Crypto::Hash> deletedTxsIds;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(topBlockId)
+      KV_MEMBER(topBlockIndex)
+      KV_MEMBER(topBlockTimestamp)
+      KV_MEMBER(lastKnownBlockIndex)
+      KV_MEMBER(peerCount)
+      KV_MEMBER(isTailBlockActual)
+      KV_MEMBER(addedTxs)
+      serializeAsBinary(deletedTxsIds, "deletedTxsIds", s);
+      KV_MEMBER(status)
+    }
+  };
+};
+
+// COMMAND_RPC_GET_NODE_STATUS held by the node until the top block is not tailBlockId anymore, the
+// pool differs from knownTxsIds or timeout milliseconds pass
+struct COMMAND_RPC_WAIT_NODE_STATUS {
+  struct request {
+    Crypto::Hash tailBlockId;
+    std::vector<Crypto::Hash> knownTxsIds;
+    uint32_t timeout;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tailBlockId)
+      serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+      KV_MEMBER(timeout)
+    }
+  };
+
+  typedef COMMAND_RPC_GET_NODE_STATUS::response response;
+};
+
 //-----------------------------------------------
 struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES {
   
@@ -162,6 +218,36 @@ struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES {
     }
   };
 };
+
+struct TransactionOutputGlobalIndexes {
+  std::vector<uint32_t> o_indexes;
+
+  void serialize(ISerializer &s) {
+    KV_MEMBER(o_indexes)
+  }
+};
+
+// global output indexes of several transactions in one round trip, the response keeps the order of txids
+struct COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES {
+  
+  struct request {
+    std::vector<Crypto::Hash> txids;
+
+    void serialize(ISerializer &s) {
+      serializeAsBinary(txids, "txids", s);
+    }
+  };
+
+  struct response {
+    std::vector<TransactionOutputGlobalIndexes> transactions;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(transactions)
+      KV_MEMBER(status)
+    }
+  };
+};
 //-----------------------------------------------
 struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request {
   std::vector<uint64_t> amounts;
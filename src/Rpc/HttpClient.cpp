@@ -73,4 +73,7 @@ void HttpClient::disconnect() {
 ConnectException::ConnectException(const std::string& whatArg) : std::runtime_error(whatArg.c_str()) {
 }
 
+NotFoundException::NotFoundException(const std::string& whatArg) : std::runtime_error(whatArg.c_str()) {
+}
+
 }
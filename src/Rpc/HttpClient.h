@@ -20,6 +20,12 @@ public:
   ConnectException(const std::string& whatArg);
 };
 
+// the server doesn't serve the requested url
+class NotFoundException : public std::runtime_error {
+public:
+  NotFoundException(const std::string& whatArg);
+};
+
 class HttpClient {
 public:
 
@@ -69,6 +75,10 @@ void invokeBinaryCommand(HttpClient& client, const std::string& url, const Reque
   hreq.setBody(storeToBinaryKeyValue(req));
   client.request(hreq, hres);
 
+  if (hres.getStatus() == HttpResponse::STATUS_404) {
+    throw NotFoundException(url);
+  }
+
   if (!loadFromBinaryKeyValue(res, hres.getBody())) {
     throw std::runtime_error("Failed to parse binary response");
   }
@@ -0,0 +1,65 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "HttpClientPool.h"
+
+#include <cassert>
+
+namespace Fortress {
+
+HttpClientPool::HttpClientPool(System::Dispatcher& dispatcher, const std::string& address, uint16_t port, size_t connectionCount) :
+  m_clientReleased(dispatcher), m_connected(false) {
+  assert(connectionCount > 0);
+
+  m_clients.reserve(connectionCount);
+  m_freeClients.reserve(connectionCount);
+  for (size_t i = 0; i < connectionCount; ++i) {
+    m_clients.emplace_back(new HttpClient(dispatcher, address, port));
+    m_freeClients.push_back(m_clients.back().get());
+  }
+
+  m_clientReleased.set();
+}
+
+size_t HttpClientPool::connectionCount() const {
+  return m_clients.size();
+}
+
+bool HttpClientPool::isConnected() const {
+  return m_connected;
+}
+
+HttpClient* HttpClientPool::acquire() {
+  while (!m_clientReleased.get()) {
+    m_clientReleased.wait();
+  }
+
+  // the most recently released connection is the most likely to be still open
+  HttpClient* client = m_freeClients.back();
+  m_freeClients.pop_back();
+  if (m_freeClients.empty()) {
+    m_clientReleased.clear();
+  }
+
+  return client;
+}
+
+void HttpClientPool::release(HttpClient* client) {
+  m_connected = client->isConnected();
+  m_freeClients.push_back(client);
+  m_clientReleased.set();
+}
+
+HttpClientPool::Lease::Lease(HttpClientPool& pool) : m_pool(pool), m_client(pool.acquire()) {
+}
+
+HttpClientPool::Lease::~Lease() {
+  m_pool.release(m_client);
+}
+
+HttpClient& HttpClientPool::Lease::client() {
+  return *m_client;
+}
+
+}
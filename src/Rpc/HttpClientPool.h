@@ -0,0 +1,55 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <System/Event.h>
+
+#include "HttpClient.h"
+
+namespace Fortress {
+
+// A fixed set of keep-alive connections to one server. Every request takes a free connection for
+// its whole round trip, so up to connectionCount requests are in flight at once and the rest wait.
+// Connections are opened on first use. Must be used from the dispatcher's thread only.
+class HttpClientPool {
+public:
+  HttpClientPool(System::Dispatcher& dispatcher, const std::string& address, uint16_t port, size_t connectionCount);
+  HttpClientPool(const HttpClientPool&) = delete;
+  HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+  size_t connectionCount() const;
+  // state of the connection that completed a request last
+  bool isConnected() const;
+
+  // Holds a connection of the pool until destroyed, waits while all connections are busy
+  class Lease {
+  public:
+    explicit Lease(HttpClientPool& pool);
+    ~Lease();
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    HttpClient& client();
+
+  private:
+    HttpClientPool& m_pool;
+    HttpClient* m_client;
+  };
+
+private:
+  HttpClient* acquire();
+  void release(HttpClient* client);
+
+  std::vector<std::unique_ptr<HttpClient>> m_clients;
+  std::vector<HttpClient*> m_freeClients;
+  System::Event m_clientReleased;
+  bool m_connected;
+};
+
+}
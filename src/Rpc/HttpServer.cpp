@@ -15,7 +15,12 @@ using namespace Logging;
 namespace Fortress {
 
 HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
-  : m_dispatcher(dispatcher), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+  : m_dispatcher(dispatcher), m_workers(nullptr), workingContextGroup(dispatcher), logger(log, "HttpServer") {
+
+}
+
+HttpServer::HttpServer(System::Dispatcher& dispatcher, System::DispatcherGroup& workers, Logging::ILogger& log)
+  : m_dispatcher(dispatcher), m_workers(&workers), workingContextGroup(dispatcher), logger(log, "HttpServer") {
 
 }
 
@@ -29,6 +34,10 @@ void HttpServer::stop() {
   workingContextGroup.wait();
 }
 
+bool HttpServer::isProcessedOnWorker(const HttpRequest& request) const {
+  return true;
+}
+
 void HttpServer::acceptLoop() {
   try {
     System::TcpConnection connection;
@@ -55,6 +64,7 @@ void HttpServer::acceptLoop() {
 
     workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
 
+    System::Dispatcher* worker = m_workers != nullptr ? &m_workers->nextDispatcher() : nullptr;
     System::TcpStreambuf streambuf(connection);
     std::iostream stream(&streambuf);
     HttpParser parser;
@@ -64,7 +74,11 @@ void HttpServer::acceptLoop() {
       HttpResponse resp;
 
       parser.receiveRequest(stream, req);
-      processRequest(req, resp);
+      if (worker != nullptr && isProcessedOnWorker(req)) {
+        System::remoteInvoke(m_dispatcher, *worker, [&] { processRequest(req, resp); });
+      } else {
+        processRequest(req, resp);
+      }
 
       stream << resp;
       stream.flush();
@@ -11,6 +11,7 @@
 
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
+#include <System/DispatcherGroup.h>
 #include <System/TcpListener.h>
 #include <System/TcpConnection.h>
 #include <System/Event.h>
@@ -24,6 +25,9 @@ class HttpServer {
 public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
+  // Connections are served on dispatcher, each of them is assigned a dispatcher of workers
+  // that runs processRequest, so slow requests do not hold up the other connections.
+  HttpServer(System::Dispatcher& dispatcher, System::DispatcherGroup& workers, Logging::ILogger& log);
 
   void start(const std::string& address, uint16_t port);
   void stop();
@@ -31,8 +35,11 @@ public:
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) = 0;
 
 protected:
+  // Requests that mostly wait, e.g. long polls, are processed on dispatcher instead of a worker
+  virtual bool isProcessedOnWorker(const HttpRequest& request) const;
 
   System::Dispatcher& m_dispatcher;
+  System::DispatcherGroup* m_workers;
 
 private:
 
@@ -0,0 +1,79 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "NodeStatusNotifier.h"
+
+#include <boost/scope_exit.hpp>
+
+#include <System/ContextGroup.h>
+#include <System/InterruptedException.h>
+#include <System/Timer.h>
+
+namespace Fortress {
+
+NodeStatusNotifier::NodeStatusNotifier(System::Dispatcher& dispatcher, std::function<void(NodeStatus&)>&& readStatus) :
+  m_dispatcher(dispatcher),
+  m_readStatus(std::move(readStatus)),
+  m_version(0),
+  m_reading(false),
+  m_statusRead(dispatcher) {
+}
+
+void NodeStatusNotifier::notify() {
+  ++m_version;
+  for (System::Event* waiter : m_waiters) {
+    waiter->set();
+  }
+}
+
+std::shared_ptr<const NodeStatusNotifier::NodeStatus> NodeStatusNotifier::getStatus() {
+  while (!m_status || m_status->version != m_version) {
+    if (m_reading) {
+      m_statusRead.wait();
+      continue;
+    }
+
+    // a change that comes while the status is read is not missed, the version tells it
+    uint64_t version = m_version;
+    m_reading = true;
+    m_statusRead.clear();
+    BOOST_SCOPE_EXIT_ALL(this) {
+      m_reading = false;
+      m_statusRead.set();
+    };
+
+    std::shared_ptr<NodeStatus> status = std::make_shared<NodeStatus>();
+    m_readStatus(*status);
+    status->version = version;
+    m_status = status;
+    return m_status;
+  }
+
+  return m_status;
+}
+
+void NodeStatusNotifier::wait(const NodeStatus& status, std::chrono::milliseconds timeout) {
+  if (m_version != status.version) {
+    return;
+  }
+
+  System::Event changed(m_dispatcher);
+  System::ContextGroup timeoutContext(m_dispatcher);
+  timeoutContext.spawn([&] {
+    try {
+      System::Timer(m_dispatcher).sleep(timeout);
+      changed.set();
+    } catch (System::InterruptedException&) {
+    }
+  });
+
+  m_waiters.insert(&changed);
+  BOOST_SCOPE_EXIT_ALL(this, &changed) {
+    m_waiters.erase(&changed);
+  };
+
+  changed.wait();
+}
+
+}
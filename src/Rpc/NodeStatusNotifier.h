@@ -0,0 +1,53 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+
+#include <System/Event.h>
+
+#include "CoreRpcServerCommandsDefinitions.h"
+
+namespace Fortress {
+
+// Holds the node status for the requests that wait for it to change. The status is read once per change and
+// shared by all of them, a request that needs it while another one reads it waits for that read.
+// Must be used from the dispatcher's thread only.
+class NodeStatusNotifier {
+public:
+  struct NodeStatus {
+    uint64_t version;
+    // the fields that don't depend on the request, the pool changes are left empty
+    COMMAND_RPC_GET_NODE_STATUS::response response;
+    // ids of the pool transactions that are reported as pool changes
+    std::unordered_set<Crypto::Hash> poolTransactionIds;
+  };
+
+  // readStatus may yield, the version is set by the notifier
+  NodeStatusNotifier(System::Dispatcher& dispatcher, std::function<void(NodeStatus&)>&& readStatus);
+  NodeStatusNotifier(const NodeStatusNotifier&) = delete;
+  NodeStatusNotifier& operator=(const NodeStatusNotifier&) = delete;
+
+  // the node status changed
+  void notify();
+  // the status read after the last change
+  std::shared_ptr<const NodeStatus> getStatus();
+  // returns when a change follows status or timeout passes
+  void wait(const NodeStatus& status, std::chrono::milliseconds timeout);
+
+private:
+  System::Dispatcher& m_dispatcher;
+  const std::function<void(NodeStatus&)> m_readStatus;
+  uint64_t m_version;
+  std::shared_ptr<const NodeStatus> m_status;
+  bool m_reading;
+  System::Event m_statusRead;
+  std::unordered_set<System::Event*> m_waiters;
+};
+
+}
@@ -75,9 +75,12 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
   { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
   { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
+  { "/get_txs_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_transactions_indexes), false } },
   { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
   { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
   { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
+  { "/get_node_status.bin", { binMethod<COMMAND_RPC_GET_NODE_STATUS>(&RpcServer::onGetNodeStatus), true } },
+  { "/wait_node_status.bin", { binMethod<COMMAND_RPC_WAIT_NODE_STATUS>(&RpcServer::onWaitNodeStatus), true } },
 
   // json handlers
   { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true } },
@@ -93,7 +96,19 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const IFortressProtocolQuery& protocolQuery) :
-  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery) {
+  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery),
+  m_nodeStatusNotifier(dispatcher, std::bind(&RpcServer::readNodeStatus, this, std::placeholders::_1)) {
+  m_core.addObserver(this);
+}
+
+RpcServer::RpcServer(System::Dispatcher& dispatcher, System::DispatcherGroup& workers, Logging::ILogger& log, core& c, NodeServer& p2p, const IFortressProtocolQuery& protocolQuery) :
+  HttpServer(dispatcher, workers, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery),
+  m_nodeStatusNotifier(dispatcher, std::bind(&RpcServer::readNodeStatus, this, std::placeholders::_1)) {
+  m_core.addObserver(this);
+}
+
+RpcServer::~RpcServer() {
+  m_core.removeObserver(this);
 }
 
 void RpcServer::processRequest(const HttpRequest& request, HttpResponse& response) {
@@ -165,6 +180,75 @@ bool RpcServer::isCoreReady() {
   return m_core.currency().isTestnet() || m_p2p.get_payload_object().isSynchronized();
 }
 
+bool RpcServer::isProcessedOnWorker(const HttpRequest& request) const {
+  // a held status request only waits for a core notification, it would block a worker meanwhile
+  return request.getUrl() != "/wait_node_status.bin";
+}
+
+void RpcServer::blockchainUpdated() {
+  m_dispatcher.remoteSpawn(std::bind(&NodeStatusNotifier::notify, &m_nodeStatusNotifier));
+}
+
+void RpcServer::poolUpdated() {
+  m_dispatcher.remoteSpawn(std::bind(&NodeStatusNotifier::notify, &m_nodeStatusNotifier));
+}
+
+bool RpcServer::getChainStatus(COMMAND_RPC_GET_NODE_STATUS::response& rsp) {
+  m_core.get_blockchain_top(rsp.topBlockIndex, rsp.topBlockId);
+
+  Block topBlock;
+  if (!m_core.getBlockByHash(rsp.topBlockId, topBlock)) {
+    rsp.status = "Internal error: can't get top block";
+    return false;
+  }
+
+  rsp.topBlockTimestamp = topBlock.timestamp;
+  rsp.lastKnownBlockIndex = std::max(static_cast<uint32_t>(1), m_protocolQuery.getObservedHeight()) - 1;
+  rsp.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
+void RpcServer::getNodeStatusPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
+  COMMAND_RPC_GET_NODE_STATUS::response& rsp) {
+  if (isCoreReady()) {
+    rsp.isTailBlockActual = m_core.getPoolChangesLite(tailBlockId, knownTxsIds, rsp.addedTxs, rsp.deletedTxsIds);
+  } else {
+    // a syncing node serves the chain part of the status only, its pool is left out
+    rsp.isTailBlockActual = tailBlockId == rsp.topBlockId;
+  }
+}
+
+void RpcServer::readNodeStatus(NodeStatusNotifier::NodeStatus& status) {
+  if (!getChainStatus(status.response)) {
+    return;
+  }
+
+  // the held requests run on the dispatcher, it serves other requests while p2p answers
+  System::Dispatcher& p2pDispatcher = m_p2p.getDispatcher();
+  if (&p2pDispatcher != &m_dispatcher) {
+    System::remoteInvoke(m_dispatcher, p2pDispatcher, [&] {
+      status.response.peerCount = m_p2p.get_connections_count();
+    });
+  } else {
+    status.response.peerCount = m_p2p.get_connections_count();
+  }
+
+  std::vector<Crypto::Hash> poolTransactionIds = m_core.getPoolChangesTransactionIds();
+  status.poolTransactionIds.insert(poolTransactionIds.begin(), poolTransactionIds.end());
+}
+
+void RpcServer::invokeOnP2p(std::function<void()>&& procedure) {
+  System::Dispatcher& p2pDispatcher = m_p2p.getDispatcher();
+  if (m_workers != nullptr) {
+    // handlers never yield on a worker, so blocking its thread costs no more than a core call
+    System::remoteInvoke(p2pDispatcher, std::move(procedure));
+  } else if (&p2pDispatcher != &m_dispatcher) {
+    System::remoteInvoke(m_dispatcher, p2pDispatcher, std::move(procedure));
+  } else {
+    procedure();
+  }
+}
+
 //
 // Binary handlers
 //
@@ -252,6 +336,26 @@ bool RpcServer::on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::
   return true;
 }
 
+bool RpcServer::on_get_transactions_indexes(const COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response& res) {
+  if (req.txids.size() > COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES_MAX_COUNT) {
+    res.status = "Failed";
+    return true;
+  }
+
+  res.transactions.resize(req.txids.size());
+  for (size_t i = 0; i < req.txids.size(); ++i) {
+    if (!m_core.get_tx_outputs_gindexs(req.txids[i], res.transactions[i].o_indexes)) {
+      res.transactions.clear();
+      res.status = "Failed";
+      return true;
+    }
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  logger(TRACE) << "COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES: [" << res.transactions.size() << "]";
+  return true;
+}
+
 bool RpcServer::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
   res.status = "Failed";
   if (!m_core.get_random_outs_for_amounts(req, res)) {
@@ -305,6 +409,47 @@ bool RpcServer::onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::re
   return true;
 }
 
+bool RpcServer::onGetNodeStatus(const COMMAND_RPC_GET_NODE_STATUS::request& req, COMMAND_RPC_GET_NODE_STATUS::response& rsp) {
+  if (!getChainStatus(rsp)) {
+    return true;
+  }
+
+  invokeOnP2p([&] {
+    rsp.peerCount = m_p2p.get_connections_count();
+  });
+
+  getNodeStatusPoolChanges(req.tailBlockId, req.knownTxsIds, rsp);
+  return true;
+}
+
+bool RpcServer::onWaitNodeStatus(const COMMAND_RPC_WAIT_NODE_STATUS::request& req, COMMAND_RPC_WAIT_NODE_STATUS::response& rsp) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::min(req.timeout, COMMAND_RPC_WAIT_NODE_STATUS_MAX_TIMEOUT));
+
+  std::unordered_set<Crypto::Hash> knownTxsIds(req.knownTxsIds.begin(), req.knownTxsIds.end());
+
+  for (;;) {
+    // the status is shared by all held requests, only the requests that have changes read their own
+    std::shared_ptr<const NodeStatusNotifier::NodeStatus> status = m_nodeStatusNotifier.getStatus();
+    rsp = status->response;
+    if (rsp.status != CORE_RPC_STATUS_OK) {
+      return true;
+    }
+
+    if (req.tailBlockId != rsp.topBlockId || (isCoreReady() && knownTxsIds != status->poolTransactionIds)) {
+      getNodeStatusPoolChanges(req.tailBlockId, req.knownTxsIds, rsp);
+      return true;
+    }
+
+    rsp.isTailBlockActual = true;
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      return true;
+    }
+
+    m_nodeStatusNotifier.wait(*status, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now));
+  }
+}
+
 //
 // JSON handlers
 //
@@ -315,11 +460,13 @@ bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RP
   res.tx_count = m_core.get_blockchain_total_transactions() - res.height; //without coinbase
   res.tx_pool_size = m_core.get_pool_transactions_count();
   res.alt_blocks_count = m_core.get_alternative_blocks_count();
-  uint64_t total_conn = m_p2p.get_connections_count();
-  res.outgoing_connections_count = m_p2p.get_outgoing_connections_count();
-  res.incoming_connections_count = total_conn - res.outgoing_connections_count;
-  res.white_peerlist_size = m_p2p.getPeerlistManager().get_white_peers_count();
-  res.grey_peerlist_size = m_p2p.getPeerlistManager().get_gray_peers_count();
+  invokeOnP2p([&] {
+    uint64_t total_conn = m_p2p.get_connections_count();
+    res.outgoing_connections_count = m_p2p.get_outgoing_connections_count();
+    res.incoming_connections_count = total_conn - res.outgoing_connections_count;
+    res.white_peerlist_size = m_p2p.getPeerlistManager().get_white_peers_count();
+    res.grey_peerlist_size = m_p2p.getPeerlistManager().get_gray_peers_count();
+  });
   res.last_known_block_index = std::max(static_cast<uint32_t>(1), m_protocolQuery.getObservedHeight()) - 1;
   res.status = CORE_RPC_STATUS_OK;
   return true;
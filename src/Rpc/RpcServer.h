@@ -9,6 +9,8 @@
 
 #include <Logging/LoggerRef.h>
 #include "CoreRpcServerCommandsDefinitions.h"
+#include "FortressCore/ICoreObserver.h"
+#include "NodeStatusNotifier.h"
 
 namespace Fortress {
 
@@ -16,9 +18,12 @@ class core;
 class NodeServer;
 class IFortressProtocolQuery;
 
-class RpcServer : public HttpServer {
+class RpcServer : public HttpServer, private ICoreObserver {
 public:
   RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, const IFortressProtocolQuery& protocolQuery);
+  // workers must not include the dispatcher of p2p
+  RpcServer(System::Dispatcher& dispatcher, System::DispatcherGroup& workers, Logging::ILogger& log, core& c, NodeServer& p2p, const IFortressProtocolQuery& protocolQuery);
+  virtual ~RpcServer();
 
   typedef std::function<bool(RpcServer*, const HttpRequest& request, HttpResponse& response)> HandlerFunction;
 
@@ -34,17 +39,34 @@ private:
   static std::unordered_map<std::string, RpcHandler<HandlerFunction>> s_handlers;
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) override;
+  virtual bool isProcessedOnWorker(const HttpRequest& request) const override;
   bool processJsonRpcRequest(const HttpRequest& request, HttpResponse& response);
   bool isCoreReady();
+  // p2p state is owned by the p2p dispatcher, it is read there when requests are served elsewhere
+  void invokeOnP2p(std::function<void()>&& procedure);
+
+  // ICoreObserver, called on the thread that changed the core
+  virtual void blockchainUpdated() override;
+  virtual void poolUpdated() override;
+  // fills the node status fields that don't depend on the request
+  bool getChainStatus(COMMAND_RPC_GET_NODE_STATUS::response& rsp);
+  // fills the pool changes against the requester's tail block, left empty until the node is synchronized
+  void getNodeStatusPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
+    COMMAND_RPC_GET_NODE_STATUS::response& rsp);
+  // reads the status shared by the held status requests, runs on dispatcher
+  void readNodeStatus(NodeStatusNotifier::NodeStatus& status);
 
   // binary handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
   bool on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, COMMAND_RPC_QUERY_BLOCKS::response& res);
   bool on_query_blocks_lite(const COMMAND_RPC_QUERY_BLOCKS_LITE::request& req, COMMAND_RPC_QUERY_BLOCKS_LITE::response& res);
   bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res);
+  bool on_get_transactions_indexes(const COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response& res);
   bool on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
   bool onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp);
   bool onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::request& req, COMMAND_RPC_GET_POOL_CHANGES_LITE::response& rsp);
+  bool onGetNodeStatus(const COMMAND_RPC_GET_NODE_STATUS::request& req, COMMAND_RPC_GET_NODE_STATUS::response& rsp);
+  bool onWaitNodeStatus(const COMMAND_RPC_WAIT_NODE_STATUS::request& req, COMMAND_RPC_WAIT_NODE_STATUS::response& rsp);
 
   // json handlers
   bool on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res);
@@ -71,6 +93,9 @@ private:
   core& m_core;
   NodeServer& m_p2p;
   const IFortressProtocolQuery& m_protocolQuery;
+
+  // owned by dispatcher
+  NodeStatusNotifier m_nodeStatusNotifier;
 };
 
 }
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "RpcServerConfig.h"
+#include <algorithm>
 #include "Common/CommandLine.h"
 #include "FortressConfig.h"
 
@@ -12,13 +13,15 @@ namespace Fortress {
 
     const std::string DEFAULT_RPC_IP = "127.0.0.1";
     const uint16_t DEFAULT_RPC_PORT = RPC_DEFAULT_PORT;
+    const uint32_t DEFAULT_RPC_THREADS = 1;
 
     const command_line::arg_descriptor<std::string> arg_rpc_bind_ip = { "rpc-bind-ip", "", DEFAULT_RPC_IP };
     const command_line::arg_descriptor<uint16_t> arg_rpc_bind_port = { "rpc-bind-port", "", DEFAULT_RPC_PORT };
+    const command_line::arg_descriptor<uint32_t> arg_rpc_threads = { "rpc-threads", "Number of threads serving rpc requests, apart from the p2p thread", DEFAULT_RPC_THREADS };
   }
 
 
-  RpcServerConfig::RpcServerConfig() : bindIp(DEFAULT_RPC_IP), bindPort(DEFAULT_RPC_PORT) {
+  RpcServerConfig::RpcServerConfig() : bindIp(DEFAULT_RPC_IP), bindPort(DEFAULT_RPC_PORT), threads(DEFAULT_RPC_THREADS) {
   }
 
   std::string RpcServerConfig::getBindAddress() const {
@@ -28,11 +31,13 @@ namespace Fortress {
   void RpcServerConfig::initOptions(boost::program_options::options_description& desc) {
     command_line::add_arg(desc, arg_rpc_bind_ip);
     command_line::add_arg(desc, arg_rpc_bind_port);
+    command_line::add_arg(desc, arg_rpc_threads);
   }
 
   void RpcServerConfig::init(const boost::program_options::variables_map& vm)  {
     bindIp = command_line::get_arg(vm, arg_rpc_bind_ip);
     bindPort = command_line::get_arg(vm, arg_rpc_bind_port);
+    threads = std::max<uint32_t>(command_line::get_arg(vm, arg_rpc_threads), 1);
   }
 
 }
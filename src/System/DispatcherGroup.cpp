@@ -0,0 +1,168 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "DispatcherGroup.h"
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <System/Dispatcher.h>
+#include <System/Event.h>
+#include <System/InterruptedException.h>
+
+namespace System {
+
+DispatcherGroup::DispatcherGroup(size_t threadCount) : workers(threadCount, Worker{nullptr, nullptr}), nextIndex(0), startedCount(0) {
+  if (threadCount == 0) {
+    throw std::invalid_argument("DispatcherGroup::DispatcherGroup, thread count must not be zero");
+  }
+
+  threads.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back(&DispatcherGroup::workerProcedure, this, i);
+  }
+
+  bool failed = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (startedCount != threadCount) {
+      condition.wait(lock);
+    }
+
+    for (auto& worker : workers) {
+      failed = failed || worker.dispatcher == nullptr;
+    }
+  }
+
+  if (failed) {
+    stop();
+    throw std::runtime_error("DispatcherGroup::DispatcherGroup, failed to create dispatcher");
+  }
+}
+
+DispatcherGroup::~DispatcherGroup() {
+  stop();
+}
+
+size_t DispatcherGroup::size() const {
+  return workers.size();
+}
+
+Dispatcher& DispatcherGroup::getDispatcher(size_t index) {
+  assert(index < workers.size());
+  assert(workers[index].dispatcher != nullptr);
+  return *workers[index].dispatcher;
+}
+
+Dispatcher& DispatcherGroup::nextDispatcher() {
+  return getDispatcher(nextIndex++ % workers.size());
+}
+
+void DispatcherGroup::stop() {
+  for (auto& worker : workers) {
+    if (worker.dispatcher != nullptr) {
+      Event* stopEvent = worker.stopEvent;
+      worker.dispatcher->remoteSpawn([stopEvent] { stopEvent->set(); });
+    }
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  threads.clear();
+  for (auto& worker : workers) {
+    worker.dispatcher = nullptr;
+    worker.stopEvent = nullptr;
+  }
+}
+
+void DispatcherGroup::workerProcedure(size_t index) {
+  std::unique_ptr<Dispatcher> dispatcher;
+  try {
+    dispatcher.reset(new Dispatcher);
+  } catch (std::exception&) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++startedCount;
+    condition.notify_one();
+    return;
+  }
+
+  Event stopEvent(*dispatcher);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    workers[index].dispatcher = dispatcher.get();
+    workers[index].stopEvent = &stopEvent;
+    ++startedCount;
+    condition.notify_one();
+  }
+
+  while (!stopEvent.get()) {
+    stopEvent.wait();
+  }
+}
+
+void remoteInvoke(Dispatcher& dispatcher, Dispatcher& target, std::function<void()>&& procedure) {
+  Event completed(dispatcher);
+  std::exception_ptr exception;
+  target.remoteSpawn([&] {
+    try {
+      procedure();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    // the waiting context returns as soon as the event is set, the captured frame is dead after that
+    Event* event = &completed;
+    dispatcher.remoteSpawn([event] { event->set(); });
+  });
+
+  bool interrupted = false;
+  while (!completed.get()) {
+    try {
+      completed.wait();
+    } catch (InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    dispatcher.interrupt();
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void remoteInvoke(Dispatcher& target, std::function<void()>&& procedure) {
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool completed = false;
+  std::exception_ptr exception;
+
+  target.remoteSpawn([&] {
+    try {
+      procedure();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    mutex.lock();
+    completed = true;
+    condition.notify_one();
+    mutex.unlock();
+  });
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!completed) {
+    condition.wait(lock);
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+}
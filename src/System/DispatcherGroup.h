@@ -0,0 +1,60 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace System {
+
+class Dispatcher;
+class Event;
+
+// Runs a dispatcher on each of the threadCount threads. A dispatcher of the group may only be
+// used from its own thread, other threads hand work to it with remoteSpawn or remoteInvoke.
+class DispatcherGroup {
+public:
+  explicit DispatcherGroup(size_t threadCount);
+  DispatcherGroup(const DispatcherGroup&) = delete;
+  ~DispatcherGroup();
+  DispatcherGroup& operator=(const DispatcherGroup&) = delete;
+
+  size_t size() const;
+  Dispatcher& getDispatcher(size_t index);
+  // Dispatchers are handed out round-robin, so connections assigned with it are spread evenly.
+  Dispatcher& nextDispatcher();
+  // Lets dispatchers finish pending work and joins the threads, called by the destructor.
+  void stop();
+
+private:
+  struct Worker {
+    Dispatcher* dispatcher;
+    Event* stopEvent;
+  };
+
+  std::vector<Worker> workers;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> nextIndex;
+  std::mutex mutex;
+  std::condition_variable condition;
+  size_t startedCount;
+
+  void workerProcedure(size_t index);
+};
+
+// Executes procedure in a new context of target and suspends the current context of dispatcher
+// until it completes, an exception thrown by procedure is rethrown. The current context is not
+// resumed before the procedure is completed, even if it is interrupted.
+void remoteInvoke(Dispatcher& dispatcher, Dispatcher& target, std::function<void()>&& procedure);
+
+// Same for a thread that is not running a dispatcher, the calling thread is blocked. Must not be
+// called from the thread of target.
+void remoteInvoke(Dispatcher& target, std::function<void()>&& procedure);
+
+}
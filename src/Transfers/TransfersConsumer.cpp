@@ -4,10 +4,10 @@
 
 #include "TransfersConsumer.h"
 
+#include <memory>
 #include <numeric>
 
 #include "CommonTypes.h"
-#include "Common/BlockingQueue.h"
 #include "FortressCore/FortressFormatUtils.h"
 #include "FortressCore/TransactionApi.h"
 
@@ -21,23 +21,6 @@ namespace {
 
 using namespace Fortress;
 
-void checkOutputKey(
-  const KeyDerivation& derivation,
-  const PublicKey& key,
-  size_t keyIndex,
-  size_t outputIndex,
-  const std::unordered_set<PublicKey>& spendKeys,
-  std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs) {
-
-  PublicKey spendKey;
-  underive_public_key(derivation, keyIndex, key, spendKey);
-
-  if (spendKeys.find(spendKey) != spendKeys.end()) {
-    outputs[spendKey].push_back(static_cast<uint32_t>(outputIndex));
-  }
-
-}
-
 void findMyOutputs(
   const ITransactionReader& tx,
   const SecretKey& viewSecretKey,
@@ -51,6 +34,11 @@ void findMyOutputs(
     return;
   }
 
+  // all output keys of the transaction are underived in one batch
+  std::vector<PublicKey> keys;
+  std::vector<size_t> keyIndexes;
+  std::vector<uint32_t> outputIndexes;
+
   size_t keyIndex = 0;
   size_t outputCount = tx.getOutputCount();
 
@@ -63,7 +51,9 @@ void findMyOutputs(
       uint64_t amount;
       KeyOutput out;
       tx.getOutput(idx, out, amount);
-      checkOutputKey(derivation, out.key, keyIndex, idx, spendKeys, outputs);
+      keys.push_back(out.key);
+      keyIndexes.push_back(keyIndex);
+      outputIndexes.push_back(static_cast<uint32_t>(idx));
       ++keyIndex;
 
     } else if (outType == TransactionTypes::OutputType::Multisignature) {
@@ -72,11 +62,34 @@ void findMyOutputs(
       MultisignatureOutput out;
       tx.getOutput(idx, out, amount);
       for (const auto& key : out.keys) {
-        checkOutputKey(derivation, key, idx, idx, spendKeys, outputs);
+        keys.push_back(key);
+        keyIndexes.push_back(idx);
+        outputIndexes.push_back(static_cast<uint32_t>(idx));
         ++keyIndex;
       }
     }
   }
+
+  std::vector<PublicKey> spendKeyCandidates(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  underive_public_keys(derivation, keyIndexes.data(), keys.data(), keys.size(), spendKeyCandidates.data(), valid.get());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (valid[i] && spendKeys.find(spendKeyCandidates[i]) != spendKeys.end()) {
+      outputs[spendKeyCandidates[i]].push_back(outputIndexes[i]);
+    }
+  }
+}
+
+template <typename F>
+std::error_code callCatchingErrors(F f) {
+  try {
+    return f();
+  } catch (const std::system_error& e) {
+    return e.code();
+  } catch (const std::exception&) {
+    return std::make_error_code(std::errc::operation_canceled);
+  }
 }
 
 std::vector<Crypto::Hash> getBlockHashes(const Fortress::CompleteBlock* blocks, size_t count) {
@@ -95,7 +108,12 @@ std::vector<Crypto::Hash> getBlockHashes(const Fortress::CompleteBlock* blocks,
 namespace Fortress {
 
 TransfersConsumer::TransfersConsumer(const Fortress::Currency& currency, INode& node, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency) {
+  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_ownWorkerPool(new Tools::JobPool()), m_workerPool(*m_ownWorkerPool) {
+  updateSyncStart();
+}
+
+TransfersConsumer::TransfersConsumer(const Fortress::Currency& currency, INode& node, const SecretKey& viewSecret, Tools::JobPool& workerPool) :
+  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_workerPool(workerPool) {
   updateSyncStart();
 }
 
@@ -182,89 +200,90 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
     const ITransactionReader* tx;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
+  struct PreprocessedTx : Tx, PreprocessInfo {
+    std::unordered_map<PublicKey, std::vector<uint32_t>> ownOutputs;
+    std::error_code ec;
+  };
 
+  // transactions are collected in block order, so the results don't need sorting
   std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
+    if (!block.is_initialized()) {
+      continue;
+    }
 
-  BlockingQueue<Tx> inputQueue(workers * 2);
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      continue;
+    }
 
-  std::atomic<bool> stopProcessing(false);
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
+
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey != NULL_PUBLIC_KEY) {
+        PreprocessedTx item;
+        item.blockInfo = blockInfo;
+        item.tx = tx.get();
+        preprocessedTransactions.push_back(std::move(item));
+      }
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+      ++blockInfo.transactionIndex;
+    }
+  }
 
-      if (!block.is_initialized()) {
-        continue;
-      }
+  size_t firstFailed = m_workerPool.run(preprocessedTransactions.size(), [&](size_t index) {
+    PreprocessedTx& item = preprocessedTransactions[index];
+    item.ec = callCatchingErrors([&] {
+      findMyOutputs(*item.tx, m_viewSecret, m_spendKeys, item.ownOutputs);
+      return std::error_code();
+    });
 
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
-        continue;
-      }
+    return !item.ec;
+  });
+
+  std::error_code processingError;
+  if (firstFailed != preprocessedTransactions.size()) {
+    processingError = preprocessedTransactions[firstFailed].ec;
+  }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
-
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
-
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
+  // global indices of all transactions that pay us are requested at once, not one round trip per transaction
+  std::vector<PreprocessedTx*> ownTransactions;
+  std::vector<Crypto::Hash> ownTransactionHashes;
+  if (!processingError) {
+    for (auto& item : preprocessedTransactions) {
+      if (!item.ownOutputs.empty()) {
+        ownTransactions.push_back(&item);
+        ownTransactionHashes.push_back(item.tx->getTransactionHash());
       }
     }
+  }
 
-    inputQueue.close();
-  });
-
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
-
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+  if (!ownTransactions.empty()) {
+    std::vector<std::vector<uint32_t>> globalIndices;
+    processingError = getGlobalIndices(ownTransactionHashes, globalIndices);
+    if (!processingError) {
+      for (size_t i = 0; i < ownTransactions.size(); ++i) {
+        ownTransactions[i]->globalIdxs = std::move(globalIndices[i]);
       }
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
-    }
-    return ec;
-  };
+      firstFailed = m_workerPool.run(ownTransactions.size(), [&](size_t index) {
+        PreprocessedTx& item = *ownTransactions[index];
+        item.ec = callCatchingErrors([&] {
+          return createSubscriptionTransfers(item.blockInfo, *item.tx, item.ownOutputs, item);
+        });
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
+        return !item.ec;
+      });
 
-  std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
+      if (firstFailed != ownTransactions.size()) {
+        processingError = ownTransactions[firstFailed]->ec;
       }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
     }
   }
 
@@ -272,11 +291,6 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
-
     for (const auto& tx : preprocessedTransactions) {
       processTransaction(tx.blockInfo, *tx.tx, tx);
     }
@@ -431,11 +445,16 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
     }
   }
 
+  return createSubscriptionTransfers(blockInfo, tx, outputs, info);
+}
+
+std::error_code TransfersConsumer::createSubscriptionTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  const std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info) {
   for (const auto& kv : outputs) {
     auto it = m_subscriptions.find(kv.first);
     if (it != m_subscriptions.end()) {
       auto& transfers = info.outputs[kv.first];
-      errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
+      std::error_code errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
       if (errorCode) {
         return errorCode;
       }
@@ -514,4 +533,24 @@ std::error_code TransfersConsumer::getGlobalIndices(const Hash& transactionHash,
   return f.get();
 }
 
+std::error_code TransfersConsumer::getGlobalIndices(const std::vector<Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  std::promise<std::error_code> prom;
+  std::future<std::error_code> f = prom.get_future();
+
+  INode::Callback cb = [&prom](std::error_code ec) {
+    std::promise<std::error_code> p(std::move(prom));
+    p.set_value(ec);
+  };
+
+  outsGlobalIndices.clear();
+  m_node.getTransactionsOutsGlobalIndices(transactionHashes, outsGlobalIndices, cb);
+
+  std::error_code ec = f.get();
+  if (!ec && outsGlobalIndices.size() != transactionHashes.size()) {
+    ec = std::make_error_code(std::errc::bad_message);
+  }
+
+  return ec;
+}
+
 }
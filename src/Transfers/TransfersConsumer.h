@@ -9,10 +9,12 @@
 #include "TransfersSubscription.h"
 #include "TypeHelpers.h"
 
+#include "Common/JobPool.h"
 #include "crypto/crypto.h"
 
 #include "IObservableImpl.h"
 
+#include <memory>
 #include <unordered_set>
 
 namespace Fortress {
@@ -22,7 +24,10 @@ class INode;
 class TransfersConsumer: public IObservableImpl<IBlockchainConsumerObserver, IBlockchainConsumer> {
 public:
 
+  // the consumer preprocesses transactions on a worker pool of its own
   TransfersConsumer(const Fortress::Currency& currency, INode& node, const Crypto::SecretKey& viewSecret);
+  // workerPool is shared with other consumers and must outlive the consumer
+  TransfersConsumer(const Fortress::Currency& currency, INode& node, const Crypto::SecretKey& viewSecret, Tools::JobPool& workerPool);
 
   ITransfersSubscription& addSubscription(const AccountSubscription& subscription);
   // returns true if no subscribers left
@@ -57,12 +62,16 @@ private:
   };
 
   std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info);
+  // outputs are the own outputs of tx grouped by spend key, info.globalIdxs must already be set for confirmed transactions
+  std::error_code createSubscriptionTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+    const std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx);
   void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& sub, const ITransactionReader& tx,
     const std::vector<TransactionOutputInformationIn>& outputs, const std::vector<uint32_t>& globalIdxs, bool& contains, bool& updated);
 
   std::error_code getGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code getGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices);
 
   void updateSyncStart();
 
@@ -75,6 +84,9 @@ private:
 
   INode& m_node;
   const Fortress::Currency& m_currency;
+
+  std::unique_ptr<Tools::JobPool> m_ownWorkerPool;
+  Tools::JobPool& m_workerPool;
 };
 
 }
@@ -17,8 +17,8 @@ namespace Fortress {
 
 const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
 
-TransfersSyncronizer::TransfersSyncronizer(const Fortress::Currency& currency, IBlockchainSynchronizer& sync, INode& node) :
-  m_currency(currency), m_sync(sync), m_node(node) {
+TransfersSyncronizer::TransfersSyncronizer(const Fortress::Currency& currency, IBlockchainSynchronizer& sync, INode& node, size_t workerThreadCount) :
+  m_workerPool(workerThreadCount), m_currency(currency), m_sync(sync), m_node(node) {
 }
 
 TransfersSyncronizer::~TransfersSyncronizer() {
@@ -39,7 +39,7 @@ ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubsc
 
   if (it == m_consumers.end()) {
     std::unique_ptr<TransfersConsumer> consumer(
-      new TransfersConsumer(m_currency, m_node, acc.keys.viewSecretKey));
+      new TransfersConsumer(m_currency, m_node, acc.keys.viewSecretKey, m_workerPool));
 
     m_sync.addConsumer(consumer.get());
     consumer->addObserver(this);
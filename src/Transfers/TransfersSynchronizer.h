@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "Common/JobPool.h"
 #include "Common/ObserverManager.h"
 #include "ITransfersSynchronizer.h"
 #include "IBlockchainSynchronizer.h"
@@ -24,7 +25,8 @@ class INode;
 
 class TransfersSyncronizer : public ITransfersSynchronizer, public IBlockchainConsumerObserver {
 public:
-  TransfersSyncronizer(const Fortress::Currency& currency, IBlockchainSynchronizer& sync, INode& node);
+  // all consumers preprocess transactions on one pool of workerThreadCount threads, 0 means one per CPU core
+  TransfersSyncronizer(const Fortress::Currency& currency, IBlockchainSynchronizer& sync, INode& node, size_t workerThreadCount = 0);
   virtual ~TransfersSyncronizer();
 
   void initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions);
@@ -44,6 +46,9 @@ public:
   virtual void load(std::istream& in) override;
 
 private:
+  // destroyed after the consumers that use it
+  Tools::JobPool m_workerPool;
+
   // map { view public key -> consumer }
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersConsumer>> ConsumersContainer;
   ConsumersContainer m_consumers;
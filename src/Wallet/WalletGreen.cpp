@@ -224,14 +224,15 @@ Fortress::AccountPublicAddress parseAccountAddressString(const std::string& addr
 
 namespace Fortress {
 
-WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currency, INode& node, uint32_t transactionSoftLockTime) :
+WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currency, INode& node, uint32_t transactionSoftLockTime,
+  size_t syncThreadCount) :
   m_dispatcher(dispatcher),
   m_currency(currency),
   m_node(node),
   m_stopped(false),
   m_blockchainSynchronizerStarted(false),
   m_blockchainSynchronizer(node, currency.genesisBlockHash()),
-  m_synchronizer(currency, m_blockchainSynchronizer, node),
+  m_synchronizer(currency, m_blockchainSynchronizer, node, syncThreadCount),
   m_eventOccurred(m_dispatcher),
   m_readyEvent(m_dispatcher),
   m_state(WalletState::NOT_INITIALIZED),
@@ -25,7 +25,8 @@ class WalletGreen : public IWallet,
                     ITransfersSynchronizerObserver,
                     IFusionManager {
 public:
-  WalletGreen(System::Dispatcher& dispatcher, const Currency& currency, INode& node, uint32_t transactionSoftLockTime = 1);
+  WalletGreen(System::Dispatcher& dispatcher, const Currency& currency, INode& node, uint32_t transactionSoftLockTime = 1,
+    size_t syncThreadCount = 0);
   virtual ~WalletGreen();
 
   virtual void initialize(const std::string& password) override;
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "crypto-ops.h"
@@ -2893,3 +2894,39 @@ int sc_isnonzero(const unsigned char *s) {
     s[18] | s[19] | s[20] | s[21] | s[22] | s[23] | s[24] | s[25] | s[26] |
     s[27] | s[28] | s[29] | s[30] | s[31]) - 1) >> 8) + 1;
 }
+
+/* Same as ge_tobytes for each of count points, with one field inversion for all of them (Montgomery's trick).
+   scratch must hold count elements. */
+void ge_tobytes_batch(unsigned char (*s)[32], const ge_p2 *h, fe *scratch, size_t count) {
+  fe recip;
+  fe zrecip;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (count == 0) {
+    return;
+  }
+
+  /* scratch[i] = Z_0 * ... * Z_i */
+  fe_copy(scratch[0], h[0].Z);
+  for (i = 1; i < count; i++) {
+    fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+  }
+
+  fe_invert(recip, scratch[count - 1]);
+  for (i = count; i-- > 0;) {
+    /* recip = 1 / (Z_0 * ... * Z_i) */
+    if (i > 0) {
+      fe_mul(zrecip, recip, scratch[i - 1]);
+      fe_mul(recip, recip, h[i].Z);
+    } else {
+      fe_copy(zrecip, recip);
+    }
+
+    fe_mul(x, h[i].X, zrecip);
+    fe_mul(y, h[i].Y, zrecip);
+    fe_tobytes(s[i], y);
+    s[i][31] ^= fe_isnegative(x) << 7;
+  }
+}
@@ -202,6 +202,47 @@ namespace Crypto {
     return true;
   }
 
+  void crypto_ops::underive_public_keys(const KeyDerivation &derivation, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *valid) {
+    struct {
+      KeyDerivation derivation;
+      char output_index[(sizeof(size_t) * 8 + 6) / 7];
+    } buf;
+    buf.derivation = derivation;
+
+    std::unique_ptr<ge_p2[]> points(new ge_p2[count]);
+    size_t pointCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+      EllipticCurveScalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      valid[i] = ge_frombytes_vartime(&point1, reinterpret_cast<const unsigned char*>(&derived_keys[i])) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+
+      char *end = buf.output_index;
+      Tools::write_varint(end, output_indexes[i]);
+      assert(end <= buf.output_index + sizeof buf.output_index);
+      hash_to_scalar(&buf, end - reinterpret_cast<char *>(&buf), scalar);
+      ge_scalarmult_base(&point2, reinterpret_cast<unsigned char*>(&scalar));
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      ge_p1p1_to_p2(&points[pointCount++], &point4);
+    }
+
+    std::unique_ptr<fe[]> scratch(new fe[pointCount]);
+    std::unique_ptr<PublicKey[]> results(new PublicKey[pointCount]);
+    ge_tobytes_batch(reinterpret_cast<unsigned char (*)[32]>(results.get()), points.get(), scratch.get(), pointCount);
+    for (size_t i = 0, j = 0; i < count; ++i) {
+      if (valid[i]) {
+        bases[i] = results[j++];
+      }
+    }
+  }
+
   bool crypto_ops::underive_public_key(const KeyDerivation &derivation, size_t output_index,
     const PublicKey &derived_key, const uint8_t* suffix, size_t suffixLength, PublicKey &base) {
     EllipticCurveScalar scalar;
@@ -63,6 +63,8 @@ struct EllipticCurveScalar {
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, PublicKey &);
     static bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
     friend bool underive_public_key(const KeyDerivation &, size_t, const PublicKey &, const uint8_t*, size_t, PublicKey &);
+    static void underive_public_keys(const KeyDerivation &, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
+    friend void underive_public_keys(const KeyDerivation &, const size_t *, const PublicKey *, size_t, PublicKey *, bool *);
     static void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     friend void generate_signature(const Hash &, const PublicKey &, const SecretKey &, Signature &);
     static bool check_signature(const Hash &, const PublicKey &, const Signature &);
@@ -187,6 +189,15 @@ struct EllipticCurveScalar {
     return crypto_ops::underive_public_key(derivation, output_index, derived_key, base);
   }
 
+  /* Same as underive_public_key for count outputs of one transaction, e.g. when scanning it for own outputs. The
+   * derivation is hashed from a shared buffer and all bases are converted to bytes with a single field inversion.
+   * valid[i] is false, and bases[i] is left unchanged, if derived_keys[i] is not a valid point.
+   */
+  inline void underive_public_keys(const KeyDerivation &derivation, const size_t *output_indexes,
+    const PublicKey *derived_keys, size_t count, PublicKey *bases, bool *valid) {
+    crypto_ops::underive_public_keys(derivation, output_indexes, derived_keys, count, bases, valid);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const Hash &prefix_hash, const PublicKey &pub, const SecretKey &sec, Signature &sig) {
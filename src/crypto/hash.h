@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <assert.h>
 #include <stddef.h>
 
 #include <CryptoTypes.h>
@@ -43,12 +44,29 @@ namespace Crypto {
 
     void *data;
     friend inline void cn_slow_hash(cn_context &, const void *, size_t, Hash &);
+    friend inline void cn_slow_hash(cn_context *, size_t, const void *const *, const size_t *, Hash *, size_t);
   };
 
   inline void cn_slow_hash(cn_context &context, const void *data, size_t length, Hash &hash) {
     (*cn_slow_hash_f)(context.data, data, length, reinterpret_cast<void *>(&hash));
   }
 
+  // Hashes count inputs with the same results as cn_slow_hash. Up to context_count (at least 1, at most
+  // SLOW_HASH_MAX_WAYS) inputs are hashed side by side on the calling thread, each in its own context.
+  inline void cn_slow_hash(cn_context *contexts, size_t context_count, const void *const *data, const size_t *lengths, Hash *hashes, size_t count) {
+    void *contextData[SLOW_HASH_MAX_WAYS];
+    assert(context_count >= 1);
+    if (context_count > SLOW_HASH_MAX_WAYS) {
+      context_count = SLOW_HASH_MAX_WAYS;
+    }
+
+    for (size_t i = 0; i < context_count; ++i) {
+      contextData[i] = contexts[i].data;
+    }
+
+    cn_slow_hash_multi_f(contextData, context_count, data, lengths, reinterpret_cast<char (*)[HASH_SIZE]>(hashes), count);
+  }
+
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -27,6 +28,12 @@ void cn_slow_hash_f(void * a, const void * b, size_t c, void * d){
 (*cn_slow_hash_fp)(a, b, c, d);
 }
 
+void (*cn_slow_hash_multi_fp)(void *const *, size_t, const void *const *, const size_t *, char (*)[HASH_SIZE], size_t);
+
+void cn_slow_hash_multi_f(void *const *contexts, size_t context_count, const void *const *data, const size_t *lengths, char (*hashes)[HASH_SIZE], size_t count) {
+  (*cn_slow_hash_multi_fp)(contexts, context_count, data, lengths, hashes, count);
+}
+
 #if defined(__GNUC__)
 #define likely(x) (__builtin_expect(!!(x), 1))
 #define unlikely(x) (__builtin_expect(!!(x), 0))
@@ -38,6 +45,9 @@ void cn_slow_hash_f(void * a, const void * b, size_t c, void * d){
 
 #if defined(_MSC_VER)
 #define restrict
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
 #endif
 
 #define MEMORY         (1 << 21) /* 2 MiB */
@@ -166,6 +176,130 @@ static void (*const extra_hashes[4])(const void *, size_t, char *) =
 #define AESNI
 #include "slow-hash.inl"
 
+/*
+ * Batches of inputs. Filling and reading the scratchpad is bound by AES throughput and is done one input at a time,
+ * the loop over the scratchpad is bound by memory latency and runs the iterations of up to SLOW_HASH_MAX_WAYS inputs
+ * side by side, each on its own scratchpad, so that their loads overlap. The fill and the read back are those of
+ * cn_slow_hash_aesni, so results are the same.
+ */
+
+// ways is a constant at every call site, so the loop over the inputs is unrolled
+static FORCE_INLINE void cn_slow_hash_ways_aesni(void *const *contexts, const void *const *data, const size_t *lengths, char (*hashes)[HASH_SIZE], const size_t ways)
+{
+  struct cn_ctx *hctx[SLOW_HASH_MAX_WAYS];
+  ALIGNED_DECL(uint64_t a[SLOW_HASH_MAX_WAYS][2], 16);
+  __m128i b_x[SLOW_HASH_MAX_WAYS];
+  size_t i, w;
+
+  for (w = 0; w < ways; w++)
+  {
+    hctx[w] = (struct cn_ctx *) contexts[w];
+    cn_slow_hash_explode_aesni(hctx[w], data[w], lengths[w]);
+    a[w][0] = hctx[w]->a[0];
+    a[w][1] = hctx[w]->a[1];
+    b_x[w] = _mm_load_si128((__m128i *)hctx[w]->b);
+  }
+
+  for(i = 0; likely(i < 0x80000); i++)
+  {
+    for (w = 0; w < ways; w++)
+    {
+      uint8_t *long_state = hctx[w]->long_state;
+      __m128i c_x = _mm_load_si128((__m128i *)&long_state[a[w][0] & 0x1FFFF0]);
+      __m128i a_x = _mm_load_si128((__m128i *)a[w]);
+      ALIGNED_DECL(uint64_t c[2], 16);
+      uint64_t b[2];
+      uint64_t *nextblock;
+      uint64_t hi, lo;
+
+      c_x = _mm_aesenc_si128(c_x, a_x);
+      _mm_store_si128((__m128i *)c, c_x);
+
+      b_x[w] = _mm_xor_si128(b_x[w], c_x);
+      _mm_store_si128((__m128i *)&long_state[a[w][0] & 0x1FFFF0], b_x[w]);
+
+      nextblock = (uint64_t *)&long_state[c[0] & 0x1FFFF0];
+      b[0] = nextblock[0];
+      b[1] = nextblock[1];
+
+#if defined(__GNUC__) && defined(__x86_64__)
+      __asm__("mulq %3\n\t"
+        : "=d" (hi),
+        "=a" (lo)
+        : "%a" (c[0]),
+        "rm" (b[0])
+        : "cc" );
+#else
+      lo = mul128(c[0], b[0], &hi);
+#endif
+
+      a[w][0] += hi;
+      a[w][1] += lo;
+      nextblock[0] = a[w][0];
+      nextblock[1] = a[w][1];
+
+      a[w][0] ^= b[0];
+      a[w][1] ^= b[1];
+      b_x[w] = c_x;
+    }
+  }
+
+  for (w = 0; w < ways; w++)
+  {
+    cn_slow_hash_implode_aesni(hctx[w], hashes[w]);
+  }
+}
+
+static void cn_slow_hash_multi_aesni(void *const *contexts, size_t context_count, const void *const *data, const size_t *lengths, char (*hashes)[HASH_SIZE], size_t count)
+{
+  // without a context nothing can be hashed, the loop below would never end
+  assert(context_count >= 1);
+  if (context_count == 0) {
+    return;
+  }
+
+  if (context_count > SLOW_HASH_MAX_WAYS) {
+    context_count = SLOW_HASH_MAX_WAYS;
+  }
+
+  while (count > 0) {
+    size_t ways = count < context_count ? count : context_count;
+    switch (ways) {
+    case 1:
+      cn_slow_hash_aesni(contexts[0], data[0], lengths[0], hashes[0]);
+      break;
+    case 2:
+      cn_slow_hash_ways_aesni(contexts, data, lengths, hashes, 2);
+      break;
+    case 3:
+      cn_slow_hash_ways_aesni(contexts, data, lengths, hashes, 3);
+      break;
+    default:
+      cn_slow_hash_ways_aesni(contexts, data, lengths, hashes, 4);
+      break;
+    }
+
+    data += ways;
+    lengths += ways;
+    hashes += ways;
+    count -= ways;
+  }
+}
+
+// without AES-NI the rounds themselves are the bottleneck, interleaving would not help
+static void cn_slow_hash_multi_noaesni(void *const *contexts, size_t context_count, const void *const *data, const size_t *lengths, char (*hashes)[HASH_SIZE], size_t count)
+{
+  size_t i;
+  assert(context_count >= 1);
+  if (context_count == 0) {
+    return;
+  }
+
+  for (i = 0; i < count; i++) {
+    cn_slow_hash_noaesni(contexts[0], data[i], lengths[i], hashes[i]);
+  }
+}
+
 INITIALIZER(detect_aes) {
   int ecx;
 #if defined(_MSC_VER)
@@ -177,4 +311,5 @@ INITIALIZER(detect_aes) {
   __cpuid(1, a, b, ecx, d);
 #endif
   cn_slow_hash_fp = (ecx & (1 << 25)) ? &cn_slow_hash_aesni : &cn_slow_hash_noaesni;
+  cn_slow_hash_multi_fp = (ecx & (1 << 25)) ? &cn_slow_hash_multi_aesni : &cn_slow_hash_multi_noaesni;
 }
@@ -2,34 +2,65 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+static FORCE_INLINE void
+#if defined(AESNI)
+cn_slow_hash_rounds_aesni
+#else
+cn_slow_hash_rounds_noaesni
+#endif
+(__m128i *xmminput, const __m128i *expkey)
+{
+#if defined(AESNI)
+  for(size_t j = 0; j < 10; j++)
+  {
+    xmminput[0] = _mm_aesenc_si128(xmminput[0], expkey[j]);
+    xmminput[1] = _mm_aesenc_si128(xmminput[1], expkey[j]);
+    xmminput[2] = _mm_aesenc_si128(xmminput[2], expkey[j]);
+    xmminput[3] = _mm_aesenc_si128(xmminput[3], expkey[j]);
+    xmminput[4] = _mm_aesenc_si128(xmminput[4], expkey[j]);
+    xmminput[5] = _mm_aesenc_si128(xmminput[5], expkey[j]);
+    xmminput[6] = _mm_aesenc_si128(xmminput[6], expkey[j]);
+    xmminput[7] = _mm_aesenc_si128(xmminput[7], expkey[j]);
+  }
+#else
+  aesb_pseudo_round((uint8_t *) &xmminput[0], (uint8_t *) &xmminput[0], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[1], (uint8_t *) &xmminput[1], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[2], (uint8_t *) &xmminput[2], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[3], (uint8_t *) &xmminput[3], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[4], (uint8_t *) &xmminput[4], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[5], (uint8_t *) &xmminput[5], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[6], (uint8_t *) &xmminput[6], (uint8_t *) expkey);
+  aesb_pseudo_round((uint8_t *) &xmminput[7], (uint8_t *) &xmminput[7], (uint8_t *) expkey);
+#endif
+}
+
+// hashes the input and fills the scratchpad, leaves the starting a and b of the main loop in the context
 static void
 #if defined(AESNI)
-cn_slow_hash_aesni
+cn_slow_hash_explode_aesni
 #else
-cn_slow_hash_noaesni
+cn_slow_hash_explode_noaesni
 #endif
-(void *restrict context, const void *restrict data, size_t length, void *restrict hash)
+(struct cn_ctx *restrict hctx, const void *restrict data, size_t length)
 {
-#define ctx ((struct cn_ctx *) context)
   ALIGNED_DECL(uint8_t ExpandedKey[256], 16);
   size_t i;
-  __m128i *longoutput, *expkey, *xmminput, b_x;
-  ALIGNED_DECL(uint64_t a[2], 16);
-  hash_process(&ctx->state.hs, (const uint8_t*) data, length);
+  __m128i *longoutput, *expkey, *xmminput;
+  hash_process(&hctx->state.hs, (const uint8_t*) data, length);
 
-  memcpy(ctx->text, ctx->state.init, INIT_SIZE_BYTE);
+  memcpy(hctx->text, hctx->state.init, INIT_SIZE_BYTE);
 #if defined(AESNI)
-  memcpy(ExpandedKey, ctx->state.hs.b, AES_KEY_SIZE);
+  memcpy(ExpandedKey, hctx->state.hs.b, AES_KEY_SIZE);
   ExpandAESKey256(ExpandedKey);
 #else
-  ctx->aes_ctx = oaes_alloc();
-  oaes_key_import_data(ctx->aes_ctx, ctx->state.hs.b, AES_KEY_SIZE);
-  memcpy(ExpandedKey, ctx->aes_ctx->key->exp_data, ctx->aes_ctx->key->exp_data_len);
+  hctx->aes_ctx = oaes_alloc();
+  oaes_key_import_data(hctx->aes_ctx, hctx->state.hs.b, AES_KEY_SIZE);
+  memcpy(ExpandedKey, hctx->aes_ctx->key->exp_data, hctx->aes_ctx->key->exp_data_len);
 #endif
 
-  longoutput = (__m128i *) ctx->long_state;
+  longoutput = (__m128i *) hctx->long_state;
   expkey = (__m128i *) ExpandedKey;
-  xmminput = (__m128i *) ctx->text;
+  xmminput = (__m128i *) hctx->text;
 
   //for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
   //    aesni_parallel_noxor(&ctx->long_state[i], ctx->text, ExpandedKey);
@@ -37,26 +68,9 @@ cn_slow_hash_noaesni
   for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
   {
 #if defined(AESNI)
-    for(size_t j = 0; j < 10; j++)
-    {
-      xmminput[0] = _mm_aesenc_si128(xmminput[0], expkey[j]);
-      xmminput[1] = _mm_aesenc_si128(xmminput[1], expkey[j]);
-      xmminput[2] = _mm_aesenc_si128(xmminput[2], expkey[j]);
-      xmminput[3] = _mm_aesenc_si128(xmminput[3], expkey[j]);
-      xmminput[4] = _mm_aesenc_si128(xmminput[4], expkey[j]);
-      xmminput[5] = _mm_aesenc_si128(xmminput[5], expkey[j]);
-      xmminput[6] = _mm_aesenc_si128(xmminput[6], expkey[j]);
-      xmminput[7] = _mm_aesenc_si128(xmminput[7], expkey[j]);
-    }
+    cn_slow_hash_rounds_aesni(xmminput, expkey);
 #else
-    aesb_pseudo_round((uint8_t *) &xmminput[0], (uint8_t *) &xmminput[0], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[1], (uint8_t *) &xmminput[1], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[2], (uint8_t *) &xmminput[2], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[3], (uint8_t *) &xmminput[3], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[4], (uint8_t *) &xmminput[4], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[5], (uint8_t *) &xmminput[5], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[6], (uint8_t *) &xmminput[6], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[7], (uint8_t *) &xmminput[7], (uint8_t *) expkey);
+    cn_slow_hash_rounds_noaesni(xmminput, expkey);
 #endif
     _mm_store_si128(&(longoutput[(i >> 4)]), xmminput[0]);
     _mm_store_si128(&(longoutput[(i >> 4) + 1]), xmminput[1]);
@@ -70,9 +84,85 @@ cn_slow_hash_noaesni
 
   for (i = 0; i < 2; i++)
   {
-    ctx->a[i] = ((uint64_t *)ctx->state.k)[i] ^  ((uint64_t *)ctx->state.k)[i+4];
-    ctx->b[i] = ((uint64_t *)ctx->state.k)[i+2] ^  ((uint64_t *)ctx->state.k)[i+6];
+    hctx->a[i] = ((uint64_t *)hctx->state.k)[i] ^  ((uint64_t *)hctx->state.k)[i+4];
+    hctx->b[i] = ((uint64_t *)hctx->state.k)[i+2] ^  ((uint64_t *)hctx->state.k)[i+6];
   }
+}
+
+// reads the scratchpad back into the state and writes the final hash
+static void
+#if defined(AESNI)
+cn_slow_hash_implode_aesni
+#else
+cn_slow_hash_implode_noaesni
+#endif
+(struct cn_ctx *restrict hctx, void *restrict hash)
+{
+  ALIGNED_DECL(uint8_t ExpandedKey[256], 16);
+  size_t i;
+  __m128i *longoutput, *expkey, *xmminput;
+
+  memcpy(hctx->text, hctx->state.init, INIT_SIZE_BYTE);
+#if defined(AESNI)
+  memcpy(ExpandedKey, &hctx->state.hs.b[32], AES_KEY_SIZE);
+  ExpandAESKey256(ExpandedKey);
+#else
+  oaes_key_import_data(hctx->aes_ctx, &hctx->state.hs.b[32], AES_KEY_SIZE);
+  memcpy(ExpandedKey, hctx->aes_ctx->key->exp_data, hctx->aes_ctx->key->exp_data_len);
+#endif
+
+  longoutput = (__m128i *) hctx->long_state;
+  expkey = (__m128i *) ExpandedKey;
+  xmminput = (__m128i *) hctx->text;
+
+  //for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
+  //    aesni_parallel_xor(&ctx->text, ExpandedKey, &ctx->long_state[i]);
+
+  for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
+  {
+    xmminput[0] = _mm_xor_si128(longoutput[(i >> 4)], xmminput[0]);
+    xmminput[1] = _mm_xor_si128(longoutput[(i >> 4) + 1], xmminput[1]);
+    xmminput[2] = _mm_xor_si128(longoutput[(i >> 4) + 2], xmminput[2]);
+    xmminput[3] = _mm_xor_si128(longoutput[(i >> 4) + 3], xmminput[3]);
+    xmminput[4] = _mm_xor_si128(longoutput[(i >> 4) + 4], xmminput[4]);
+    xmminput[5] = _mm_xor_si128(longoutput[(i >> 4) + 5], xmminput[5]);
+    xmminput[6] = _mm_xor_si128(longoutput[(i >> 4) + 6], xmminput[6]);
+    xmminput[7] = _mm_xor_si128(longoutput[(i >> 4) + 7], xmminput[7]);
+
+#if defined(AESNI)
+    cn_slow_hash_rounds_aesni(xmminput, expkey);
+#else
+    cn_slow_hash_rounds_noaesni(xmminput, expkey);
+#endif
+  }
+
+#if !defined(AESNI)
+  oaes_free((OAES_CTX **) &hctx->aes_ctx);
+#endif
+
+  memcpy(hctx->state.init, hctx->text, INIT_SIZE_BYTE);
+  hash_permutation(&hctx->state.hs);
+  extra_hashes[hctx->state.hs.b[0] & 3](&hctx->state, 200, hash);
+}
+
+static void
+#if defined(AESNI)
+cn_slow_hash_aesni
+#else
+cn_slow_hash_noaesni
+#endif
+(void *restrict context, const void *restrict data, size_t length, void *restrict hash)
+{
+#define ctx ((struct cn_ctx *) context)
+  size_t i;
+  __m128i b_x;
+  ALIGNED_DECL(uint64_t a[2], 16);
+
+#if defined(AESNI)
+  cn_slow_hash_explode_aesni(ctx, data, length);
+#else
+  cn_slow_hash_explode_noaesni(ctx, data, length);
+#endif
 
   b_x = _mm_load_si128((__m128i *)ctx->b);
   a[0] = ctx->a[0];
@@ -130,59 +220,10 @@ cn_slow_hash_noaesni
     //__builtin_prefetch(&ctx->long_state[a[0] & 0x1FFFF0], 0, 3);
   }
 
-  memcpy(ctx->text, ctx->state.init, INIT_SIZE_BYTE);
-#if defined(AESNI)
-  memcpy(ExpandedKey, &ctx->state.hs.b[32], AES_KEY_SIZE);
-  ExpandAESKey256(ExpandedKey);
-#else
-  oaes_key_import_data(ctx->aes_ctx, &ctx->state.hs.b[32], AES_KEY_SIZE);
-  memcpy(ExpandedKey, ctx->aes_ctx->key->exp_data, ctx->aes_ctx->key->exp_data_len);
-#endif
-
-  //for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
-  //    aesni_parallel_xor(&ctx->text, ExpandedKey, &ctx->long_state[i]);
-
-  for (i = 0; likely(i < MEMORY); i += INIT_SIZE_BYTE)
-  {
-    xmminput[0] = _mm_xor_si128(longoutput[(i >> 4)], xmminput[0]);
-    xmminput[1] = _mm_xor_si128(longoutput[(i >> 4) + 1], xmminput[1]);
-    xmminput[2] = _mm_xor_si128(longoutput[(i >> 4) + 2], xmminput[2]);
-    xmminput[3] = _mm_xor_si128(longoutput[(i >> 4) + 3], xmminput[3]);
-    xmminput[4] = _mm_xor_si128(longoutput[(i >> 4) + 4], xmminput[4]);
-    xmminput[5] = _mm_xor_si128(longoutput[(i >> 4) + 5], xmminput[5]);
-    xmminput[6] = _mm_xor_si128(longoutput[(i >> 4) + 6], xmminput[6]);
-    xmminput[7] = _mm_xor_si128(longoutput[(i >> 4) + 7], xmminput[7]);
-
 #if defined(AESNI)
-    for(size_t j = 0; j < 10; j++)
-    {
-      xmminput[0] = _mm_aesenc_si128(xmminput[0], expkey[j]);
-      xmminput[1] = _mm_aesenc_si128(xmminput[1], expkey[j]);
-      xmminput[2] = _mm_aesenc_si128(xmminput[2], expkey[j]);
-      xmminput[3] = _mm_aesenc_si128(xmminput[3], expkey[j]);
-      xmminput[4] = _mm_aesenc_si128(xmminput[4], expkey[j]);
-      xmminput[5] = _mm_aesenc_si128(xmminput[5], expkey[j]);
-      xmminput[6] = _mm_aesenc_si128(xmminput[6], expkey[j]);
-      xmminput[7] = _mm_aesenc_si128(xmminput[7], expkey[j]);
-    }
+  cn_slow_hash_implode_aesni(ctx, hash);
 #else
-    aesb_pseudo_round((uint8_t *) &xmminput[0], (uint8_t *) &xmminput[0], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[1], (uint8_t *) &xmminput[1], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[2], (uint8_t *) &xmminput[2], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[3], (uint8_t *) &xmminput[3], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[4], (uint8_t *) &xmminput[4], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[5], (uint8_t *) &xmminput[5], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[6], (uint8_t *) &xmminput[6], (uint8_t *) expkey);
-    aesb_pseudo_round((uint8_t *) &xmminput[7], (uint8_t *) &xmminput[7], (uint8_t *) expkey);
+  cn_slow_hash_implode_noaesni(ctx, hash);
 #endif
-
-  }
-
-#if !defined(AESNI)
-  oaes_free((OAES_CTX **) &ctx->aes_ctx);
-#endif
-
-  memcpy(ctx->state.init, ctx->text, INIT_SIZE_BYTE);
-  hash_permutation(&ctx->state.hs);
-  extra_hashes[ctx->state.hs.b[0] & 3](&ctx->state, 200, hash);
+#undef ctx
 }
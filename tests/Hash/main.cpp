@@ -7,6 +7,7 @@
 #include <iomanip>
 #include <ios>
 #include <string>
+#include <vector>
 
 #include "crypto/hash.h"
 #include "../Io.h"
@@ -15,6 +16,42 @@ using namespace std;
 typedef Crypto::Hash chash;
 
 Crypto::cn_context *context;
+Crypto::cn_context *contexts;
+
+// Hashes the input twice in a batch of 2 * ways - 1 inputs, first and last, so that both a full batch and a shorter
+// remainder are used. The other inputs are checked against the single hash.
+static void slow_hash_multi(size_t ways, const void *data, size_t length, char *hash) {
+  const size_t count = 2 * ways - 1;
+  std::vector<std::string> others(count);
+  std::vector<const void *> inputs(count);
+  std::vector<size_t> lengths(count);
+  std::vector<chash> results(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (i == 0 || i == count - 1) {
+      inputs[i] = data;
+      lengths[i] = length;
+    } else {
+      others[i] = "batch input " + std::to_string(i);
+      inputs[i] = others[i].data();
+      lengths[i] = others[i].size();
+    }
+  }
+
+  cn_slow_hash(contexts, ways, inputs.data(), lengths.data(), results.data(), count);
+  for (size_t i = 1; i < count - 1; ++i) {
+    chash expected;
+    cn_slow_hash(*context, inputs[i], lengths[i], expected);
+    if (results[i] != expected) {
+      throw ios_base::failure("Batch hash mismatch on input " + std::to_string(i));
+    }
+  }
+
+  if (results[0] != results[count - 1]) {
+    throw ios_base::failure("Batch hash mismatch between full batch and remainder");
+  }
+
+  *reinterpret_cast<chash *>(hash) = results[0];
+}
 
 extern "C" {
 #ifdef _MSC_VER
@@ -31,13 +68,22 @@ extern "C" {
   static void slow_hash(const void *data, size_t length, char *hash) {
     cn_slow_hash(*context, data, length, *reinterpret_cast<chash *>(hash));
   }
+
+  static void slow_hash_2way(const void *data, size_t length, char *hash) {
+    slow_hash_multi(2, data, length, hash);
+  }
+
+  static void slow_hash_4way(const void *data, size_t length, char *hash) {
+    slow_hash_multi(4, data, length, hash);
+  }
 }
 
 extern "C" typedef void hash_f(const void *, size_t, char *);
 struct hash_func {
   const string name;
   hash_f &f;
-} hashes[] = {{"fast", Crypto::cn_fast_hash}, {"slow", slow_hash}, {"tree", hash_tree},
+} hashes[] = {{"fast", Crypto::cn_fast_hash}, {"slow", slow_hash}, {"slow-2way", slow_hash_2way},
+  {"slow-4way", slow_hash_4way}, {"tree", hash_tree},
   {"extra-blake", Crypto::hash_extra_blake}, {"extra-groestl", Crypto::hash_extra_groestl},
   {"extra-jh", Crypto::hash_extra_jh}, {"extra-skein", Crypto::hash_extra_skein}};
 
@@ -63,8 +109,9 @@ int main(int argc, char *argv[]) {
       break;
     }
   }
-  if (f == slow_hash) {
+  if (f == slow_hash || f == slow_hash_2way || f == slow_hash_4way) {
     context = new Crypto::cn_context();
+    contexts = new Crypto::cn_context[Crypto::SLOW_HASH_MAX_WAYS];
   }
   input.open(argv[2], ios_base::in);
   for (;;) {
@@ -206,13 +206,15 @@ TEST_F(IntegrationTest, BlockPropagationSpeed) {
 
     for (size_t blockNumber = 0; blockNumber < BLOCKS_COUNT; ++blockNumber) {
       uint32_t localHeight = localObserver.waitLastKnownBlockHeightUpdated();
+      auto minedTime = std::chrono::steady_clock::now();
       uint32_t remoteHeight = 0;
 
       while (remoteHeight != localHeight) {
         ASSERT_TRUE(remoteObserver.waitLastKnownBlockHeightUpdated(std::chrono::milliseconds(5000), remoteHeight));
       }
 
-      logger(INFO) << "Iteration " << blockNumber + 1 << ": " << "height = " << localHeight;
+      auto propagationTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - minedTime);
+      logger(INFO) << "Iteration " << blockNumber + 1 << ": " << "height = " << localHeight << ", propagated in " << propagationTime.count() << " ms";
     }
 
     nodeDaemons.front()->stopMining();
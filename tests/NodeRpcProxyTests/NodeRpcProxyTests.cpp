@@ -3,6 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 #include <thread>
 
 #include <Logging/LoggerRef.h>
@@ -59,6 +62,57 @@ private:
   NodeRpcProxy& m_nodeProxy;
 };
 
+// Sends requestCount independent requests at once and reports the average wallet-side latency
+// and the request throughput over connectionCount connections
+void measureRequests(ILogger& log, size_t connectionCount, size_t requestCount) {
+  LoggerRef logger(log, "measureRequests");
+  NodeRpcProxy nodeProxy("127.0.0.1", 18081, connectionCount);
+
+  std::promise<std::error_code> initPromise;
+  nodeProxy.init([&](std::error_code ec) { initPromise.set_value(ec); });
+  std::error_code initError = initPromise.get_future().get();
+  if (initError) {
+    logger(ERROR) << "init error: " << initError.message() << ':' << initError.value();
+    return;
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  typedef std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount> Outs;
+
+  std::mutex mutex;
+  std::condition_variable completed;
+  size_t completedCount = 0;
+  size_t failedCount = 0;
+  Clock::duration totalLatency = Clock::duration::zero();
+
+  std::vector<Outs> outs(requestCount);
+  auto start = Clock::now();
+  for (size_t i = 0; i < requestCount; ++i) {
+    auto requestStart = Clock::now();
+    nodeProxy.getRandomOutsByAmounts({ 100000000 }, 10, outs[i], [&, requestStart](std::error_code ec) {
+      auto latency = Clock::now() - requestStart;
+      std::lock_guard<std::mutex> lock(mutex);
+      totalLatency += latency;
+      failedCount += ec ? 1 : 0;
+      if (++completedCount == requestCount) {
+        completed.notify_one();
+      }
+    });
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    completed.wait(lock, [&] { return completedCount == requestCount; });
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+  auto averageLatency = std::chrono::duration_cast<std::chrono::microseconds>(totalLatency).count() / static_cast<int64_t>(requestCount);
+  logger(INFO, BRIGHT_GREEN) << connectionCount << " connection(s), " << requestCount << " requests (" << failedCount << " failed): " <<
+    "average latency " << averageLatency << " us, " << (requestCount * 1000000 / std::max<int64_t>(elapsed, 1)) << " requests/s";
+
+  nodeProxy.shutdown();
+}
+
 int main(int argc, const char** argv) {
 
   Logging::ConsoleLogger log;
@@ -136,4 +190,8 @@ int main(int argc, const char** argv) {
   });
 
   std::this_thread::sleep_for(std::chrono::seconds(60));
+
+  for (size_t connectionCount : { static_cast<size_t>(1), NodeRpcProxy::DEFAULT_CONNECTION_COUNT, 2 * NodeRpcProxy::DEFAULT_CONNECTION_COUNT }) {
+    measureRequests(log, connectionCount, 1000);
+  }
 }
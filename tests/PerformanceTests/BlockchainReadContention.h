@@ -0,0 +1,202 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/StringTools.h"
+#include "FortressCore/Account.h"
+#include "FortressCore/Blockchain.h"
+#include "FortressCore/Checkpoints.h"
+#include "FortressCore/Currency.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/FortressTools.h"
+#include "FortressCore/ITimeProvider.h"
+#include "FortressCore/TransactionPool.h"
+#include "Logging/LoggerGroup.h"
+
+#include "../TestGenerator/TestGenerator.h"
+
+#include "PerformanceUtils.h"
+
+// Runs concurrent Blockchain queries (haveTransaction, getBlockIdByHeight, getBlockHeight, getBlockByHash) over a
+// populated chain while the readers take turns pushing new blocks through addNewBlock. The same amount of queries
+// is split between a_thread_count readers, so with shared readers elapsed time should go down as threads are added.
+// Without them every call is serialized on an outer mutex as it was with the exclusive Blockchain lock, and elapsed
+// time should stay flat or grow.
+template<size_t a_thread_count, bool a_shared_readers>
+class test_blockchain_read_contention {
+  static_assert(0 < a_thread_count, "thread_count must be greater than 0");
+
+public:
+  static const size_t loop_count = 10;
+  static const uint32_t chain_size = 200;
+  static const size_t queries_per_call = 1000000;
+  static const size_t queries_per_commit = 100000;
+  static const size_t commit_count = loop_count * queries_per_call / queries_per_commit;
+
+  test_blockchain_read_contention() :
+    m_currency(Fortress::CurrencyBuilder(m_logger).currency()),
+    m_pool(m_currency, m_blockchain, m_timeProvider, m_logger),
+    m_blockchain(m_currency, m_pool, m_logger),
+    m_committed(chain_size),
+    m_initialized(false) {
+  }
+
+  ~test_blockchain_read_contention() {
+    if (m_initialized) {
+      m_blockchain.deinit();
+    }
+
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(m_dataDir, ignoredErrorCode);
+  }
+
+  bool init() {
+    m_dataDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("blockchain_read_contention_%%%%%%%%");
+    if (!boost::filesystem::create_directories(m_dataDir) || !m_blockchain.init(m_dataDir.string(), false)) {
+      return false;
+    }
+
+    m_initialized = true;
+
+    Fortress::AccountBase miner;
+    miner.generate();
+    test_generator generator(m_currency);
+    std::vector<size_t> blockSizes;
+    const Fortress::Block& genesis = m_currency.genesisBlock();
+    generator.addBlock(genesis, 0, 0, blockSizes, 0);
+
+    m_blocks.push_back(genesis);
+    while (m_blocks.size() < chain_size + commit_count) {
+      Fortress::Block block;
+      if (!generator.constructBlock(block, m_blocks.back(), miner)) {
+        return false;
+      }
+
+      m_blocks.push_back(block);
+    }
+
+    for (auto& block : m_blocks) {
+      m_blockHashes.push_back(Fortress::get_block_hash(block));
+      m_baseTransactionHashes.push_back(Fortress::getObjectHash(block.baseTransaction));
+    }
+
+    // a checkpoint on the last block spares the pushes the proof of work check, which would outweigh the queries
+    Fortress::Checkpoints checkpoints(m_logger);
+    checkpoints.add_checkpoint(static_cast<uint32_t>(m_blocks.size() - 1), Common::podToHex(m_blockHashes.back()));
+    m_blockchain.setCheckpoints(std::move(checkpoints));
+
+    for (uint32_t height = 1; height < chain_size; ++height) {
+      if (!pushBlock(height)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool test() {
+    std::atomic<size_t> found(0);
+    std::atomic<bool> pushed(true);
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < a_thread_count; ++t) {
+      readers.emplace_back([this, t, &found, &pushed] {
+        reset_thread_affinity();
+        size_t localFound = 0;
+        for (size_t i = t; i < queries_per_call; i += a_thread_count) {
+          if (i % queries_per_commit == 0 && !commit()) {
+            pushed = false;
+          }
+
+          localFound += query(static_cast<uint32_t>(i));
+        }
+
+        found += localFound;
+      });
+    }
+
+    for (auto& reader : readers) {
+      reader.join();
+    }
+
+    return pushed && found == queries_per_call;
+  }
+
+private:
+  Logging::LoggerGroup m_logger;
+  Fortress::Currency m_currency;
+  Fortress::RealTimeProvider m_timeProvider;
+  Fortress::tx_memory_pool m_pool;
+  Fortress::Blockchain m_blockchain;
+  boost::filesystem::path m_dataDir;
+  std::vector<Fortress::Block> m_blocks;
+  std::vector<Crypto::Hash> m_blockHashes;
+  std::vector<Crypto::Hash> m_baseTransactionHashes;
+  // heights below it are in the chain, pushes are ordered by m_commitMutex
+  std::atomic<uint32_t> m_committed;
+  std::mutex m_commitMutex;
+  std::recursive_mutex m_exclusiveMutex;
+  bool m_initialized;
+
+  bool pushBlock(uint32_t height) {
+    if (height >= m_blocks.size()) {
+      return false;
+    }
+
+    Fortress::block_verification_context bvc = boost::value_initialized<Fortress::block_verification_context>();
+    return m_blockchain.addNewBlock(m_blocks[height], bvc) && bvc.m_added_to_main_chain;
+  }
+
+  size_t query(uint32_t i) {
+    if (a_shared_readers) {
+      return queryBlockchain(i);
+    } else {
+      std::lock_guard<std::recursive_mutex> lock(m_exclusiveMutex);
+      return queryBlockchain(i);
+    }
+  }
+
+  size_t queryBlockchain(uint32_t i) {
+    uint32_t height = i % m_committed.load();
+    switch (i % 4) {
+    case 0:
+      return m_blockchain.haveTransaction(m_baseTransactionHashes[height]) ? 1 : 0;
+    case 1:
+      return m_blockchain.getBlockIdByHeight(height) == m_blockHashes[height] ? 1 : 0;
+    case 2: {
+      uint32_t blockHeight;
+      return m_blockchain.getBlockHeight(m_blockHashes[height], blockHeight) && blockHeight == height ? 1 : 0;
+    }
+    default: {
+      Fortress::Block block;
+      return m_blockchain.getBlockByHash(m_blockHashes[height], block) && block.nonce == m_blocks[height].nonce ? 1 : 0;
+    }
+    }
+  }
+
+  bool commit() {
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    uint32_t height = m_committed.load();
+    bool added;
+    if (a_shared_readers) {
+      added = pushBlock(height);
+    } else {
+      std::lock_guard<std::recursive_mutex> lock(m_exclusiveMutex);
+      added = pushBlock(height);
+    }
+
+    if (added) {
+      m_committed = height + 1;
+    }
+
+    return added;
+  }
+};
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <string>
+
 #include "Common/StringTools.h"
 #include "crypto/crypto.h"
 #include "FortressCore/FortressBasic.h"
@@ -44,3 +47,36 @@ private:
   Crypto::Hash m_expected_hash;
   Crypto::cn_context m_context;
 };
+
+// One call hashes inputs_count inputs, a_ways of them side by side, so the hashrate of one core is
+// 1000 * inputs_count / (time per call).
+template<size_t a_ways>
+class test_cn_slow_hash_multi {
+public:
+  static const size_t loop_count = 10;
+  static const size_t inputs_count = 4;
+
+  bool init() {
+    for (size_t i = 0; i < inputs_count; ++i) {
+      m_inputs[i] = "batch input " + std::to_string(i);
+      m_data[i] = m_inputs[i].data();
+      m_lengths[i] = m_inputs[i].size();
+      Crypto::cn_slow_hash(m_contexts[0], m_data[i], m_lengths[i], m_expected_hashes[i]);
+    }
+
+    return test();
+  }
+
+  bool test() {
+    Crypto::Hash hashes[inputs_count];
+    Crypto::cn_slow_hash(m_contexts, a_ways, m_data, m_lengths, hashes, inputs_count);
+    return std::equal(hashes, hashes + inputs_count, m_expected_hashes);
+  }
+
+private:
+  std::string m_inputs[inputs_count];
+  const void* m_data[inputs_count];
+  size_t m_lengths[inputs_count];
+  Crypto::Hash m_expected_hashes[inputs_count];
+  Crypto::cn_context m_contexts[a_ways];
+};
@@ -0,0 +1,55 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <vector>
+
+#include "FortressCore/RandomOutputsIndex.h"
+
+#include "PerformanceUtils.h"
+
+// One call serves a getrandom_outs request for a_amount_count amounts with a_mixin mixins each,
+// i.e. a_mixin + 1 outputs per amount, against a chain where every amount has outputs_per_amount outputs.
+template<size_t a_amount_count, size_t a_mixin>
+class test_get_random_outputs {
+  static_assert(0 < a_amount_count, "amount_count must be greater than 0");
+
+public:
+  static const size_t loop_count = 1000;
+  static const uint32_t mature_depth = 10;
+  static const uint32_t chain_size = 100000;
+  static const uint32_t outputs_per_amount = 20000;
+
+  test_get_random_outputs() : m_index(mature_depth) {
+  }
+
+  bool init() {
+    for (uint64_t amount = 1; amount <= a_amount_count; ++amount) {
+      for (uint32_t i = 0; i < outputs_per_amount; ++i) {
+        // every hundredth output has an unlock time beyond its maturity and has to be checked
+        m_index.push(amount, static_cast<uint32_t>(uint64_t(i) * chain_size / outputs_per_amount), i % 100 == 0);
+      }
+    }
+
+    m_index.setChainSize(chain_size);
+    m_indexes.reserve(a_amount_count * (a_mixin + 1));
+    return true;
+  }
+
+  bool test() {
+    m_indexes.clear();
+    for (uint64_t amount = 1; amount <= a_amount_count; ++amount) {
+      if (m_index.sample(amount, a_mixin + 1, m_indexes, [](uint32_t index) { return index % 200 == 0; }) != a_mixin + 1) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  Fortress::RandomOutputsIndex m_index;
+  std::vector<uint32_t> m_indexes;
+};
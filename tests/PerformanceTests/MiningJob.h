@@ -0,0 +1,58 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include "FortressConfig.h"
+#include "FortressCore/FortressBasic.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/MiningJob.h"
+
+// One call hashes one nonce of a block template with a_transaction_count transactions, so the hashrate of a single
+// thread is 1000 / (time per call). With a_use_mining_job the hashing blob is serialized once and only the nonce is
+// patched, otherwise get_block_longhash rebuilds it for every nonce.
+template<size_t a_transaction_count, bool a_use_mining_job>
+class test_mining_hash {
+public:
+  static const size_t loop_count = 100;
+
+  bool init() {
+    m_block.majorVersion = Fortress::BLOCK_MAJOR_VERSION_1;
+    m_block.minorVersion = Fortress::BLOCK_MINOR_VERSION_0;
+    m_block.timestamp = 1451606400;
+    m_block.nonce = 0;
+    m_block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+    m_block.baseTransaction.version = Fortress::CURRENT_TRANSACTION_VERSION;
+    m_block.baseTransaction.unlockTime = 0;
+    m_block.baseTransaction.inputs.push_back(Fortress::BaseInput{ 1 });
+    for (size_t i = 0; i < a_transaction_count; ++i) {
+      m_block.transactionHashes.push_back(Crypto::rand<Crypto::Hash>());
+    }
+
+    m_job = Fortress::MiningJob(m_block);
+
+    Crypto::Hash expected;
+    Crypto::Hash actual;
+    m_job.getLongHash(m_context, actual);
+    return Fortress::get_block_longhash(m_context, m_block, expected) && expected == actual;
+  }
+
+  bool test() {
+    Crypto::Hash hash;
+    if (a_use_mining_job) {
+      m_job.setNonce(m_job.getNonce() + 1);
+      m_job.getLongHash(m_context, hash);
+      return true;
+    }
+
+    ++m_block.nonce;
+    return Fortress::get_block_longhash(m_context, m_block, hash);
+  }
+
+private:
+  Fortress::Block m_block;
+  Fortress::MiningJob m_job;
+  Crypto::cn_context m_context;
+};
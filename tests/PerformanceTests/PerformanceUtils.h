@@ -34,6 +34,22 @@ void set_process_affinity(int core)
 #endif
 }
 
+// Lets a worker thread run on any core, undoing the affinity inherited from the main thread
+void reset_thread_affinity()
+{
+#if defined(__APPLE__) || defined(BOOST_WINDOWS)
+  return;
+#elif defined(BOOST_HAS_PTHREADS)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int i = 0; i < CPU_SETSIZE; ++i)
+  {
+    CPU_SET(i, &cpuset);
+  }
+  ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset);
+#endif
+}
+
 void set_thread_high_priority()
 {
 #if defined(__APPLE__)
@@ -0,0 +1,64 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "FortressCore/FortressBasic.h"
+
+#include "SingleTransactionTestBase.h"
+
+// One call scans a_outputs_count output keys of a transaction against the view key, either one by one with
+// underive_public_key or in one batch with underive_public_keys.
+template<size_t a_outputs_count, bool a_batched>
+class test_underive_public_keys : public single_tx_test_base
+{
+public:
+  static const size_t loop_count = 100;
+
+  bool init()
+  {
+    if (!single_tx_test_base::init())
+      return false;
+
+    Crypto::generate_key_derivation(m_tx_pub_key, m_bob.getAccountKeys().viewSecretKey, m_key_derivation);
+    const Crypto::PublicKey& spendPublicKey = m_bob.getAccountKeys().address.spendPublicKey;
+
+    m_output_keys.resize(a_outputs_count);
+    m_output_indexes.resize(a_outputs_count);
+    m_bases.resize(a_outputs_count);
+    m_valid.reset(new bool[a_outputs_count]);
+    for (size_t i = 0; i < a_outputs_count; ++i) {
+      m_output_indexes[i] = i;
+      if (!Crypto::derive_public_key(m_key_derivation, i, spendPublicKey, m_output_keys[i]))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    if (a_batched) {
+      Crypto::underive_public_keys(m_key_derivation, m_output_indexes.data(), m_output_keys.data(), a_outputs_count,
+        m_bases.data(), m_valid.get());
+    } else {
+      for (size_t i = 0; i < a_outputs_count; ++i) {
+        m_valid[i] = Crypto::underive_public_key(m_key_derivation, i, m_output_keys[i], m_bases[i]);
+      }
+    }
+
+    return m_bases[0] == m_bob.getAccountKeys().address.spendPublicKey;
+  }
+
+private:
+  Crypto::KeyDerivation m_key_derivation;
+  std::vector<Crypto::PublicKey> m_output_keys;
+  std::vector<size_t> m_output_indexes;
+  std::vector<Crypto::PublicKey> m_bases;
+  std::unique_ptr<bool[]> m_valid;
+};
@@ -0,0 +1,73 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "FortressCore/Account.h"
+#include "FortressCore/FortressBasic.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/FortressTools.h"
+#include "FortressCore/RingSignatureVerifier.h"
+#include "crypto/crypto.h"
+
+#include "MultiTransactionTestBase.h"
+#include "PerformanceUtils.h"
+
+// One call verifies the ring signatures of a block with inputs_count inputs of ring size 10,
+// so blocks per second are 1000 / (time per call).
+template<size_t a_thread_count>
+class test_verify_block_signatures : private multi_tx_test_base<10>
+{
+  static_assert(0 < a_thread_count, "thread_count must be greater than 0");
+
+public:
+  static const size_t loop_count = 20;
+  static const size_t inputs_count = 100;
+
+  typedef multi_tx_test_base<10> base_class;
+
+  bool init()
+  {
+    using namespace Fortress;
+
+    if (!base_class::init())
+      return false;
+
+    m_alice.generate();
+
+    std::vector<TransactionDestinationEntry> destinations;
+    destinations.push_back(TransactionDestinationEntry(this->m_source_amount, m_alice.getAccountKeys().address));
+
+    Transaction tx;
+    if (!constructTransaction(this->m_miners[this->real_source_idx].getAccountKeys(), this->m_sources, destinations, std::vector<uint8_t>(), tx, 0, this->m_logger))
+      return false;
+
+    RingSignatureVerifier::Job job;
+    getObjectHash(*static_cast<TransactionPrefix*>(&tx), job.prefixHash);
+    job.keyImage = boost::get<KeyInput>(tx.inputs[0]).keyImage;
+    job.keys.assign(this->m_public_keys, this->m_public_keys + ring_size);
+    job.signatures = tx.signatures[0];
+    m_jobs.assign(inputs_count, job);
+
+    // worker threads inherit affinity of the thread that creates them
+    reset_thread_affinity();
+    m_verifier.reset(new RingSignatureVerifier(a_thread_count));
+    set_process_affinity(1);
+
+    return true;
+  }
+
+  bool test()
+  {
+    return m_verifier->verify(m_jobs) == m_jobs.size();
+  }
+
+private:
+  Fortress::AccountBase m_alice;
+  std::vector<Fortress::RingSignatureVerifier::Job> m_jobs;
+  std::unique_ptr<Fortress::RingSignatureVerifier> m_verifier;
+};
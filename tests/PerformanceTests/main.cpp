@@ -6,6 +6,7 @@
 #include "PerformanceUtils.h"
 
 // tests
+#include "BlockchainReadContention.h"
 #include "ConstructTransaction.h"
 #include "CheckRingSignature.h"
 #include "FortressSlowHash.h"
@@ -14,7 +15,11 @@
 #include "GenerateKeyDerivation.h"
 #include "GenerateKeyImage.h"
 #include "GenerateKeyImageHelper.h"
+#include "GetRandomOutputs.h"
 #include "IsOutToAccount.h"
+#include "MiningJob.h"
+#include "UnderivePublicKeys.h"
+#include "VerifyBlockSignatures.h"
 
 int main(int argc, char** argv)
 {
@@ -50,14 +55,43 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(test_check_ring_signature, 10);
   TEST_PERFORMANCE1(test_check_ring_signature, 100);
 
+  TEST_PERFORMANCE1(test_verify_block_signatures, 1);
+  TEST_PERFORMANCE1(test_verify_block_signatures, 2);
+  TEST_PERFORMANCE1(test_verify_block_signatures, 4);
+  TEST_PERFORMANCE1(test_verify_block_signatures, 8);
+
   TEST_PERFORMANCE0(test_is_out_to_acc);
   TEST_PERFORMANCE0(test_generate_key_image_helper);
   TEST_PERFORMANCE0(test_generate_key_derivation);
   TEST_PERFORMANCE0(test_generate_key_image);
   TEST_PERFORMANCE0(test_derive_public_key);
   TEST_PERFORMANCE0(test_derive_secret_key);
+  TEST_PERFORMANCE2(test_underive_public_keys, 1, false);
+  TEST_PERFORMANCE2(test_underive_public_keys, 1, true);
+  TEST_PERFORMANCE2(test_underive_public_keys, 16, false);
+  TEST_PERFORMANCE2(test_underive_public_keys, 16, true);
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 1);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 2);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 4);
+
+  TEST_PERFORMANCE2(test_mining_hash, 1, false);
+  TEST_PERFORMANCE2(test_mining_hash, 1, true);
+  TEST_PERFORMANCE2(test_mining_hash, 100, false);
+  TEST_PERFORMANCE2(test_mining_hash, 100, true);
+
+  TEST_PERFORMANCE2(test_get_random_outputs, 1, 10);
+  TEST_PERFORMANCE2(test_get_random_outputs, 100, 10);
+
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 1, false);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 2, false);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 4, false);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 8, false);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 1, true);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 2, true);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 4, true);
+  TEST_PERFORMANCE2(test_blockchain_read_contention, 8, true);
 
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
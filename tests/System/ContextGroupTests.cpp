@@ -386,3 +386,26 @@ TEST(ContextGroupTests, ContextGroupIsWaitingNestedSpawnsEvenThoughItWasInterrup
   ASSERT_FALSE(contextFinished);
   ASSERT_TRUE(nestedContextFinished);
 }
+
+#ifdef __linux__
+TEST(ContextGroupTests, spawnedContextGetsRequestedStackSize) {
+  Dispatcher dispatcher;
+  size_t checksum = 0;
+  {
+    ContextGroup cg1(dispatcher);
+    cg1.spawn([&] {
+      volatile uint8_t buffer[512 * 1024];
+      for (size_t i = 0; i < sizeof buffer; i += 4096) {
+        buffer[i] = static_cast<uint8_t>(i >> 12);
+        checksum += buffer[i];
+      }
+    }, 1024 * 1024);
+
+    cg1.spawn([&] {
+      ++checksum;
+    });
+  }
+
+  ASSERT_EQ(8129, checksum);
+}
+#endif
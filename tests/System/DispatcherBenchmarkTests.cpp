@@ -0,0 +1,256 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/Ipv4Address.h>
+#include <System/TcpConnection.h>
+#include <System/TcpConnector.h>
+#include <System/TcpListener.h>
+#include <gtest/gtest.h>
+
+#ifdef __linux__
+#include <ucontext.h>
+#endif
+
+using namespace System;
+
+namespace {
+
+const Ipv4Address LISTEN_ADDRESS("127.0.0.1");
+const uint16_t LISTEN_PORT = 6667;
+const size_t CONNECTION_COUNT = 64;
+const size_t ROUND_TRIP_COUNT = 500;
+const size_t SPAWN_COUNT = 100000;
+const size_t SWITCH_COUNT = 1000000;
+const size_t RELAY_CONNECTION_COUNT = 16;
+const size_t RELAY_COUNT = 10;
+const size_t RELAY_HEADER_SIZE = 33;
+const size_t RELAY_PAYLOAD_SIZE = 1024 * 1024;
+
+// Ping-pongs one byte over many connections at once, so every read blocks and the
+// dispatcher has many ready events to handle per wakeup. Returns events per second.
+double measureEventsPerSecond(Dispatcher& dispatcher) {
+  TcpListener listener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT);
+  std::vector<TcpConnection> clients;
+  std::vector<TcpConnection> servers;
+  for (size_t i = 0; i < CONNECTION_COUNT; ++i) {
+    clients.emplace_back(TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT));
+    servers.emplace_back(listener.accept());
+  }
+
+  size_t events = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < CONNECTION_COUNT; ++i) {
+      contextGroup.spawn([&, i] {
+        uint8_t byte = 0;
+        for (size_t j = 0; j < ROUND_TRIP_COUNT; ++j) {
+          ASSERT_EQ(1, servers[i].read(&byte, 1));
+          ASSERT_EQ(1, servers[i].write(&byte, 1));
+          ++events;
+        }
+      });
+
+      contextGroup.spawn([&, i] {
+        uint8_t byte = static_cast<uint8_t>(i);
+        for (size_t j = 0; j < ROUND_TRIP_COUNT; ++j) {
+          ASSERT_EQ(1, clients[i].write(&byte, 1));
+          ASSERT_EQ(1, clients[i].read(&byte, 1));
+          ASSERT_EQ(static_cast<uint8_t>(i), byte);
+          ++events;
+        }
+      });
+    }
+
+    contextGroup.wait();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(2 * CONNECTION_COUNT * ROUND_TRIP_COUNT, events);
+  return events / elapsed.count();
+}
+
+double measureSwitchesPerSecond(Dispatcher& dispatcher) {
+  size_t switches = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < 2; ++i) {
+      contextGroup.spawn([&] {
+        while (switches < SWITCH_COUNT) {
+          ++switches;
+          dispatcher.pushContext(dispatcher.getCurrentContext());
+          dispatcher.dispatch();
+        }
+      });
+    }
+
+    contextGroup.wait();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return switches / elapsed.count();
+}
+
+void writeAll(TcpConnection& connection, std::vector<TcpConnection::Buffer> buffers) {
+  size_t first = 0;
+  while (first < buffers.size()) {
+    size_t transferred = connection.writeBuffers(&buffers[first], buffers.size() - first);
+    while (first < buffers.size() && transferred >= buffers[first].size) {
+      transferred -= buffers[first].size;
+      ++first;
+    }
+
+    if (first < buffers.size()) {
+      buffers[first].data += transferred;
+      buffers[first].size -= transferred;
+    }
+  }
+}
+
+// Relays the same framed payload to many connections, either building a framed copy for every
+// connection or gathering one shared header and payload. Returns the relay time in seconds.
+double measureRelay(Dispatcher& dispatcher, bool shared, size_t& copiedBytes) {
+  TcpListener listener(dispatcher, LISTEN_ADDRESS, LISTEN_PORT);
+  std::vector<TcpConnection> clients;
+  std::vector<TcpConnection> servers;
+  for (size_t i = 0; i < RELAY_CONNECTION_COUNT; ++i) {
+    clients.emplace_back(TcpConnector(dispatcher).connect(LISTEN_ADDRESS, LISTEN_PORT));
+    servers.emplace_back(listener.accept());
+  }
+
+  std::vector<uint8_t> header(RELAY_HEADER_SIZE, 1);
+  std::vector<uint8_t> payload(RELAY_PAYLOAD_SIZE, 2);
+  copiedBytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < RELAY_CONNECTION_COUNT; ++i) {
+      contextGroup.spawn([&, i] {
+        std::vector<uint8_t> buffer(64 * 1024);
+        size_t left = RELAY_COUNT * (RELAY_HEADER_SIZE + RELAY_PAYLOAD_SIZE);
+        while (left > 0) {
+          size_t transferred = servers[i].read(buffer.data(), buffer.size());
+          ASSERT_NE(0, transferred);
+          left -= transferred;
+        }
+      });
+
+      contextGroup.spawn([&, i] {
+        for (size_t j = 0; j < RELAY_COUNT; ++j) {
+          if (shared) {
+            writeAll(clients[i], { { header.data(), header.size() }, { payload.data(), payload.size() } });
+          } else {
+            std::vector<uint8_t> message;
+            message.reserve(header.size() + payload.size());
+            message.insert(message.end(), header.begin(), header.end());
+            message.insert(message.end(), payload.begin(), payload.end());
+            copiedBytes += message.size();
+            writeAll(clients[i], { { message.data(), message.size() } });
+          }
+        }
+      });
+    }
+
+    contextGroup.wait();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+#ifdef __linux__
+ucontext_t referenceContexts[2];
+size_t referenceSwitches;
+
+void referenceProcedure() {
+  for (;;) {
+    ++referenceSwitches;
+    swapcontext(&referenceContexts[1], &referenceContexts[0]);
+  }
+}
+
+// plain makecontext/swapcontext, which the dispatcher used before switching in user space
+double measureReferenceSwitchesPerSecond() {
+  std::vector<uint8_t> stack(64 * 1024);
+  getcontext(&referenceContexts[1]);
+  referenceContexts[1].uc_stack.ss_sp = stack.data();
+  referenceContexts[1].uc_stack.ss_size = stack.size();
+  referenceContexts[1].uc_link = nullptr;
+  makecontext(&referenceContexts[1], referenceProcedure, 0);
+
+  referenceSwitches = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (referenceSwitches < SWITCH_COUNT / 2) {
+    swapcontext(&referenceContexts[0], &referenceContexts[1]);
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return 2 * referenceSwitches / elapsed.count();
+}
+#endif
+
+}
+
+TEST(DispatcherBenchmarkTests, spawn) {
+  Dispatcher dispatcher;
+  size_t finished = 0;
+  auto start = std::chrono::steady_clock::now();
+  {
+    ContextGroup contextGroup(dispatcher);
+    for (size_t i = 0; i < SPAWN_COUNT; ++i) {
+      contextGroup.spawn([&] {
+        ++finished;
+      });
+
+      if (i % 1000 == 999) {
+        contextGroup.wait();
+      }
+    }
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_EQ(SPAWN_COUNT, finished);
+  std::cout << "spawn: " << static_cast<uint64_t>(SPAWN_COUNT / elapsed.count()) << " contexts/sec" << std::endl;
+}
+
+TEST(DispatcherBenchmarkTests, contextSwitch) {
+  Dispatcher dispatcher;
+  std::cout << "dispatcher: " << static_cast<uint64_t>(measureSwitchesPerSecond(dispatcher)) << " switches/sec" << std::endl;
+#ifdef __linux__
+  std::cout << "swapcontext: " << static_cast<uint64_t>(measureReferenceSwitchesPerSecond()) << " switches/sec" << std::endl;
+#endif
+}
+
+TEST(DispatcherBenchmarkTests, pingPong) {
+  Dispatcher dispatcher;
+  std::cout << "default backend: " << static_cast<uint64_t>(measureEventsPerSecond(dispatcher)) << " events/sec" << std::endl;
+}
+
+TEST(DispatcherBenchmarkTests, relay) {
+  Dispatcher dispatcher;
+  size_t copiedBytes;
+  double copied = measureRelay(dispatcher, false, copiedBytes);
+  std::cout << "relay with a copy per connection: " << static_cast<uint64_t>(copied * 1000) << " ms, " << copiedBytes << " bytes copied" << std::endl;
+  double gathered = measureRelay(dispatcher, true, copiedBytes);
+  std::cout << "relay with shared buffers: " << static_cast<uint64_t>(gathered * 1000) << " ms, " << copiedBytes << " bytes copied" << std::endl;
+}
+
+#ifdef __linux__
+TEST(DispatcherBenchmarkTests, pingPongIoUring) {
+  Dispatcher dispatcher(Dispatcher::Backend::IO_URING);
+  if (dispatcher.getBackend() != Dispatcher::Backend::IO_URING) {
+    std::cout << "io_uring is not available, skipped" << std::endl;
+    return;
+  }
+
+  std::cout << "io_uring backend: " << static_cast<uint64_t>(measureEventsPerSecond(dispatcher)) << " events/sec" << std::endl;
+}
+#endif
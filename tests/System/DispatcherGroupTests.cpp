@@ -0,0 +1,130 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <System/DispatcherGroup.h>
+#include <System/ContextGroup.h>
+#include <System/Dispatcher.h>
+#include <System/InterruptedException.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+using namespace System;
+
+class DispatcherGroupTests : public testing::Test {
+public:
+  Dispatcher dispatcher;
+};
+
+TEST_F(DispatcherGroupTests, groupHasRequestedDispatchers) {
+  DispatcherGroup group(3);
+  ASSERT_EQ(3, group.size());
+  std::set<Dispatcher*> dispatchers;
+  for (size_t i = 0; i < group.size(); ++i) {
+    dispatchers.insert(&group.getDispatcher(i));
+  }
+
+  ASSERT_EQ(3, dispatchers.size());
+  ASSERT_EQ(0, dispatchers.count(&dispatcher));
+}
+
+TEST_F(DispatcherGroupTests, nextDispatcherIsRoundRobin) {
+  DispatcherGroup group(3);
+  ASSERT_EQ(&group.getDispatcher(0), &group.nextDispatcher());
+  ASSERT_EQ(&group.getDispatcher(1), &group.nextDispatcher());
+  ASSERT_EQ(&group.getDispatcher(2), &group.nextDispatcher());
+  ASSERT_EQ(&group.getDispatcher(0), &group.nextDispatcher());
+}
+
+TEST_F(DispatcherGroupTests, zeroThreadsThrows) {
+  ASSERT_THROW(DispatcherGroup(0), std::invalid_argument);
+}
+
+TEST_F(DispatcherGroupTests, dispatchersRunOnOwnThreads) {
+  DispatcherGroup group(2);
+  std::thread::id ids[2];
+  for (size_t i = 0; i < 2; ++i) {
+    remoteInvoke(dispatcher, group.getDispatcher(i), [&] { ids[i] = std::this_thread::get_id(); });
+  }
+
+  ASSERT_NE(std::this_thread::get_id(), ids[0]);
+  ASSERT_NE(std::this_thread::get_id(), ids[1]);
+  ASSERT_NE(ids[0], ids[1]);
+}
+
+TEST_F(DispatcherGroupTests, remoteInvokeRethrowsException) {
+  DispatcherGroup group(1);
+  ASSERT_THROW(remoteInvoke(dispatcher, group.getDispatcher(0), [] { throw std::string("Hi there!"); }), std::string);
+  ASSERT_THROW(remoteInvoke(group.getDispatcher(0), [] { throw std::string("Hi there!"); }), std::string);
+}
+
+TEST_F(DispatcherGroupTests, remoteInvokeFromThreadWaitsForCompletion) {
+  DispatcherGroup group(1);
+  bool done = false;
+  remoteInvoke(group.getDispatcher(0), [&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    done = true;
+  });
+
+  ASSERT_TRUE(done);
+}
+
+TEST_F(DispatcherGroupTests, interruptDoesNotAbandonRemoteInvoke) {
+  DispatcherGroup group(1);
+  bool done = false;
+  ContextGroup contextGroup(dispatcher);
+  contextGroup.spawn([&] {
+    ASSERT_NO_THROW(remoteInvoke(dispatcher, group.getDispatcher(0), [&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      done = true;
+    }));
+
+    ASSERT_TRUE(done);
+    ASSERT_TRUE(dispatcher.interrupted());
+  });
+
+  contextGroup.interrupt();
+  contextGroup.wait();
+  ASSERT_TRUE(done);
+}
+
+TEST_F(DispatcherGroupTests, remoteInvokesRunInParallel) {
+  const size_t threadCount = 4;
+  DispatcherGroup group(threadCount);
+  std::atomic<size_t> running(0);
+  std::atomic<size_t> maxRunning(0);
+  ContextGroup contextGroup(dispatcher);
+  for (size_t i = 0; i < threadCount; ++i) {
+    contextGroup.spawn([&] {
+      remoteInvoke(dispatcher, group.nextDispatcher(), [&] {
+        size_t current = ++running;
+        size_t observed = maxRunning;
+        while (current > observed && !maxRunning.compare_exchange_weak(observed, current)) {
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        --running;
+      });
+    });
+  }
+
+  contextGroup.wait();
+  ASSERT_EQ(threadCount, maxRunning);
+}
+
+TEST_F(DispatcherGroupTests, stopFinishesPendingWork) {
+  std::atomic<bool> done(false);
+  {
+    DispatcherGroup group(1);
+    group.getDispatcher(0).remoteSpawn([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      done = true;
+    });
+  }
+
+  ASSERT_TRUE(done);
+}
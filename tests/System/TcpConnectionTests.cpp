@@ -262,6 +262,63 @@ TEST_F(TcpConnectionTests, sendBigChunk) {
   ASSERT_EQ(buf, incoming);
 }
 
+TEST_F(TcpConnectionTests, sendBigChunkWithWriteBuffers) {
+  connect();
+
+  std::vector<std::vector<uint8_t>> chunks;
+  std::vector<uint8_t> expected;
+  for (size_t i = 0; i < 200; ++i) {
+    std::vector<uint8_t> chunk(1 + (i * 7919) % (256 * 1024));
+    fillRandomBuf(chunk);
+    expected.insert(expected.end(), chunk.begin(), chunk.end());
+    chunks.push_back(std::move(chunk));
+  }
+
+  std::vector<uint8_t> incoming;
+  Event readComplete(dispatcher);
+
+  contextGroup.spawn([&]{
+    uint8_t readBuf[1024];
+    size_t readSize;
+    while ((readSize = connection2.read(readBuf, sizeof(readBuf))) > 0) {
+      incoming.insert(incoming.end(), readBuf, readBuf + readSize);
+    }
+
+    readComplete.set();
+  });
+
+  contextGroup.spawn([&]{
+    std::vector<TcpConnection::Buffer> buffers;
+    for (auto& chunk : chunks) {
+      TcpConnection::Buffer buffer = { chunk.data(), chunk.size() };
+      buffers.push_back(buffer);
+    }
+
+    size_t first = 0;
+    while (first < buffers.size()) {
+      size_t transferred = connection1.writeBuffers(&buffers[first], buffers.size() - first);
+      while (transferred >= buffers[first].size) {
+        transferred -= buffers[first].size;
+        if (++first == buffers.size()) {
+          break;
+        }
+      }
+
+      if (first < buffers.size()) {
+        buffers[first].data += transferred;
+        buffers[first].size -= transferred;
+      }
+    }
+
+    connection1 = TcpConnection(); // close connection
+  });
+
+  readComplete.wait();
+
+  ASSERT_EQ(expected.size(), incoming.size());
+  ASSERT_EQ(expected, incoming);
+}
+
 TEST_F(TcpConnectionTests, writeWhenReadWaiting) {
   connect();
 
@@ -2,9 +2,30 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <cstring>
+#include <iostream>
+
 #include <gtest/gtest.h>
 
+#ifdef __linux__
+#include <System/Dispatcher.h>
+#endif
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
+
+#ifdef __linux__
+  // --io_uring runs the tests on dispatchers with the io_uring backend
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--io_uring") == 0) {
+      System::Dispatcher::setDefaultBackend(System::Dispatcher::Backend::IO_URING);
+      System::Dispatcher dispatcher;
+      if (dispatcher.getBackend() != System::Dispatcher::Backend::IO_URING) {
+        std::cout << "io_uring is not available, running on epoll" << std::endl;
+      }
+    }
+  }
+#endif
+
   return RUN_ALL_TESTS();
 }
@@ -94,6 +94,10 @@ std::vector<Fortress::Transaction> ICoreStub::getPoolTransactions() {
   return std::vector<Fortress::Transaction>();
 }
 
+bool ICoreStub::havePoolTransaction(const Crypto::Hash& transactionHash) {
+  return transactionPool.count(transactionHash) != 0;
+}
+
 bool ICoreStub::getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                                std::vector<Fortress::Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) {
   std::unordered_set<Crypto::Hash> knownSet;
@@ -132,6 +136,7 @@ bool ICoreStub::getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::v
 
 void ICoreStub::getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Fortress::Transaction>& addedTxs,
                                std::vector<Crypto::Hash>& deletedTxsIds) {
+  getPoolChanges(Crypto::Hash(), knownTxsIds, addedTxs, deletedTxsIds);
 }
 
 bool ICoreStub::queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
@@ -29,6 +29,7 @@ public:
   virtual Fortress::i_Fortress_protocol* get_protocol() override;
   virtual bool handle_incoming_tx(Fortress::BinaryArray const& tx_blob, Fortress::tx_verification_context& tvc, bool keeped_by_block) override;
   virtual std::vector<Fortress::Transaction> getPoolTransactions() override;
+  virtual bool havePoolTransaction(const Crypto::Hash& transactionHash) override;
   virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
                               std::vector<Fortress::Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
   virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
@@ -48,6 +49,7 @@ public:
   virtual void pause_mining() override {}
   virtual void update_block_template_and_resume_mining() override {}
   virtual bool handle_incoming_block_blob(const Fortress::BinaryArray& block_blob, Fortress::block_verification_context& bvc, bool control_miner, bool relay_block) override { return false; }
+  virtual bool handle_incoming_block(const Fortress::CachedBlock& block, Fortress::block_verification_context& bvc, bool control_miner, bool relay_block) override { return false; }
   virtual bool handle_get_objects(Fortress::NOTIFY_REQUEST_GET_OBJECTS::request& arg, Fortress::NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) override { return false; }
   virtual void on_synchronized() override {}
   virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, Fortress::MultisignatureOutput& out) override { return true; }
@@ -9,6 +9,7 @@
 #include "Wallet/WalletErrors.h"
 
 #include <functional>
+#include <future>
 #include <thread>
 #include <iterator>
 #include <cassert>
@@ -49,6 +50,25 @@ bool INodeDummyStub::removeObserver(INodeObserver* observer) {
   return observerManager.remove(observer);
 }
 
+void INodeDummyStub::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+  std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.resize(transactionHashes.size());
+  for (size_t i = 0; i < transactionHashes.size(); ++i) {
+    std::promise<std::error_code> prom;
+    std::future<std::error_code> f = prom.get_future();
+    getTransactionOutsGlobalIndices(transactionHashes[i], outsGlobalIndices[i], [&prom](std::error_code ec) { prom.set_value(ec); });
+
+    std::error_code ec = f.get();
+    if (ec) {
+      callback(ec);
+      return;
+    }
+  }
+
+  callback(std::error_code());
+}
+
 void INodeTrivialRefreshStub::getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback)
 {
   m_asyncCounter.addAsyncContext();
@@ -36,6 +36,8 @@ public:
   virtual void relayTransaction(const Fortress::Transaction& transaction, const Callback& callback) override { callback(std::error_code()); };
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<Fortress::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override { callback(std::error_code()); };
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override { callback(std::error_code()); };
+  // asks getTransactionOutsGlobalIndices for every transaction, so stubs overriding it see batched requests too
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& known_pool_tx_ids, Crypto::Hash known_block_id, bool& is_bc_actual,
           std::vector<std::unique_ptr<Fortress::ITransactionReader>>& new_txs, std::vector<Crypto::Hash>& deleted_tx_ids, const Callback& callback) override {
     is_bc_actual = true; callback(std::error_code());
@@ -0,0 +1,183 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "FortressConfig.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressProtocol/BlockDownloadScheduler.h"
+#include "crypto/crypto.h"
+
+using namespace Fortress;
+
+namespace {
+
+typedef BlockDownloadScheduler::Clock Clock;
+
+const size_t RANGE_SIZE = 2;
+const size_t CONNECTION_REQUESTS = 2;
+const size_t MAX_RANGES = 3;
+const Clock::duration TIMEOUT = std::chrono::seconds(10);
+
+Block createBlock(uint64_t nonce) {
+  Block block;
+  block.majorVersion = BLOCK_MAJOR_VERSION_1;
+  block.minorVersion = 0;
+  block.timestamp = 1451606400;
+  block.nonce = static_cast<uint32_t>(nonce);
+  block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+  return block;
+}
+
+BlockDownloadScheduler::DownloadedRange createRange(const boost::uuids::uuid& connectionId, const std::vector<Block>& blocks) {
+  BlockDownloadScheduler::DownloadedRange range;
+  range.connectionId = connectionId;
+  range.entries.resize(blocks.size());
+  range.blocks = blocks;
+  for (const Block& block : range.blocks) {
+    range.cachedBlocks.emplace_back(block);
+  }
+
+  return range;
+}
+
+}
+
+class BlockDownloadSchedulerTest : public testing::Test {
+public:
+  BlockDownloadSchedulerTest() :
+    scheduler(RANGE_SIZE, CONNECTION_REQUESTS, MAX_RANGES, TIMEOUT),
+    firstConnection(Crypto::rand<boost::uuids::uuid>()),
+    secondConnection(Crypto::rand<boost::uuids::uuid>()),
+    now(Clock::now()) {
+    blockIds.push_back(Crypto::rand<Crypto::Hash>());
+    for (uint64_t i = 1; i <= 7; ++i) {
+      blocks.push_back(createBlock(i));
+      blockIds.push_back(get_block_hash(blocks.back()));
+    }
+
+    scheduler.reset(0, blockIds[0]);
+  }
+
+  std::vector<Block> blockRange(size_t startHeight, size_t count) {
+    return std::vector<Block>(blocks.begin() + startHeight - 1, blocks.begin() + startHeight - 1 + count);
+  }
+
+  std::vector<Crypto::Hash> idRange(size_t startHeight, size_t count) {
+    return std::vector<Crypto::Hash>(blockIds.begin() + startHeight, blockIds.begin() + startHeight + count);
+  }
+
+  BlockDownloadScheduler scheduler;
+  boost::uuids::uuid firstConnection;
+  boost::uuids::uuid secondConnection;
+  Clock::time_point now;
+  // blockIds[0] is in the blockchain already, blocks[i] has id blockIds[i + 1]
+  std::vector<Crypto::Hash> blockIds;
+  std::vector<Block> blocks;
+};
+
+TEST_F(BlockDownloadSchedulerTest, spreadsRangesOverConnections) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 6)));
+
+  std::vector<Crypto::Hash> ids;
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+  ASSERT_EQ(idRange(1, 2), ids);
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+  ASSERT_EQ(idRange(3, 2), ids);
+  ASSERT_FALSE(scheduler.requestRange(firstConnection, 100, now, ids));
+
+  ASSERT_TRUE(scheduler.requestRange(secondConnection, 100, now, ids));
+  ASSERT_EQ(idRange(5, 1), ids);
+  ASSERT_FALSE(scheduler.hasUnrequestedRanges());
+}
+
+TEST_F(BlockDownloadSchedulerTest, requestsOnlyBlocksThePeerHas) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 6)));
+
+  std::vector<Crypto::Hash> ids;
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 3, now, ids));
+  ASSERT_EQ(idRange(1, 2), ids);
+  ASSERT_FALSE(scheduler.requestRange(firstConnection, 3, now, ids));
+  ASSERT_TRUE(scheduler.hasUnrequestedRanges());
+}
+
+TEST_F(BlockDownloadSchedulerTest, keepsRequestsWithinWindow) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 8)));
+
+  std::vector<Crypto::Hash> ids;
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+  ASSERT_TRUE(scheduler.requestRange(secondConnection, 100, now, ids));
+  ASSERT_EQ(idRange(5, 2), ids);
+  ASSERT_FALSE(scheduler.requestRange(secondConnection, 100, now, ids));
+
+  ASSERT_TRUE(scheduler.addRange(createRange(firstConnection, blockRange(1, 2))));
+  BlockDownloadScheduler::DownloadedRange range;
+  ASSERT_TRUE(scheduler.takeRange(range));
+  ASSERT_TRUE(scheduler.requestRange(secondConnection, 100, now, ids));
+  ASSERT_EQ(idRange(7, 1), ids);
+}
+
+TEST_F(BlockDownloadSchedulerTest, returnsRangesInBlockchainOrder) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 5)));
+
+  std::vector<Crypto::Hash> ids;
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+  ASSERT_TRUE(scheduler.requestRange(secondConnection, 100, now, ids));
+
+  BlockDownloadScheduler::DownloadedRange range;
+  ASSERT_TRUE(scheduler.addRange(createRange(secondConnection, blockRange(3, 2))));
+  ASSERT_FALSE(scheduler.takeRange(range));
+
+  ASSERT_TRUE(scheduler.addRange(createRange(firstConnection, blockRange(1, 2))));
+  ASSERT_TRUE(scheduler.takeRange(range));
+  ASSERT_EQ(firstConnection, range.connectionId);
+  ASSERT_EQ(blockIds[1], range.cachedBlocks[0].getBlockHash());
+  ASSERT_EQ(blockIds[2], range.cachedBlocks[1].getBlockHash());
+
+  ASSERT_TRUE(scheduler.takeRange(range));
+  ASSERT_EQ(secondConnection, range.connectionId);
+  ASSERT_EQ(blockIds[3], range.cachedBlocks[0].getBlockHash());
+  ASSERT_TRUE(scheduler.empty());
+}
+
+TEST_F(BlockDownloadSchedulerTest, rejectsBlocksNotRequestedFromConnection) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 5)));
+
+  std::vector<Crypto::Hash> ids;
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+
+  ASSERT_FALSE(scheduler.addRange(createRange(secondConnection, blockRange(1, 2))));
+  ASSERT_FALSE(scheduler.addRange(createRange(firstConnection, blockRange(3, 2))));
+  ASSERT_FALSE(scheduler.addRange(createRange(firstConnection, blockRange(1, 1))));
+}
+
+TEST_F(BlockDownloadSchedulerTest, releasesStalledConnections) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 3)));
+
+  std::vector<Crypto::Hash> ids;
+  ASSERT_TRUE(scheduler.requestRange(firstConnection, 100, now, ids));
+  ASSERT_TRUE(scheduler.releaseStalledConnections(now + TIMEOUT / 2).empty());
+  ASSERT_FALSE(scheduler.requestRange(secondConnection, 100, now, ids));
+
+  ASSERT_EQ(std::vector<boost::uuids::uuid>({ firstConnection }), scheduler.releaseStalledConnections(now + TIMEOUT));
+  ASSERT_FALSE(scheduler.hasRequests(firstConnection));
+  ASSERT_TRUE(scheduler.requestRange(secondConnection, 100, now, ids));
+  ASSERT_EQ(idRange(1, 2), ids);
+  ASSERT_FALSE(scheduler.addRange(createRange(firstConnection, blockRange(1, 2))));
+}
+
+TEST_F(BlockDownloadSchedulerTest, appendsOnlyIdsContinuingQueuedOnes) {
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 4)));
+
+  ASSERT_FALSE(scheduler.addBlockIds(2, { blockIds[2], Crypto::rand<Crypto::Hash>(), Crypto::rand<Crypto::Hash>() }));
+  ASSERT_TRUE(scheduler.addBlockIds(0, idRange(0, 2)));
+  ASSERT_TRUE(scheduler.addBlockIds(2, idRange(2, 4)));
+
+  std::vector<Crypto::Hash> ids;
+  while (scheduler.requestRange(firstConnection, 100, now, ids) || scheduler.requestRange(secondConnection, 100, now, ids)) {
+  }
+
+  ASSERT_EQ(idRange(5, 1), ids);
+}
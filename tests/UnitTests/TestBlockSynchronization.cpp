@@ -0,0 +1,244 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <System/Dispatcher.h>
+#include <Logging/ConsoleLogger.h>
+
+#include "FortressCore/Currency.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/FortressTools.h"
+#include "FortressCore/VerificationContext.h"
+#include "FortressProtocol/FortressProtocolHandler.h"
+#include "P2p/LevinProtocol.h"
+#include "ICoreStub.h"
+
+using namespace Fortress;
+
+namespace {
+
+const size_t MAX_BLOCK_BLOB_SIZE = 10000;
+
+struct Notification {
+  boost::uuids::uuid connectionId;
+  int command;
+  BinaryArray buffer;
+};
+
+class P2pEndpointStub : public p2p_endpoint_stub {
+public:
+  virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const FortressConnectionContext& context) override {
+    notifications.push_back({ context.m_connection_id, command, req_buff });
+    return true;
+  }
+
+  virtual void for_each_connection(std::function<void(FortressConnectionContext&, PeerIdType)> f) override {
+    for (FortressConnectionContext* context : connections) {
+      f(*context, 0);
+    }
+  }
+
+  std::vector<NOTIFY_REQUEST_GET_OBJECTS::request> takeBlockRequests(const FortressConnectionContext& context) {
+    std::vector<NOTIFY_REQUEST_GET_OBJECTS::request> requests;
+    for (auto it = notifications.begin(); it != notifications.end();) {
+      if (it->connectionId == context.m_connection_id && it->command == NOTIFY_REQUEST_GET_OBJECTS::ID) {
+        NOTIFY_REQUEST_GET_OBJECTS::request request;
+        EXPECT_TRUE(LevinProtocol::decode(it->buffer, request));
+        requests.push_back(std::move(request));
+        it = notifications.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    return requests;
+  }
+
+  std::vector<Notification> notifications;
+  std::vector<FortressConnectionContext*> connections;
+};
+
+// adds blocks that continue the blockchain
+class CoreStub : public ICoreStub {
+public:
+  virtual bool handle_incoming_block(const CachedBlock& block, block_verification_context& bvc, bool control_miner, bool relay_block) override {
+    blockThreads.push_back(std::this_thread::get_id());
+    uint32_t height;
+    Crypto::Hash top;
+    get_blockchain_top(height, top);
+    if (block.getBlock().previousBlockHash != top) {
+      bvc.m_marked_as_orphaned = true;
+      return false;
+    }
+
+    addBlock(block.getBlock());
+    bvc.m_added_to_main_chain = true;
+    return true;
+  }
+
+  std::vector<std::thread::id> blockThreads;
+};
+
+Block createBlock(uint32_t height, const Crypto::Hash& previousBlockHash) {
+  Block block;
+  block.majorVersion = BLOCK_MAJOR_VERSION_1;
+  block.minorVersion = 0;
+  block.timestamp = 1451606400 + height;
+  block.nonce = 42;
+  block.previousBlockHash = previousBlockHash;
+
+  BaseInput input;
+  input.blockIndex = height;
+  block.baseTransaction.version = CURRENT_TRANSACTION_VERSION;
+  block.baseTransaction.unlockTime = height + 10;
+  block.baseTransaction.inputs.push_back(input);
+  return block;
+}
+
+}
+
+class BlockSynchronizationTest : public testing::Test {
+public:
+  BlockSynchronizationTest() :
+    currency(CurrencyBuilder(logger).maxBlockBlobSize(MAX_BLOCK_BLOB_SIZE).currency()),
+    handler(currency, dispatcher, core, &endpoint, logger) {
+    chain.push_back(createBlock(0, Crypto::Hash()));
+    chainIds.push_back(get_block_hash(chain.back()));
+    core.addBlock(chain.back());
+    core.set_blockchain_top(0, chainIds.back());
+    // three ranges of blocks after the genesis block
+    while (chain.size() < 2 * BLOCKS_SYNCHRONIZING_DEFAULT_COUNT + 2) {
+      chain.push_back(createBlock(static_cast<uint32_t>(chain.size()), chainIds.back()));
+      chainIds.push_back(get_block_hash(chain.back()));
+    }
+
+    for (FortressConnectionContext* context : { &firstContext, &secondContext }) {
+      context->m_connection_id = Crypto::rand<boost::uuids::uuid>();
+      context->version = P2PProtocolVersion::CURRENT;
+      context->m_state = FortressConnectionContext::state_synchronizing;
+      context->m_remote_blockchain_height = static_cast<uint32_t>(chain.size());
+      endpoint.connections.push_back(context);
+    }
+  }
+
+  template <typename Command>
+  void notify(typename Command::request& request, FortressConnectionContext& context) {
+    BinaryArray out;
+    bool handled;
+    handler.handleCommand(true, Command::ID, LevinProtocol::encode(request), out, context, handled);
+    ASSERT_TRUE(handled);
+  }
+
+  void sendChainEntry(FortressConnectionContext& context) {
+    NOTIFY_RESPONSE_CHAIN_ENTRY::request chainEntry;
+    chainEntry.start_height = 0;
+    chainEntry.total_height = static_cast<uint32_t>(chain.size());
+    chainEntry.m_block_ids = chainIds;
+
+    notify<NOTIFY_RESPONSE_CHAIN_ENTRY>(chainEntry, context);
+  }
+
+  void sendBlocks(const NOTIFY_REQUEST_GET_OBJECTS::request& request, FortressConnectionContext& context) {
+    NOTIFY_RESPONSE_GET_OBJECTS::request response;
+    response.current_blockchain_height = static_cast<uint32_t>(chain.size());
+    for (const Crypto::Hash& blockId : request.blocks) {
+      size_t height = std::find(chainIds.begin(), chainIds.end(), blockId) - chainIds.begin();
+      block_complete_entry entry;
+      entry.block = Common::asString(toBinaryArray(chain[height]));
+      response.blocks.push_back(entry);
+    }
+
+    notify<NOTIFY_RESPONSE_GET_OBJECTS>(response, context);
+  }
+
+  uint32_t getTopHeight() {
+    uint32_t height;
+    Crypto::Hash top;
+    core.get_blockchain_top(height, top);
+    return height;
+  }
+
+  System::Dispatcher dispatcher;
+  Logging::ConsoleLogger logger;
+  Currency currency;
+  CoreStub core;
+  P2pEndpointStub endpoint;
+  FortressProtocolHandler handler;
+  FortressConnectionContext firstContext;
+  FortressConnectionContext secondContext;
+  std::vector<Block> chain;
+  std::vector<Crypto::Hash> chainIds;
+};
+
+TEST_F(BlockSynchronizationTest, downloadsRangesFromSeveralPeersAndAddsThemInOrder) {
+  sendChainEntry(firstContext);
+  auto firstRequests = endpoint.takeBlockRequests(firstContext);
+  ASSERT_EQ(BLOCKS_SYNCHRONIZING_PEER_REQUESTS, firstRequests.size());
+
+  sendChainEntry(secondContext);
+  auto secondRequests = endpoint.takeBlockRequests(secondContext);
+  ASSERT_EQ(1, secondRequests.size());
+  ASSERT_EQ(chainIds.back(), secondRequests[0].blocks.back());
+
+  sendBlocks(secondRequests[0], secondContext);
+  sendBlocks(firstRequests[1], firstContext);
+  ASSERT_EQ(0, getTopHeight());
+
+  sendBlocks(firstRequests[0], firstContext);
+  ASSERT_EQ(chain.size() - 1, getTopHeight());
+  ASSERT_EQ(FortressConnectionContext::state_normal, firstContext.m_state);
+  ASSERT_EQ(FortressConnectionContext::state_normal, secondContext.m_state);
+}
+
+TEST_F(BlockSynchronizationTest, requestsBlocksMissedByPeerFromOtherPeers) {
+  sendChainEntry(firstContext);
+  auto firstRequests = endpoint.takeBlockRequests(firstContext);
+  sendChainEntry(secondContext);
+  auto secondRequests = endpoint.takeBlockRequests(secondContext);
+  ASSERT_EQ(1, secondRequests.size());
+
+  NOTIFY_RESPONSE_GET_OBJECTS::request response;
+  response.current_blockchain_height = static_cast<uint32_t>(chain.size());
+  response.missed_ids = firstRequests[0].blocks;
+  notify<NOTIFY_RESPONSE_GET_OBJECTS>(response, firstContext);
+  ASSERT_EQ(FortressConnectionContext::state_idle, firstContext.m_state);
+
+  handler.on_idle();
+  secondRequests = endpoint.takeBlockRequests(secondContext);
+  ASSERT_EQ(1, secondRequests.size());
+  ASSERT_EQ(firstRequests[0].blocks, secondRequests[0].blocks);
+}
+
+TEST_F(BlockSynchronizationTest, addsBlocksOutsideDispatcherThread) {
+  sendChainEntry(firstContext);
+  auto requests = endpoint.takeBlockRequests(firstContext);
+  ASSERT_FALSE(requests.empty());
+
+  sendBlocks(requests[0], firstContext);
+  ASSERT_EQ(requests[0].blocks.size(), core.blockThreads.size());
+  for (const std::thread::id& threadId : core.blockThreads) {
+    ASSERT_NE(std::this_thread::get_id(), threadId);
+  }
+}
+
+TEST_F(BlockSynchronizationTest, dropsPeerSendingTooBigBlock) {
+  chain[1].baseTransaction.extra.resize(MAX_BLOCK_BLOB_SIZE);
+  for (size_t height = 1; height < chain.size(); ++height) {
+    chain[height].previousBlockHash = chainIds[height - 1];
+    chainIds[height] = get_block_hash(chain[height]);
+  }
+
+  sendChainEntry(firstContext);
+  auto requests = endpoint.takeBlockRequests(firstContext);
+  ASSERT_FALSE(requests.empty());
+
+  sendBlocks(requests[0], firstContext);
+  ASSERT_EQ(FortressConnectionContext::state_shutdown, firstContext.m_state);
+  ASSERT_TRUE(core.blockThreads.empty());
+  ASSERT_EQ(0, getTopHeight());
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "FortressCore/BlockchainJournal.h"
+#include "FortressCore/FortressBasic.h"
+
+using namespace Fortress;
+
+namespace {
+
+class BlockchainJournalTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    m_fileName = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("test_journal_%%%%%%%%%%%%")).string();
+  }
+
+  virtual void TearDown() override {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove(m_fileName, ignoredErrorCode);
+  }
+
+  std::string m_fileName;
+};
+
+Crypto::Hash makeHash(uint8_t value) {
+  Crypto::Hash hash = NULL_HASH;
+  hash.data[0] = value;
+  return hash;
+}
+
+}
+
+TEST_F(BlockchainJournalTest, newJournalFollowsNoSnapshot) {
+  BlockchainJournal journal;
+  std::vector<BinaryArray> records;
+  ASSERT_TRUE(journal.open(m_fileName, records));
+  ASSERT_TRUE(records.empty());
+  ASSERT_EQ(NULL_HASH, journal.snapshotHash());
+}
+
+TEST_F(BlockchainJournalTest, recordsSurviveReopen) {
+  {
+    BlockchainJournal journal;
+    std::vector<BinaryArray> records;
+    ASSERT_TRUE(journal.open(m_fileName, records));
+    ASSERT_TRUE(journal.reset(makeHash(1)));
+    journal.append(BinaryArray{ 1, 2, 3 });
+    journal.append(BinaryArray());
+    journal.append(BinaryArray{ 4 });
+  }
+
+  BlockchainJournal journal;
+  std::vector<BinaryArray> records;
+  ASSERT_TRUE(journal.open(m_fileName, records));
+  ASSERT_EQ(makeHash(1), journal.snapshotHash());
+  ASSERT_EQ((std::vector<BinaryArray>{ { 1, 2, 3 }, {}, { 4 } }), records);
+  ASSERT_EQ(3, journal.recordCount());
+}
+
+TEST_F(BlockchainJournalTest, tornRecordIsDropped) {
+  {
+    BlockchainJournal journal;
+    std::vector<BinaryArray> records;
+    ASSERT_TRUE(journal.open(m_fileName, records));
+    journal.append(BinaryArray{ 1, 2, 3 });
+    journal.append(BinaryArray{ 4, 5, 6 });
+  }
+
+  boost::filesystem::resize_file(m_fileName, boost::filesystem::file_size(m_fileName) - 2);
+
+  {
+    BlockchainJournal journal;
+    std::vector<BinaryArray> records;
+    ASSERT_TRUE(journal.open(m_fileName, records));
+    ASSERT_EQ((std::vector<BinaryArray>{ { 1, 2, 3 } }), records);
+    journal.append(BinaryArray{ 7 });
+  }
+
+  BlockchainJournal journal;
+  std::vector<BinaryArray> records;
+  ASSERT_TRUE(journal.open(m_fileName, records));
+  ASSERT_EQ((std::vector<BinaryArray>{ { 1, 2, 3 }, { 7 } }), records);
+}
+
+TEST_F(BlockchainJournalTest, resetDropsRecords) {
+  {
+    BlockchainJournal journal;
+    std::vector<BinaryArray> records;
+    ASSERT_TRUE(journal.open(m_fileName, records));
+    journal.append(BinaryArray{ 1 });
+    ASSERT_EQ(1, journal.recordCount());
+    ASSERT_TRUE(journal.reset(makeHash(2)));
+    ASSERT_EQ(0, journal.recordCount());
+    journal.append(BinaryArray{ 2 });
+  }
+
+  BlockchainJournal journal;
+  std::vector<BinaryArray> records;
+  ASSERT_TRUE(journal.open(m_fileName, records));
+  ASSERT_EQ(makeHash(2), journal.snapshotHash());
+  ASSERT_EQ((std::vector<BinaryArray>{ { 2 } }), records);
+}
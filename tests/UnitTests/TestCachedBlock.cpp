@@ -0,0 +1,96 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "FortressCore/CachedBlock.h"
+#include "FortressCore/CachedTransaction.h"
+#include "FortressConfig.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/FortressTools.h"
+#include "crypto/crypto.h"
+
+using namespace Fortress;
+
+namespace {
+
+Transaction createBaseTransaction(uint32_t height) {
+  Transaction tx;
+  tx.version = CURRENT_TRANSACTION_VERSION;
+  tx.unlockTime = height + 10;
+
+  BaseInput input;
+  input.blockIndex = height;
+  tx.inputs.push_back(input);
+
+  KeyOutput output;
+  Crypto::SecretKey secretKey;
+  Crypto::generate_keys(output.key, secretKey);
+  tx.outputs.push_back({ 1000, output });
+  return tx;
+}
+
+Block createBlock(size_t transactionCount) {
+  Block block;
+  block.majorVersion = BLOCK_MAJOR_VERSION_1;
+  block.minorVersion = 0;
+  block.timestamp = 1451606400;
+  block.nonce = 42;
+  block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+  block.baseTransaction = createBaseTransaction(1);
+  for (size_t i = 0; i < transactionCount; ++i) {
+    block.transactionHashes.push_back(Crypto::rand<Crypto::Hash>());
+  }
+
+  return block;
+}
+
+}
+
+TEST(CachedBlock, hashesMatchFormatUtils) {
+  for (size_t transactionCount : { 0, 1, 2, 5 }) {
+    Block block = createBlock(transactionCount);
+    CachedBlock cachedBlock(block);
+
+    BinaryArray hashingBlob;
+    ASSERT_TRUE(get_block_hashing_blob(block, hashingBlob));
+    ASSERT_EQ(hashingBlob, cachedBlock.getBlockHashingBinaryArray());
+    ASSERT_EQ(get_block_hash(block), cachedBlock.getBlockHash());
+    ASSERT_EQ(getObjectHash(block.baseTransaction), cachedBlock.getBaseTransactionHash());
+    ASSERT_EQ(get_tx_tree_hash(block), cachedBlock.getTransactionTreeHash());
+    ASSERT_EQ(toBinaryArray(block), cachedBlock.getBlockBinaryArray());
+  }
+}
+
+TEST(CachedBlock, usesGivenBlob) {
+  Block block = createBlock(1);
+  BinaryArray blob = toBinaryArray(block);
+  CachedBlock cachedBlock(block, blob);
+
+  ASSERT_EQ(blob, cachedBlock.getBlockBinaryArray());
+  ASSERT_EQ(get_block_hash(block), cachedBlock.getBlockHash());
+}
+
+TEST(CachedTransaction, hashesMatchFormatUtils) {
+  Transaction tx = createBaseTransaction(5);
+  CachedTransaction transaction(tx);
+
+  Crypto::Hash hash;
+  size_t size;
+  ASSERT_TRUE(getObjectHash(tx, hash, size));
+  ASSERT_EQ(hash, transaction.getTransactionHash());
+  ASSERT_EQ(size, transaction.getTransactionBinarySize());
+  ASSERT_EQ(getObjectHash(static_cast<const TransactionPrefix&>(tx)), transaction.getTransactionPrefixHash());
+}
+
+TEST(CachedTransaction, usesGivenValues) {
+  Transaction tx = createBaseTransaction(5);
+  Crypto::Hash hash = Crypto::rand<Crypto::Hash>();
+  Crypto::Hash prefixHash = Crypto::rand<Crypto::Hash>();
+  CachedTransaction transaction(tx, hash, prefixHash, 123);
+
+  ASSERT_EQ(hash, transaction.getTransactionHash());
+  ASSERT_EQ(prefixHash, transaction.getTransactionPrefixHash());
+  ASSERT_EQ(123, transaction.getTransactionBinarySize());
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "FortressCore/DifficultyWindow.h"
+
+using namespace Fortress;
+
+namespace {
+
+void pushHeights(DifficultyWindow& window, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t height = window.endHeight();
+    window.push(1000 + height, 10 * height);
+  }
+}
+
+}
+
+TEST(DifficultyWindow, dropsOldestBlockWhenFull) {
+  DifficultyWindow window(4);
+  window.clear(1);
+  pushHeights(window, 6);
+
+  ASSERT_TRUE(window.full());
+  ASSERT_EQ(3, window.beginHeight());
+  ASSERT_EQ(7, window.endHeight());
+
+  std::vector<uint64_t> timestamps;
+  std::vector<difficulty_type> cumulativeDifficulties;
+  window.copy(window.beginHeight(), window.endHeight(), timestamps, cumulativeDifficulties);
+  ASSERT_EQ((std::vector<uint64_t>{1003, 1004, 1005, 1006}), timestamps);
+  ASSERT_EQ((std::vector<difficulty_type>{30, 40, 50, 60}), cumulativeDifficulties);
+}
+
+TEST(DifficultyWindow, popAndPushFrontRestoreWindow) {
+  DifficultyWindow window(4);
+  window.clear(1);
+  pushHeights(window, 6);
+
+  window.pop();
+  ASSERT_FALSE(window.full());
+  window.pushFront(1002, 20);
+  ASSERT_EQ(2, window.beginHeight());
+  ASSERT_EQ(6, window.endHeight());
+
+  std::vector<uint64_t> timestamps;
+  std::vector<difficulty_type> cumulativeDifficulties;
+  window.copy(3, 5, timestamps, cumulativeDifficulties);
+  ASSERT_EQ((std::vector<uint64_t>{1003, 1004}), timestamps);
+  ASSERT_EQ((std::vector<difficulty_type>{30, 40}), cumulativeDifficulties);
+}
+
+TEST(DifficultyWindow, clearSetsNextHeight) {
+  DifficultyWindow window(4);
+  window.clear(1);
+  pushHeights(window, 2);
+  window.clear(10);
+
+  ASSERT_EQ(0, window.size());
+  ASSERT_EQ(10, window.beginHeight());
+  ASSERT_EQ(10, window.endHeight());
+}
@@ -147,6 +147,33 @@ TEST_F(InProcessNodeTests, getTransactionOutsGlobalIndicesFailure) {
   ASSERT_NE(std::error_code(), status.getStatus());
 }
 
+TEST_F(InProcessNodeTests, getTransactionsOutsGlobalIndicesSuccess) {
+  std::vector<Crypto::Hash> hashes(3);
+  std::vector<std::vector<uint32_t>> indices;
+  std::vector<uint32_t> expectedIndices = { 10, 11, 12 };
+  coreStub.set_outputs_gindexs(expectedIndices, true);
+
+  CallbackStatus status;
+  node.getTransactionsOutsGlobalIndices(hashes, indices, [&status] (std::error_code ec) { status.setStatus(ec); });
+  ASSERT_TRUE(status.ok());
+
+  ASSERT_EQ(hashes.size(), indices.size());
+  for (const auto& transactionIndices : indices) {
+    ASSERT_EQ(expectedIndices, transactionIndices);
+  }
+}
+
+TEST_F(InProcessNodeTests, getTransactionsOutsGlobalIndicesFailure) {
+  std::vector<Crypto::Hash> hashes(3);
+  std::vector<std::vector<uint32_t>> indices;
+  coreStub.set_outputs_gindexs(std::vector<uint32_t>(), false);
+
+  CallbackStatus status;
+  node.getTransactionsOutsGlobalIndices(hashes, indices, [&status] (std::error_code ec) { status.setStatus(ec); });
+  ASSERT_TRUE(status.wait());
+  ASSERT_NE(std::error_code(), status.getStatus());
+}
+
 TEST_F(InProcessNodeTests, getRandomOutsByAmountsSuccess) {
   Crypto::PublicKey ignoredPublicKey;
   Crypto::SecretKey ignoredSectetKey;
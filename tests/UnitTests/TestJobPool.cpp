@@ -0,0 +1,53 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <memory>
+
+#include "Common/JobPool.h"
+
+using namespace Tools;
+
+TEST(JobPool, runsEveryJobOnce) {
+  for (size_t threadCount : { 1, 2, 4 }) {
+    JobPool pool(threadCount);
+    ASSERT_EQ(threadCount, pool.threadCount());
+
+    // the pool is reused across runs
+    for (size_t jobCount : { 0, 1, 7, 1000 }) {
+      std::unique_ptr<std::atomic<size_t>[]> calls(new std::atomic<size_t>[jobCount]);
+      for (size_t i = 0; i < jobCount; ++i) {
+        calls[i] = 0;
+      }
+
+      size_t result = pool.run(jobCount, [&](size_t index) {
+        ++calls[index];
+        return true;
+      });
+
+      ASSERT_EQ(jobCount, result);
+      for (size_t i = 0; i < jobCount; ++i) {
+        ASSERT_EQ(1, calls[i]);
+      }
+    }
+  }
+}
+
+TEST(JobPool, returnsFirstFailedJob) {
+  JobPool pool(4);
+  for (int i = 0; i < 20; ++i) {
+    size_t result = pool.run(1000, [](size_t index) {
+      return index != 300 && index != 700;
+    });
+
+    ASSERT_EQ(300, result);
+  }
+}
+
+TEST(JobPool, zeroThreadCountUsesAllCores) {
+  JobPool pool;
+  ASSERT_LE(1, pool.threadCount());
+}
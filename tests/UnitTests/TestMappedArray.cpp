@@ -0,0 +1,133 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "FortressCore/MappedArray.h"
+
+namespace {
+
+struct TestItem {
+  uint64_t value;
+  uint32_t square;
+  uint16_t index;
+};
+
+TestItem makeItem(uint64_t value) {
+  TestItem item = { value, static_cast<uint32_t>(value * value), static_cast<uint16_t>(value % 7) };
+  return item;
+}
+
+class MappedArrayTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    m_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("test_data_%%%%%%%%%%%%");
+    boost::filesystem::create_directories(m_dir);
+  }
+
+  virtual void TearDown() override {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(m_dir, ignoredErrorCode);
+  }
+
+  std::string fileName() const {
+    return (m_dir / "items").string();
+  }
+
+  boost::filesystem::path m_dir;
+};
+
+}
+
+TEST_F(MappedArrayTest, itemsSurviveReopen) {
+  // three items fit a segment
+  {
+    MappedArray<TestItem> array(3 * sizeof(TestItem) + 1);
+    ASSERT_TRUE(array.open(fileName()));
+    ASSERT_TRUE(array.empty());
+    for (uint64_t i = 0; i < 10; ++i) {
+      array.push_back(makeItem(i));
+    }
+  }
+
+  ASSERT_TRUE(boost::filesystem::exists(fileName() + ".0003"));
+
+  // the segment size recorded in the header wins over the constructor argument
+  MappedArray<TestItem> array;
+  ASSERT_TRUE(array.open(fileName()));
+  ASSERT_EQ(10, array.size());
+  for (uint64_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(i, array[i].value);
+    ASSERT_EQ(i * i, array[i].square);
+    ASSERT_EQ(i % 7, array[i].index);
+  }
+}
+
+TEST_F(MappedArrayTest, referencesStayValidWhileGrowing) {
+  MappedArray<TestItem> array(2 * sizeof(TestItem));
+  ASSERT_TRUE(array.open(fileName()));
+  array.push_back(makeItem(1));
+  const TestItem& first = array[0];
+  for (uint64_t i = 2; i < 20; ++i) {
+    array.push_back(makeItem(i));
+  }
+
+  ASSERT_EQ(1, first.value);
+  ASSERT_EQ(&first, &array[0]);
+}
+
+TEST_F(MappedArrayTest, resizeIsPersistentAndOnlyShrinks) {
+  {
+    MappedArray<TestItem> array(1024);
+    ASSERT_TRUE(array.open(fileName()));
+    for (uint64_t i = 0; i < 5; ++i) {
+      array.push_back(makeItem(i));
+    }
+
+    array.resize(3);
+    ASSERT_ANY_THROW(array.resize(4));
+    array.push_back(makeItem(10));
+  }
+
+  MappedArray<TestItem> array(1024);
+  ASSERT_TRUE(array.open(fileName()));
+  ASSERT_EQ(4, array.size());
+  ASSERT_EQ(2, array[2].value);
+  ASSERT_EQ(10, array[3].value);
+
+  array.clear();
+  ASSERT_TRUE(array.empty());
+}
+
+TEST_F(MappedArrayTest, missingSegmentTruncatesArray) {
+  {
+    MappedArray<TestItem> array(2 * sizeof(TestItem));
+    ASSERT_TRUE(array.open(fileName()));
+    for (uint64_t i = 0; i < 6; ++i) {
+      array.push_back(makeItem(i));
+    }
+  }
+
+  boost::filesystem::remove(fileName() + ".0002");
+
+  MappedArray<TestItem> array(2 * sizeof(TestItem));
+  ASSERT_TRUE(array.open(fileName()));
+  ASSERT_EQ(4, array.size());
+  ASSERT_EQ(3, array[3].value);
+}
+
+TEST_F(MappedArrayTest, openFailsForDifferentItemSize) {
+  {
+    MappedArray<TestItem> array(1024);
+    ASSERT_TRUE(array.open(fileName()));
+    array.push_back(makeItem(1));
+  }
+
+  MappedArray<uint64_t> array(1024);
+  ASSERT_FALSE(array.open(fileName()));
+}
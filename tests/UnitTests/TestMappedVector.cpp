@@ -0,0 +1,193 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "FortressCore/MappedVector.h"
+
+namespace {
+
+struct TestItem {
+  uint64_t value;
+  std::string payload;
+
+  void serialize(Fortress::ISerializer& s) {
+    s(value, "value");
+    s(payload, "payload");
+  }
+};
+
+struct TestItemPrefix {
+  uint64_t value;
+
+  void serialize(Fortress::ISerializer& s) {
+    s(value, "value");
+  }
+};
+
+TestItem makeItem(uint64_t value) {
+  TestItem item;
+  item.value = value;
+  item.payload = std::string(20, static_cast<char>('a' + value % 26));
+  return item;
+}
+
+class MappedVectorTest : public ::testing::Test {
+protected:
+  virtual void SetUp() override {
+    m_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("test_data_%%%%%%%%%%%%");
+    boost::filesystem::create_directories(m_dir);
+  }
+
+  virtual void TearDown() override {
+    boost::system::error_code ignoredErrorCode;
+    boost::filesystem::remove_all(m_dir, ignoredErrorCode);
+  }
+
+  bool open(MappedVector<TestItem>& vector) {
+    return vector.open(itemFileName(), (m_dir / "index.dat").string(), 4);
+  }
+
+  std::string itemFileName() const {
+    return (m_dir / "items").string();
+  }
+
+  boost::filesystem::path m_dir;
+};
+
+}
+
+TEST_F(MappedVectorTest, itemsSurviveReopen) {
+  {
+    MappedVector<TestItem> vector(1024);
+    ASSERT_TRUE(open(vector));
+    ASSERT_TRUE(vector.empty());
+    for (uint64_t i = 0; i < 100; ++i) {
+      vector.push_back(makeItem(i));
+    }
+  }
+
+  MappedVector<TestItem> vector(1024);
+  ASSERT_TRUE(open(vector));
+  ASSERT_EQ(100, vector.size());
+  for (uint64_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(i, vector[i].value);
+    ASSERT_EQ(makeItem(i).payload, vector[i].payload);
+  }
+}
+
+TEST_F(MappedVectorTest, itemsDoNotCrossSegments) {
+  {
+    MappedVector<TestItem> vector(40);
+    ASSERT_TRUE(open(vector));
+    for (uint64_t i = 0; i < 10; ++i) {
+      vector.push_back(makeItem(i));
+    }
+  }
+
+  ASSERT_TRUE(boost::filesystem::exists(itemFileName() + ".0009"));
+
+  // the segment size recorded in the index wins over the constructor argument
+  MappedVector<TestItem> vector;
+  ASSERT_TRUE(open(vector));
+  ASSERT_EQ(10, vector.size());
+  for (uint64_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(i, vector[i].value);
+  }
+}
+
+TEST_F(MappedVectorTest, popBackAndClearArePersistent) {
+  {
+    MappedVector<TestItem> vector(1024);
+    ASSERT_TRUE(open(vector));
+    for (uint64_t i = 0; i < 5; ++i) {
+      vector.push_back(makeItem(i));
+    }
+
+    vector.pop_back();
+    vector.pop_back();
+    vector.push_back(makeItem(10));
+  }
+
+  {
+    MappedVector<TestItem> vector(1024);
+    ASSERT_TRUE(open(vector));
+    ASSERT_EQ(4, vector.size());
+    ASSERT_EQ(2, vector[2].value);
+    ASSERT_EQ(10, vector.back().value);
+    vector.clear();
+  }
+
+  MappedVector<TestItem> vector(1024);
+  ASSERT_TRUE(open(vector));
+  ASSERT_TRUE(vector.empty());
+}
+
+TEST_F(MappedVectorTest, indexGrowsBeyondInitialCapacity) {
+  {
+    MappedVector<TestItem> vector(1024 * 1024);
+    ASSERT_TRUE(open(vector));
+    for (uint64_t i = 0; i < 3000; ++i) {
+      vector.push_back(makeItem(i));
+    }
+
+    ASSERT_EQ(1234, vector[1234].value);
+  }
+
+  MappedVector<TestItem> vector(1024 * 1024);
+  ASSERT_TRUE(open(vector));
+  ASSERT_EQ(3000, vector.size());
+  ASSERT_EQ(2999, vector.back().value);
+}
+
+TEST_F(MappedVectorTest, corruptedTailIsTruncated) {
+  {
+    MappedVector<TestItem> vector(1024);
+    ASSERT_TRUE(open(vector));
+    for (uint64_t i = 0; i < 3; ++i) {
+      vector.push_back(makeItem(i));
+    }
+  }
+
+  {
+    std::fstream segment(itemFileName() + ".0000", std::ios::in | std::ios::out | std::ios::binary);
+    segment.seekp(60);
+    segment.write("xxxx", 4);
+  }
+
+  MappedVector<TestItem> vector(1024);
+  ASSERT_TRUE(open(vector));
+  ASSERT_EQ(2, vector.size());
+  ASSERT_EQ(1, vector.back().value);
+
+  vector.push_back(makeItem(7));
+  ASSERT_EQ(7, vector[2].value);
+}
+
+TEST_F(MappedVectorTest, rawAndPartialAccess) {
+  MappedVector<TestItem> vector(1024);
+  ASSERT_TRUE(open(vector));
+  TestItem item = makeItem(300);
+  vector.push_back(item);
+
+  std::vector<uint8_t> serialized;
+  {
+    Common::VectorOutputStream stream(serialized);
+    Fortress::BinaryOutputStreamSerializer archive(stream);
+    item.serialize(archive);
+  }
+
+  Common::ArrayView<uint8_t> raw = vector.raw(0);
+  ASSERT_EQ(serialized.size(), raw.getSize());
+  ASSERT_EQ(0, memcmp(serialized.data(), raw.getData(), serialized.size()));
+
+  TestItemPrefix prefix;
+  vector.load(0, prefix);
+  ASSERT_EQ(300, prefix.value);
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "FortressConfig.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/MiningJob.h"
+#include "crypto/crypto.h"
+
+using namespace Fortress;
+
+namespace {
+
+Block createBlockTemplate(size_t transactionCount) {
+  Block block;
+  block.majorVersion = BLOCK_MAJOR_VERSION_1;
+  block.minorVersion = BLOCK_MINOR_VERSION_0;
+  block.timestamp = 1451606400;
+  block.nonce = 0x01020304;
+  block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+  block.baseTransaction.version = CURRENT_TRANSACTION_VERSION;
+  block.baseTransaction.unlockTime = 10;
+  block.baseTransaction.inputs.push_back(BaseInput{ 1 });
+  for (size_t i = 0; i < transactionCount; ++i) {
+    block.transactionHashes.push_back(Crypto::rand<Crypto::Hash>());
+  }
+
+  return block;
+}
+
+}
+
+TEST(MiningJob, blobMatchesBlockHashingBlob) {
+  Block block = createBlockTemplate(3);
+  MiningJob job(block);
+
+  BinaryArray blob;
+  ASSERT_TRUE(get_block_hashing_blob(block, blob));
+  ASSERT_EQ(blob, job.getHashingBinaryArray());
+  ASSERT_EQ(block.nonce, job.getNonce());
+}
+
+TEST(MiningJob, setNonceMatchesBlockWithThatNonce) {
+  Block block = createBlockTemplate(2);
+  MiningJob job(block);
+
+  for (uint32_t nonce : { 0u, 1u, 0xdeadbeefu, 0xffffffffu }) {
+    job.setNonce(nonce);
+    block.nonce = nonce;
+
+    BinaryArray blob;
+    ASSERT_TRUE(get_block_hashing_blob(block, blob));
+    ASSERT_EQ(blob, job.getHashingBinaryArray());
+    ASSERT_EQ(nonce, job.getNonce());
+  }
+}
+
+TEST(MiningJob, longHashMatchesBlockLongHash) {
+  Block block = createBlockTemplate(1);
+  MiningJob job(block);
+  Crypto::cn_context context;
+
+  for (uint32_t nonce = 0; nonce < 3; ++nonce) {
+    job.setNonce(nonce);
+    block.nonce = nonce;
+
+    Crypto::Hash expected;
+    Crypto::Hash actual;
+    ASSERT_TRUE(get_block_longhash(context, block, expected));
+    job.getLongHash(context, actual);
+    ASSERT_EQ(expected, actual);
+  }
+}
+
+TEST(MiningJob, copiesAreIndependent) {
+  MiningJob job(createBlockTemplate(0));
+  MiningJob copy(job);
+  copy.setNonce(job.getNonce() + 1);
+
+  ASSERT_NE(job.getNonce(), copy.getNonce());
+  ASSERT_NE(job.getHashingBinaryArray(), copy.getHashingBinaryArray());
+}
+
+TEST(MiningJob, longHashesMatchSingleHashes) {
+  MiningJob job(createBlockTemplate(1));
+  Crypto::cn_context contexts[Crypto::SLOW_HASH_MAX_WAYS];
+  const uint32_t nonceStep = 3;
+  const size_t count = 5;
+
+  Crypto::Hash hashes[count];
+  job.getLongHashes(contexts, Crypto::SLOW_HASH_MAX_WAYS, nonceStep, hashes, count);
+
+  uint32_t firstNonce = job.getNonce();
+  for (size_t i = 0; i < count; ++i) {
+    Crypto::Hash expected;
+    job.setNonce(firstNonce + static_cast<uint32_t>(i) * nonceStep);
+    job.getLongHash(contexts[0], expected);
+    ASSERT_EQ(expected, hashes[i]);
+  }
+}
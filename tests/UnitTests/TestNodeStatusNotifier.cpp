@@ -0,0 +1,130 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "System/ContextGroup.h"
+#include "System/Dispatcher.h"
+#include "System/InterruptedException.h"
+#include "System/Timer.h"
+
+#include "Rpc/NodeStatusNotifier.h"
+
+using namespace Fortress;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const std::chrono::milliseconds LONG_TIMEOUT(10000);
+
+}
+
+class NodeStatusNotifierTest : public testing::Test {
+public:
+  NodeStatusNotifierTest() :
+    contextGroup(dispatcher),
+    readCount(0),
+    notifier(dispatcher, [this](NodeStatusNotifier::NodeStatus& status) {
+      // reading the status yields like the p2p call of the server does
+      System::Timer(dispatcher).sleep(std::chrono::milliseconds(10));
+      status.response.topBlockIndex = ++readCount;
+    }) {
+  }
+
+  System::Dispatcher dispatcher;
+  System::ContextGroup contextGroup;
+  uint32_t readCount;
+  NodeStatusNotifier notifier;
+};
+
+TEST_F(NodeStatusNotifierTest, waiterWakesOnChange) {
+  bool woken = false;
+  contextGroup.spawn([&] {
+    auto status = notifier.getStatus();
+    auto start = Clock::now();
+    notifier.wait(*status, LONG_TIMEOUT);
+    ASSERT_LT(Clock::now() - start, LONG_TIMEOUT / 2);
+    ASSERT_EQ(2, notifier.getStatus()->response.topBlockIndex);
+    woken = true;
+  });
+
+  contextGroup.spawn([&] {
+    System::Timer(dispatcher).sleep(std::chrono::milliseconds(50));
+    notifier.notify();
+  });
+
+  contextGroup.wait();
+  ASSERT_TRUE(woken);
+}
+
+TEST_F(NodeStatusNotifierTest, waiterReturnsOnTimeout) {
+  contextGroup.spawn([&] {
+    auto status = notifier.getStatus();
+    notifier.wait(*status, std::chrono::milliseconds(50));
+    ASSERT_EQ(status, notifier.getStatus());
+  });
+
+  contextGroup.wait();
+  ASSERT_EQ(1, readCount);
+}
+
+TEST_F(NodeStatusNotifierTest, waiterDoesNotMissChangeDuringRead) {
+  contextGroup.spawn([&] {
+    auto status = notifier.getStatus();
+    auto start = Clock::now();
+    notifier.wait(*status, LONG_TIMEOUT);
+    ASSERT_LT(Clock::now() - start, LONG_TIMEOUT / 2);
+  });
+
+  contextGroup.spawn([&] {
+    notifier.notify();
+  });
+
+  contextGroup.wait();
+}
+
+TEST_F(NodeStatusNotifierTest, statusIsReadOncePerChange) {
+  const size_t WAITER_COUNT = 5;
+  size_t wokenCount = 0;
+  for (size_t i = 0; i < WAITER_COUNT; ++i) {
+    contextGroup.spawn([&] {
+      auto status = notifier.getStatus();
+      notifier.wait(*status, LONG_TIMEOUT);
+      notifier.getStatus();
+      ++wokenCount;
+    });
+  }
+
+  contextGroup.spawn([&] {
+    System::Timer(dispatcher).sleep(std::chrono::milliseconds(50));
+    notifier.notify();
+  });
+
+  contextGroup.wait();
+  ASSERT_EQ(WAITER_COUNT, wokenCount);
+  ASSERT_EQ(2, readCount);
+}
+
+TEST_F(NodeStatusNotifierTest, waiterIsInterruptedOnStop) {
+  bool interrupted = false;
+  contextGroup.spawn([&] {
+    auto status = notifier.getStatus();
+    try {
+      notifier.wait(*status, LONG_TIMEOUT);
+    } catch (System::InterruptedException&) {
+      interrupted = true;
+    }
+  });
+
+  contextGroup.spawn([&] {
+    System::Timer(dispatcher).sleep(std::chrono::milliseconds(50));
+    contextGroup.interrupt();
+  });
+
+  auto start = Clock::now();
+  contextGroup.wait();
+  ASSERT_LT(Clock::now() - start, LONG_TIMEOUT / 2);
+  ASSERT_TRUE(interrupted);
+}
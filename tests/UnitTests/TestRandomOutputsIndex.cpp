@@ -0,0 +1,162 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <set>
+
+#include "FortressCore/RandomOutputsIndex.h"
+
+using namespace Fortress;
+
+namespace {
+
+const uint64_t AMOUNT = 100;
+
+// one output of AMOUNT in each of the blocks [0, count)
+void pushOutputs(RandomOutputsIndex& index, uint32_t count) {
+  for (uint32_t block = 0; block < count; ++block) {
+    index.push(AMOUNT, block, false);
+  }
+}
+
+}
+
+TEST(RandomOutputsIndex, matureBoundFollowsChainSize) {
+  RandomOutputsIndex index(10);
+  pushOutputs(index, 20);
+
+  // an output is mature once its block is mature depth blocks below the chain size
+  index.setChainSize(20);
+  ASSERT_EQ(11, index.matureEnd(AMOUNT));
+
+  index.setChainSize(25);
+  ASSERT_EQ(16, index.matureEnd(AMOUNT));
+
+  index.setChainSize(12);
+  ASSERT_EQ(3, index.matureEnd(AMOUNT));
+
+  index.setChainSize(5);
+  ASSERT_EQ(0, index.matureEnd(AMOUNT));
+  ASSERT_EQ(0, index.matureEnd(AMOUNT + 1));
+}
+
+TEST(RandomOutputsIndex, popRemovesNewestOutput) {
+  RandomOutputsIndex index(1);
+  pushOutputs(index, 70);
+  index.push(AMOUNT, 70, true);
+  index.setChainSize(72);
+  ASSERT_EQ(71, index.matureEnd(AMOUNT));
+  ASSERT_TRUE(index.mayBeLocked(AMOUNT, 70));
+
+  index.pop(AMOUNT);
+  ASSERT_EQ(70, index.size(AMOUNT));
+  ASSERT_EQ(70, index.matureEnd(AMOUNT));
+
+  index.push(AMOUNT, 71, false);
+  ASSERT_FALSE(index.mayBeLocked(AMOUNT, 70));
+
+  for (uint32_t i = 0; i < 71; ++i) {
+    index.pop(AMOUNT);
+  }
+
+  ASSERT_EQ(0, index.size(AMOUNT));
+}
+
+TEST(RandomOutputsIndex, sampleOffersDistinctMatureOutputs) {
+  RandomOutputsIndex index(10);
+  pushOutputs(index, 100);
+  index.setChainSize(100);
+
+  std::vector<uint32_t> indexes;
+  ASSERT_EQ(91, index.sample(AMOUNT, 1000, indexes, [](uint32_t) { return true; }));
+  std::set<uint32_t> unique(indexes.begin(), indexes.end());
+  ASSERT_EQ(91, unique.size());
+  ASSERT_EQ(90, *unique.rbegin());
+
+  indexes.clear();
+  ASSERT_EQ(11, index.sample(AMOUNT, 11, indexes, [](uint32_t) { return true; }));
+  ASSERT_EQ(0, index.sample(AMOUNT + 1, 11, indexes, [](uint32_t) { return true; }));
+}
+
+TEST(RandomOutputsIndex, onlyFlaggedOutputsAreChecked) {
+  RandomOutputsIndex index(1);
+  for (uint32_t block = 0; block < 10; ++block) {
+    index.push(AMOUNT, block, block % 2 == 0);
+  }
+
+  index.setChainSize(10);
+
+  std::vector<uint32_t> checked;
+  std::vector<uint32_t> indexes;
+  index.sample(AMOUNT, 10, indexes, [&](uint32_t i) {
+    checked.push_back(i);
+    return false;
+  });
+
+  std::set<uint32_t> offered(indexes.begin(), indexes.end());
+  ASSERT_EQ((std::set<uint32_t>{1, 3, 5, 7, 9}), offered);
+  ASSERT_EQ((std::set<uint32_t>{0, 2, 4, 6, 8}), std::set<uint32_t>(checked.begin(), checked.end()));
+}
+
+TEST(RandomOutputsIndex, matureBoundFollowsReorgsOfAnyDepth) {
+  const uint32_t DEPTH = 10;
+  const uint32_t BLOCK_COUNT = 3 * RandomOutputsIndex::LISTED_MATURE_BLOCKS;
+  RandomOutputsIndex index(DEPTH);
+
+  // the amounts of a block are its index modulo 3 and modulo 5, so every amount is missing from some blocks
+  auto pushBlock = [&](uint32_t block) {
+    index.push(block % 3, block, false);
+    index.push(10 + block % 5, block, false);
+    index.setChainSize(block + 1);
+  };
+
+  auto popBlock = [&](uint32_t block) {
+    index.pop(10 + block % 5);
+    index.pop(block % 3);
+    index.setChainSize(block);
+  };
+
+  auto expectMatureEnds = [&](uint32_t chainSize) {
+    for (uint64_t amount = 0; amount < 15; ++amount) {
+      uint64_t modulo = amount < 10 ? 3 : 5;
+      uint64_t residue = amount < 10 ? amount : amount - 10;
+      if (residue >= modulo) {
+        continue;
+      }
+
+      uint64_t matureBlocks = chainSize >= DEPTH ? chainSize - DEPTH + 1 : 0;
+      uint64_t expected = matureBlocks > residue ? (matureBlocks - residue + modulo - 1) / modulo : 0;
+      ASSERT_EQ(expected, index.matureEnd(amount)) << "amount " << amount << ", chain size " << chainSize;
+    }
+  };
+
+  for (uint32_t block = 0; block < BLOCK_COUNT; ++block) {
+    pushBlock(block);
+    expectMatureEnds(block + 1);
+  }
+
+  // a short reorg stays within the listed blocks, a deep one falls back to all amounts
+  for (uint32_t depth : { 5u, 2 * RandomOutputsIndex::LISTED_MATURE_BLOCKS }) {
+    for (uint32_t block = BLOCK_COUNT; block > BLOCK_COUNT - depth; --block) {
+      popBlock(block - 1);
+      expectMatureEnds(block - 1);
+    }
+
+    for (uint32_t block = BLOCK_COUNT - depth; block < BLOCK_COUNT; ++block) {
+      pushBlock(block);
+      expectMatureEnds(block + 1);
+    }
+  }
+
+  // a rebuild pushes all outputs before the chain size is set
+  index.clear();
+  for (uint32_t block = 0; block < BLOCK_COUNT; ++block) {
+    index.push(block % 3, block, false);
+    index.push(10 + block % 5, block, false);
+  }
+
+  index.setChainSize(BLOCK_COUNT);
+  expectMatureEnds(BLOCK_COUNT);
+}
@@ -0,0 +1,151 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common/RecursiveSharedMutex.h"
+
+using namespace Tools;
+
+TEST(RecursiveSharedMutex, readersEnterConcurrently) {
+  RecursiveSharedMutex mutex;
+  std::atomic<size_t> inside(0);
+  std::promise<void> allInside;
+  std::shared_future<void> allInsideFuture = allInside.get_future().share();
+
+  const size_t readerCount = 4;
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < readerCount; ++i) {
+    readers.emplace_back([&] {
+      SharedLockGuard lock(mutex);
+      if (++inside == readerCount) {
+        allInside.set_value();
+      }
+
+      ASSERT_EQ(std::future_status::ready, allInsideFuture.wait_for(std::chrono::seconds(10)));
+    });
+  }
+
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(readerCount, inside);
+}
+
+TEST(RecursiveSharedMutex, writerExcludesReaders) {
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> readerEntered(false);
+
+  mutex.lock();
+  std::thread reader([&] {
+    SharedLockGuard lock(mutex);
+    readerEntered = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(readerEntered);
+  mutex.unlock();
+
+  reader.join();
+  ASSERT_TRUE(readerEntered);
+}
+
+TEST(RecursiveSharedMutex, readerExcludesWriter) {
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> writerEntered(false);
+
+  mutex.lock_shared();
+  std::thread writer([&] {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    writerEntered = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(writerEntered);
+  mutex.unlock_shared();
+
+  writer.join();
+  ASSERT_TRUE(writerEntered);
+}
+
+TEST(RecursiveSharedMutex, writerCanReenterInBothModes) {
+  RecursiveSharedMutex mutex;
+
+  std::lock_guard<RecursiveSharedMutex> lock(mutex);
+  {
+    std::lock_guard<RecursiveSharedMutex> nestedLock(mutex);
+    SharedLockGuard nestedSharedLock(mutex);
+  }
+
+  std::atomic<bool> readerEntered(false);
+  std::thread reader([&] {
+    SharedLockGuard readerLock(mutex);
+    readerEntered = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_FALSE(readerEntered);
+  mutex.unlock();
+  reader.join();
+  mutex.lock();
+  ASSERT_TRUE(readerEntered);
+}
+
+TEST(RecursiveSharedMutex, readerReentersWhileWriterWaits) {
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> writerEntered(false);
+
+  mutex.lock_shared();
+  std::thread writer([&] {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    writerEntered = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // must not deadlock behind the waiting writer
+  mutex.lock_shared();
+  mutex.unlock_shared();
+  ASSERT_FALSE(writerEntered);
+
+  mutex.unlock_shared();
+  writer.join();
+  ASSERT_TRUE(writerEntered);
+}
+
+TEST(RecursiveSharedMutex, waitingWriterBlocksNewReaders) {
+  RecursiveSharedMutex mutex;
+  std::atomic<bool> writerEntered(false);
+  std::atomic<bool> readerEntered(false);
+
+  mutex.lock_shared();
+  std::thread writer([&] {
+    std::lock_guard<RecursiveSharedMutex> lock(mutex);
+    writerEntered = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_FALSE(readerEntered);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::thread reader([&] {
+    SharedLockGuard lock(mutex);
+    ASSERT_TRUE(writerEntered);
+    readerEntered = true;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  mutex.unlock_shared();
+
+  writer.join();
+  reader.join();
+  ASSERT_TRUE(readerEntered);
+}
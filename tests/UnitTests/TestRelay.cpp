@@ -0,0 +1,323 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <System/Dispatcher.h>
+#include <Logging/ConsoleLogger.h>
+
+#include "FortressCore/Currency.h"
+#include "FortressCore/FortressFormatUtils.h"
+#include "FortressCore/FortressTools.h"
+#include "FortressCore/VerificationContext.h"
+#include "FortressProtocol/FortressProtocolHandler.h"
+#include "P2p/LevinProtocol.h"
+#include "ICoreStub.h"
+
+using namespace Fortress;
+
+namespace {
+
+class P2pEndpointStub : public p2p_endpoint_stub {
+public:
+  virtual bool invoke_notify_to_peer(int command, const BinaryArray& req_buff, const FortressConnectionContext& context) override {
+    notifications.emplace_back(command, req_buff);
+    return true;
+  }
+
+  virtual void for_each_connection(std::function<void(FortressConnectionContext&, PeerIdType)> f) override {
+    for (FortressConnectionContext* context : connections) {
+      f(*context, 0);
+    }
+  }
+
+  std::vector<std::pair<int, BinaryArray>> notifications;
+  std::vector<FortressConnectionContext*> connections;
+};
+
+// counts the transaction blobs handed to the core
+class CoreStub : public ICoreStub {
+public:
+  virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) override {
+    ++incomingTxCount;
+    return ICoreStub::handle_incoming_tx(tx_blob, tvc, keeped_by_block);
+  }
+
+  size_t incomingTxCount = 0;
+};
+
+Transaction createTransaction(uint64_t unlockTime) {
+  Transaction tx;
+  tx.version = CURRENT_TRANSACTION_VERSION;
+  tx.unlockTime = unlockTime;
+
+  KeyOutput output;
+  Crypto::SecretKey secretKey;
+  Crypto::generate_keys(output.key, secretKey);
+  tx.outputs.push_back({ 1000, output });
+  return tx;
+}
+
+Block createBlock(const std::vector<Transaction>& transactions) {
+  Block block;
+  block.majorVersion = BLOCK_MAJOR_VERSION_1;
+  block.minorVersion = 0;
+  block.timestamp = 1451606400;
+  block.nonce = 42;
+  block.previousBlockHash = Crypto::rand<Crypto::Hash>();
+
+  BaseInput input;
+  input.blockIndex = 1;
+  block.baseTransaction = createTransaction(11);
+  block.baseTransaction.inputs.push_back(input);
+  for (const Transaction& tx : transactions) {
+    block.transactionHashes.push_back(getObjectHash(tx));
+  }
+
+  return block;
+}
+
+}
+
+class RelayTest : public testing::Test {
+public:
+  RelayTest() :
+    currency(CurrencyBuilder(logger).currency()),
+    handler(currency, dispatcher, core, &endpoint, logger) {
+    context.version = P2PProtocolVersion::V3;
+    context.m_state = FortressConnectionContext::state_normal;
+    endpoint.connections.push_back(&context);
+  }
+
+  template <typename Command>
+  void notify(typename Command::request& request) {
+    BinaryArray out;
+    bool handled;
+    handler.handleCommand(true, Command::ID, LevinProtocol::encode(request), out, context, handled);
+    ASSERT_TRUE(handled);
+  }
+
+  void addToPool(const Transaction& tx) {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    core.handleIncomingTransaction(tx, getObjectHash(tx), getObjectBinarySize(tx), tvc, false);
+  }
+
+  System::Dispatcher dispatcher;
+  Logging::ConsoleLogger logger;
+  Currency currency;
+  CoreStub core;
+  P2pEndpointStub endpoint;
+  FortressProtocolHandler handler;
+  FortressConnectionContext context;
+};
+
+TEST_F(RelayTest, compactBlockRequestsTransactionsMissingInPool) {
+  std::vector<Transaction> transactions = { createTransaction(1), createTransaction(2), createTransaction(3) };
+  Block block = createBlock(transactions);
+  addToPool(transactions[1]);
+
+  NOTIFY_NEW_COMPACT_BLOCK::request compactBlock;
+  compactBlock.block = Common::asString(toBinaryArray(block));
+  compactBlock.current_blockchain_height = 2;
+  compactBlock.hop = 0;
+  notify<NOTIFY_NEW_COMPACT_BLOCK>(compactBlock);
+
+  ASSERT_EQ(1, endpoint.notifications.size());
+  ASSERT_EQ(static_cast<int>(NOTIFY_REQUEST_BLOCK_TXS::ID), endpoint.notifications[0].first);
+
+  NOTIFY_REQUEST_BLOCK_TXS::request request;
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[0].second, request));
+  ASSERT_EQ(get_block_hash(block), request.blockId);
+  ASSERT_EQ(std::vector<uint32_t>({ 0, 2 }), request.txIndices);
+  ASSERT_EQ(FortressConnectionContext::state_normal, context.m_state);
+}
+
+TEST_F(RelayTest, sendsRequestedBlockTransactions) {
+  std::vector<Transaction> transactions = { createTransaction(1), createTransaction(2), createTransaction(3) };
+  Block block = createBlock(transactions);
+  core.addBlock(block);
+  for (const Transaction& tx : transactions) {
+    core.addTransaction(tx);
+  }
+
+  NOTIFY_REQUEST_BLOCK_TXS::request request;
+  request.blockId = get_block_hash(block);
+  request.txIndices = { 0, 2 };
+  notify<NOTIFY_REQUEST_BLOCK_TXS>(request);
+
+  ASSERT_EQ(1, endpoint.notifications.size());
+  ASSERT_EQ(static_cast<int>(NOTIFY_NEW_COMPACT_BLOCK::ID), endpoint.notifications[0].first);
+
+  NOTIFY_NEW_COMPACT_BLOCK::request compactBlock;
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[0].second, compactBlock));
+  ASSERT_EQ(toBinaryArray(block), Common::asBinaryArray(compactBlock.block));
+  ASSERT_EQ(2, compactBlock.txs.size());
+  ASSERT_EQ(toBinaryArray(transactions[0]), Common::asBinaryArray(compactBlock.txs[0]));
+  ASSERT_EQ(toBinaryArray(transactions[2]), Common::asBinaryArray(compactBlock.txs[1]));
+}
+
+TEST_F(RelayTest, dropsPeerRequestingTransactionOutOfBlock) {
+  Block block = createBlock({ createTransaction(1) });
+  core.addBlock(block);
+
+  NOTIFY_REQUEST_BLOCK_TXS::request request;
+  request.blockId = get_block_hash(block);
+  request.txIndices = { 1 };
+  notify<NOTIFY_REQUEST_BLOCK_TXS>(request);
+
+  ASSERT_TRUE(endpoint.notifications.empty());
+  ASSERT_EQ(FortressConnectionContext::state_shutdown, context.m_state);
+}
+
+TEST_F(RelayTest, dropsPeerRequestingTransactionRepeatedly) {
+  std::vector<Transaction> transactions = { createTransaction(1), createTransaction(2) };
+  Block block = createBlock(transactions);
+  core.addBlock(block);
+  for (const Transaction& tx : transactions) {
+    core.addTransaction(tx);
+  }
+
+  NOTIFY_REQUEST_BLOCK_TXS::request request;
+  request.blockId = get_block_hash(block);
+  request.txIndices = { 0, 0 };
+  notify<NOTIFY_REQUEST_BLOCK_TXS>(request);
+
+  ASSERT_TRUE(endpoint.notifications.empty());
+  ASSERT_EQ(FortressConnectionContext::state_shutdown, context.m_state);
+
+  context.m_state = FortressConnectionContext::state_normal;
+  request.txIndices = { 1, 0 };
+  notify<NOTIFY_REQUEST_BLOCK_TXS>(request);
+
+  ASSERT_TRUE(endpoint.notifications.empty());
+  ASSERT_EQ(FortressConnectionContext::state_shutdown, context.m_state);
+}
+
+TEST_F(RelayTest, requestsOnlyUnknownTransactionsNotRequestedYet) {
+  std::vector<Transaction> transactions = { createTransaction(1), createTransaction(2), createTransaction(3) };
+  addToPool(transactions[0]);
+
+  FortressConnectionContext otherContext = context;
+  otherContext.m_connection_id = Crypto::rand<boost::uuids::uuid>();
+
+  NOTIFY_TX_INVENTORY::request inventory;
+  inventory.txs = { getObjectHash(transactions[0]), getObjectHash(transactions[1]) };
+  notify<NOTIFY_TX_INVENTORY>(inventory);
+
+  inventory.txs = { getObjectHash(transactions[1]), getObjectHash(transactions[2]) };
+  std::swap(context, otherContext);
+  notify<NOTIFY_TX_INVENTORY>(inventory);
+
+  ASSERT_EQ(2, endpoint.notifications.size());
+  ASSERT_EQ(static_cast<int>(NOTIFY_REQUEST_TXS::ID), endpoint.notifications[0].first);
+
+  NOTIFY_REQUEST_TXS::request request;
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[0].second, request));
+  ASSERT_EQ(std::vector<Crypto::Hash>({ getObjectHash(transactions[1]) }), request.txs);
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[1].second, request));
+  ASSERT_EQ(std::vector<Crypto::Hash>({ getObjectHash(transactions[2]) }), request.txs);
+}
+
+TEST_F(RelayTest, requestsTransactionFromOtherAnnouncerOnIdle) {
+  Transaction tx = createTransaction(1);
+  FortressConnectionContext otherContext = context;
+  otherContext.m_connection_id = Crypto::rand<boost::uuids::uuid>();
+  endpoint.connections.push_back(&otherContext);
+
+  // the other peer has reached the rate limit and is asked when it is reset
+  otherContext.m_txsFetchedCount = P2P_TX_RELAY_MAX_RATE;
+  NOTIFY_TX_INVENTORY::request inventory;
+  inventory.txs = { getObjectHash(tx) };
+  std::swap(context, otherContext);
+  notify<NOTIFY_TX_INVENTORY>(inventory);
+  std::swap(context, otherContext);
+  ASSERT_TRUE(endpoint.notifications.empty());
+
+  context.m_txsFetchedCount = P2P_TX_RELAY_MAX_RATE;
+  handler.on_idle();
+
+  ASSERT_EQ(1, endpoint.notifications.size());
+  NOTIFY_REQUEST_TXS::request request;
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[0].second, request));
+  ASSERT_EQ(inventory.txs, request.txs);
+  ASSERT_EQ(1, otherContext.m_txsFetchedCount);
+  ASSERT_EQ(0, context.m_txsFetchedCount);
+}
+
+TEST_F(RelayTest, ignoresUnaskedTransactionsBeyondRateLimit) {
+  context.m_txsFetchedCount = P2P_TX_RELAY_MAX_RATE - 1;
+  NOTIFY_NEW_TRANSACTIONS::request notification;
+  notification.txs = { Common::asString(toBinaryArray(createTransaction(1))), Common::asString(toBinaryArray(createTransaction(2))) };
+  notify<NOTIFY_NEW_TRANSACTIONS>(notification);
+
+  ASSERT_EQ(1, core.incomingTxCount);
+  ASSERT_EQ(P2P_TX_RELAY_MAX_RATE, context.m_txsFetchedCount);
+}
+
+TEST_F(RelayTest, acceptsRequestedTransactionsBeyondRateLimit) {
+  Transaction tx = createTransaction(1);
+  NOTIFY_TX_INVENTORY::request inventory;
+  inventory.txs = { getObjectHash(tx) };
+  notify<NOTIFY_TX_INVENTORY>(inventory);
+  ASSERT_EQ(1, endpoint.notifications.size());
+
+  context.m_txsFetchedCount = P2P_TX_RELAY_MAX_RATE;
+  NOTIFY_NEW_TRANSACTIONS::request notification;
+  notification.txs = { Common::asString(toBinaryArray(tx)) };
+  notify<NOTIFY_NEW_TRANSACTIONS>(notification);
+
+  ASSERT_EQ(1, core.incomingTxCount);
+}
+
+TEST_F(RelayTest, servesRequestedTransactionsWithinRateLimit) {
+  std::vector<Transaction> transactions = { createTransaction(1), createTransaction(2) };
+  for (const Transaction& tx : transactions) {
+    core.addTransaction(tx);
+  }
+
+  context.m_txsServedCount = P2P_TX_RELAY_MAX_RATE - 1;
+  NOTIFY_REQUEST_TXS::request request;
+  request.txs = { getObjectHash(transactions[1]), getObjectHash(transactions[0]) };
+  notify<NOTIFY_REQUEST_TXS>(request);
+
+  ASSERT_EQ(1, endpoint.notifications.size());
+  ASSERT_EQ(static_cast<int>(NOTIFY_NEW_TRANSACTIONS::ID), endpoint.notifications[0].first);
+
+  NOTIFY_NEW_TRANSACTIONS::request rsp;
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[0].second, rsp));
+  ASSERT_EQ(1, rsp.txs.size());
+  ASSERT_EQ(toBinaryArray(transactions[1]), Common::asBinaryArray(rsp.txs[0]));
+  ASSERT_EQ(P2P_TX_RELAY_MAX_RATE, context.m_txsServedCount);
+}
+
+TEST_F(RelayTest, dropsPeerAnnouncingTooManyTransactions) {
+  NOTIFY_TX_INVENTORY::request inventory;
+  inventory.txs.resize(P2P_TX_INVENTORY_MAX_COUNT + 1);
+  notify<NOTIFY_TX_INVENTORY>(inventory);
+
+  ASSERT_TRUE(endpoint.notifications.empty());
+  ASSERT_EQ(FortressConnectionContext::state_shutdown, context.m_state);
+}
+
+TEST_F(RelayTest, announcesPoolTransactionsOnIdle) {
+  Transaction knownTx = createTransaction(1);
+  Transaction unknownTx = createTransaction(2);
+  addToPool(knownTx);
+  addToPool(unknownTx);
+
+  NOTIFY_REQUEST_TX_POOL::request poolRequest;
+  poolRequest.txs = { getObjectHash(knownTx) };
+  notify<NOTIFY_REQUEST_TX_POOL>(poolRequest);
+  ASSERT_TRUE(endpoint.notifications.empty());
+
+  handler.on_idle();
+  handler.on_idle();
+
+  ASSERT_EQ(1, endpoint.notifications.size());
+  ASSERT_EQ(static_cast<int>(NOTIFY_TX_INVENTORY::ID), endpoint.notifications[0].first);
+
+  NOTIFY_TX_INVENTORY::request inventory;
+  ASSERT_TRUE(LevinProtocol::decode(endpoint.notifications[0].second, inventory));
+  ASSERT_EQ(std::vector<Crypto::Hash>({ getObjectHash(unknownTx) }), inventory.txs);
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <utility>
+#include <vector>
+
+#include "FortressProtocol/TransactionRequestScheduler.h"
+#include "crypto/crypto.h"
+
+using namespace Fortress;
+
+namespace {
+
+typedef TransactionRequestScheduler::Clock Clock;
+typedef std::vector<std::pair<net_connection_id, Crypto::Hash>> Requests;
+
+const size_t MAX_COUNT = 3;
+const Clock::duration TIMEOUT = std::chrono::seconds(10);
+
+}
+
+class TransactionRequestSchedulerTest : public testing::Test {
+public:
+  TransactionRequestSchedulerTest() :
+    scheduler(MAX_COUNT, TIMEOUT),
+    firstConnection(Crypto::rand<net_connection_id>()),
+    secondConnection(Crypto::rand<net_connection_id>()),
+    txHash(Crypto::rand<Crypto::Hash>()),
+    now(Clock::now()) {
+  }
+
+  Requests requestTransactions(Clock::time_point time, const net_connection_id* busyConnection = nullptr) {
+    Requests requests;
+    scheduler.requestTransactions(time, [](const Crypto::Hash&) {
+      return false;
+    }, [&](const net_connection_id& connectionId, const Crypto::Hash& hash) {
+      if (busyConnection != nullptr && connectionId == *busyConnection) {
+        return false;
+      }
+
+      requests.emplace_back(connectionId, hash);
+      return true;
+    });
+
+    return requests;
+  }
+
+  TransactionRequestScheduler scheduler;
+  net_connection_id firstConnection;
+  net_connection_id secondConnection;
+  Crypto::Hash txHash;
+  Clock::time_point now;
+};
+
+TEST_F(TransactionRequestSchedulerTest, asksTransactionFromFirstAnnouncerOnly) {
+  ASSERT_TRUE(scheduler.addAnnouncement(txHash, firstConnection, true, now));
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, secondConnection, true, now));
+  ASSERT_TRUE(requestTransactions(now + TIMEOUT / 2).empty());
+  ASSERT_EQ(1, scheduler.size());
+}
+
+TEST_F(TransactionRequestSchedulerTest, asksNextAnnouncerWhenRequestTimesOut) {
+  ASSERT_TRUE(scheduler.addAnnouncement(txHash, firstConnection, true, now));
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, secondConnection, true, now));
+
+  ASSERT_EQ(Requests({ { secondConnection, txHash } }), requestTransactions(now + TIMEOUT));
+  ASSERT_TRUE(requestTransactions(now + TIMEOUT + TIMEOUT / 2).empty());
+
+  // no announcer is left after the second one times out too
+  ASSERT_TRUE(requestTransactions(now + 2 * TIMEOUT).empty());
+  ASSERT_EQ(0, scheduler.size());
+}
+
+TEST_F(TransactionRequestSchedulerTest, asksTransactionLaterWhenAnnouncerIsRateLimited) {
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, firstConnection, false, now));
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, secondConnection, true, now));
+
+  ASSERT_EQ(Requests({ { secondConnection, txHash } }), requestTransactions(now, &firstConnection));
+  ASSERT_EQ(Requests({ { firstConnection, txHash } }), requestTransactions(now + TIMEOUT));
+}
+
+TEST_F(TransactionRequestSchedulerTest, asksNextAnnouncerWhenConnectionIsReleased) {
+  ASSERT_TRUE(scheduler.addAnnouncement(txHash, firstConnection, true, now));
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, secondConnection, true, now));
+
+  scheduler.releaseConnection(firstConnection);
+  ASSERT_EQ(Requests({ { secondConnection, txHash } }), requestTransactions(now));
+}
+
+TEST_F(TransactionRequestSchedulerTest, forgetsReceivedTransactions) {
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, firstConnection, false, now));
+  ASSERT_TRUE(scheduler.remove(txHash));
+  ASSERT_FALSE(scheduler.remove(txHash));
+
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, firstConnection, false, now));
+  scheduler.requestTransactions(now, [](const Crypto::Hash&) { return true; }, [](const net_connection_id&, const Crypto::Hash&) {
+    return true;
+  });
+
+  ASSERT_EQ(0, scheduler.size());
+}
+
+TEST_F(TransactionRequestSchedulerTest, keepsAtMostMaxCountTransactions) {
+  for (size_t i = 0; i < MAX_COUNT; ++i) {
+    ASSERT_TRUE(scheduler.addAnnouncement(Crypto::rand<Crypto::Hash>(), firstConnection, true, now));
+  }
+
+  ASSERT_FALSE(scheduler.addAnnouncement(txHash, firstConnection, true, now));
+  ASSERT_EQ(MAX_COUNT, scheduler.size());
+}
@@ -551,6 +551,57 @@ TEST_F(TransfersConsumerTest, onNewBlocks_getTransactionOutsGlobalIndicesIsPrope
   ASSERT_EQ(expectedHash, node.hash);
 }
 
+TEST_F(TransfersConsumerTest, onNewBlocks_getTransactionsOutsGlobalIndicesIsCalledOncePerBatch) {
+  class INodeGlobalIndicesStub: public INodeDummyStub {
+  public:
+    INodeGlobalIndicesStub() : calls(0) {};
+
+    virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+      std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override {
+      ++calls;
+      hashes = transactionHashes;
+      outsGlobalIndices.assign(transactionHashes.size(), std::vector<uint32_t>{ 3, 4 });
+      callback(std::error_code());
+    };
+
+    size_t calls;
+    std::vector<Crypto::Hash> hashes;
+  };
+
+  INodeGlobalIndicesStub node;
+  TransfersConsumer consumer(m_currency, node, m_accountKeys.viewSecretKey);
+
+  AccountSubscription subscription = getAccountSubscription(m_accountKeys);
+  subscription.syncStart.height = 0;
+  subscription.syncStart.timestamp = 0;
+  consumer.addSubscription(subscription);
+
+  // no inputs, unsigned transactions with inputs can't be serialized and all get the same hash
+  std::shared_ptr<ITransaction> tx1(createTransaction());
+  addTestKeyOutput(*tx1, 900, 2, m_accountKeys);
+
+  std::shared_ptr<ITransaction> tx2(createTransaction());
+  addTestKeyOutput(*tx2, 800, 2, m_accountKeys);
+
+  std::shared_ptr<ITransaction> foreignTx(createTransaction());
+  addTestKeyOutput(*foreignTx, 700, 2, generateAccountKeys());
+
+  CompleteBlock blocks[2];
+  blocks[0].block = Fortress::Block();
+  blocks[0].block->timestamp = 0;
+  blocks[0].transactions.push_back(tx1);
+  blocks[0].transactions.push_back(foreignTx);
+  blocks[1].block = Fortress::Block();
+  blocks[1].block->timestamp = 0;
+  blocks[1].transactions.push_back(tx2);
+
+  ASSERT_TRUE(consumer.onNewBlocks(blocks, 1, 2));
+  ASSERT_EQ(1, node.calls);
+  ASSERT_EQ(2, node.hashes.size());
+  ASSERT_EQ(tx1->getTransactionHash(), node.hashes[0]);
+  ASSERT_EQ(tx2->getTransactionHash(), node.hashes[1]);
+}
+
 TEST_F(TransfersConsumerTest, onNewBlocks_getTransactionOutsGlobalIndicesIsNotCalled) {
   class INodeGlobalIndicesStub: public INodeDummyStub {
   public:
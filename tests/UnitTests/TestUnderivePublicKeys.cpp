@@ -0,0 +1,92 @@
+// Copyright (c) 2011-2016 The Fortress developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+
+#include "crypto/crypto.h"
+
+using namespace Crypto;
+
+namespace {
+
+KeyDerivation generateDerivation() {
+  PublicKey txPublicKey;
+  SecretKey txSecretKey;
+  PublicKey viewPublicKey;
+  SecretKey viewSecretKey;
+  generate_keys(txPublicKey, txSecretKey);
+  generate_keys(viewPublicKey, viewSecretKey);
+
+  KeyDerivation derivation;
+  generate_key_derivation(txPublicKey, viewSecretKey, derivation);
+  return derivation;
+}
+
+PublicKey generateInvalidKey() {
+  PublicKey key;
+  do {
+    key = rand<PublicKey>();
+  } while (check_key(key));
+
+  return key;
+}
+
+}
+
+TEST(underive_public_keys, matchesUnderivePublicKey) {
+  KeyDerivation derivation = generateDerivation();
+  std::vector<PublicKey> keys;
+  std::vector<size_t> indexes;
+  for (size_t i = 0; i < 20; ++i) {
+    PublicKey key;
+    SecretKey secretKey;
+    generate_keys(key, secretKey);
+    keys.push_back(key);
+    indexes.push_back(i % 3 == 0 ? i * 1000 : i);
+  }
+
+  keys[5] = generateInvalidKey();
+
+  std::vector<PublicKey> bases(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  underive_public_keys(derivation, indexes.data(), keys.data(), keys.size(), bases.data(), valid.get());
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    PublicKey expected;
+    ASSERT_EQ(underive_public_key(derivation, indexes[i], keys[i], expected), valid[i]);
+    if (valid[i]) {
+      ASSERT_EQ(expected, bases[i]);
+    }
+  }
+
+  ASSERT_FALSE(valid[5]);
+}
+
+TEST(underive_public_keys, findsDerivedSpendKey) {
+  KeyDerivation derivation = generateDerivation();
+  PublicKey spendPublicKey;
+  SecretKey spendSecretKey;
+  generate_keys(spendPublicKey, spendSecretKey);
+
+  PublicKey keys[2];
+  size_t indexes[2] = { 0, 1 };
+  ASSERT_TRUE(derive_public_key(derivation, 0, spendPublicKey, keys[0]));
+  ASSERT_TRUE(derive_public_key(derivation, 1, spendPublicKey, keys[1]));
+
+  PublicKey bases[2];
+  bool valid[2];
+  underive_public_keys(derivation, indexes, keys, 2, bases, valid);
+  ASSERT_TRUE(valid[0]);
+  ASSERT_TRUE(valid[1]);
+  ASSERT_EQ(spendPublicKey, bases[0]);
+  ASSERT_EQ(spendPublicKey, bases[1]);
+}
+
+TEST(underive_public_keys, emptyBatch) {
+  KeyDerivation derivation = generateDerivation();
+  underive_public_keys(derivation, nullptr, nullptr, 0, nullptr, nullptr);
+}
@@ -24,11 +24,11 @@ using namespace Fortress;
 using namespace Fortress;
 
 class TransactionValidator : public Fortress::ITransactionValidator {
-  virtual bool checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock) override {
+  virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock) override {
     return true;
   }
 
-  virtual bool checkTransactionInputs(const Fortress::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
+  virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
     return true;
   }
 
@@ -41,6 +41,26 @@ class TransactionValidator : public Fortress::ITransactionValidator {
   }
 };
 
+class CountingTransactionValidator : public TransactionValidator {
+public:
+  CountingTransactionValidator() : inputChecks(0), spentKeyImageChecks(0), spentKeyImages(false) {
+  }
+
+  virtual bool checkTransactionInputs(const Fortress::CachedTransaction& transaction, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override {
+    ++inputChecks;
+    return true;
+  }
+
+  virtual bool haveSpentKeyImages(const Fortress::Transaction& tx) override {
+    ++spentKeyImageChecks;
+    return spentKeyImages;
+  }
+
+  size_t inputChecks;
+  size_t spentKeyImageChecks;
+  bool spentKeyImages;
+};
+
 class FakeTimeProvider : public ITimeProvider {
 public:
   FakeTimeProvider(time_t currentTime = time(nullptr))
@@ -372,6 +392,56 @@ TEST_F(tx_pool, fillblock_same_size)
 }
 
 
+TEST_F(tx_pool, fillblock_reuses_ready_checks)
+{
+  TestPool<CountingTransactionValidator, RealTimeProvider> pool(currency, logger);
+
+  const size_t totalTransactions = 10;
+  for (size_t i = 0; i < totalTransactions; ++i) {
+    Transaction tx;
+    GenerateTransaction(currency, tx, currency.minimumFee(), 1);
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    ASSERT_TRUE(pool.add_tx(tx, tvc, false));
+  }
+
+  Block bl;
+  InitBlock(bl);
+  size_t totalSize = 0;
+  uint64_t txFee = 0;
+  uint64_t median = 5000;
+
+  ASSERT_TRUE(pool.fill_block_template(bl, median, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(totalTransactions, bl.transactionHashes.size());
+  ASSERT_EQ(totalTransactions, pool.validator.inputChecks);
+
+  // same pool and chain top, the template is served from the cache
+  ASSERT_TRUE(pool.fill_block_template(bl, median, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(totalTransactions, bl.transactionHashes.size());
+  ASSERT_EQ(totalTransactions, pool.validator.inputChecks);
+
+  // a new block keeps ready transactions ready unless their key images got spent
+  size_t keyImageChecks = pool.validator.spentKeyImageChecks;
+  Crypto::Hash topBlockId = Crypto::rand<Crypto::Hash>();
+  ASSERT_TRUE(pool.on_blockchain_inc(1, topBlockId));
+  ASSERT_EQ(keyImageChecks + totalTransactions, pool.validator.spentKeyImageChecks);
+  ASSERT_TRUE(pool.fill_block_template(bl, median, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(totalTransactions, bl.transactionHashes.size());
+  ASSERT_EQ(totalTransactions, pool.validator.inputChecks);
+
+  pool.validator.spentKeyImages = true;
+  ASSERT_TRUE(pool.on_blockchain_inc(2, Crypto::rand<Crypto::Hash>()));
+  ASSERT_TRUE(pool.fill_block_template(bl, median, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_TRUE(bl.transactionHashes.empty());
+  ASSERT_EQ(2 * totalTransactions, pool.validator.inputChecks);
+
+  // popping a block drops all cached results
+  pool.validator.spentKeyImages = false;
+  ASSERT_TRUE(pool.on_blockchain_dec(1, topBlockId));
+  ASSERT_TRUE(pool.fill_block_template(bl, median, textMaxCumulativeSize, 0, totalSize, txFee));
+  ASSERT_EQ(totalTransactions, bl.transactionHashes.size());
+  ASSERT_EQ(3 * totalTransactions, pool.validator.inputChecks);
+}
+
 TEST_F(tx_pool, cleanup_stale_tx)
 {
   TestPool<TransactionValidator, FakeTimeProvider> pool(currency, logger);